@@ -201,6 +201,128 @@ inline bool annexb_to_nalus(uint8_t* data, size_t len, std::vector<std::shared_p
     return true;
 }
 
+//a piece of the es data, it points to the memory of others without copying
+class es_slice
+{
+public:
+    es_slice(const uint8_t* slice_data = nullptr, size_t slice_len = 0):data(slice_data), len(slice_len)
+    {
+    }
+
+public:
+    const uint8_t* data;
+    size_t len;
+};
+
+//split avcc(4 bytes length + nalu) into the nalus without the length, no data is copied
+inline bool avcc_to_nalus(const uint8_t* data, size_t len, std::vector<es_slice>& nalus) {
+    const uint8_t* p = data;
+    size_t remain = len;
+
+    while (remain > 0) {
+        if (remain < 4) {
+            return false;
+        }
+        uint32_t nalu_len = read_4bytes(p);
+        p += 4;
+        remain -= 4;
+        if ((nalu_len == 0) || (nalu_len > remain)) {
+            log_errorf("avcc nalu len is wrong, nalu len:%u, remain:%lu", nalu_len, remain);
+            return false;
+        }
+        nalus.emplace_back(p, nalu_len);
+        p += nalu_len;
+        remain -= nalu_len;
+    }
+    return !nalus.empty();
+}
+
+inline size_t es_slices_size(const std::vector<es_slice>& slices) {
+    size_t total = 0;
+    for (const es_slice& slice : slices) {
+        total += slice.len;
+    }
+    return total;
+}
+
+//write the slices into the buffer in one pass, the space is reserved once by the exact size
+inline void es_slices_write(const std::vector<es_slice>& slices, data_buffer& buffer) {
+    uint8_t* p = (uint8_t*)buffer.append_space(es_slices_size(slices));
+    for (const es_slice& slice : slices) {
+        memcpy(p, slice.data, slice.len);
+        p += slice.len;
+    }
+}
+
+//split annexb(3 or 4 bytes start code) into the nalus without the start code, no data is copied
+inline bool annexb_split_nalus(const uint8_t* data, size_t len, std::vector<es_slice>& nalus) {
+    size_t pos = 0;
+    size_t nalu_start = 0;
+    bool found = false;
+
+    while (pos + 3 <= len) {
+        if ((data[pos] != 0x00) || (data[pos + 1] != 0x00) || (data[pos + 2] != 0x01)) {
+            pos++;
+            continue;
+        }
+        if (found) {
+            size_t nalu_end = pos;
+            if ((nalu_end > nalu_start) && (data[nalu_end - 1] == 0x00)) {
+                nalu_end--;//4 bytes start code
+            }
+            if (nalu_end > nalu_start) {
+                nalus.emplace_back(data + nalu_start, nalu_end - nalu_start);
+            }
+        }
+        found = true;
+        pos += 3;
+        nalu_start = pos;
+    }
+    if (found && (len > nalu_start)) {
+        nalus.emplace_back(data + nalu_start, len - nalu_start);
+    }
+    return !nalus.empty();
+}
+
+//write the nalus as avcc(4 bytes length + nalu), the space is reserved once
+inline void nalus_to_avcc(const std::vector<es_slice>& nalus, data_buffer& buffer) {
+    size_t total = 0;
+    for (const es_slice& nalu : nalus) {
+        total += 4 + nalu.len;
+    }
+    uint8_t* p = (uint8_t*)buffer.append_space(total);
+    for (const es_slice& nalu : nalus) {
+        write_4bytes(p, (uint32_t)nalu.len);
+        memcpy(p + 4, nalu.data, nalu.len);
+        p += 4 + nalu.len;
+    }
+}
+
+//make the AVCDecoderConfigurationRecord(avcC) by the sps and pps without start code
+inline bool make_avcc_record(const uint8_t* sps, size_t sps_len,
+                        const uint8_t* pps, size_t pps_len, data_buffer& buffer) {
+    if ((sps_len < 4) || (pps_len == 0) || (sps_len > 0xffff) || (pps_len > 0xffff)) {
+        return false;
+    }
+    uint8_t* p = (uint8_t*)buffer.append_space(11 + sps_len + pps_len);
+
+    *p++ = 0x01;//configurationVersion
+    *p++ = sps[1];//AVCProfileIndication
+    *p++ = sps[2];//profile_compatibility
+    *p++ = sps[3];//AVCLevelIndication
+    *p++ = 0xff;//lengthSizeMinusOne: 3
+    *p++ = 0xe1;//numOfSequenceParameterSets: 1
+    write_2bytes(p, (uint16_t)sps_len);
+    p += 2;
+    memcpy(p, sps, sps_len);
+    p += sps_len;
+    *p++ = 0x01;//numOfPictureParameterSets
+    write_2bytes(p, (uint16_t)pps_len);
+    p += 2;
+    memcpy(p, pps, pps_len);
+    return true;
+}
+
 inline int get_sps_pps_from_extradata(uint8_t *pps, size_t& pps_len, 
                                 uint8_t *sps, size_t& sps_len, 
                                 const uint8_t *extra_data, size_t extra_len)
@@ -380,4 +502,194 @@ inline int get_hevc_dec_info_from_extradata(HEVC_DEC_CONF_RECORD* hevc_dec_info,
     return 0;
 }
 
+//bit reader over the rbsp of a nalu, the emulation prevention bytes are removed
+class nalu_bits_reader
+{
+public:
+    nalu_bits_reader(const uint8_t* data, size_t len) {
+        rbsp_.reserve(len);
+        for (size_t i = 0; i < len; i++) {
+            if ((i >= 2) && (data[i] == 0x03) && (data[i-1] == 0x00) && (data[i-2] == 0x00)) {
+                continue;
+            }
+            rbsp_.push_back(data[i]);
+        }
+    }
+
+    bool is_error() { return error_; }
+
+    uint32_t read_bits(int count) {
+        uint32_t value = 0;
+        for (int i = 0; i < count; i++) {
+            if (pos_ >= rbsp_.size() * 8) {
+                error_ = true;
+                return 0;
+            }
+            value = (value << 1) | ((rbsp_[pos_ / 8] >> (7 - (pos_ % 8))) & 0x01);
+            pos_++;
+        }
+        return value;
+    }
+
+    void skip_bits(size_t count) { pos_ += count; }
+
+    uint32_t read_ue() {
+        int zeros = 0;
+        while ((read_bits(1) == 0) && !error_ && (zeros < 32)) {
+            zeros++;
+        }
+        if (zeros == 0) {
+            return 0;
+        }
+        return ((1u << zeros) - 1) + read_bits(zeros);
+    }
+
+    int32_t read_se() {
+        uint32_t value = read_ue();
+        return (value & 0x01) ? (int32_t)((value + 1) / 2) : -(int32_t)(value / 2);
+    }
+
+private:
+    std::vector<uint8_t> rbsp_;
+    size_t pos_ = 0;
+    bool error_ = false;
+};
+
+//get the picture size from h264 sps(with the nalu header, without the start code)
+inline bool get_h264_sps_size(const uint8_t* sps, size_t sps_len, int& width, int& height) {
+    if (sps_len < 4) {
+        return false;
+    }
+    nalu_bits_reader reader(sps + 1, sps_len - 1);
+    uint32_t chroma_format_idc = 1;
+
+    uint32_t profile_idc = reader.read_bits(8);
+    reader.skip_bits(16);//constraint flags, level_idc
+    reader.read_ue();//seq_parameter_set_id
+    if ((profile_idc == 100) || (profile_idc == 110) || (profile_idc == 122) || (profile_idc == 244) ||
+        (profile_idc == 44) || (profile_idc == 83) || (profile_idc == 86) || (profile_idc == 118) ||
+        (profile_idc == 128) || (profile_idc == 138) || (profile_idc == 139) || (profile_idc == 134) ||
+        (profile_idc == 135)) {
+        chroma_format_idc = reader.read_ue();
+        if (chroma_format_idc == 3) {
+            reader.skip_bits(1);//separate_colour_plane_flag
+        }
+        reader.read_ue();//bit_depth_luma_minus8
+        reader.read_ue();//bit_depth_chroma_minus8
+        reader.skip_bits(1);//qpprime_y_zero_transform_bypass_flag
+        if (reader.read_bits(1)) {//seq_scaling_matrix_present_flag
+            int count = (chroma_format_idc != 3) ? 8 : 12;
+            for (int i = 0; i < count; i++) {
+                if (!reader.read_bits(1)) {
+                    continue;
+                }
+                int size = (i < 6) ? 16 : 64;
+                int last_scale = 8;
+                int next_scale = 8;
+                for (int j = 0; j < size; j++) {
+                    if (next_scale != 0) {
+                        next_scale = (last_scale + reader.read_se() + 256) % 256;
+                    }
+                    last_scale = (next_scale == 0) ? last_scale : next_scale;
+                }
+            }
+        }
+    }
+    reader.read_ue();//log2_max_frame_num_minus4
+    uint32_t poc_type = reader.read_ue();
+    if (poc_type == 0) {
+        reader.read_ue();//log2_max_pic_order_cnt_lsb_minus4
+    } else if (poc_type == 1) {
+        reader.skip_bits(1);//delta_pic_order_always_zero_flag
+        reader.read_se();//offset_for_non_ref_pic
+        reader.read_se();//offset_for_top_to_bottom_field
+        uint32_t cycle_count = reader.read_ue();
+        for (uint32_t i = 0; (i < cycle_count) && !reader.is_error(); i++) {
+            reader.read_se();
+        }
+    }
+    reader.read_ue();//max_num_ref_frames
+    reader.skip_bits(1);//gaps_in_frame_num_value_allowed_flag
+    uint32_t width_in_mbs  = reader.read_ue() + 1;
+    uint32_t height_in_map = reader.read_ue() + 1;
+    uint32_t frame_mbs_only_flag = reader.read_bits(1);
+    if (!frame_mbs_only_flag) {
+        reader.skip_bits(1);//mb_adaptive_frame_field_flag
+    }
+    reader.skip_bits(1);//direct_8x8_inference_flag
+
+    uint32_t crop_left = 0, crop_right = 0, crop_top = 0, crop_bottom = 0;
+    if (reader.read_bits(1)) {//frame_cropping_flag
+        crop_left   = reader.read_ue();
+        crop_right  = reader.read_ue();
+        crop_top    = reader.read_ue();
+        crop_bottom = reader.read_ue();
+    }
+    if (reader.is_error()) {
+        return false;
+    }
+    uint32_t crop_unit_x = (chroma_format_idc == 0) ? 1 : ((chroma_format_idc == 3) ? 1 : 2);
+    uint32_t crop_unit_y = ((chroma_format_idc == 1) ? 2 : 1) * (2 - frame_mbs_only_flag);
+
+    width  = (int)(width_in_mbs * 16 - crop_unit_x * (crop_left + crop_right));
+    height = (int)((2 - frame_mbs_only_flag) * height_in_map * 16 - crop_unit_y * (crop_top + crop_bottom));
+    return (width > 0) && (height > 0);
+}
+
+//get the picture size from h265 sps(with the nalu header, without the start code)
+inline bool get_h265_sps_size(const uint8_t* sps, size_t sps_len, int& width, int& height) {
+    if (sps_len < 16) {
+        return false;
+    }
+    nalu_bits_reader reader(sps + 2, sps_len - 2);
+
+    reader.skip_bits(4);//sps_video_parameter_set_id
+    uint32_t max_sub_layers_minus1 = reader.read_bits(3);
+    reader.skip_bits(1);//sps_temporal_id_nesting_flag
+
+    //profile_tier_level: general profile(88 bits) and general_level_idc(8 bits)
+    reader.skip_bits(96);
+    bool profile_present[8] = {false};
+    bool level_present[8]   = {false};
+    for (uint32_t i = 0; i < max_sub_layers_minus1; i++) {
+        profile_present[i] = reader.read_bits(1) != 0;
+        level_present[i]   = reader.read_bits(1) != 0;
+    }
+    if (max_sub_layers_minus1 > 0) {
+        reader.skip_bits(2 * (8 - max_sub_layers_minus1));
+    }
+    for (uint32_t i = 0; i < max_sub_layers_minus1; i++) {
+        if (profile_present[i]) {
+            reader.skip_bits(88);
+        }
+        if (level_present[i]) {
+            reader.skip_bits(8);
+        }
+    }
+
+    reader.read_ue();//sps_seq_parameter_set_id
+    uint32_t chroma_format_idc = reader.read_ue();
+    if (chroma_format_idc == 3) {
+        reader.skip_bits(1);//separate_colour_plane_flag
+    }
+    uint32_t pic_width  = reader.read_ue();
+    uint32_t pic_height = reader.read_ue();
+    uint32_t conf_left = 0, conf_right = 0, conf_top = 0, conf_bottom = 0;
+    if (reader.read_bits(1)) {//conformance_window_flag
+        conf_left   = reader.read_ue();
+        conf_right  = reader.read_ue();
+        conf_top    = reader.read_ue();
+        conf_bottom = reader.read_ue();
+    }
+    if (reader.is_error()) {
+        return false;
+    }
+    uint32_t sub_width  = ((chroma_format_idc == 1) || (chroma_format_idc == 2)) ? 2 : 1;
+    uint32_t sub_height = (chroma_format_idc == 1) ? 2 : 1;
+
+    width  = (int)(pic_width - sub_width * (conf_left + conf_right));
+    height = (int)(pic_height - sub_height * (conf_top + conf_bottom));
+    return (width > 0) && (height > 0);
+}
+
 #endif
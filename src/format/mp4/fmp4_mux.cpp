@@ -0,0 +1,473 @@
+#include "fmp4_mux.hpp"
+#include "format/h264_header.hpp"
+#include "format/audio_pub.hpp"
+#include "utils/byte_stream.hpp"
+#include "logger.hpp"
+#include <string.h>
+
+static const uint32_t s_matrix[9] = {
+    0x00010000, 0, 0,
+    0, 0x00010000, 0,
+    0, 0, 0x40000000
+};
+
+static inline void put_u8(std::vector<uint8_t>& buf, uint8_t value) {
+    buf.push_back(value);
+}
+
+static inline void put_u16(std::vector<uint8_t>& buf, uint16_t value) {
+    buf.push_back((value >> 8) & 0xff);
+    buf.push_back(value & 0xff);
+}
+
+static inline void put_u24(std::vector<uint8_t>& buf, uint32_t value) {
+    buf.push_back((value >> 16) & 0xff);
+    buf.push_back((value >> 8) & 0xff);
+    buf.push_back(value & 0xff);
+}
+
+static inline void put_u32(std::vector<uint8_t>& buf, uint32_t value) {
+    buf.push_back((value >> 24) & 0xff);
+    buf.push_back((value >> 16) & 0xff);
+    buf.push_back((value >> 8) & 0xff);
+    buf.push_back(value & 0xff);
+}
+
+static inline void put_u64(std::vector<uint8_t>& buf, uint64_t value) {
+    put_u32(buf, (uint32_t)(value >> 32));
+    put_u32(buf, (uint32_t)(value & 0xffffffff));
+}
+
+static inline void put_bytes(std::vector<uint8_t>& buf, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    buf.insert(buf.end(), p, p + len);
+}
+
+static inline void put_zeros(std::vector<uint8_t>& buf, size_t len) {
+    buf.insert(buf.end(), len, 0);
+}
+
+//return the start position of the box, the size is written by box_end
+static inline size_t box_start(std::vector<uint8_t>& buf, const char* type) {
+    size_t pos = buf.size();
+    put_u32(buf, 0);
+    put_bytes(buf, type, 4);
+    return pos;
+}
+
+static inline size_t full_box_start(std::vector<uint8_t>& buf, const char* type, uint8_t version, uint32_t flags) {
+    size_t pos = box_start(buf, type);
+    put_u8(buf, version);
+    put_u24(buf, flags);
+    return pos;
+}
+
+static inline void box_end(std::vector<uint8_t>& buf, size_t pos) {
+    write_4bytes(&buf[pos], (uint32_t)(buf.size() - pos));
+}
+
+//mpeg4 descriptor with one byte size
+static inline size_t descr_start(std::vector<uint8_t>& buf, uint8_t tag) {
+    put_u8(buf, tag);
+    put_u8(buf, 0);
+    return buf.size();
+}
+
+static inline void descr_end(std::vector<uint8_t>& buf, size_t pos) {
+    buf[pos - 1] = (uint8_t)(buf.size() - pos);
+}
+
+fmp4_mux::fmp4_mux()
+{
+    video_track_.track_id  = FMP4_VIDEO_TRACK_ID;
+    video_track_.timescale = FMP4_VIDEO_TIMESCALE;
+    audio_track_.track_id  = FMP4_AUDIO_TRACK_ID;
+}
+
+fmp4_mux::~fmp4_mux()
+{
+}
+
+int fmp4_mux::set_video_config(MEDIA_CODEC_TYPE codec, const uint8_t* data, size_t len) {
+    int width  = 0;
+    int height = 0;
+
+    if (codec == MEDIA_CODEC_H264) {
+        uint8_t sps[1024];
+        size_t sps_len = 0;
+        uint8_t pps[1024];
+        size_t pps_len = 0;
+
+        if (get_sps_pps_from_extradata(pps, pps_len, sps, sps_len, data, len) != 0) {
+            log_errorf("fmp4 get sps/pps from avcC error");
+            return -1;
+        }
+        get_h264_sps_size(sps, sps_len, width, height);
+    } else if (codec == MEDIA_CODEC_H265) {
+        HEVC_DEC_CONF_RECORD hevc_info;
+        uint8_t vps[1024];
+        size_t vps_len = 0;
+        uint8_t sps[1024];
+        size_t sps_len = 0;
+        uint8_t pps[1024];
+        size_t pps_len = 0;
+
+        if ((get_hevc_dec_info_from_extradata(&hevc_info, data, len) != 0) ||
+            (get_vps_sps_pps_from_hevc_dec_info(&hevc_info, vps, vps_len, sps, sps_len, pps, pps_len) != 0)) {
+            log_errorf("fmp4 get vps/sps/pps from hvcC error");
+            return -1;
+        }
+        get_h265_sps_size(sps, sps_len, width, height);
+    } else {
+        log_errorf("fmp4 does not support video codec:%s", codectype_tostring(codec).c_str());
+        return -1;
+    }
+
+    video_track_.codec  = codec;
+    video_track_.width  = width;
+    video_track_.height = height;
+    video_track_.config.assign((const char*)data, len);
+    return 0;
+}
+
+int fmp4_mux::set_audio_config(MEDIA_CODEC_TYPE codec, const uint8_t* data, size_t len) {
+    uint8_t aac_type = 0;
+    int sample_rate  = 0;
+    uint8_t channel  = 0;
+
+    if (codec != MEDIA_CODEC_AAC) {
+        log_errorf("fmp4 does not support audio codec:%s", codectype_tostring(codec).c_str());
+        return -1;
+    }
+    if ((len < 2) || !get_audioinfo_by_asc((uint8_t*)data, len, aac_type, sample_rate, channel)) {
+        log_errorf("fmp4 aac asc decode error");
+        return -1;
+    }
+
+    audio_track_.codec       = codec;
+    audio_track_.timescale   = sample_rate;
+    audio_track_.sample_rate = sample_rate;
+    audio_track_.channel     = channel;
+    audio_track_.last_duration = FMP4_AAC_FRAME_SIZE;
+    audio_track_.config.assign((const char*)data, len);
+    return 0;
+}
+
+int fmp4_mux::gen_init_segment(data_buffer& buffer) {
+    std::vector<uint8_t> buf;
+
+    if (!has_video() && !has_audio()) {
+        return -1;
+    }
+    buf.reserve(1024 + video_track_.config.size() + audio_track_.config.size());
+
+    size_t ftyp = box_start(buf, "ftyp");
+    put_bytes(buf, "iso6", 4);//major brand
+    put_u32(buf, 0);//minor version
+    put_bytes(buf, "iso6", 4);
+    put_bytes(buf, "cmfc", 4);
+    put_bytes(buf, "mp41", 4);
+    box_end(buf, ftyp);
+
+    size_t moov = box_start(buf, "moov");
+
+    size_t mvhd = full_box_start(buf, "mvhd", 0, 0);
+    put_u32(buf, 0);//creation_time
+    put_u32(buf, 0);//modification_time
+    put_u32(buf, 1000);//timescale
+    put_u32(buf, 0);//duration
+    put_u32(buf, 0x00010000);//rate
+    put_u16(buf, 0x0100);//volume
+    put_zeros(buf, 2 + 8);//reserved
+    for (uint32_t value : s_matrix) {
+        put_u32(buf, value);
+    }
+    put_zeros(buf, 6 * 4);//pre_defined
+    put_u32(buf, FMP4_AUDIO_TRACK_ID + 1);//next_track_ID
+    box_end(buf, mvhd);
+
+    if (has_video()) {
+        write_trak(buf, video_track_);
+    }
+    if (has_audio()) {
+        write_trak(buf, audio_track_);
+    }
+
+    size_t mvex = box_start(buf, "mvex");
+    fmp4_track* tracks[2] = { &video_track_, &audio_track_ };
+    for (fmp4_track* track : tracks) {
+        if (track->config.empty()) {
+            continue;
+        }
+        size_t trex = full_box_start(buf, "trex", 0, 0);
+        put_u32(buf, track->track_id);
+        put_u32(buf, 1);//default_sample_description_index
+        put_u32(buf, 0);//default_sample_duration
+        put_u32(buf, 0);//default_sample_size
+        put_u32(buf, 0);//default_sample_flags
+        box_end(buf, trex);
+    }
+    box_end(buf, mvex);
+    box_end(buf, moov);
+
+    buffer.append_data((char*)&buf[0], buf.size());
+    return 0;
+}
+
+void fmp4_mux::write_trak(std::vector<uint8_t>& buf, fmp4_track& track) {
+    bool is_video = (track.track_id == FMP4_VIDEO_TRACK_ID);
+
+    size_t trak = box_start(buf, "trak");
+
+    size_t tkhd = full_box_start(buf, "tkhd", 0, 0x03);//enabled, in movie
+    put_u32(buf, 0);//creation_time
+    put_u32(buf, 0);//modification_time
+    put_u32(buf, track.track_id);
+    put_u32(buf, 0);//reserved
+    put_u32(buf, 0);//duration
+    put_zeros(buf, 8);//reserved
+    put_u16(buf, 0);//layer
+    put_u16(buf, 0);//alternate_group
+    put_u16(buf, is_video ? 0 : 0x0100);//volume
+    put_u16(buf, 0);//reserved
+    for (uint32_t value : s_matrix) {
+        put_u32(buf, value);
+    }
+    put_u32(buf, is_video ? ((uint32_t)track.width << 16) : 0);
+    put_u32(buf, is_video ? ((uint32_t)track.height << 16) : 0);
+    box_end(buf, tkhd);
+
+    size_t mdia = box_start(buf, "mdia");
+
+    size_t mdhd = full_box_start(buf, "mdhd", 0, 0);
+    put_u32(buf, 0);//creation_time
+    put_u32(buf, 0);//modification_time
+    put_u32(buf, track.timescale);
+    put_u32(buf, 0);//duration
+    put_u16(buf, 0x55c4);//language: und
+    put_u16(buf, 0);//pre_defined
+    box_end(buf, mdhd);
+
+    size_t hdlr = full_box_start(buf, "hdlr", 0, 0);
+    put_u32(buf, 0);//pre_defined
+    put_bytes(buf, is_video ? "vide" : "soun", 4);
+    put_zeros(buf, 3 * 4);//reserved
+    const char* name = is_video ? "VideoHandler" : "SoundHandler";
+    put_bytes(buf, name, strlen(name) + 1);
+    box_end(buf, hdlr);
+
+    size_t minf = box_start(buf, "minf");
+    if (is_video) {
+        size_t vmhd = full_box_start(buf, "vmhd", 0, 0x01);
+        put_u16(buf, 0);//graphicsmode
+        put_zeros(buf, 3 * 2);//opcolor
+        box_end(buf, vmhd);
+    } else {
+        size_t smhd = full_box_start(buf, "smhd", 0, 0);
+        put_u16(buf, 0);//balance
+        put_u16(buf, 0);//reserved
+        box_end(buf, smhd);
+    }
+
+    size_t dinf = box_start(buf, "dinf");
+    size_t dref = full_box_start(buf, "dref", 0, 0);
+    put_u32(buf, 1);//entry_count
+    size_t url = full_box_start(buf, "url ", 0, 0x01);//media data in the same file
+    box_end(buf, url);
+    box_end(buf, dref);
+    box_end(buf, dinf);
+
+    size_t stbl = box_start(buf, "stbl");
+    write_stsd(buf, track);
+    const char* empty_boxes[3] = { "stts", "stsc", "stco" };
+    for (const char* type : empty_boxes) {
+        size_t box = full_box_start(buf, type, 0, 0);
+        put_u32(buf, 0);//entry_count
+        box_end(buf, box);
+    }
+    size_t stsz = full_box_start(buf, "stsz", 0, 0);
+    put_u32(buf, 0);//sample_size
+    put_u32(buf, 0);//sample_count
+    box_end(buf, stsz);
+    box_end(buf, stbl);
+
+    box_end(buf, minf);
+    box_end(buf, mdia);
+    box_end(buf, trak);
+}
+
+void fmp4_mux::write_stsd(std::vector<uint8_t>& buf, fmp4_track& track) {
+    size_t stsd = full_box_start(buf, "stsd", 0, 0);
+    put_u32(buf, 1);//entry_count
+
+    if (track.track_id == FMP4_VIDEO_TRACK_ID) {
+        bool is_h264 = (track.codec == MEDIA_CODEC_H264);
+        size_t entry = box_start(buf, is_h264 ? "avc1" : "hvc1");
+        put_zeros(buf, 6);//reserved
+        put_u16(buf, 1);//data_reference_index
+        put_u16(buf, 0);//pre_defined
+        put_u16(buf, 0);//reserved
+        put_zeros(buf, 3 * 4);//pre_defined
+        put_u16(buf, (uint16_t)track.width);
+        put_u16(buf, (uint16_t)track.height);
+        put_u32(buf, 0x00480000);//horizresolution: 72 dpi
+        put_u32(buf, 0x00480000);//vertresolution: 72 dpi
+        put_u32(buf, 0);//reserved
+        put_u16(buf, 1);//frame_count
+        put_zeros(buf, 32);//compressorname
+        put_u16(buf, 0x0018);//depth
+        put_u16(buf, 0xffff);//pre_defined
+
+        size_t config = box_start(buf, is_h264 ? "avcC" : "hvcC");
+        put_bytes(buf, track.config.data(), track.config.size());
+        box_end(buf, config);
+        box_end(buf, entry);
+    } else {
+        size_t entry = box_start(buf, "mp4a");
+        put_zeros(buf, 6);//reserved
+        put_u16(buf, 1);//data_reference_index
+        put_zeros(buf, 2 * 4);//reserved
+        put_u16(buf, track.channel);
+        put_u16(buf, 16);//samplesize
+        put_u16(buf, 0);//pre_defined
+        put_u16(buf, 0);//reserved
+        put_u32(buf, (track.sample_rate < 65536) ? ((uint32_t)track.sample_rate << 16) : 0);
+
+        size_t esds = full_box_start(buf, "esds", 0, 0);
+        size_t es_descr = descr_start(buf, 0x03);//ES_DescrTag
+        put_u16(buf, 0);//ES_ID
+        put_u8(buf, 0);//flags
+        size_t dec_config = descr_start(buf, 0x04);//DecoderConfigDescrTag
+        put_u8(buf, 0x40);//objectTypeIndication: mpeg4 audio
+        put_u8(buf, (0x05 << 2) | 0x01);//streamType: audio
+        put_u24(buf, 0);//bufferSizeDB
+        put_u32(buf, 0);//maxBitrate
+        put_u32(buf, 0);//avgBitrate
+        size_t dec_specific = descr_start(buf, 0x05);//DecSpecificInfoTag
+        put_bytes(buf, track.config.data(), track.config.size());
+        descr_end(buf, dec_specific);
+        descr_end(buf, dec_config);
+        size_t sl_config = descr_start(buf, 0x06);//SLConfigDescrTag
+        put_u8(buf, 0x02);
+        descr_end(buf, sl_config);
+        descr_end(buf, es_descr);
+        box_end(buf, esds);
+        box_end(buf, entry);
+    }
+    box_end(buf, stsd);
+}
+
+int fmp4_mux::input_sample(MEDIA_PACKET_PTR pkt_ptr, const uint8_t* data, size_t len) {
+    fmp4_track* track = nullptr;
+
+    if ((pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) && has_video()) {
+        track = &video_track_;
+    } else if ((pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE) && has_audio()) {
+        track = &audio_track_;
+    } else {
+        return -1;
+    }
+
+    fmp4_sample sample;
+    sample.pkt_ptr  = pkt_ptr;
+    sample.data     = data;
+    sample.data_len = len;
+    sample.dts      = pkt_ptr->dts_ * track->timescale / 1000;
+    sample.cts      = (pkt_ptr->pts_ - pkt_ptr->dts_) * track->timescale / 1000;
+    sample.is_key   = (track == &audio_track_) || pkt_ptr->is_key_frame_;
+    track->samples.push_back(sample);
+    return 0;
+}
+
+int64_t fmp4_mux::sample_duration(fmp4_track& track, size_t index) {
+    if (track.codec == MEDIA_CODEC_AAC) {
+        return FMP4_AAC_FRAME_SIZE;
+    }
+    if (index + 1 < track.samples.size()) {
+        int64_t duration = track.samples[index + 1].dts - track.samples[index].dts;
+        if (duration > 0) {
+            track.last_duration = duration;
+        }
+        return (duration > 0) ? duration : 0;
+    }
+    //the next sample is unknown yet, use the last duration for the last one
+    return (track.last_duration > 0) ? track.last_duration : (int64_t)track.timescale / 25;
+}
+
+void fmp4_mux::write_traf(std::vector<uint8_t>& buf, fmp4_track& track, size_t& data_offset_pos) {
+    size_t traf = box_start(buf, "traf");
+
+    size_t tfhd = full_box_start(buf, "tfhd", 0, 0x020000);//default-base-is-moof
+    put_u32(buf, track.track_id);
+    box_end(buf, tfhd);
+
+    size_t tfdt = full_box_start(buf, "tfdt", 1, 0);
+    put_u64(buf, (uint64_t)track.samples[0].dts);//baseMediaDecodeTime
+    box_end(buf, tfdt);
+
+    //data-offset, sample-duration, sample-size, sample-flags, sample-composition-time-offset
+    size_t trun = full_box_start(buf, "trun", 1, 0x000001 | 0x000100 | 0x000200 | 0x000400 | 0x000800);
+    put_u32(buf, (uint32_t)track.samples.size());
+    data_offset_pos = buf.size();
+    put_u32(buf, 0);//data_offset, written after the moof size is known
+    for (size_t i = 0; i < track.samples.size(); i++) {
+        fmp4_sample& sample = track.samples[i];
+        put_u32(buf, (uint32_t)sample_duration(track, i));
+        put_u32(buf, (uint32_t)sample.data_len);
+        //sync sample: depends on no others; otherwise: depends on others, non sync
+        put_u32(buf, sample.is_key ? 0x02000000 : 0x01010000);
+        put_u32(buf, (uint32_t)(int32_t)sample.cts);
+    }
+    box_end(buf, trun);
+
+    box_end(buf, traf);
+}
+
+int fmp4_mux::write_fragment(data_buffer& buffer) {
+    std::vector<uint8_t> buf;
+    fmp4_track* tracks[2] = { &video_track_, &audio_track_ };
+    size_t data_offset_pos[2] = { 0, 0 };
+
+    if (!has_samples()) {
+        return 0;
+    }
+    buf.reserve(256 + (video_track_.samples.size() + audio_track_.samples.size()) * 16);
+
+    size_t moof = box_start(buf, "moof");
+    size_t mfhd = full_box_start(buf, "mfhd", 0, 0);
+    put_u32(buf, ++sequence_);
+    box_end(buf, mfhd);
+    for (int i = 0; i < 2; i++) {
+        if (!tracks[i]->samples.empty()) {
+            write_traf(buf, *tracks[i], data_offset_pos[i]);
+        }
+    }
+    box_end(buf, moof);
+
+    //the samples of the tracks are laid out one track after another in mdat
+    size_t mdat_size = 8;
+    for (int i = 0; i < 2; i++) {
+        if (tracks[i]->samples.empty()) {
+            continue;
+        }
+        write_4bytes(&buf[data_offset_pos[i]], (uint32_t)(buf.size() + mdat_size));
+        for (fmp4_sample& sample : tracks[i]->samples) {
+            mdat_size += sample.data_len;
+        }
+    }
+
+    char* p = buffer.append_space(buf.size() + mdat_size);
+    memcpy(p, &buf[0], buf.size());
+    p += buf.size();
+    write_4bytes((uint8_t*)p, (uint32_t)mdat_size);
+    memcpy(p + 4, "mdat", 4);
+    p += 8;
+    for (int i = 0; i < 2; i++) {
+        for (fmp4_sample& sample : tracks[i]->samples) {
+            memcpy(p, sample.data, sample.data_len);
+            p += sample.data_len;
+        }
+        tracks[i]->samples.clear();
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+#ifndef FMP4_MUX_HPP
+#define FMP4_MUX_HPP
+#include "data_buffer.hpp"
+#include "utils/av/av.hpp"
+#include "utils/av/media_packet.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <string>
+
+#define FMP4_VIDEO_TRACK_ID   1
+#define FMP4_AUDIO_TRACK_ID   2
+#define FMP4_VIDEO_TIMESCALE  90000
+#define FMP4_AAC_FRAME_SIZE   1024
+
+class fmp4_sample
+{
+public:
+    MEDIA_PACKET_PTR pkt_ptr;//hold the packet memory
+    const uint8_t* data = nullptr;
+    size_t data_len = 0;
+    int64_t dts = 0;//in track timescale
+    int64_t cts = 0;//pts - dts in track timescale
+    bool is_key = false;
+};
+
+class fmp4_track
+{
+public:
+    uint32_t track_id = 0;
+    uint32_t timescale = 1000;
+    MEDIA_CODEC_TYPE codec = MEDIA_CODEC_UNKOWN;
+    std::string config;//avcC/hvcC record, or aac AudioSpecificConfig
+    int width  = 0;
+    int height = 0;
+    int sample_rate = 0;
+    uint8_t channel = 0;
+    int64_t last_duration = 0;
+    std::vector<fmp4_sample> samples;
+};
+
+/*
+cmaf/fmp4 muxer for hls:
+    init segment: ftyp + moov(one trak per track, mvex/trex)
+    fragment:     moof(mfhd, traf/tfhd/tfdt/trun per track) + mdat
+the h264/h265 samples are avcc(4 bytes length + nalu) as in flv,
+the aac samples are raw frames, they are copied into mdat only once.
+*/
+class fmp4_mux
+{
+public:
+    fmp4_mux();
+    ~fmp4_mux();
+
+public:
+    //data is the flv sequence header payload: avcC/hvcC record or aac AudioSpecificConfig
+    int set_video_config(MEDIA_CODEC_TYPE codec, const uint8_t* data, size_t len);
+    int set_audio_config(MEDIA_CODEC_TYPE codec, const uint8_t* data, size_t len);
+    bool has_video() { return !video_track_.config.empty(); }
+    bool has_audio() { return !audio_track_.config.empty(); }
+
+    int gen_init_segment(data_buffer& buffer);
+
+    //the sample data must stay valid until the fragment is written
+    int input_sample(MEDIA_PACKET_PTR pkt_ptr, const uint8_t* data, size_t len);
+    bool has_samples() { return !video_track_.samples.empty() || !audio_track_.samples.empty(); }
+    //write moof + mdat of the pending samples
+    int write_fragment(data_buffer& buffer);
+
+private:
+    void write_trak(std::vector<uint8_t>& buf, fmp4_track& track);
+    void write_stsd(std::vector<uint8_t>& buf, fmp4_track& track);
+    void write_traf(std::vector<uint8_t>& buf, fmp4_track& track, size_t& data_offset_pos);
+    int64_t sample_duration(fmp4_track& track, size_t index);
+
+private:
+    fmp4_track video_track_;
+    fmp4_track audio_track_;
+    uint32_t sequence_ = 0;
+};
+
+#endif
@@ -120,6 +120,10 @@ int mpegts_mux::write_pat() {
     if (ret < 0) {
         return ret;
     }
+    if (output_buffer_) {
+        output_buffer_->append_data((char*)pat_data_, TS_PACKET_SIZE);
+        return 0;
+    }
     MEDIA_PACKET_PTR pkt_ptr;
     ts_callback(pkt_ptr, pat_data_);
     return 0;
@@ -130,6 +134,10 @@ int mpegts_mux::write_pmt() {
     if (ret < 0) {
         return ret;
     }
+    if (output_buffer_) {
+        output_buffer_->append_data((char*)pmt_data_, TS_PACKET_SIZE);
+        return 0;
+    }
     MEDIA_PACKET_PTR pkt_ptr;
     ts_callback(pkt_ptr, pmt_data_);
     return 0;
@@ -138,13 +146,34 @@ int mpegts_mux::write_pmt() {
 int mpegts_mux::input_packet(MEDIA_PACKET_PTR pkt_ptr) {
     int ret = -1;
 
-    ret = write_pes(pkt_ptr);
+    if (output_buffer_) {
+        std::vector<es_slice> slices;
+        slices.emplace_back((uint8_t*)pkt_ptr->buffer_ptr_->data(), pkt_ptr->buffer_ptr_->data_len());
+        ret = write_pes_to_buffer(pkt_ptr, slices);
+    } else {
+        ret = write_pes(pkt_ptr);
+    }
     if (ret < 0) {
         return ret;
     }
     return 0;
 }
 
+int mpegts_mux::input_slices(MEDIA_PACKET_PTR pkt_ptr, const std::vector<es_slice>& slices) {
+    if (output_buffer_) {
+        return (write_pes_to_buffer(pkt_ptr, slices) < 0) ? -1 : 0;
+    }
+
+    //the callback output needs the es data in one buffer
+    if (!slices_pkt_ptr_) {
+        slices_pkt_ptr_ = std::make_shared<MEDIA_PACKET>();
+    }
+    slices_pkt_ptr_->copy_properties(pkt_ptr);
+    slices_pkt_ptr_->buffer_ptr_->reset();
+    es_slices_write(slices, *slices_pkt_ptr_->buffer_ptr_);
+    return (write_pes(slices_pkt_ptr_) < 0) ? -1 : 0;
+}
+
 /*
 PAT:
 table_id 8 
@@ -653,6 +682,112 @@ int mpegts_mux::write_pes(MEDIA_PACKET_PTR pkt_ptr) {
     return 0;
 }
 
+/*
+write the whole pes into output_buffer_ in one run:
+the ts packets count is computed first, the space is reserved once,
+and every ts header/adaptation field/stuffing is built in place.
+the es data is gathered from the slices, it's never joined before.
+*/
+int mpegts_mux::write_pes_to_buffer(MEDIA_PACKET_PTR pkt_ptr, const std::vector<es_slice>& slices) {
+    const int TS_DEF_DATALEN = 184;
+    const int PCR_ADAPTATION_LEN = 8;//adaptation_field_length(1) + flags(1) + pcr(6)
+
+    int64_t data_size = (int64_t)es_slices_size(slices);
+    bool is_video = (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE);
+    bool has_pcr = is_video && pkt_ptr->is_key_frame_;
+    int64_t dts = pkt_ptr->dts_ * 90;
+    int64_t pts = pkt_ptr->pts_ * 90;
+    uint16_t pid = is_video ? video_pid_ : audio_pid_;
+    uint8_t& cc  = is_video ? video_cc_ : audio_cc_;
+
+    write_pes_header(data_size, is_video, dts, pts);
+
+    int64_t total_len = pes_header_size_ + data_size;
+    int64_t first_payload_max = TS_DEF_DATALEN - (has_pcr ? PCR_ADAPTATION_LEN : 0);
+    int64_t packet_count = 1;
+    if (total_len > first_payload_max) {
+        packet_count += (total_len - first_payload_max + TS_DEF_DATALEN - 1) / TS_DEF_DATALEN;
+    }
+
+    uint8_t* p = (uint8_t*)output_buffer_->append_space(packet_count * TS_PACKET_SIZE);
+    int64_t header_pos = 0;//bytes of pes header written
+    int64_t data_pos   = 0;//bytes of es data written
+    size_t slice_index  = 0;
+    size_t slice_offset = 0;//bytes of the current slice written
+
+    for (int64_t index = 0; index < packet_count; index++) {
+        bool first = (index == 0);
+        uint8_t* ts_packet = p + index * TS_PACKET_SIZE;
+        int64_t remain = total_len - header_pos - data_pos;
+
+        cc = (cc + 1) & 0x0f;
+
+        ts_packet[0] = 0x47;
+        ts_packet[1] = (uint8_t)((pid >> 8) & 0x1f) | (first ? 0x40 : 0x00);
+        ts_packet[2] = (uint8_t)pid;
+        ts_packet[3] = 0x10 | cc;
+
+        uint8_t* q = ts_packet + 4;
+        int64_t payload_max = TS_DEF_DATALEN;
+        bool pcr_here = first && has_pcr;
+        if (pcr_here) {
+            payload_max -= PCR_ADAPTATION_LEN;
+        }
+        int64_t payload_len = (remain < payload_max) ? remain : payload_max;
+        int64_t stuffing    = payload_max - payload_len;
+
+        if (pcr_here || (stuffing > 0)) {
+            ts_packet[3] |= 0x20;
+
+            //adaptation_field_length excludes the length byte itself
+            int64_t af_len = stuffing - 1 + (pcr_here ? PCR_ADAPTATION_LEN : 0);
+            *q++ = (uint8_t)af_len;
+            if (af_len > 0) {
+                *q++ = pcr_here ? 0x50 : 0x00;
+                if (pcr_here) {
+                    write_pcr(q, dts);
+                    q += 6;
+                }
+                int64_t fill = af_len - 1 - (pcr_here ? 6 : 0);
+                if (fill > 0) {
+                    memset(q, 0xff, fill);
+                    q += fill;
+                }
+            }
+        }
+
+        if (header_pos < pes_header_size_) {
+            int64_t len = pes_header_size_ - header_pos;
+            if (len > payload_len) {
+                len = payload_len;
+            }
+            memcpy(q, pes_header_ + header_pos, len);
+            q += len;
+            header_pos += len;
+            payload_len -= len;
+        }
+
+        data_pos += payload_len;
+        while ((payload_len > 0) && (slice_index < slices.size())) {
+            const es_slice& slice = slices[slice_index];
+            int64_t len = (int64_t)(slice.len - slice_offset);
+            if (len > payload_len) {
+                len = payload_len;
+            }
+            memcpy(q, slice.data + slice_offset, len);
+            q += len;
+            payload_len  -= len;
+            slice_offset += len;
+            if (slice_offset >= slice.len) {
+                slice_index++;
+                slice_offset = 0;
+            }
+        }
+    }
+
+    return 0;
+}
+
 void mpegts_mux::ts_callback(MEDIA_PACKET_PTR pkt_ptr, uint8_t* data) {
     if (cb_) {
         MEDIA_PACKET_PTR ts_pkt_ptr = std::make_shared<MEDIA_PACKET>(256);
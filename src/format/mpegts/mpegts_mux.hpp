@@ -4,6 +4,8 @@
 #include "data_buffer.hpp"
 #include "utils/av/av.hpp"
 #include "format/av_format_interface.hpp"
+#include "format/h264_header.hpp"
+#include <vector>
 
 uint8_t* get_h264_aud_data(size_t& len);
 uint8_t* get_h265_aud_data(size_t& len);
@@ -16,6 +18,8 @@ public:
 
 public:
     int input_packet(MEDIA_PACKET_PTR pkt_ptr);
+    //the es data of the pes is the slices in order, pkt_ptr only gives the properties
+    int input_slices(MEDIA_PACKET_PTR pkt_ptr, const std::vector<es_slice>& slices);
     int write_pat();
     int write_pmt();
     void set_video_flag(bool flag) { has_video_ = flag;}
@@ -28,10 +32,16 @@ public:
     MEDIA_CODEC_TYPE get_video_codec() { return video_codec_type_; }
     MEDIA_CODEC_TYPE get_audio_codec() { return audio_codec_type_; }
 
+    //when the output buffer is set, pat/pmt/pes are written into it directly
+    //instead of being called back packet by packet.
+    void set_output_buffer(data_buffer* buffer) { output_buffer_ = buffer; }
+    data_buffer* get_output_buffer() { return output_buffer_; }
+
 private:
     int generate_pat();
     int generate_pmt();
     int write_pes(MEDIA_PACKET_PTR pkt_ptr);
+    int write_pes_to_buffer(MEDIA_PACKET_PTR pkt_ptr, const std::vector<es_slice>& slices);
     int write_pes_header(int64_t data_size,
                     bool is_video, int64_t dts, int64_t pts);
     int write_ts(uint8_t* data, uint8_t flag, int64_t ts);
@@ -43,6 +53,8 @@ private:
 
 private:
     av_format_callback* cb_ = nullptr;
+    data_buffer* output_buffer_ = nullptr;
+    MEDIA_PACKET_PTR slices_pkt_ptr_;//reused to join the slices for the callback output
 
 private:
     uint32_t pmt_count_     = 1;
@@ -0,0 +1,239 @@
+#include "mpegts_mux.hpp"
+#include "format/flv/flv_pub.hpp"
+#include "format/flv/flv_demux.hpp"
+#include "format/h264_header.hpp"
+#include "format/audio_pub.hpp"
+#include "logger.hpp"
+#include "timeex.hpp"
+#include <string>
+#include <memory>
+#include <vector>
+#include <stdlib.h>
+#include <assert.h>
+
+/*
+mpegts muxer benchmark:
+    mpegts_mux_bench input.flv [loop count]
+the flv file(h264/aac) is demuxed and converted into annexb/adts frames in memory first,
+then the frames are muxed again and again by:
+    callback mode: one MEDIA_PACKET per 188 bytes ts packet through av_format_callback
+    buffer mode:   the whole pes written into the segment buffer directly
+*/
+
+class frame_collector : public av_format_callback
+{
+public:
+    frame_collector() {}
+    virtual ~frame_collector() {}
+
+public:
+    virtual int output_packet(MEDIA_PACKET_PTR pkt_ptr) override {
+        if (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) {
+            return handle_h264(pkt_ptr);
+        } else if (pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE) {
+            return handle_aac(pkt_ptr);
+        }
+        return 0;
+    }
+
+private:
+    int handle_h264(MEDIA_PACKET_PTR pkt_ptr) {
+        if (pkt_ptr->codec_type_ != MEDIA_CODEC_H264) {
+            return 0;
+        }
+        if (pkt_ptr->is_seq_hdr_) {
+            uint8_t sps[1024];
+            size_t sps_len = 0;
+            uint8_t pps[1024];
+            size_t pps_len = 0;
+
+            int ret = get_sps_pps_from_extradata(pps, pps_len, sps, sps_len,
+                                (uint8_t*)pkt_ptr->buffer_ptr_->data(),
+                                pkt_ptr->buffer_ptr_->data_len());
+            if (ret == 0) {
+                memcpy(sps_, H264_START_CODE, sizeof(H264_START_CODE));
+                memcpy(sps_ + sizeof(H264_START_CODE), sps, sps_len);
+                sps_len_ = sizeof(H264_START_CODE) + sps_len;
+                memcpy(pps_, H264_START_CODE, sizeof(H264_START_CODE));
+                memcpy(pps_ + sizeof(H264_START_CODE), pps, pps_len);
+                pps_len_ = sizeof(H264_START_CODE) + pps_len;
+            }
+            return 0;
+        }
+
+        std::vector<std::shared_ptr<data_buffer>> nalus;
+        if (!annexb_to_nalus((uint8_t*)pkt_ptr->buffer_ptr_->data(),
+                        pkt_ptr->buffer_ptr_->data_len(), nalus)) {
+            return -1;
+        }
+
+        MEDIA_PACKET_PTR frame_ptr = std::make_shared<MEDIA_PACKET>();
+        frame_ptr->copy_properties(pkt_ptr);
+
+        size_t aud_data_len = 0;
+        uint8_t* aud_data = get_h264_aud_data(aud_data_len);
+        frame_ptr->buffer_ptr_->append_data((char*)aud_data, aud_data_len);
+        for (std::shared_ptr<data_buffer> item : nalus) {
+            uint8_t nalu_type = ((uint8_t*)item->data())[4] & 0x1f;
+            if (H264_IS_AUD(nalu_type) || H264_IS_SEQ(nalu_type)) {
+                continue;
+            }
+            if (H264_IS_KEYFRAME(nalu_type) && (sps_len_ > 0) && (pps_len_ > 0)) {
+                frame_ptr->buffer_ptr_->append_data((char*)sps_, sps_len_);
+                frame_ptr->buffer_ptr_->append_data((char*)pps_, pps_len_);
+            }
+            frame_ptr->buffer_ptr_->append_data(item->data(), item->data_len());
+        }
+        frames_.push_back(frame_ptr);
+        return 0;
+    }
+
+    int handle_aac(MEDIA_PACKET_PTR pkt_ptr) {
+        if (pkt_ptr->codec_type_ != MEDIA_CODEC_AAC) {
+            return 0;
+        }
+        if (pkt_ptr->is_seq_hdr_) {
+            get_audioinfo_by_asc((uint8_t*)pkt_ptr->buffer_ptr_->data(),
+                            pkt_ptr->buffer_ptr_->data_len(), aac_type_, sample_rate_, channel_);
+            return 0;
+        }
+        if ((aac_type_ == 0) || (sample_rate_ == 0) || (channel_ == 0)) {
+            return 0;
+        }
+
+        MEDIA_PACKET_PTR frame_ptr = std::make_shared<MEDIA_PACKET>();
+        uint8_t adts_data[32];
+        int adts_len = make_adts(adts_data, aac_type_,
+                sample_rate_, channel_, pkt_ptr->buffer_ptr_->data_len());
+        assert(adts_len == 7);
+
+        frame_ptr->copy_properties(pkt_ptr);
+        frame_ptr->buffer_ptr_->append_data((char*)adts_data, adts_len);
+        frame_ptr->buffer_ptr_->append_data(pkt_ptr->buffer_ptr_->data(), pkt_ptr->buffer_ptr_->data_len());
+        frames_.push_back(frame_ptr);
+        return 0;
+    }
+
+public:
+    std::vector<MEDIA_PACKET_PTR> frames_;
+
+private:
+    uint8_t sps_[1024];
+    uint8_t pps_[1024];
+    size_t  sps_len_ = 0;
+    size_t  pps_len_ = 0;
+
+    uint8_t aac_type_ = 0;
+    int sample_rate_  = 0;
+    uint8_t channel_  = 0;
+};
+
+//the old output path: every ts packet is delivered as a new MEDIA_PACKET
+class segment_callback : public av_format_callback
+{
+public:
+    segment_callback(data_buffer* segment):segment_(segment) {}
+    virtual ~segment_callback() {}
+
+public:
+    virtual int output_packet(MEDIA_PACKET_PTR pkt_ptr) override {
+        segment_->append_data(pkt_ptr->buffer_ptr_->data(), pkt_ptr->buffer_ptr_->data_len());
+        return 0;
+    }
+
+private:
+    data_buffer* segment_ = nullptr;
+};
+
+static int64_t mux_frames(const std::vector<MEDIA_PACKET_PTR>& frames, bool buffer_mode, data_buffer& segment) {
+    segment_callback cb(&segment);
+    mpegts_mux muxer(&cb);
+    int64_t last_patpmt_ts = -1;
+
+    if (buffer_mode) {
+        muxer.set_output_buffer(&segment);
+    }
+    for (auto frame_ptr : frames) {
+        if ((last_patpmt_ts < 0) || ((frame_ptr->dts_ - last_patpmt_ts) > 1000)) {
+            last_patpmt_ts = frame_ptr->dts_;
+            muxer.write_pat();
+            muxer.write_pmt();
+        }
+        muxer.input_packet(frame_ptr);
+    }
+    return (int64_t)segment.data_len();
+}
+
+static double run_bench(const std::vector<MEDIA_PACKET_PTR>& frames, bool buffer_mode,
+                        int loop_count, size_t reserve_size, std::string& output) {
+    int64_t total_bytes = 0;
+    int64_t start_us = now_microsec();
+
+    for (int i = 0; i < loop_count; i++) {
+        //the segment is reserved up front as mpegts_handle does
+        data_buffer segment(reserve_size);
+        total_bytes += mux_frames(frames, buffer_mode, segment);
+        if (i == 0) {
+            output.assign(segment.data(), segment.data_len());
+        }
+    }
+    int64_t cost_us = now_microsec() - start_us;
+    if (cost_us <= 0) {
+        cost_us = 1;
+    }
+    return (double)total_bytes / (double)cost_us;//bytes per microsecond == MB/s
+}
+
+int main(int argn, char** argv) {
+    if (argn < 2) {
+        printf("usage: %s input.flv [loop count]\r\n", argv[0]);
+        return -1;
+    }
+    int loop_count = (argn > 2) ? atoi(argv[2]) : 20;
+    if (loop_count <= 0) {
+        loop_count = 20;
+    }
+
+    Logger::get_instance()->set_filename("mpegts_mux_bench.log");
+
+    FILE* fh_p = fopen(argv[1], "r");
+    if (!fh_p) {
+        printf("fail to open flv filename:%s\r\n", argv[1]);
+        return -1;
+    }
+
+    frame_collector collector;
+    flv_demuxer demuxer(&collector);
+    char buffer[2048];
+    int n = 0;
+
+    do {
+        n = fread(buffer, 1, sizeof(buffer), fh_p);
+        MEDIA_PACKET_PTR pkt_ptr = std::make_shared<MEDIA_PACKET>();
+        pkt_ptr->fmt_type_ = MEDIA_FORMAT_FLV;
+        pkt_ptr->key_ = "live/bench";
+        pkt_ptr->buffer_ptr_->append_data(buffer, n);
+
+        demuxer.input_packet(pkt_ptr);
+    } while (n > 0);
+    fclose(fh_p);
+
+    int64_t es_bytes = 0;
+    for (auto frame_ptr : collector.frames_) {
+        es_bytes += frame_ptr->buffer_ptr_->data_len();
+    }
+    printf("frames:%lu, es bytes:%ld, loop count:%d\r\n",
+        collector.frames_.size(), es_bytes, loop_count);
+
+    std::string callback_output;
+    std::string buffer_output;
+    size_t reserve_size = es_bytes + es_bytes/4;
+    double callback_speed = run_bench(collector.frames_, false, loop_count, reserve_size, callback_output);
+    double buffer_speed   = run_bench(collector.frames_, true, loop_count, reserve_size, buffer_output);
+
+    printf("callback mode: %.2f MB/s, ts bytes:%lu\r\n", callback_speed, callback_output.size());
+    printf("buffer mode:   %.2f MB/s, ts bytes:%lu\r\n", buffer_speed, buffer_output.size());
+    printf("speed up: %.2fx, output %s\r\n", buffer_speed/callback_speed,
+        (callback_output == buffer_output) ? "identical" : "different");
+    return 0;
+}
@@ -6,6 +6,7 @@
 #include "net/webrtc/srtp_session.hpp"
 #include "net/webrtc/rtmp2rtc.hpp"
 #include "net/hls/hls_writer.hpp"
+#include "net/hls/hls_server.hpp"
 #include "net/http/http_common.hpp"
 #include "net/websocket/wsimple/flv_websocket.hpp"
 #include "net/websocket/wsimple/protoo_server.hpp"
@@ -30,7 +31,6 @@
 #endif
 
 uv_loop_t* MediaServer::loop_ = uv_default_loop();
-uv_loop_t* MediaServer::hls_loop_ = uv_loop_new();
 
 websocket_server* MediaServer::ws_p  = nullptr;
 flv_websocket* MediaServer::ws_flv_server = nullptr;
@@ -41,6 +41,7 @@ std::shared_ptr<rtmp_server> MediaServer::rtmp_ptr;
 std::shared_ptr<httpflv_server> MediaServer::httpflv_ptr;
 std::shared_ptr<httpapi_server> MediaServer::httpapi_ptr;
 hls_writer* MediaServer::hls_output = nullptr;
+std::shared_ptr<hls_server> MediaServer::hls_http_ptr;
 rtmp_relay_manager* MediaServer::relay_mgr_p = nullptr;
 
 void on_play_callback(const std::string& key) {
@@ -71,7 +72,7 @@ void MediaServer::create_webrtc() {
     byte_crypto::init();
     rtc_dtls::dtls_init(Config::tls_key(), Config::tls_cert());
     srtp_session::init();
-    init_single_udp_server(loop_, Config::candidate_ip(), Config::webrtc_udp_port());
+    init_single_udp_server(loop_, Config::candidate_ip(), Config::webrtc_udp_port(), Config::webrtc_workers());
     init_webrtc_stream_manager_callback();
 
     if (Config::rtmp2rtc_is_enable()) {
@@ -157,11 +158,23 @@ void MediaServer::create_hls() {
         log_infof("hls is disable...");
         return;
     }
-    MediaServer::hls_output = new hls_writer(MediaServer::hls_loop_, Config::hls_path(), true);//enable hls
+    MediaServer::hls_output = new hls_writer(Config::hls_path(), true,
+                                            Config::hls_worker_count());//enable hls
+    MediaServer::hls_output->set_low_latency(Config::hls_low_latency(), Config::hls_part_duration());
+    MediaServer::hls_output->set_fmp4_enable(Config::hls_fmp4_enable());
+    MediaServer::hls_output->set_dvr_window((int64_t)Config::hls_dvr_window() * 1000);
+    MediaServer::hls_output->set_abr(Config::hls_abr_threads(), Config::hls_abr_apps());
+    if (Config::hls_http_port() > 0) {
+        MediaServer::hls_http_ptr = std::make_shared<hls_server>(MediaServer::loop_,
+                                                        Config::hls_http_port(),
+                                                        MediaServer::hls_output);
+    }
     media_stream_manager::set_hls_writer(hls_output);
     MediaServer::hls_output->run();
 
-    log_infof("hls server is starting, hls path:%s", Config::hls_path().c_str());
+    log_infof("hls server is starting, hls path:%s, worker count:%lu, http port:%d, low latency:%s, fmp4:%s",
+        Config::hls_path().c_str(), Config::hls_worker_count(), Config::hls_http_port(),
+        Config::hls_low_latency() ? "true" : "false", Config::hls_fmp4_enable() ? "true" : "false");
     return;
 }
 
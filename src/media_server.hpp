@@ -8,6 +8,7 @@
 #include "net/webrtc/srtp_session.hpp"
 #include "net/webrtc/rtmp2rtc.hpp"
 #include "net/hls/hls_writer.hpp"
+#include "net/hls/hls_server.hpp"
 #include "net/httpapi/httpapi_server.hpp"
 #include "net/rtmp/rtmp_relay_mgr.hpp"
 #include "utils/byte_crypto.hpp"
@@ -43,7 +44,6 @@ private:
 
 private:
     static uv_loop_t* loop_;
-    static uv_loop_t* hls_loop_;
 
 private:
     static websocket_server* ws_p;
@@ -60,6 +60,7 @@ private:
 
 private:
     static hls_writer* hls_output;
+    static std::shared_ptr<hls_server> hls_http_ptr;
 
 private:
     static flv_websocket* ws_flv_server;
@@ -0,0 +1,229 @@
+#include "hls_dvr.hpp"
+#include "logger.hpp"
+#include "timeex.hpp"
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+dvr_chunk::dvr_chunk(int64_t id, const std::string& filename):id_(id)
+                                                        , filename_(filename)
+{
+}
+
+dvr_chunk::~dvr_chunk()
+{
+    //the mappings in flight keep their pages after the file is closed
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool dvr_chunk::open_file() {
+    fd_ = open(filename_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd_ < 0) {
+        log_errorf("open dvr log error:%s, filename:%s", strerror(errno), filename_.c_str());
+        return false;
+    }
+    //the file is released with the last fd or mapping, nothing is left after a crash
+    unlink(filename_.c_str());
+    return true;
+}
+
+int64_t dvr_chunk::append(const uint8_t* data, size_t len) {
+    int64_t offset = size_;
+    size_t written = 0;
+
+    while (written < len) {
+        ssize_t ret = write(fd_, data + written, len - written);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log_errorf("write dvr log error:%s, filename:%s", strerror(errno), filename_.c_str());
+            return -1;
+        }
+        written += (size_t)ret;
+    }
+    size_ += (int64_t)len;
+    return offset;
+}
+
+static std::string get_program_date_time(int64_t wall_ms) {
+    time_t t = (time_t)(wall_ms / 1000);
+    struct tm tm_info;
+    char desc[80];
+
+    gmtime_r(&t, &tm_info);
+    snprintf(desc, sizeof(desc), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+        tm_info.tm_year + 1900, tm_info.tm_mon + 1, tm_info.tm_mday,
+        tm_info.tm_hour, tm_info.tm_min, tm_info.tm_sec, (int)(wall_ms % 1000));
+    return std::string(desc);
+}
+
+std::atomic<int64_t> hls_dvr::s_instance_id{0};
+
+hls_dvr::hls_dvr(const std::string& dir, const std::string& streamname,
+                int64_t window_ms):dir_(dir)
+                                , streamname_(streamname)
+                                , window_ms_(window_ms)
+                                , instance_id_(++s_instance_id)
+{
+    std::stringstream cmd;
+
+    cmd << "mkdir -p " << dir_;
+    system(cmd.str().c_str());
+    log_infof("hls dvr construct dir:%s, window:%ldms", dir_.c_str(), window_ms_);
+}
+
+hls_dvr::~hls_dvr()
+{
+    std::lock_guard<std::mutex> locker(mutex_);
+    segments_.clear();
+    chunks_.clear();
+    log_infof("hls dvr destruct dir:%s", dir_.c_str());
+}
+
+std::shared_ptr<dvr_chunk> hls_dvr::get_write_chunk(size_t len) {
+    std::lock_guard<std::mutex> locker(mutex_);
+
+    if (!chunks_.empty()) {
+        std::shared_ptr<dvr_chunk> chunk_ptr = chunks_.rbegin()->second;
+        if ((chunk_ptr->get_size() == 0) ||
+            (chunk_ptr->get_size() + (int64_t)len <= HLS_DVR_CHUNK_MAX_SIZE)) {
+            return chunk_ptr;
+        }
+    }
+
+    std::stringstream ss;
+    ss << dir_ << "/dvr_" << instance_id_ << "_" << next_chunk_id_ << ".log";
+    std::shared_ptr<dvr_chunk> chunk_ptr = std::make_shared<dvr_chunk>(next_chunk_id_, ss.str());
+    if (!chunk_ptr->open_file()) {
+        return nullptr;
+    }
+    chunks_[next_chunk_id_++] = chunk_ptr;
+    return chunk_ptr;
+}
+
+int hls_dvr::append(int64_t msn, int64_t start_dts, int64_t duration, const uint8_t* data, size_t len) {
+    if ((len == 0) || (duration <= 0)) {
+        return 0;
+    }
+    std::shared_ptr<dvr_chunk> chunk_ptr = get_write_chunk(len);
+    if (!chunk_ptr) {
+        return -1;
+    }
+
+    //only the worker writes the log, the file is written without the lock
+    int64_t offset = chunk_ptr->append(data, len);
+    if (offset < 0) {
+        return -1;
+    }
+
+    dvr_segment segment;
+    segment.msn       = msn;
+    segment.start_dts = start_dts;
+    segment.duration  = duration;
+    segment.wall_ms   = now_millisec() - duration;
+    segment.chunk_id  = chunk_ptr->get_id();
+    segment.offset    = offset;
+    segment.size      = len;
+
+    std::lock_guard<std::mutex> locker(mutex_);
+    if (!segments_.empty() && (segments_.back().msn + 1 != msn)) {
+        //the index is looked up by msn, it must be consecutive
+        log_errorf("hls dvr msn is not consecutive, last:%ld, msn:%ld", segments_.back().msn, msn);
+        segments_.clear();
+    }
+    segments_.push_back(segment);
+    remove_expired();
+    return 0;
+}
+
+void hls_dvr::remove_expired() {
+    while (segments_.size() > 1) {
+        const dvr_segment& first = segments_.front();
+        const dvr_segment& last  = segments_.back();
+
+        if ((last.start_dts + last.duration - first.start_dts) <= window_ms_) {
+            break;
+        }
+        segments_.pop_front();
+    }
+
+    int64_t first_chunk_id = segments_.empty() ? next_chunk_id_ - 1 : segments_.front().chunk_id;
+    while (!chunks_.empty() && (chunks_.begin()->first < first_chunk_id)) {
+        chunks_.erase(chunks_.begin());
+    }
+}
+
+bool hls_dvr::gen_m3u8(std::string& m3u8, bool has_start, double start_sec) {
+    std::stringstream ss;
+    int64_t max_duration = 0;
+    int64_t total_duration = 0;
+
+    std::lock_guard<std::mutex> locker(mutex_);
+    if (segments_.empty()) {
+        return false;
+    }
+    for (const dvr_segment& segment : segments_) {
+        if (segment.duration > max_duration) {
+            max_duration = segment.duration;
+        }
+        total_duration += segment.duration;
+    }
+
+    ss << "#EXTM3U\n";
+    ss << "#EXT-X-VERSION:3\n";
+    ss << "#EXT-X-TARGETDURATION:" << (max_duration + 999) / 1000 << "\n";
+    //no EXT-X-PLAYLIST-TYPE: the window always slides at last, EVENT can't be changed to live
+    ss << "#EXT-X-MEDIA-SEQUENCE:" << segments_.front().msn << "\n";
+
+    if (has_start) {
+        double total_sec = total_duration / 1000.0;
+        double offset = start_sec;
+
+        if (start_sec >= 1000000000.0) {
+            offset = (start_sec * 1000.0 - (double)segments_.front().wall_ms) / 1000.0;
+        }
+        if (offset < 0) {
+            offset = (offset < -total_sec) ? -total_sec : offset;
+        } else {
+            offset = (offset > total_sec) ? total_sec : offset;
+        }
+        char start_desc[80];
+        snprintf(start_desc, sizeof(start_desc), "#EXT-X-START:TIME-OFFSET=%.3f,PRECISE=YES\n", offset);
+        ss << start_desc;
+    }
+
+    ss << "#EXT-X-PROGRAM-DATE-TIME:" << get_program_date_time(segments_.front().wall_ms) << "\n";
+    for (const dvr_segment& segment : segments_) {
+        ss << "#EXTINF:" << segment.duration / 1000.0 << ",\n";
+        ss << streamname_ << "/dvr_" << segment.msn << ".ts\n";
+    }
+    m3u8 = ss.str();
+    return true;
+}
+
+std::shared_ptr<file_mapping> hls_dvr::map_segment(int64_t msn) {
+    std::lock_guard<std::mutex> locker(mutex_);
+
+    if (segments_.empty() || (msn < segments_.front().msn) || (msn > segments_.back().msn)) {
+        return nullptr;
+    }
+    const dvr_segment& segment = segments_[msn - segments_.front().msn];
+    auto iter = chunks_.find(segment.chunk_id);
+    if (iter == chunks_.end()) {
+        return nullptr;
+    }
+
+    std::shared_ptr<file_mapping> mapping_ptr = file_mapping::map(iter->second->get_fd(), segment.offset, segment.size);
+    if (!mapping_ptr) {
+        log_errorf("hls dvr mmap error:%s, msn:%ld", strerror(errno), msn);
+    }
+    return mapping_ptr;
+}
@@ -0,0 +1,92 @@
+#ifndef HLS_DVR_HPP
+#define HLS_DVR_HPP
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include "file_mapping.hpp"
+
+#define HLS_DVR_CHUNK_MAX_SIZE (64*1024*1024) //the log file is rotated at this size
+
+//one file of the append-only segment log, it's unlinked when it's opened,
+//so only the fd and the mappings in flight keep it, until no segment in the window uses it
+class dvr_chunk
+{
+public:
+    dvr_chunk(int64_t id, const std::string& filename);
+    ~dvr_chunk();
+
+public:
+    bool open_file();
+    //append the data at the end of the file, return the offset of the data or -1
+    int64_t append(const uint8_t* data, size_t len);
+    int64_t get_id() { return id_; }
+    int64_t get_size() { return size_; }
+    int get_fd() { return fd_; }
+
+private:
+    int64_t id_ = 0;
+    std::string filename_;//only for the logs
+    int fd_ = -1;
+    int64_t size_ = 0;
+};
+
+class dvr_segment
+{
+public:
+    int64_t msn = 0;
+    int64_t start_dts = 0;
+    int64_t duration  = 0;
+    int64_t wall_ms   = 0;//the wall clock of the segment start, for EXT-X-PROGRAM-DATE-TIME
+    int64_t chunk_id  = 0;
+    int64_t offset    = 0;
+    size_t size       = 0;
+};
+
+/*
+the time-shift window of one stream. the finished mpegts segments are appended
+to the log files in the stream directory, only their offsets are kept in memory.
+the index is a deque of consecutive msn, so a segment is found by msn - first msn.
+the hls worker appends the segments, the http thread builds the playlist and maps
+the segments from the log, the mapped pages are sent without copying.
+*/
+class hls_dvr
+{
+public:
+    hls_dvr(const std::string& dir, const std::string& streamname, int64_t window_ms);
+    ~hls_dvr();
+
+public://called in the hls worker thread
+    int append(int64_t msn, int64_t start_dts, int64_t duration, const uint8_t* data, size_t len);
+
+public://called in the http thread
+    //start_sec: the _HLS_start of the request, negative is from the live edge,
+    //an epoch second is matched with the wall clock, others are from the window start.
+    bool gen_m3u8(std::string& m3u8, bool has_start, double start_sec);
+    //the mapping holds the pages of the segment until the response is sent
+    std::shared_ptr<file_mapping> map_segment(int64_t msn);
+    int64_t get_window() { return window_ms_; }
+
+private:
+    std::shared_ptr<dvr_chunk> get_write_chunk(size_t len);
+    void remove_expired();
+
+private:
+    std::string dir_;
+    std::string streamname_;
+    int64_t window_ms_ = 0;
+
+private:
+    std::mutex mutex_;
+    std::deque<dvr_segment> segments_;
+    std::map<int64_t, std::shared_ptr<dvr_chunk>> chunks_;//chunk id -> log file
+    int64_t next_chunk_id_ = 0;
+    int64_t instance_id_   = 0;//in the chunk names, the dvr of a restarted stream never opens the old files
+    static std::atomic<int64_t> s_instance_id;
+};
+
+#endif
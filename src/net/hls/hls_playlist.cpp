@@ -0,0 +1,271 @@
+#include "hls_playlist.hpp"
+#include "logger.hpp"
+#include <sstream>
+
+hls_playlist::hls_playlist(const std::string& ext):ext_(ext)
+{
+}
+
+hls_playlist::~hls_playlist()
+{
+}
+
+void hls_playlist::set_list_max(size_t list_max) {
+    if (list_max < 3) {
+        list_max_ = 3;
+        return;
+    }
+
+    if (list_max > 6) {
+        list_max_ = 6;
+        return;
+    }
+    list_max_ = list_max;
+    return;
+}
+
+void hls_playlist::set_low_latency(bool enable, size_t part_duration) {
+    low_latency_   = enable;
+    part_duration_ = part_duration;
+}
+
+std::shared_ptr<ts_item_info> hls_playlist::new_segment(const std::string& filename, int64_t msn) {
+    size_t reserve_size = EXTRA_LEN;
+
+    //the next segment is about the same size as the last one,
+    //reserve it up front to avoid growing the buffer while muxing.
+    if (ts_info_ptr_) {
+        size_t last_size = ts_info_ptr_->ts_buffer.data_len();
+        if (reserve_size < last_size + last_size/4) {
+            reserve_size = last_size + last_size/4;
+        }
+    }
+    std::shared_ptr<ts_item_info> ts_info_ptr = std::make_shared<ts_item_info>(reserve_size);
+    ts_info_ptr->reset();
+    ts_info_ptr->set_ts_filename(filename);
+    ts_info_ptr->msn = msn;
+    part_offset_ = 0;
+
+    std::lock_guard<std::mutex> locker(list_mutex_);
+    ts_info_ptr_ = ts_info_ptr;
+    return ts_info_ptr;
+}
+
+//the bytes since the last part are copied out, the segment buffer keeps growing
+void hls_playlist::close_part(int64_t start_dts, int64_t duration, bool independent) {
+    if (!low_latency_ || !ts_info_ptr_ || (start_dts < 0)) {
+        return;
+    }
+    data_buffer& ts_buffer = ts_info_ptr_->ts_buffer;
+    if (ts_buffer.data_len() <= part_offset_) {
+        return;
+    }
+    size_t part_len = ts_buffer.data_len() - part_offset_;
+    std::shared_ptr<ts_part_info> part_ptr = std::make_shared<ts_part_info>(part_len);
+    const std::string& ts_key = ts_info_ptr_->ts_key;
+    std::stringstream uri_ss;
+
+    uri_ss << ts_key.substr(0, ts_key.size() - ext_.size())
+        << ".part" << ts_info_ptr_->parts.size() << ext_;
+    part_ptr->index       = (int64_t)ts_info_ptr_->parts.size();
+    part_ptr->start_dts   = start_dts;
+    part_ptr->duration    = duration;
+    part_ptr->independent = independent;
+    part_ptr->uri         = uri_ss.str();
+    part_ptr->part_buffer.append_data(ts_buffer.data() + part_offset_, part_len);
+    part_offset_ = ts_buffer.data_len();
+
+    std::lock_guard<std::mutex> locker(list_mutex_);
+    ts_info_ptr_->parts.push_back(part_ptr);
+}
+
+void hls_playlist::finish_segment(int64_t next_dts) {
+    if (!ts_info_ptr_) {
+        return;
+    }
+    ts_info_ptr_->finish(next_dts);
+
+    std::lock_guard<std::mutex> locker(list_mutex_);
+    ts_list_.push_back(ts_info_ptr_);
+    if (ts_list_.size() > list_max_) {
+        ts_list_.pop_front();
+    }
+}
+
+void hls_playlist::set_init_segment(std::shared_ptr<data_buffer> init_ptr) {
+    std::lock_guard<std::mutex> locker(list_mutex_);
+    init_ptr_ = init_ptr;
+}
+
+std::shared_ptr<data_buffer> hls_playlist::get_init_segment() {
+    std::lock_guard<std::mutex> locker(list_mutex_);
+    return init_ptr_;
+}
+
+//the peak bitrate(bps) of the finished segments in the list, 0 when none is finished
+int64_t hls_playlist::get_bandwidth() {
+    int64_t bandwidth = 0;
+
+    std::lock_guard<std::mutex> locker(list_mutex_);
+    for (auto item_ptr : ts_list_) {
+        if ((item_ptr == ts_info_ptr_) || (item_ptr->duration <= 0)) {
+            continue;
+        }
+        int64_t bps = (int64_t)item_ptr->ts_buffer.data_len() * 8 * 1000 / item_ptr->duration;
+        if (bps > bandwidth) {
+            bandwidth = bps;
+        }
+    }
+    return bandwidth;
+}
+
+static void write_part_tags(std::stringstream& ss, const std::vector<std::shared_ptr<ts_part_info>>& parts) {
+    for (auto part_ptr : parts) {
+        ss << "#EXT-X-PART:DURATION=" << part_ptr->duration/1000.0;
+        ss << ",URI=\"" << part_ptr->uri << "\"";
+        if (part_ptr->independent) {
+            ss << ",INDEPENDENT=YES";
+        }
+        ss << "\n";
+    }
+}
+
+bool hls_playlist::gen_live_m3u8(std::string& m3u8_header, bool low_latency) {
+    std::stringstream header_ss;
+    std::stringstream item_list_ss;
+    int64_t max_duration = 0;
+    int64_t first_msn = -1;
+
+    std::lock_guard<std::mutex> locker(list_mutex_);
+    if (ts_list_.size() < list_max_) {
+        //log_infof("ts list size:%lu, ts_max:%d", ts_list_.size(), list_max_);
+        return false;
+    }
+    low_latency = low_latency && low_latency_;
+
+    //the parts are only listed for the last two segments
+    size_t part_index = (ts_list_.size() > 2) ? (ts_list_.size() - 2) : 0;
+    size_t index = 0;
+    for (auto iter = ts_list_.begin();
+        iter != ts_list_.end();
+        iter++) {
+        if (index++ == 0) {
+            continue;
+        }
+        if (first_msn < 0) {
+            first_msn = iter->get()->msn;
+        }
+
+        if (iter->get()->duration > max_duration) {
+            max_duration = iter->get()->duration;
+        }
+        if (low_latency && (index > part_index)) {
+            write_part_tags(item_list_ss, iter->get()->parts);
+        }
+        item_list_ss << "#EXTINF:" << iter->get()->duration/1000.0 << ",\n";
+        item_list_ss << iter->get()->ts_key << "\n";
+    }
+
+    if (low_latency && ts_info_ptr_) {
+        const std::string& ts_key = ts_info_ptr_->ts_key;
+
+        write_part_tags(item_list_ss, ts_info_ptr_->parts);
+        item_list_ss << "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"" << ts_key.substr(0, ts_key.size() - ext_.size())
+                    << ".part" << ts_info_ptr_->parts.size() << ext_ << "\"\n";
+    }
+
+    //the target duration is an integer of seconds, not less than any segment duration
+    int64_t target_duration = (max_duration + 999)/1000;
+    if (target_duration <= 0) {
+        target_duration = 1;
+    }
+
+    header_ss << "#EXTM3U\n";
+    if (low_latency || !map_uri_.empty()) {
+        header_ss << "#EXT-X-VERSION:" << (map_uri_.empty() ? 6 : 7) << "\n";
+    } else {
+        header_ss << "#EXT-X-VERSION:3\n";
+        header_ss << "#EXT-X-ALLOW-CACHE:NO\n";
+    }
+    header_ss << "#EXT-X-TARGETDURATION:" << target_duration << "\n";
+    if (low_latency) {
+        header_ss << "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK="
+                << part_duration_ * 3 / 1000.0 << "\n";
+        header_ss << "#EXT-X-PART-INF:PART-TARGET=" << part_duration_/1000.0 << "\n";
+    }
+    header_ss << "#EXT-X-MEDIA-SEQUENCE:" << first_msn << "\n";
+    if (!map_uri_.empty()) {
+        header_ss << "#EXT-X-MAP:URI=\"" << map_uri_ << "\"\n";
+    }
+    header_ss << "\n";
+
+    m3u8_header = header_ss.str();
+    m3u8_header += item_list_ss.str();
+
+    return true;
+}
+
+std::shared_ptr<ts_item_info> hls_playlist::get_item(const std::string& ts_name) {
+    std::lock_guard<std::mutex> locker(list_mutex_);
+    std::shared_ptr<ts_item_info> ts_ptr;
+    for (auto item : ts_list_) {
+        size_t pos = item->ts_filename.find(ts_name);
+        if (pos == std::string::npos) {
+            continue;
+        }
+        ts_ptr = item;
+        break;
+    }
+
+    return ts_ptr;
+}
+
+int hls_playlist::playlist_ready(int64_t msn, int64_t part) {
+    std::lock_guard<std::mutex> locker(list_mutex_);
+
+    if (!ts_info_ptr_) {
+        return 0;
+    }
+
+    int64_t current_msn = ts_info_ptr_->msn;
+    if (msn > current_msn + 2) {
+        return -1;
+    }
+    if (msn < current_msn) {
+        return 1;
+    }
+    if ((msn == current_msn) && (part >= 0) && ((int64_t)ts_info_ptr_->parts.size() > part)) {
+        return 1;
+    }
+    return 0;
+}
+
+int hls_playlist::get_part(const std::string& ts_name, int64_t index,
+                        std::shared_ptr<ts_part_info>& part_ptr, int64_t& msn) {
+    std::lock_guard<std::mutex> locker(list_mutex_);
+
+    if (index < 0) {
+        return -1;
+    }
+
+    for (auto item : ts_list_) {
+        if (item->ts_name != ts_name) {
+            continue;
+        }
+        if (index >= (int64_t)item->parts.size()) {
+            return -1;
+        }
+        part_ptr = item->parts[index];
+        return 0;
+    }
+
+    if (!ts_info_ptr_ || (ts_info_ptr_->ts_name != ts_name)) {
+        return -1;
+    }
+    if (index < (int64_t)ts_info_ptr_->parts.size()) {
+        part_ptr = ts_info_ptr_->parts[index];
+        return 0;
+    }
+    msn = ts_info_ptr_->msn;
+    return 1;
+}
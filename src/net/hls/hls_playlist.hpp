@@ -0,0 +1,186 @@
+#ifndef HLS_PLAYLIST_HPP
+#define HLS_PLAYLIST_HPP
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+#include <list>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include "data_buffer.hpp"
+#include "stringex.hpp"
+
+//ll-hls partial segment, a copy of the segment bytes in [start_dts, start_dts + duration)
+class ts_part_info
+{
+public:
+    ts_part_info(size_t buffer_size = EXTRA_LEN):part_buffer(buffer_size)
+    {
+    }
+    ~ts_part_info()
+    {
+    }
+
+public:
+    int64_t index = 0;
+    int64_t start_dts = -1;
+    int64_t duration = -1;
+    bool independent = false;
+    std::string uri;//relative to the live m3u8, eg: "streamname/1700000000.part0.ts"
+    data_buffer part_buffer;
+};
+
+//notify the part or segment is ready, it's called in the hls worker thread
+class hls_part_callbackI
+{
+public:
+    virtual void on_part_ready(const std::string& key) = 0;
+};
+
+class ts_item_info
+{
+public:
+    ts_item_info(size_t buffer_size = EXTRA_LEN):ts_buffer(buffer_size)
+    {
+    }
+    ~ts_item_info()
+    {
+    }
+
+    void set_ts_filename(const std::string& filename) {
+        ts_filename = filename;
+
+        std::vector<std::string> output_vec;
+        string_split(ts_filename, "/", output_vec);
+        if (output_vec.size() >= 2) {
+            ts_key += output_vec[output_vec.size() - 2];
+            ts_key += "/";
+            ts_key += output_vec[output_vec.size() - 1];
+        } else {
+            ts_key = filename;
+        }
+
+        ts_name = output_vec.empty() ? filename : output_vec.back();
+        size_t pos = ts_name.rfind(".");
+        if (pos != std::string::npos) {
+            ts_name = ts_name.substr(0, pos);
+        }
+    }
+
+    void update_dts(int64_t dts) {
+        if (start_dts < 0) {
+            start_dts = dts;
+        }
+        end_dts = dts;
+
+        if (end_dts > start_dts) {
+            duration = end_dts - start_dts;
+        }
+    }
+    
+    //the segment ends where the next one starts
+    void finish(int64_t next_dts) {
+        if ((start_dts >= 0) && (next_dts > start_dts)) {
+            end_dts  = next_dts;
+            duration = end_dts - start_dts;
+        }
+    }
+    
+    void write(int64_t dts, uint8_t* data, size_t data_len, const std::string& filename) {
+        update_dts(dts);
+
+        if (!filename.empty()) {
+            FILE* file_p = fopen(filename.c_str(), "ab+");
+            if (file_p) {
+                fwrite(data, data_len, 1, file_p);
+                fclose(file_p);
+            }
+        }
+
+        return;
+    }
+
+    //write the whole segment buffer into the file at once
+    void save(const std::string& filename) {
+        if (filename.empty() || (ts_buffer.data_len() == 0)) {
+            return;
+        }
+        FILE* file_p = fopen(filename.c_str(), "wb");
+        if (file_p) {
+            fwrite(ts_buffer.data(), ts_buffer.data_len(), 1, file_p);
+            fclose(file_p);
+        }
+    }
+
+    void reset() {
+        start_dts = -1;
+        end_dts   = -1;
+        duration  = -1;
+        ts_buffer.reset();
+    }
+
+public:
+    int64_t start_dts = -1;
+    int64_t end_dts = -1;
+    int64_t duration = -1;
+    int64_t msn = 0;//media sequence number
+    std::string ts_filename;
+    std::string ts_key;
+    std::string ts_name;//filename without path and extension
+    data_buffer ts_buffer;//data of the segment(mpegts or fmp4), written by the muxer directly
+    std::vector<std::shared_ptr<ts_part_info>> parts;
+};
+
+/*
+the segment list of one output(mpegts or fmp4) of a stream.
+the hls worker writes the current segment and cuts the parts, the http
+thread reads the playlist, the finished segments and the parts.
+*/
+class hls_playlist
+{
+public:
+    hls_playlist(const std::string& ext);
+    ~hls_playlist();
+
+public://called in the hls worker thread
+    void set_list_max(size_t list_max);
+    void set_low_latency(bool enable, size_t part_duration);
+    void set_map_uri(const std::string& uri) { map_uri_ = uri; }
+    const std::string& get_ext() { return ext_; }
+
+    std::shared_ptr<ts_item_info> current() { return ts_info_ptr_; }
+    std::shared_ptr<ts_item_info> new_segment(const std::string& filename, int64_t msn);
+    void close_part(int64_t start_dts, int64_t duration, bool independent);
+    void finish_segment(int64_t next_dts);
+    void set_init_segment(std::shared_ptr<data_buffer> init_ptr);
+
+public://may be called in the http thread
+    bool is_low_latency() { return low_latency_; }
+    bool gen_live_m3u8(std::string& m3u8_header, bool low_latency = false);
+    std::shared_ptr<ts_item_info> get_item(const std::string& ts_name);
+    std::shared_ptr<data_buffer> get_init_segment();
+    int64_t get_bandwidth();
+
+    //return 1: the playlist has the msn(and part), 0: wait, -1: the msn is too far
+    int playlist_ready(int64_t msn, int64_t part);
+    //return 0: the part is found, 1: wait for the part of the msn, -1: not found
+    int get_part(const std::string& ts_name, int64_t index,
+                std::shared_ptr<ts_part_info>& part_ptr, int64_t& msn);
+
+private:
+    std::string ext_;//".ts" or ".m4s"
+    std::string map_uri_;//EXT-X-MAP uri of the fmp4 init segment
+    size_t list_max_ = 3;
+    bool low_latency_ = false;
+    size_t part_duration_ = 500;
+    size_t part_offset_ = 0;//start of the current part in the segment buffer
+
+private:
+    std::mutex list_mutex_;
+    std::shared_ptr<ts_item_info> ts_info_ptr_;
+    std::list<std::shared_ptr<ts_item_info>> ts_list_;
+    std::shared_ptr<data_buffer> init_ptr_;
+};
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef HLS_SEGMENTER_HPP
+#define HLS_SEGMENTER_HPP
+#include <stdint.h>
+#include <stddef.h>
+#include "media_packet.hpp"
+
+#define HLS_PART_DEF_DURATION 500 //ms
+#define HLS_PART_MIN_DURATION 200 //ms
+#define HLS_PART_MAX_DURATION 1000 //ms
+
+enum HLS_CUT_TYPE
+{
+    HLS_CUT_NONE = 0,
+    HLS_CUT_PART,
+    HLS_CUT_SEGMENT
+};
+
+//the part closed by the last cut
+class hls_part_cut
+{
+public:
+    int64_t start_dts = -1;
+    int64_t duration  = 0;
+    bool independent  = false;
+};
+
+/*
+keyframe aligned segmentation shared by the mpegts and fmp4 outputs:
+segments are cut at the video keyframe by the media timestamp, so the
+duration of a segment is the sum of its parts; parts are cut before the
+next packet would make them longer than the part target.
+*/
+class hls_segmenter
+{
+public:
+    hls_segmenter() {}
+    ~hls_segmenter() {}
+
+public:
+    void set_duration(size_t duration) {
+        if (duration > 30) {
+            duration = 30;
+        }
+        if (duration < 2) {
+            duration = 2;
+        }
+        duration_ = duration;
+    }
+    size_t get_duration() { return duration_; }
+
+    void set_low_latency(bool enable, size_t part_duration) {
+        if (part_duration < HLS_PART_MIN_DURATION) {
+            part_duration = HLS_PART_MIN_DURATION;
+        }
+        if (part_duration > HLS_PART_MAX_DURATION) {
+            part_duration = HLS_PART_MAX_DURATION;
+        }
+        low_latency_   = enable;
+        part_duration_ = part_duration;
+    }
+    bool is_low_latency() { return low_latency_; }
+    size_t get_part_duration() { return part_duration_; }
+
+    const hls_part_cut& last_part() { return last_part_; }
+
+    //called for every packet before it's muxed
+    HLS_CUT_TYPE input(MEDIA_PACKET_PTR pkt_ptr) {
+        HLS_CUT_TYPE cut = HLS_CUT_NONE;
+        bool is_media = !pkt_ptr->is_seq_hdr_;
+        int64_t dts = pkt_ptr->dts_;
+
+        if (!started_) {
+            started_ = true;
+            cut = HLS_CUT_SEGMENT;
+        } else if (is_media && (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) && pkt_ptr->is_key_frame_
+            && (segment_start_dts_ >= 0)
+            && ((dts < segment_start_dts_) || ((dts - segment_start_dts_) >= (int64_t)duration_ * 1000))) {
+            cut = HLS_CUT_SEGMENT;
+        } else if (low_latency_ && is_media && (part_start_dts_ >= 0)) {
+            int64_t gap = (last_media_dts_ >= 0) ? (dts - last_media_dts_) : 0;
+            if (gap > part_max_gap_) {
+                part_max_gap_ = gap;
+            }
+            if ((dts < part_start_dts_) ||
+                ((dts - part_start_dts_ + part_max_gap_) > (int64_t)part_duration_)) {
+                cut = HLS_CUT_PART;
+            }
+        }
+
+        if (cut != HLS_CUT_NONE) {
+            last_part_.start_dts   = part_start_dts_;
+            last_part_.duration    = ((part_start_dts_ >= 0) && (dts > part_start_dts_)) ? (dts - part_start_dts_) : 0;
+            last_part_.independent = part_independent_;
+
+            part_start_dts_   = -1;
+            part_max_gap_     = 0;
+            part_video_seen_  = false;
+            part_independent_ = false;
+            if (cut == HLS_CUT_SEGMENT) {
+                segment_start_dts_ = -1;
+            }
+        }
+
+        if (is_media) {
+            last_media_dts_ = dts;
+            if (segment_start_dts_ < 0) {
+                segment_start_dts_ = dts;
+            }
+            if (part_start_dts_ < 0) {
+                part_start_dts_ = dts;
+            }
+            if ((pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) && !part_video_seen_) {
+                part_video_seen_  = true;
+                part_independent_ = pkt_ptr->is_key_frame_;
+            }
+        }
+        return cut;
+    }
+
+private:
+    size_t duration_ = 4;//second
+    bool low_latency_ = false;
+    size_t part_duration_ = HLS_PART_DEF_DURATION;//ms
+
+private:
+    bool started_ = false;
+    int64_t segment_start_dts_ = -1;
+    int64_t part_start_dts_    = -1;
+    int64_t last_media_dts_    = -1;
+    int64_t part_max_gap_      = 0;//the max dts gap between two packets in the part
+    bool part_video_seen_  = false;
+    bool part_independent_ = false;
+    hls_part_cut last_part_;
+};
+
+#endif
@@ -0,0 +1,456 @@
+#include "hls_server.hpp"
+#include "http_common.hpp"
+#include "logger.hpp"
+#include "stringex.hpp"
+#include "timeex.hpp"
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+
+static hls_server* s_hls_server = nullptr;
+
+void hls_handle(const http_request* request, std::shared_ptr<http_response> response) {
+    if (!s_hls_server) {
+        response->close();
+        return;
+    }
+    s_hls_server->handle_request(request, response);
+}
+
+hls_server::hls_server(uv_loop_t* loop, uint16_t port, hls_writer* writer):timer_interface(loop, 200)
+    , server_(loop, port)
+    , writer_(writer)
+{
+    async_ = new uv_async_t;
+    uv_async_init(loop, async_, hls_server::on_async_callback);
+    async_->data = this;
+
+    s_hls_server = this;
+    server_.add_get_handle("/", hls_handle);
+    writer_->set_part_callback(this);
+    start_timer();
+    log_infof("http hls server is listen:%d", port);
+}
+
+hls_server::~hls_server()
+{
+    stop_timer();
+    //no worker calls on_part_ready after it returns
+    writer_->set_part_callback(nullptr);
+    s_hls_server = nullptr;
+    async_->data = nullptr;
+    uv_close((uv_handle_t*)async_, hls_server::on_async_close);
+    async_ = nullptr;
+}
+
+void hls_server::on_async_close(uv_handle_t* handle) {
+    delete (uv_async_t*)handle;
+}
+
+void hls_server::on_async_callback(uv_async_t* handle) {
+    hls_server* server = (hls_server*)handle->data;
+    if (server) {
+        server->on_async();
+    }
+}
+
+//it's called in the hls worker thread
+void hls_server::on_part_ready(const std::string& key) {
+    {
+        std::lock_guard<std::mutex> locker(ready_mutex_);
+        ready_keys_.insert(key);
+    }
+    uv_async_send(async_);
+}
+
+void hls_server::on_async() {
+    std::set<std::string> ready_keys;
+    {
+        std::lock_guard<std::mutex> locker(ready_mutex_);
+        ready_keys.swap(ready_keys_);
+    }
+
+    for (const std::string& key : ready_keys) {
+        auto iter = block_requests_.find(key);
+        if (iter == block_requests_.end()) {
+            continue;
+        }
+        std::list<hls_block_request>& req_list = iter->second;
+        for (auto req_iter = req_list.begin(); req_iter != req_list.end();) {
+            if (try_response(*req_iter)) {
+                req_iter = req_list.erase(req_iter);
+                continue;
+            }
+            req_iter++;
+        }
+        if (req_list.empty()) {
+            block_requests_.erase(iter);
+        }
+    }
+}
+
+void hls_server::on_timer() {
+    int64_t now_ms = now_millisec();
+
+    for (auto iter = block_requests_.begin(); iter != block_requests_.end();) {
+        std::list<hls_block_request>& req_list = iter->second;
+        for (auto req_iter = req_list.begin(); req_iter != req_list.end();) {
+            if (req_iter->response->session_ == nullptr) {
+                req_iter = req_list.erase(req_iter);
+                continue;
+            }
+            if (now_ms >= req_iter->expire_ms) {
+                log_infof("hls block request is timeout, key:%s, msn:%ld, part:%ld",
+                    req_iter->key.c_str(), req_iter->msn, req_iter->part);
+                response_error(req_iter->response, 503, "Service Unavailable");
+                req_iter = req_list.erase(req_iter);
+                continue;
+            }
+            req_iter++;
+        }
+        if (req_list.empty()) {
+            iter = block_requests_.erase(iter);
+            continue;
+        }
+        iter++;
+    }
+}
+
+static const char* s_fmp4_suffix = "_fmp4";
+static const char* s_master_suffix = "_master";
+static const char* s_dvr_suffix = "_dvr";
+static const char* s_dvr_prefix = "dvr_";
+static const char* s_record_suffix = "_record";
+
+static const char* segment_content_type(bool fmp4) {
+    return fmp4 ? "video/mp4" : "video/mp2t";
+}
+
+void hls_server::handle_request(const http_request* request, std::shared_ptr<http_response> response) {
+    std::string uri = request->uri_;
+    if (!uri.empty() && (uri[0] == '/')) {
+        uri = uri.substr(1);
+    }
+
+    size_t pos = uri.rfind(".m3u8");
+    if ((pos != std::string::npos) && (pos + 5 == uri.size())) {
+        handle_m3u8(uri.substr(0, pos), request, response);
+        return;
+    }
+
+    pos = uri.rfind(".ts");
+    if ((pos != std::string::npos) && (pos + 3 == uri.size())) {
+        handle_segment(uri.substr(0, pos), false, request, response);
+        return;
+    }
+
+    pos = uri.rfind(".m4s");
+    if ((pos != std::string::npos) && (pos + 4 == uri.size())) {
+        handle_segment(uri.substr(0, pos), true, request, response);
+        return;
+    }
+
+    pos = uri.rfind(".mp4");
+    if ((pos != std::string::npos) && (pos + 4 == uri.size())) {
+        handle_segment(uri.substr(0, pos), true, request, response);
+        return;
+    }
+
+    pos = uri.rfind(".flv");
+    if ((pos != std::string::npos) && (pos + 4 == uri.size())) {
+        response_file(request, response);
+        return;
+    }
+    log_errorf("hls request uri error:%s", request->uri_.c_str());
+    response_error(response, 404, "Not Found");
+}
+
+void hls_server::handle_m3u8(const std::string& uri, const http_request* request, std::shared_ptr<http_response> response) {
+    std::string key = uri;
+    bool fmp4 = false;
+    size_t suffix_len = strlen(s_record_suffix);
+    if ((key.size() > suffix_len) && (key.compare(key.size() - suffix_len, suffix_len, s_record_suffix) == 0)) {
+        response_file(request, response);
+        return;
+    }
+
+    suffix_len = strlen(s_master_suffix);
+
+    if ((key.size() > suffix_len) && (key.compare(key.size() - suffix_len, suffix_len, s_master_suffix) == 0)) {
+        response_master_m3u8(key.substr(0, key.size() - suffix_len), response);
+        return;
+    }
+
+    suffix_len = strlen(s_dvr_suffix);
+    if ((key.size() > suffix_len) && (key.compare(key.size() - suffix_len, suffix_len, s_dvr_suffix) == 0)) {
+        response_dvr_m3u8(key.substr(0, key.size() - suffix_len), request, response);
+        return;
+    }
+
+    suffix_len = strlen(s_fmp4_suffix);
+    if ((key.size() > suffix_len) && (key.compare(key.size() - suffix_len, suffix_len, s_fmp4_suffix) == 0)) {
+        key  = key.substr(0, key.size() - suffix_len);
+        fmp4 = true;
+    }
+
+    std::shared_ptr<mpegts_handle> handle_ptr = writer_->get_mpegts_handle(key);
+    hls_playlist* playlist = handle_ptr ? handle_ptr->get_playlist(fmp4) : nullptr;
+    if (!playlist) {
+        log_errorf("fail to get hls playlist by key:%s, fmp4:%d", key.c_str(), fmp4);
+        response_error(response, 404, "Not Found");
+        return;
+    }
+
+    auto msn_iter  = request->params.find("_HLS_msn");
+    auto part_iter = request->params.find("_HLS_part");
+    if (msn_iter == request->params.end()) {
+        if (part_iter != request->params.end()) {
+            response_error(response, 400, "Bad Request");
+            return;
+        }
+        response_m3u8(playlist, response);
+        return;
+    }
+
+    if (!playlist->is_low_latency()) {
+        response_m3u8(playlist, response);
+        return;
+    }
+
+    hls_block_request block_req;
+    block_req.response = response;
+    block_req.key      = key;
+    block_req.fmp4     = fmp4;
+    block_req.msn      = atoll(msn_iter->second.c_str());
+    block_req.part     = (part_iter != request->params.end()) ? atoll(part_iter->second.c_str()) : -1;
+
+    if (!try_response(block_req)) {
+        block_request(block_req, handle_ptr);
+    }
+}
+
+void hls_server::handle_segment(const std::string& uri, bool fmp4, const http_request* request,
+                            std::shared_ptr<http_response> response) {
+    std::vector<std::string> output_vec;
+
+    string_split(uri, "/", output_vec);
+    if (output_vec.size() < 3) {
+        log_errorf("hls segment uri error:%s", uri.c_str());
+        response_error(response, 404, "Not Found");
+        return;
+    }
+    size_t count = output_vec.size();
+    std::string key  = output_vec[count - 3] + "/" + output_vec[count - 2];
+    std::string name = output_vec[count - 1];
+
+    std::shared_ptr<mpegts_handle> handle_ptr = writer_->get_mpegts_handle(key);
+    if (!fmp4 && handle_ptr && (name.compare(0, strlen(s_dvr_prefix), s_dvr_prefix) == 0)) {
+        response_dvr_segment(handle_ptr, atoll(name.substr(strlen(s_dvr_prefix)).c_str()), response);
+        return;
+    }
+
+    hls_playlist* playlist = handle_ptr ? handle_ptr->get_playlist(fmp4) : nullptr;
+    if (!playlist) {
+        //the stream is over, the segment may be recorded
+        response_file(request, response);
+        return;
+    }
+
+    if (fmp4 && (name == "init")) {
+        std::shared_ptr<data_buffer> init_ptr = playlist->get_init_segment();
+        if (!init_ptr) {
+            response_error(response, 404, "Not Found");
+            return;
+        }
+        response_segment(*init_ptr, segment_content_type(fmp4), response);
+        return;
+    }
+
+    size_t pos = name.find(".part");
+    if (pos != std::string::npos) {
+        hls_block_request block_req;
+        block_req.response = response;
+        block_req.key      = key;
+        block_req.fmp4     = fmp4;
+        block_req.ts_name  = name.substr(0, pos);
+        block_req.part     = atoll(name.substr(pos + 5).c_str());
+
+        if (!try_response(block_req)) {
+            block_request(block_req, handle_ptr);
+        }
+        return;
+    }
+
+    std::shared_ptr<ts_item_info> ts_item = playlist->get_item("/" + name + playlist->get_ext());
+    if (!ts_item) {
+        //it's out of the live playlist, the segment may be recorded
+        response_file(request, response);
+        return;
+    }
+    response_segment(ts_item->ts_buffer, segment_content_type(fmp4), response);
+}
+
+bool hls_server::try_response(hls_block_request& block_req) {
+    std::shared_ptr<mpegts_handle> handle_ptr = writer_->get_mpegts_handle(block_req.key);
+    hls_playlist* playlist = handle_ptr ? handle_ptr->get_playlist(block_req.fmp4) : nullptr;
+    if (!playlist) {
+        response_error(block_req.response, 404, "Not Found");
+        return true;
+    }
+
+    if (block_req.ts_name.empty()) {
+        int ret = playlist->playlist_ready(block_req.msn, block_req.part);
+        if (ret < 0) {
+            response_error(block_req.response, 400, "Bad Request");
+            return true;
+        }
+        if (ret == 0) {
+            return false;
+        }
+        response_m3u8(playlist, block_req.response);
+        return true;
+    }
+
+    std::shared_ptr<ts_part_info> part_ptr;
+    int64_t msn = -1;
+    int ret = playlist->get_part(block_req.ts_name, block_req.part, part_ptr, msn);
+    if (ret > 0) {
+        block_req.msn = msn;
+        return false;
+    }
+    if (ret < 0) {
+        response_error(block_req.response, 404, "Not Found");
+        return true;
+    }
+    response_segment(part_ptr->part_buffer, segment_content_type(block_req.fmp4), block_req.response);
+    return true;
+}
+
+void hls_server::block_request(hls_block_request& block_req, std::shared_ptr<mpegts_handle> handle_ptr) {
+    //the server should answer in three target durations
+    block_req.expire_ms = now_millisec() + (int64_t)handle_ptr->get_ts_duration() * 3 * 1000;
+    block_requests_[block_req.key].push_back(block_req);
+}
+
+void hls_server::response_m3u8(hls_playlist* playlist, std::shared_ptr<http_response> response) {
+    std::string m3u8_data;
+
+    if (!playlist->gen_live_m3u8(m3u8_data, playlist->is_low_latency())) {
+        log_infof("live m3u8 is not ready");
+        response_error(response, 404, "Not Found");
+        return;
+    }
+    response->add_header("Access-Control-Allow-Origin", "*");
+    response->add_header("Cache-Control", "no-cache");
+    response->add_header("Content-Type", "application/vnd.apple.mpegurl");
+    response->write(m3u8_data.c_str(), m3u8_data.size());
+}
+
+void hls_server::response_master_m3u8(const std::string& key, std::shared_ptr<http_response> response) {
+    std::shared_ptr<mpegts_handle> handle_ptr = writer_->get_mpegts_handle(key);
+    std::string m3u8_data;
+
+    if (!handle_ptr || !handle_ptr->gen_master_m3u8(m3u8_data)) {
+        log_errorf("fail to get hls master playlist by key:%s", key.c_str());
+        response_error(response, 404, "Not Found");
+        return;
+    }
+    response->add_header("Access-Control-Allow-Origin", "*");
+    response->add_header("Cache-Control", "no-cache");
+    response->add_header("Content-Type", "application/vnd.apple.mpegurl");
+    response->write(m3u8_data.c_str(), m3u8_data.size());
+}
+
+void hls_server::response_dvr_m3u8(const std::string& key, const http_request* request,
+                                std::shared_ptr<http_response> response) {
+    std::shared_ptr<mpegts_handle> handle_ptr = writer_->get_mpegts_handle(key);
+    std::shared_ptr<hls_dvr> dvr_ptr = handle_ptr ? handle_ptr->get_dvr() : nullptr;
+    std::string m3u8_data;
+
+    auto start_iter = request->params.find("_HLS_start");
+    bool has_start  = (start_iter != request->params.end());
+    double start_sec = has_start ? atof(start_iter->second.c_str()) : 0.0;
+
+    if (!dvr_ptr || !dvr_ptr->gen_m3u8(m3u8_data, has_start, start_sec)) {
+        log_errorf("fail to get hls dvr playlist by key:%s", key.c_str());
+        response_error(response, 404, "Not Found");
+        return;
+    }
+    response->add_header("Access-Control-Allow-Origin", "*");
+    response->add_header("Cache-Control", "no-cache");
+    response->add_header("Content-Type", "application/vnd.apple.mpegurl");
+    response->write(m3u8_data.c_str(), m3u8_data.size());
+}
+
+//the segment is mapped from the dvr log and sent from the page cache without copying
+void hls_server::response_dvr_segment(std::shared_ptr<mpegts_handle> handle_ptr, int64_t msn,
+                                    std::shared_ptr<http_response> response) {
+    std::shared_ptr<hls_dvr> dvr_ptr = handle_ptr->get_dvr();
+    std::shared_ptr<file_mapping> mapping_ptr = dvr_ptr ? dvr_ptr->map_segment(msn) : nullptr;
+
+    if (!mapping_ptr) {
+        log_errorf("fail to get hls dvr segment msn:%ld", msn);
+        response_error(response, 404, "Not Found");
+        return;
+    }
+    response->add_header("Access-Control-Allow-Origin", "*");
+    response->add_header("Content-Type", segment_content_type(false));
+    response->write(mapping_ptr, mapping_ptr->data(), mapping_ptr->data_len());
+}
+
+static std::string file_content_type(const std::string& path) {
+    static const std::vector<std::pair<std::string, std::string>> types = {
+        {".m3u8", "application/vnd.apple.mpegurl"},
+        {".ts",   "video/mp2t"},
+        {".m4s",  "video/mp4"},
+        {".mp4",  "video/mp4"},
+        {".flv",  "video/x-flv"}
+    };
+    for (auto& item : types) {
+        const std::string& ext = item.first;
+        if ((path.size() > ext.size()) && (path.compare(path.size() - ext.size(), ext.size(), ext) == 0)) {
+            return item.second;
+        }
+    }
+    return "application/octet-stream";
+}
+
+void hls_server::response_file(const http_request* request, std::shared_ptr<http_response> response) {
+    std::string uri = request->uri_;
+    if (!uri.empty() && (uri[0] == '/')) {
+        uri = uri.substr(1);
+    }
+    if (uri.find("..") != std::string::npos) {
+        response_error(response, 403, "Forbidden");
+        return;
+    }
+
+    std::string path = writer_->get_path();
+    if (!path.empty() && (path.back() != '/')) {
+        path += "/";
+    }
+    path += uri;
+
+    std::shared_ptr<http_file> file_ptr = file_cache_.get_file(path);
+    if (!file_ptr) {
+        log_errorf("fail to get hls file:%s", path.c_str());
+        response_error(response, 404, "Not Found");
+        return;
+    }
+    http_response_file(request, response, file_ptr, file_content_type(path));
+}
+
+void hls_server::response_segment(data_buffer& buffer, const std::string& content_type, std::shared_ptr<http_response> response) {
+    response->add_header("Access-Control-Allow-Origin", "*");
+    response->add_header("Content-Type", content_type);
+    response->write(buffer.data(), buffer.data_len());
+}
+
+void hls_server::response_error(std::shared_ptr<http_response> response, int code, const std::string& status) {
+    std::string err_str = std::to_string(code) + " " + status;
+
+    response->set_status_code(code);
+    response->set_status(status);
+    response->add_header("Access-Control-Allow-Origin", "*");
+    response->write(err_str.c_str(), err_str.length());
+}
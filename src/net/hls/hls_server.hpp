@@ -0,0 +1,94 @@
+#ifndef HLS_SERVER_HPP
+#define HLS_SERVER_HPP
+#include "http_server.hpp"
+#include "hls_writer.hpp"
+#include "http_file_cache.hpp"
+#include "mpegts_handle.hpp"
+#include "timer.hpp"
+#include <uv.h>
+#include <stdint.h>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <list>
+#include <unordered_map>
+
+//a blocking playlist reload or a preload hint part request, held until the part is ready
+class hls_block_request
+{
+public:
+    std::shared_ptr<http_response> response;
+    std::string key;     //app/streamname
+    std::string ts_name; //empty for the playlist request
+    bool fmp4 = false;   //the fmp4 output or the mpegts one
+    int64_t msn  = -1;
+    int64_t part = -1;
+    int64_t expire_ms = 0;
+};
+
+/*
+serve the live m3u8, the segments and the ll-hls parts from memory:
+    GET /app/streamname.m3u8[?_HLS_msn=x&_HLS_part=y]
+    GET /app/streamname/1700000000.ts
+    GET /app/streamname/1700000000.part0.ts
+the fmp4 output of the same stream:
+    GET /app/streamname_fmp4.m3u8[?_HLS_msn=x&_HLS_part=y]
+    GET /app/streamname/init.mp4
+    GET /app/streamname/1700000000.m4s
+    GET /app/streamname/1700000000.part0.m4s
+the master playlist of the abr ladder:
+    GET /app/streamname_master.m3u8
+the time-shift window, the segments are mapped from the dvr log:
+    GET /app/streamname_dvr.m3u8[?_HLS_start=-60]
+    GET /app/streamname/dvr_100.ts
+the recorded files in the hls path are sent from the disk by sendfile:
+    GET /app/streamname_record.m3u8
+    GET /app/streamname/1700000000.ts(not in memory any more)
+    GET /app/streamname.flv
+the hls workers notify the parts through uv_async, the blocked requests
+are answered in the uv loop thread.
+*/
+class hls_server : public timer_interface, public hls_part_callbackI
+{
+public:
+    hls_server(uv_loop_t* loop, uint16_t port, hls_writer* writer);
+    virtual ~hls_server();
+
+public:
+    void handle_request(const http_request* request, std::shared_ptr<http_response> response);
+
+public:
+    virtual void on_timer() override;
+    virtual void on_part_ready(const std::string& key) override;
+
+private:
+    static void on_async_callback(uv_async_t* handle);
+    static void on_async_close(uv_handle_t* handle);
+    void on_async();
+    void handle_m3u8(const std::string& key, const http_request* request, std::shared_ptr<http_response> response);
+    void handle_segment(const std::string& uri, bool fmp4, const http_request* request, std::shared_ptr<http_response> response);
+    void response_file(const http_request* request, std::shared_ptr<http_response> response);
+    bool try_response(hls_block_request& block_req);
+    void response_m3u8(hls_playlist* playlist, std::shared_ptr<http_response> response);
+    void response_master_m3u8(const std::string& key, std::shared_ptr<http_response> response);
+    void response_dvr_m3u8(const std::string& key, const http_request* request, std::shared_ptr<http_response> response);
+    void response_dvr_segment(std::shared_ptr<mpegts_handle> handle_ptr, int64_t msn,
+                            std::shared_ptr<http_response> response);
+    void response_segment(data_buffer& buffer, const std::string& content_type, std::shared_ptr<http_response> response);
+    void response_error(std::shared_ptr<http_response> response, int code, const std::string& status);
+    void block_request(hls_block_request& block_req, std::shared_ptr<mpegts_handle> handle_ptr);
+
+private:
+    http_server server_;
+    hls_writer* writer_ = nullptr;
+    uv_async_t* async_ = nullptr;//released in the close callback, after the server
+    http_file_cache file_cache_;
+
+private:
+    std::mutex ready_mutex_;
+    std::set<std::string> ready_keys_;//the streams whose parts are ready, written by the hls workers
+    std::unordered_map<std::string, std::list<hls_block_request>> block_requests_;
+};
+
+#endif //HLS_SERVER_HPP
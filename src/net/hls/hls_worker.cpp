@@ -1,104 +1,16 @@
 #include "hls_worker.hpp"
 #include "logger.hpp"
 #include "stringex.hpp"
+#include "timeex.hpp"
 
-static hls_worker* s_worker = nullptr;
-
-/*
-void response_error(std::shared_ptr<http_response> response) {
-    std::string err_str = "403 Forbidden";
-    //StatusForbidden:                    ,
-    response->set_status_code(403);
-    response->set_status("Forbidden");
-    response->write(err_str.c_str(), err_str.length());
-    return;
-}
-
-void hls_handle(const http_request* request, std::shared_ptr<http_response> response) {
-    size_t pos = request->uri_.find(".m3u8");
-    if (pos != std::string::npos) {
-        std::string m3u8_header;
-        std::string key = request->uri_.substr(0, pos);
-        if (key[0] == '/') {
-            key = key.substr(1);
-        }
-        log_infof("http request m3u8 uri:%s, key:%s", request->uri_.c_str(), key.c_str());
-        std::shared_ptr<mpegts_handle> handle_ptr = s_worker->get_mpegts_handle(key);
-        if (!handle_ptr) {
-            log_errorf("fail to get mpegts handle by key:%s", key.c_str());
-            response_error(response);
-            return;
-        }
-        bool ret = handle_ptr->gen_live_m3u8(m3u8_header);
-        if (!ret) {
-            log_infof("live m3u8 is not ready");
-            response_error(response);
-            return;
-        }
-        log_infof("hls response m3u8_header:%s", m3u8_header.c_str());
-
-        response->add_header("Access-Control-Allow-Origin", "*");
-        response->add_header("Cache-Control", "no-cache");
-        response->add_header("Content-Type", "application/x-mpegURL");
-        response->write(m3u8_header.c_str(), m3u8_header.size());
-    } else {
-        pos = request->uri_.find(".ts");
-        if (pos == std::string::npos) {
-            log_errorf("http request error uri:%s", request->uri_.c_str());
-            response_error(response);
-            return;
-        }
-        std::string key = request->uri_.substr(0, pos);
-        std::string handle_key;
-        std::vector<std::string> output_vec;
-        log_infof("http request ts file uri:%s, key:%s", request->uri_.c_str(), key.c_str());
-
-        string_split(key, "/", output_vec);
-        if (output_vec.size() >= 2) {
-            if (output_vec[0].empty() && output_vec.size() >= 2) {
-                handle_key = output_vec[1];
-                handle_key += "/";
-                handle_key += output_vec[2];
-            } else {
-                handle_key = output_vec[0];
-                handle_key += "/";
-                handle_key += output_vec[1];
-            }
-        } else {
-            handle_key = key;
-        }
-        std::shared_ptr<mpegts_handle> handle_ptr = s_worker->get_mpegts_handle(handle_key);
-        if (!handle_ptr) {
-            log_errorf("fail to get mpegts handle by key:%s", handle_key.c_str());
-            response_error(response);
-            return;
-        }
-        std::shared_ptr<ts_item_info> ts_item = handle_ptr->get_mpegts_item(key);
-        if (!ts_item) {
-            log_errorf("fail to get mpegts file item by key:%s", key.c_str());
-            response_error(response);
-            return;
-        }
-        log_infof("get http mpegts filename:%s, file key:%s, data len:%lu",
-                ts_item->ts_filename.c_str(), ts_item->ts_key.c_str(),
-                ts_item->ts_buffer.data_len());
-		response->add_header("Access-Control-Allow-Origin", "*");
-		response->add_header("Content-Type", "video/mp2ts");
-        response->write(ts_item->ts_buffer.data(), ts_item->ts_buffer.data_len());
-    }
-
-}
-*/
-hls_worker::hls_worker(uv_loop_t* loop):timer_interface(loop, 5000)
+hls_worker::hls_worker(size_t index):index_(index)
+    , pkt_queue_(HLS_WORKER_QUEUE_SIZE)
 {
-    run();
-    start_timer();
 }
 
 hls_worker::~hls_worker()
 {
     stop();
-    stop_timer();
 }
 
 void hls_worker::run() {
@@ -106,8 +18,6 @@ void hls_worker::run() {
         return;
     }
     run_flag_ = true;
-    //server_.add_get_handle("/", hls_handle);
-    s_worker = this;
     run_thread_ptr_ = std::make_shared<std::thread>(&hls_worker::on_work, this);
 }
 
@@ -116,27 +26,42 @@ void hls_worker::stop() {
         return;
     }
     run_flag_ = false;
+    {
+        std::unique_lock<std::mutex> locker(wait_mutex_);
+        wait_cond_.notify_one();
+    }
     run_thread_ptr_->join();
 }
 
 void hls_worker::insert_packet(MEDIA_PACKET_PTR pkt_ptr) {
-    std::unique_lock<std::mutex> locker(queue_mutex_);
-    
-    pkt_queue_.push(pkt_ptr);
-    return;
-}
+    if (!pkt_queue_.push(pkt_ptr)) {
+        int64_t drop_count = drop_count_.fetch_add(1) + 1;
+        if ((drop_count % 1000) == 1) {
+            log_errorf("hls worker[%lu] queue is full, drop packet key:%s, drop count:%ld",
+                index_, pkt_ptr->key_.c_str(), drop_count);
+        }
+        return;
+    }
 
-MEDIA_PACKET_PTR hls_worker::get_packet() {
-    std::unique_lock<std::mutex> locker(queue_mutex_);
-    MEDIA_PACKET_PTR pkt_ptr;
-    if (pkt_queue_.empty()) {
-        return pkt_ptr;
+    //pairs with the fence in wait_packet: either the worker sees the packet
+    //before sleeping, or we see waiting_ and wake it up.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_.load(std::memory_order_relaxed)) {
+        std::unique_lock<std::mutex> locker(wait_mutex_);
+        wait_cond_.notify_one();
     }
+    return;
+}
 
-    pkt_ptr = pkt_queue_.front();
-    pkt_queue_.pop();
+void hls_worker::wait_packet(int64_t timeout_ms) {
+    std::unique_lock<std::mutex> locker(wait_mutex_);
 
-    return pkt_ptr;
+    waiting_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (pkt_queue_.empty() && run_flag_) {
+        wait_cond_.wait_for(locker, std::chrono::milliseconds(timeout_ms));
+    }
+    waiting_.store(false, std::memory_order_relaxed);
 }
 
 void hls_worker::on_handle_packet(MEDIA_PACKET_PTR pkt_ptr) {
@@ -150,11 +75,38 @@ void hls_worker::on_handle_packet(MEDIA_PACKET_PTR pkt_ptr) {
             pkt_ptr->app_.c_str(), pkt_ptr->streamname_.c_str(), pkt_ptr->key_.c_str());
         return;
     }
+
+    //the transcoder copies what it needs before the handle changes the packet
+    auto abr_iter = abr_transcodes_.find(pkt_ptr->key_);
+    if (abr_iter != abr_transcodes_.end()) {
+        abr_iter->second->input_packet(pkt_ptr);
+    }
     handle->handle_media_packet(pkt_ptr);
     return;
 }
 
+//the renditions of the app, nullptr for the streams which are renditions themselves
+const ABR_RENDITIONS* hls_worker::get_abr_renditions(MEDIA_PACKET_PTR pkt_ptr) {
+    if (!abr_pool_ || !abr_cb_) {
+        return nullptr;
+    }
+    auto iter = abr_apps_.find(pkt_ptr->app_);
+    if (iter == abr_apps_.end()) {
+        return nullptr;
+    }
+    const std::string& streamname = pkt_ptr->streamname_;
+    for (const abr_rendition& rendition : iter->second) {
+        std::string suffix = "_" + rendition.name;
+        if ((streamname.size() > suffix.size()) &&
+            (streamname.compare(streamname.size() - suffix.size(), suffix.size(), suffix) == 0)) {
+            return nullptr;
+        }
+    }
+    return &iter->second;
+}
+
 std::shared_ptr<mpegts_handle> hls_worker::get_mpegts_handle(MEDIA_PACKET_PTR pkt_ptr) {
+    //the map is only modified in the worker thread, so the lookup here needs no lock
     auto iter = mpegts_handles_.find(pkt_ptr->key_);
     if (iter != mpegts_handles_.end()) {
         return iter->second;
@@ -163,12 +115,30 @@ std::shared_ptr<mpegts_handle> hls_worker::get_mpegts_handle(MEDIA_PACKET_PTR pk
                                                                             pkt_ptr->streamname_,
                                                                             path_,
                                                                             rec_enable_);
+    handle_ptr->set_low_latency(low_latency_, part_duration_);
+    handle_ptr->set_part_callback(this);
+    handle_ptr->set_fmp4_enable(fmp4_enable_);
+    handle_ptr->set_dvr_window(dvr_window_ms_);
+
+    const ABR_RENDITIONS* renditions = get_abr_renditions(pkt_ptr);
+    if (renditions) {
+        std::shared_ptr<abr_transcode> abr_ptr = std::make_shared<abr_transcode>(pkt_ptr->app_,
+                                                                            pkt_ptr->streamname_,
+                                                                            *renditions,
+                                                                            abr_pool_,
+                                                                            abr_cb_);
+        abr_transcodes_[pkt_ptr->key_] = abr_ptr;
+        handle_ptr->set_abr_renditions(*renditions);
+    }
+
+    std::unique_lock<std::mutex> locker(handles_mutex_);
     mpegts_handles_[pkt_ptr->key_] = handle_ptr;
 
     return handle_ptr;
 }
 
 std::shared_ptr<mpegts_handle> hls_worker::get_mpegts_handle(const std::string& key) {
+    std::unique_lock<std::mutex> locker(handles_mutex_);
     std::shared_ptr<mpegts_handle> handle_ptr;
     auto iter = mpegts_handles_.find(key);
     if (iter == mpegts_handles_.end()) {
@@ -179,20 +149,34 @@ std::shared_ptr<mpegts_handle> hls_worker::get_mpegts_handle(const std::string&
     return handle_ptr;
 }
 
+//it's called by the handles in the worker thread
+void hls_worker::on_part_ready(const std::string& key) {
+    std::lock_guard<std::mutex> locker(part_mutex_);
+    if (part_cb_) {
+        part_cb_->on_part_ready(key);
+    }
+}
+
 void hls_worker::on_work() {
-    log_infof("http hls is running...");
+    log_infof("http hls worker[%lu] is running...", index_);
+    last_check_ms_ = now_millisec();
+
     while (run_flag_) {
-        MEDIA_PACKET_PTR pkt_ptr = get_packet();
-        if (!pkt_ptr) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        MEDIA_PACKET_PTR pkt_ptr;
+        while (pkt_queue_.pop(pkt_ptr)) {
+            on_handle_packet(pkt_ptr);
+        }
+
+        int64_t now_ms = now_millisec();
+        if ((now_ms - last_check_ms_) >= HLS_CHECK_TIMEOUT_MS) {
+            last_check_ms_ = now_ms;
+            check_timeout();
         }
-        on_handle_packet(pkt_ptr);
-    }
-    log_infof("http hls is over...");
-}
 
-void hls_worker::on_timer() {
-    check_timeout();
+        int64_t wait_ms = HLS_CHECK_TIMEOUT_MS - (now_ms - last_check_ms_);
+        wait_packet((wait_ms > 0) ? wait_ms : 1);
+    }
+    log_infof("http hls worker[%lu] is over...", index_);
 }
 
 void hls_worker::check_timeout() {
@@ -205,7 +189,14 @@ void hls_worker::check_timeout() {
         }
         log_infof("mpegts handle is timeout, key:%s", iter->first.c_str());
         iter->second->flush();
+
+        auto abr_iter = abr_transcodes_.find(iter->first);
+        if (abr_iter != abr_transcodes_.end()) {
+            abr_iter->second->stop();
+            abr_transcodes_.erase(abr_iter);
+        }
+
+        std::unique_lock<std::mutex> locker(handles_mutex_);
         iter = mpegts_handles_.erase(iter);
     }
 }
-    
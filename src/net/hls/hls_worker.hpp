@@ -4,7 +4,7 @@
 #include <stddef.h>
 #include <string>
 #include <memory>
-#include <queue>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 #include <map>
@@ -12,13 +12,23 @@
 
 #include "media_packet.hpp"
 #include "mpegts_handle.hpp"
-#include "http_server.hpp"
-#include "timer.hpp"
+#include "mpsc_ring.hpp"
+#include "abr_transcode.hpp"
 
-class hls_worker : public timer_interface
+#define HLS_WORKER_QUEUE_SIZE    8192
+#define HLS_CHECK_TIMEOUT_MS     5000
+
+/*
+one hls worker thread owns the mpegts handles of the streams hashed to it.
+packets are handed over through a lock-free ring, the thread sleeps on
+the condition variable only when the ring is empty.
+the handles notify the parts through the worker, so the callback can be
+changed from other threads while the handles are alive.
+*/
+class hls_worker : public hls_part_callbackI
 {
 public:
-    hls_worker(uv_loop_t* loop);
+    hls_worker(size_t index);
     virtual ~hls_worker();
 
 public:
@@ -26,31 +36,67 @@ public:
     void stop();
     void set_path(const std::string& path) { path_ = path; }
     void set_rec_enable(bool enable) { rec_enable_ = enable; }
+    void set_low_latency(bool enable, size_t part_duration) {
+        low_latency_   = enable;
+        part_duration_ = part_duration;
+    }
+    //it waits for the notification in progress, the old callback isn't called after it returns
+    void set_part_callback(hls_part_callbackI* cb) {
+        std::lock_guard<std::mutex> locker(part_mutex_);
+        part_cb_ = cb;
+    }
+    void set_fmp4_enable(bool enable) { fmp4_enable_ = enable; }
+    void set_dvr_window(int64_t window_ms) { dvr_window_ms_ = window_ms; }
+    void set_abr(encoder_pool* pool, abr_packet_callbackI* cb,
+                const std::map<std::string, ABR_RENDITIONS>& abr_apps) {
+        abr_pool_ = pool;
+        abr_cb_   = cb;
+        abr_apps_ = abr_apps;
+    }
     void insert_packet(MEDIA_PACKET_PTR pkt_ptr);
     std::shared_ptr<mpegts_handle> get_mpegts_handle(const std::string& key);
 
-protected:
-    virtual void on_timer() override;
+public:
+    virtual void on_part_ready(const std::string& key) override;
 
 private:
-    MEDIA_PACKET_PTR get_packet();
     void on_work();
+    void wait_packet(int64_t timeout_ms);
     void on_handle_packet(MEDIA_PACKET_PTR pkt_ptr);
     void check_timeout();
     std::shared_ptr<mpegts_handle> get_mpegts_handle(MEDIA_PACKET_PTR pkt_ptr);
+    const ABR_RENDITIONS* get_abr_renditions(MEDIA_PACKET_PTR pkt_ptr);
 
 private:
-    bool run_flag_ = false;
+    size_t index_ = 0;
+    std::atomic<bool> run_flag_{false};
     std::shared_ptr<std::thread> run_thread_ptr_;
 
 private:
-    std::queue<MEDIA_PACKET_PTR> pkt_queue_;
-    std::mutex queue_mutex_;
+    mpsc_ring<MEDIA_PACKET_PTR> pkt_queue_;
+    std::mutex wait_mutex_;
+    std::condition_variable wait_cond_;
+    std::atomic<bool> waiting_{false};
+    int64_t last_check_ms_ = 0;
+    std::atomic<int64_t> drop_count_{0};//the ring has several producers
 
 private:
     std::string path_;
     bool rec_enable_ = false;
+    bool low_latency_ = false;
+    bool fmp4_enable_ = false;
+    int64_t dvr_window_ms_ = 0;
+    size_t part_duration_ = HLS_PART_DEF_DURATION;
+    std::mutex part_mutex_;
+    hls_part_callbackI* part_cb_ = nullptr;
+    std::mutex handles_mutex_;//only the writes in the worker and the reads from other threads lock it
     std::map<std::string, std::shared_ptr<mpegts_handle>> mpegts_handles_;
+
+private://the abr ladders of the source streams, only used in the worker thread
+    encoder_pool* abr_pool_ = nullptr;
+    abr_packet_callbackI* abr_cb_ = nullptr;
+    std::map<std::string, ABR_RENDITIONS> abr_apps_;//app -> renditions
+    std::map<std::string, std::shared_ptr<abr_transcode>> abr_transcodes_;
 };
 
 #endif
@@ -1,27 +1,90 @@
 #include "hls_writer.hpp"
 
-hls_writer::hls_writer(uv_loop_t* loop,
-                    const std::string& path, bool rec_enable):work_(loop)
+hls_writer::hls_writer(const std::string& path, bool rec_enable, size_t worker_count):path_(path)
 {
-    work_.set_path(path);
-    work_.set_rec_enable(rec_enable);
+    if (worker_count == 0) {
+        worker_count = 1;
+    }
+    for (size_t index = 0; index < worker_count; index++) {
+        std::shared_ptr<hls_worker> worker_ptr = std::make_shared<hls_worker>(index);
+        worker_ptr->set_path(path);
+        worker_ptr->set_rec_enable(rec_enable);
+        workers_.push_back(worker_ptr);
+    }
 }
 
 hls_writer::~hls_writer()
 {
-
+    //the encoders write into the workers, so they stop first
+    if (abr_pool_) {
+        abr_pool_->stop();
+    }
 }
 
 void hls_writer::run() {
-    work_.run();
+    if (abr_pool_) {
+        abr_pool_->start();
+    }
+    for (auto worker_ptr : workers_) {
+        worker_ptr->run();
+    }
+}
+
+void hls_writer::set_low_latency(bool enable, size_t part_duration) {
+    for (auto worker_ptr : workers_) {
+        worker_ptr->set_low_latency(enable, part_duration);
+    }
+}
+
+void hls_writer::set_part_callback(hls_part_callbackI* cb) {
+    for (auto worker_ptr : workers_) {
+        worker_ptr->set_part_callback(cb);
+    }
+}
+
+void hls_writer::set_fmp4_enable(bool enable) {
+    for (auto worker_ptr : workers_) {
+        worker_ptr->set_fmp4_enable(enable);
+    }
+}
+
+void hls_writer::set_dvr_window(int64_t window_ms) {
+    for (auto worker_ptr : workers_) {
+        worker_ptr->set_dvr_window(window_ms);
+    }
+}
+
+void hls_writer::set_abr(size_t thread_count, const std::map<std::string, ABR_RENDITIONS>& abr_apps) {
+    if (abr_apps.empty()) {
+        return;
+    }
+    abr_pool_ = std::make_shared<encoder_pool>(thread_count);
+    for (auto worker_ptr : workers_) {
+        worker_ptr->set_abr(abr_pool_.get(), this, abr_apps);
+    }
+}
+
+//all packets of one stream go to the same worker, so the stream is muxed in order
+hls_worker* hls_writer::get_worker(const std::string& key) {
+    size_t index = std::hash<std::string>()(key) % workers_.size();
+    return workers_[index].get();
+}
+
+std::shared_ptr<mpegts_handle> hls_writer::get_mpegts_handle(const std::string& key) {
+    return get_worker(key)->get_mpegts_handle(key);
 }
 
 int hls_writer::write_packet(MEDIA_PACKET_PTR pkt_ptr) {
-    auto new_pkt_ptr = pkt_ptr->copy();
-    work_.insert_packet(new_pkt_ptr);
+    //media_stream_manager has copied the packet for the hls writer already
+    get_worker(pkt_ptr->key_)->insert_packet(pkt_ptr);
     return 0;
 }
 
+//the renditions are written as new streams, they may go to other workers
+void hls_writer::on_abr_packet(MEDIA_PACKET_PTR pkt_ptr) {
+    write_packet(pkt_ptr);
+}
+
 std::string hls_writer::get_key() {
     //ignore
     return "";
@@ -3,18 +3,27 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <string>
+#include <vector>
+#include <memory>
 
 #include "media_packet.hpp"
 #include "hls_worker.hpp"
 
-class hls_writer : public av_writer_base
+class hls_writer : public av_writer_base, public abr_packet_callbackI
 {
 public:
-    hls_writer(uv_loop_t* loop,
-            const std::string& path, bool rec_enable);
+    hls_writer(const std::string& path, bool rec_enable, size_t worker_count = 1);
     virtual ~hls_writer();
 
     void run();
+    //called before run()
+    void set_low_latency(bool enable, size_t part_duration);
+    void set_part_callback(hls_part_callbackI* cb);
+    void set_fmp4_enable(bool enable);
+    void set_dvr_window(int64_t window_ms);
+    void set_abr(size_t thread_count, const std::map<std::string, ABR_RENDITIONS>& abr_apps);
+    std::shared_ptr<mpegts_handle> get_mpegts_handle(const std::string& key);
+    const std::string& get_path() { return path_; }
 
 public:
     virtual int write_packet(MEDIA_PACKET_PTR) override;
@@ -24,8 +33,16 @@ public:
     virtual bool is_inited() override;
     virtual void set_init_flag(bool flag) override;
 
+public:
+    virtual void on_abr_packet(MEDIA_PACKET_PTR pkt_ptr) override;
+
+private:
+    hls_worker* get_worker(const std::string& key);
+
 private:
-    hls_worker work_;
+    std::string path_;
+    std::vector<std::shared_ptr<hls_worker>> workers_;
+    std::shared_ptr<encoder_pool> abr_pool_;
 };
 
 #endif
@@ -15,6 +15,8 @@ mpegts_handle::mpegts_handle(const std::string& app, const std::string& streamna
                         , app_(app)
                         , streamname_(streamname)
                         , muxer_(this)
+                        , ts_playlist_(".ts")
+                        , fmp4_playlist_(".m4s")
 {
     std::stringstream cmd;
     std::string prefix_path;
@@ -26,6 +28,7 @@ mpegts_handle::mpegts_handle(const std::string& app, const std::string& streamna
     path_ += "/";
     path_ += app;
     prefix_path = path_;
+    key_ = app + "/" + streamname;
     path_ += "/";
     path_ += streamname;
 
@@ -42,6 +45,16 @@ mpegts_handle::mpegts_handle(const std::string& app, const std::string& streamna
     rec_m3u8_filename_ += streamname;
     rec_m3u8_filename_ += "_record.m3u8";
 
+    fmp4_m3u8_filename_ = prefix_path + "/";
+    fmp4_m3u8_filename_ += streamname;
+    fmp4_m3u8_filename_ += "_fmp4.m3u8";
+
+    master_m3u8_filename_ = prefix_path + "/";
+    master_m3u8_filename_ += streamname;
+    master_m3u8_filename_ += "_master.m3u8";
+
+    fmp4_playlist_.set_map_uri(streamname + "/init.mp4");
+
     log_infof("mpegts_handle construct path:%s", path_.c_str());
 }
 
@@ -52,28 +65,14 @@ mpegts_handle::~mpegts_handle()
 }
 
 void mpegts_handle::set_ts_list_max(size_t list_max) {
-    if (list_max < 3) {
-        ts_list_max_ = 3;
-        return;
-    }
-
-    if (list_max > 6) {
-        ts_list_max_ = 6;
-        return;
-    }
-    ts_list_max_ = list_max;
-    return;
+    ts_playlist_.set_list_max(list_max);
+    fmp4_playlist_.set_list_max(list_max);
 }
 
-void mpegts_handle::set_ts_duration(size_t duration) {
-    if (duration > 30) {
-        duration = 30;
-    }
-    if (duration < 2) {
-        duration = 2;
-    }
-    mpegts_duration_ = duration;
-    return;
+void mpegts_handle::set_low_latency(bool enable, size_t part_duration) {
+    segmenter_.set_low_latency(enable, part_duration);
+    ts_playlist_.set_low_latency(enable, segmenter_.get_part_duration());
+    fmp4_playlist_.set_low_latency(enable, segmenter_.get_part_duration());
 }
 
 void mpegts_handle::handle_media_packet(MEDIA_PACKET_PTR pkt_ptr) {
@@ -109,86 +108,80 @@ int mpegts_handle::output_packet(MEDIA_PACKET_PTR pkt_ptr) {
         filename = ts_filename_;
     }
 
-    if (!ts_info_ptr_) {
+    std::shared_ptr<ts_item_info> ts_info_ptr = ts_playlist_.current();
+    if (!ts_info_ptr) {
         return 0;
     }
 
-    ts_info_ptr_->write(pkt_ptr->dts_, (uint8_t*)pkt_ptr->buffer_ptr_->data(),
+    ts_info_ptr->write(pkt_ptr->dts_, (uint8_t*)pkt_ptr->buffer_ptr_->data(),
                     pkt_ptr->buffer_ptr_->data_len(), filename);
     return 0;
 }
 
-bool mpegts_handle::gen_live_m3u8(std::string& m3u8_header) {
-    std::stringstream header_ss;
-    std::stringstream item_list_ss;
-    int64_t max_duration = 0;
-
-    if (ts_list_.size() < ts_list_max_) {
-        //log_infof("ts list size:%lu, ts_max:%d", ts_list_.size(), ts_list_max_);
-        return false;
-    }
-
-    int index = 0;
-    for (auto iter = ts_list_.begin();
-        iter != ts_list_.end();
-        iter++) {
-        if (index++ == 0) {
-            continue;
-        }
-        
-        if (iter->get()->duration > max_duration) {
-            max_duration = iter->get()->duration;
+void mpegts_handle::write_live_m3u8(hls_playlist& playlist, const std::string& filename) {
+    std::string live_m3u8;
+    bool ok = playlist.gen_live_m3u8(live_m3u8);
+    if (ok) {
+        FILE* file_p = fopen(filename.c_str(), "w");
+        if (file_p) {
+            fwrite(live_m3u8.c_str(), live_m3u8.length(), 1, file_p);
+            fclose(file_p);
         }
-        item_list_ss << "#EXTINF:" << iter->get()->duration/1000.0 << ",\n";
-        item_list_ss << iter->get()->ts_key << "\n";
     }
+}
 
-    header_ss << "#EXTM3U\n";
-    header_ss << "#EXT-X-VERSION:3\n";
-    header_ss << "#EXT-X-ALLOW-CACHE:NO\n";
-    header_ss << "#EXT-X-TARGETDURATION:" << max_duration << "\n";
-    header_ss << "#EXT-X-MEDIA-SEQUENCE:" << seq_ << "\n\n";
-
-    m3u8_header = header_ss.str();
-    m3u8_header += item_list_ss.str();
-
-    return true;
+void mpegts_handle::set_dvr_window(int64_t window_ms) {
+    if (window_ms <= 0) {
+        dvr_ = nullptr;
+        return;
+    }
+    dvr_ = std::make_shared<hls_dvr>(path_, streamname_, window_ms);
 }
 
-std::shared_ptr<ts_item_info> mpegts_handle::get_mpegts_item(const std::string& ts_name) {
-    std::shared_ptr<ts_item_info> ts_ptr;
-    for (auto item : ts_list_) {
-        size_t pos = item->ts_filename.find(ts_name);
-        if (pos == std::string::npos) {
-            continue;
-        }
-        ts_ptr = item;
-        break;
+bool mpegts_handle::gen_master_m3u8(std::string& master_m3u8) {
+    if (abr_renditions_.empty()) {
+        return false;
     }
+    std::stringstream ss;
+    int64_t max_bandwidth = 0;
 
-    return ts_ptr;
-}
+    for (const abr_rendition& rendition : abr_renditions_) {
+        int64_t bandwidth = (int64_t)rendition.bitrate * 1000 + ABR_AUDIO_BANDWIDTH;
+        if (bandwidth > max_bandwidth) {
+            max_bandwidth = bandwidth;
+        }
+    }
+    //the source is measured by its segments, it's the top of the ladder before that
+    int64_t source_bandwidth = ts_playlist_.get_bandwidth();
+    if (source_bandwidth <= 0) {
+        source_bandwidth = max_bandwidth;
+    }
 
-void mpegts_handle::write_live_m3u8() {
-    std::string live_m3u8;
-    bool ok = this->gen_live_m3u8(live_m3u8);
-    if (ok) {
-        FILE* file_p = fopen(live_m3u8_filename_.c_str(), "w");
-        if (file_p) {
-            fwrite(live_m3u8.c_str(), live_m3u8.length(), 1, file_p);
-            fclose(file_p);
+    ss << "#EXTM3U\n";
+    ss << "#EXT-X-VERSION:3\n";
+    ss << "#EXT-X-STREAM-INF:BANDWIDTH=" << source_bandwidth << "\n";
+    ss << streamname_ << ".m3u8\n";
+    for (const abr_rendition& rendition : abr_renditions_) {
+        ss << "#EXT-X-STREAM-INF:BANDWIDTH=" << (int64_t)rendition.bitrate * 1000 + ABR_AUDIO_BANDWIDTH;
+        if ((rendition.width > 0) && (rendition.height > 0)) {
+            ss << ",RESOLUTION=" << rendition.width << "x" << rendition.height;
         }
+        ss << "\n";
+        ss << streamname_ << "_" << rendition.name << ".m3u8\n";
     }
+    master_m3u8 = ss.str();
+    return true;
 }
 
 void mpegts_handle::write_record_m3u8() {
-    if (!ts_info_ptr_) {
+    std::shared_ptr<ts_item_info> ts_info_ptr = ts_playlist_.current();
+    if (!ts_info_ptr) {
         return;
     }
 
     if (!record_init_) {
         std::stringstream header_ss;
-        int64_t duration_max = ts_info_ptr_->duration/1000 + 2;
+        int64_t duration_max = ts_info_ptr->duration/1000 + 2;
 
         record_init_ = true;
 
@@ -207,8 +200,8 @@ void mpegts_handle::write_record_m3u8() {
 
     std::stringstream iter_ss;
 
-    iter_ss << "#EXTINF:" << ts_info_ptr_->duration/1000.0 << ",\n";
-    iter_ss << ts_info_ptr_->ts_key << "\n";
+    iter_ss << "#EXTINF:" << ts_info_ptr->duration/1000.0 << ",\n";
+    iter_ss << ts_info_ptr->ts_key << "\n";
 
     FILE* file_p = fopen(rec_m3u8_filename_.c_str(), "ab+");
     if (file_p) {
@@ -217,8 +210,85 @@ void mpegts_handle::write_record_m3u8() {
     }
 }
 
+//finish the current segments of both outputs and start the next ones with the same msn
+void mpegts_handle::new_segment(int64_t next_dts) {
+    std::stringstream ss;
+    int64_t now_sec = now_millisec()/1000;
+
+    //the filename is the wall clock second, keep it unique when segments are cut quickly
+    last_ts_ = (now_sec > last_ts_) ? now_sec : (last_ts_ + 1);
+    ss << path_ << "/" << last_ts_;
+    std::string filename = ss.str();
+
+    if (ts_playlist_.current()) {
+        ts_playlist_.finish_segment(next_dts);
+        if (rec_enable_) {
+            ts_playlist_.current()->save(ts_playlist_.current()->ts_filename);
+        }
+        write_live_m3u8(ts_playlist_, live_m3u8_filename_);
+        write_record_m3u8();
+
+        if (dvr_) {
+            std::shared_ptr<ts_item_info> item_ptr = ts_playlist_.current();
+            dvr_->append(item_ptr->msn, item_ptr->start_dts, item_ptr->duration,
+                        (uint8_t*)item_ptr->ts_buffer.data(), item_ptr->ts_buffer.data_len());
+        }
+
+        std::string master_m3u8;
+        if (gen_master_m3u8(master_m3u8)) {
+            FILE* file_p = fopen(master_m3u8_filename_.c_str(), "w");
+            if (file_p) {
+                fwrite(master_m3u8.c_str(), master_m3u8.length(), 1, file_p);
+                fclose(file_p);
+            }
+        }
+    }
+    if (fmp4_enable_ && fmp4_playlist_.current()) {
+        fmp4_playlist_.finish_segment(next_dts);
+        if (rec_enable_) {
+            fmp4_playlist_.current()->save(fmp4_playlist_.current()->ts_filename);
+        }
+        write_live_m3u8(fmp4_playlist_, fmp4_m3u8_filename_);
+    }
+
+    seq_++;
+    ts_filename_ = filename + ts_playlist_.get_ext();
+    std::shared_ptr<ts_item_info> ts_info_ptr = ts_playlist_.new_segment(ts_filename_, seq_);
+    muxer_.set_output_buffer(&ts_info_ptr->ts_buffer);
+    if (fmp4_enable_) {
+        fmp4_playlist_.new_segment(filename + fmp4_playlist_.get_ext(), seq_);
+    }
+}
+
+//the part is closed at the same media timestamp in both outputs
+void mpegts_handle::close_part() {
+    const hls_part_cut& cut = segmenter_.last_part();
+
+    fmp4_flush_fragment();
+    ts_playlist_.close_part(cut.start_dts, cut.duration, cut.independent);
+    if (fmp4_enable_) {
+        fmp4_playlist_.close_part(cut.start_dts, cut.duration, cut.independent);
+    }
+}
+
+void mpegts_handle::notify_part_ready() {
+    if (segmenter_.is_low_latency() && part_cb_) {
+        part_cb_->on_part_ready(key_);
+    }
+}
+
 void mpegts_handle::flush() {
     const std::string endlist_str = "#EXT-X-ENDLIST";
+    std::shared_ptr<ts_item_info> ts_info_ptr = ts_playlist_.current();
+
+    fmp4_flush_fragment();
+    if (rec_enable_ && fmp4_enable_ && fmp4_playlist_.current()) {
+        fmp4_playlist_.current()->save(fmp4_playlist_.current()->ts_filename);
+    }
+    if (rec_enable_ && ts_info_ptr && (ts_info_ptr->ts_buffer.data_len() > 0)) {
+        ts_info_ptr->save(ts_info_ptr->ts_filename);
+        write_record_m3u8();
+    }
 
     if (!record_init_) {
         return;
@@ -230,40 +300,78 @@ void mpegts_handle::flush() {
     }
 }
 
+//the init segment is made when the sequence headers of all the tracks are known
+void mpegts_handle::fmp4_gen_init() {
+    if (fmp4_init_done_) {
+        return;
+    }
+    if ((video_ready_ && !fmp4_muxer_.has_video()) || (audio_ready_ && !fmp4_muxer_.has_audio())) {
+        return;
+    }
+    std::shared_ptr<data_buffer> init_ptr = std::make_shared<data_buffer>();
+    if (fmp4_muxer_.gen_init_segment(*init_ptr) != 0) {
+        return;
+    }
+    fmp4_init_done_ = true;
+    fmp4_playlist_.set_init_segment(init_ptr);
+
+    if (rec_enable_) {
+        std::string filename = path_ + "/init.mp4";
+        FILE* file_p = fopen(filename.c_str(), "wb");
+        if (file_p) {
+            fwrite(init_ptr->data(), init_ptr->data_len(), 1, file_p);
+            fclose(file_p);
+        }
+    }
+    log_infof("fmp4 init segment is ready, key:%s, len:%lu", key_.c_str(), init_ptr->data_len());
+}
+
+//it's called after the flv header is consumed, before the mpegts muxer changes the data
+void mpegts_handle::fmp4_input(MEDIA_PACKET_PTR pkt_ptr) {
+    if (!fmp4_enable_) {
+        return;
+    }
+    const uint8_t* data = (const uint8_t*)pkt_ptr->buffer_ptr_->data();
+    size_t data_len = pkt_ptr->buffer_ptr_->data_len();
+
+    if (pkt_ptr->is_seq_hdr_) {
+        if (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) {
+            fmp4_muxer_.set_video_config(pkt_ptr->codec_type_, data, data_len);
+        } else if (pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE) {
+            fmp4_muxer_.set_audio_config(pkt_ptr->codec_type_, data, data_len);
+        }
+        fmp4_gen_init();
+        return;
+    }
+
+    if (!fmp4_init_done_ || !fmp4_playlist_.current() || (data_len == 0)) {
+        return;
+    }
+    fmp4_muxer_.input_sample(pkt_ptr, data, data_len);
+    fmp4_playlist_.current()->update_dts(pkt_ptr->dts_);
+}
+
+void mpegts_handle::fmp4_flush_fragment() {
+    if (!fmp4_enable_ || !fmp4_playlist_.current() || !fmp4_muxer_.has_samples()) {
+        return;
+    }
+    fmp4_muxer_.write_fragment(fmp4_playlist_.current()->ts_buffer);
+}
+
 void mpegts_handle::handle_packet(MEDIA_PACKET_PTR pkt_ptr) {
-    int64_t now_sec = now_millisec()/1000;
-    if (((pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) && (pkt_ptr->is_key_frame_) && ((now_sec - last_ts_) > (int64_t)mpegts_duration_)) || (ts_filename_.empty())) {
-        std::stringstream ss;
-        last_ts_ = now_sec;
-        ss << path_ << "/" << last_ts_ << ".ts";
-        ts_filename_ = ss.str();
+    HLS_CUT_TYPE cut = segmenter_.input(pkt_ptr);
 
+    if (cut == HLS_CUT_SEGMENT) {
+        //the pending fmp4 samples belong to the last part of the finished segment
+        close_part();
+        new_segment(pkt_ptr->dts_);
         audio_first_flag_ = true;
         pat_pmt_flag_ = true;
-        seq_++;
-        
-        if (!ts_info_ptr_) {
-            ts_info_ptr_ = std::make_shared<ts_item_info>();
-            ts_info_ptr_->reset();
-            ts_info_ptr_->set_ts_filename(ts_filename_);
-        } else {
-            //log_infof("ts duration:%ld", ts_info_ptr_->duration);
-            ts_list_.push_back(ts_info_ptr_);
-            if (ts_list_.size() > ts_list_max_) {
-                //log_infof("pop mpegts filename:%s, file key:%s",
-                //    ts_list_.front()->ts_filename.c_str(),
-                //    ts_list_.front()->ts_key.c_str());
-                ts_list_.pop_front();
-            }
-            write_live_m3u8();
-            write_record_m3u8();
-
-            ts_info_ptr_ = std::make_shared<ts_item_info>();
-            ts_info_ptr_->reset();
-            ts_info_ptr_->set_ts_filename(ts_filename_);
-        }
-        //log_infof("ts_filename_:%s, ts key:%s, seq:%ld",
-        //    ts_filename_.c_str(), ts_info_ptr_->ts_key.c_str(), seq_);
+        notify_part_ready();
+    } else if (cut == HLS_CUT_PART) {
+        close_part();
+        pat_pmt_flag_ = true;//every part starts with pat/pmt
+        notify_part_ready();
     }
 
     if (pat_pmt_flag_ || ((pkt_ptr->dts_ - last_patpmt_ts_) > 1000)) {
@@ -285,6 +393,11 @@ void mpegts_handle::handle_packet(MEDIA_PACKET_PTR pkt_ptr) {
         pkt_ptr->fmt_type_ = MEDIA_FORMAT_RAW;
     }
 
+    if (!pkt_ptr->is_seq_hdr_) {
+        ts_playlist_.current()->update_dts(pkt_ptr->dts_);
+    }
+    fmp4_input(pkt_ptr);
+
     if (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) {
         if (pkt_ptr->codec_type_ == MEDIA_CODEC_H264) {
             handle_video_h264(pkt_ptr);
@@ -336,46 +449,42 @@ int mpegts_handle::handle_video_h265(MEDIA_PACKET_PTR pkt_ptr) {
     if ((vps_len_ == 0) || (sps_len_ == 0) || (pps_len_ == 0)) {
         return 0;
     }
-    std::vector<std::shared_ptr<data_buffer>> nalus;
-    bool ret = annexb_to_nalus((uint8_t*)pkt_ptr->buffer_ptr_->data(),
-                    pkt_ptr->buffer_ptr_->data_len(), nalus);
+    nalus_.clear();
+    bool ret = avcc_to_nalus((uint8_t*)pkt_ptr->buffer_ptr_->data(),
+                    pkt_ptr->buffer_ptr_->data_len(), nalus_);
     if (!ret) {
         return -1;
     }
 
-    MEDIA_PACKET_PTR nalu_pkt_ptr = std::make_shared<MEDIA_PACKET>();
+    //the annexb frame is the slices: aud, [vps, sps, pps,] start code + nalu...
+    size_t aud_data_len = 0;
+    uint8_t* aud_data = get_h265_aud_data(aud_data_len);
     bool append_vps_pps_sps = false;
 
-    for (std::shared_ptr<data_buffer> item : nalus) {
-        uint8_t* data = (uint8_t*)item->data();
-        size_t data_len = (size_t)item->data_len();
-
-        uint8_t nalu_type = GET_HEVC_NALU_TYPE(data[4]);
+    slices_.clear();
+    slices_.emplace_back(aud_data, aud_data_len);
+    for (const es_slice& nalu : nalus_) {
+        uint8_t nalu_type = GET_HEVC_NALU_TYPE(nalu.data[0]);
         if (nalu_type == NAL_UNIT_ACCESS_UNIT_DELIMITER) {
             continue;
         }
 
-        nalu_pkt_ptr->copy_properties(pkt_ptr);
-        nalu_pkt_ptr->buffer_ptr_->reset();
-        size_t aud_data_len = 0;
-        uint8_t* aud_data = get_h265_aud_data(aud_data_len);
-        
-        nalu_pkt_ptr->buffer_ptr_->append_data((char*)aud_data, aud_data_len);
         if ((nalu_type >= NAL_UNIT_CODED_SLICE_BLA) && (nalu_type <= NAL_UNIT_RESERVED_23) && !append_vps_pps_sps) {
-            nalu_pkt_ptr->buffer_ptr_->append_data((char*)H264_START_CODE, sizeof(H264_START_CODE));
-            nalu_pkt_ptr->buffer_ptr_->append_data((char*)vps_, vps_len_);
-            nalu_pkt_ptr->buffer_ptr_->append_data((char*)H264_START_CODE, sizeof(H264_START_CODE));
-            nalu_pkt_ptr->buffer_ptr_->append_data((char*)sps_, sps_len_);
-            nalu_pkt_ptr->buffer_ptr_->append_data((char*)H264_START_CODE, sizeof(H264_START_CODE));
-            nalu_pkt_ptr->buffer_ptr_->append_data((char*)pps_, pps_len_);
+            slices_.emplace_back(H264_START_CODE, sizeof(H264_START_CODE));
+            slices_.emplace_back(vps_, vps_len_);
+            slices_.emplace_back(H264_START_CODE, sizeof(H264_START_CODE));
+            slices_.emplace_back(sps_, sps_len_);
+            slices_.emplace_back(H264_START_CODE, sizeof(H264_START_CODE));
+            slices_.emplace_back(pps_, pps_len_);
             append_vps_pps_sps = true;
         }
-        nalu_pkt_ptr->buffer_ptr_->append_data((char*)H264_START_CODE, sizeof(H264_START_CODE));
-        nalu_pkt_ptr->buffer_ptr_->append_data((char*)data + 4, data_len - 4);
-        
-        muxer_.input_packet(nalu_pkt_ptr);
+        slices_.emplace_back(H264_START_CODE, sizeof(H264_START_CODE));
+        slices_.push_back(nalu);
     }
-    
+    if (slices_.size() > 1) {
+        muxer_.input_slices(pkt_ptr, slices_);
+    }
+
     return 0;
 }
 
@@ -406,9 +515,9 @@ int mpegts_handle::handle_video_h264(MEDIA_PACKET_PTR pkt_ptr) {
         return 0;
     }
 
-    std::vector<std::shared_ptr<data_buffer>> nalus;
-    bool ret = annexb_to_nalus((uint8_t*)pkt_ptr->buffer_ptr_->data(),
-                        pkt_ptr->buffer_ptr_->data_len(), nalus);
+    nalus_.clear();
+    bool ret = avcc_to_nalus((uint8_t*)pkt_ptr->buffer_ptr_->data(),
+                        pkt_ptr->buffer_ptr_->data_len(), nalus_);
     if (!ret) {
         log_errorf("mpegts handle h264 error, dump:%s", pkt_ptr->dump().c_str());
         log_info_data((uint8_t*)pkt_ptr->buffer_ptr_->data(),
@@ -416,39 +525,46 @@ int mpegts_handle::handle_video_h264(MEDIA_PACKET_PTR pkt_ptr) {
         return -1;
     }
 
-    MEDIA_PACKET_PTR nalu_pkt_ptr = std::make_shared<MEDIA_PACKET>();
-    for (std::shared_ptr<data_buffer> item : nalus) {
-        uint8_t* data = (uint8_t*)item->data();
-        size_t data_len = (size_t)item->data_len();
+    //the annexb frame is the slices: aud, [sps, pps,] start code + nalu...
+    size_t aud_data_len = 0;
+    uint8_t* aud_data = get_h264_aud_data(aud_data_len);
+    bool append_sps_pps = false;
 
-        uint8_t nalu_type = data[4] & 0x1f;
+    slices_.clear();
+    slices_.emplace_back(aud_data, aud_data_len);
+    for (const es_slice& nalu : nalus_) {
+        uint8_t nalu_type = nalu.data[0] & 0x1f;
         if (H264_IS_AUD(nalu_type)) {
             continue;
         }
         if (H264_IS_PPS(nalu_type)) {
-            pps_len_ = data_len;
-            memcpy(pps_, data, pps_len_);
+            if ((sizeof(H264_START_CODE) + nalu.len) < sizeof(pps_)) {
+                memcpy(pps_, H264_START_CODE, sizeof(H264_START_CODE));
+                memcpy(pps_ + sizeof(H264_START_CODE), nalu.data, nalu.len);
+                pps_len_ = sizeof(H264_START_CODE) + nalu.len;
+            }
             continue;
         }
         if (H264_IS_SPS(nalu_type)) {
-            sps_len_ = data_len;
-            memcpy(sps_, data, sps_len_);
+            if ((sizeof(H264_START_CODE) + nalu.len) < sizeof(sps_)) {
+                memcpy(sps_, H264_START_CODE, sizeof(H264_START_CODE));
+                memcpy(sps_ + sizeof(H264_START_CODE), nalu.data, nalu.len);
+                sps_len_ = sizeof(H264_START_CODE) + nalu.len;
+            }
             continue;
         }
-        nalu_pkt_ptr->copy_properties(pkt_ptr);
-        nalu_pkt_ptr->buffer_ptr_->reset();
-        
-        size_t aud_data_len = 0;
-        uint8_t* aud_data = get_h264_aud_data(aud_data_len);
-        nalu_pkt_ptr->buffer_ptr_->append_data((char*)aud_data, aud_data_len);
-        if (H264_IS_KEYFRAME(nalu_type) && (sps_len_ > 0) && (pps_len_ > 0)) {
-            nalu_pkt_ptr->buffer_ptr_->append_data((char*)sps_, sps_len_);
-            nalu_pkt_ptr->buffer_ptr_->append_data((char*)pps_, pps_len_);
+        if (H264_IS_KEYFRAME(nalu_type) && !append_sps_pps && (sps_len_ > 0) && (pps_len_ > 0)) {
+            slices_.emplace_back(sps_, sps_len_);
+            slices_.emplace_back(pps_, pps_len_);
+            append_sps_pps = true;
         }
-        nalu_pkt_ptr->buffer_ptr_->append_data((char*)data, data_len);
-        muxer_.input_packet(nalu_pkt_ptr);
+        slices_.emplace_back(H264_START_CODE, sizeof(H264_START_CODE));
+        slices_.push_back(nalu);
     }
-    
+    if (slices_.size() > 1) {
+        muxer_.input_slices(pkt_ptr, slices_);
+    }
+
     return 0;
 }
 
@@ -7,71 +7,19 @@
 #include <list>
 #include <stdio.h>
 #include <vector>
+#include <memory>
+#include <mutex>
 #include "format/mpegts/mpegts_mux.hpp"
+#include "format/mp4/fmp4_mux.hpp"
+#include "hls_playlist.hpp"
+#include "hls_segmenter.hpp"
+#include "hls_dvr.hpp"
+#include "abr_rendition.hpp"
 #include "media_packet.hpp"
 #include "stringex.hpp"
 #include "session_aliver.hpp"
 #include "utils/logger.hpp"
 
-class ts_item_info
-{
-public:
-    ts_item_info()
-    {
-    }
-    ~ts_item_info()
-    {
-    }
-
-    void set_ts_filename(const std::string& filename) {
-        ts_filename = filename;
-
-        std::vector<std::string> output_vec;
-        string_split(ts_filename, "/", output_vec);
-        if (output_vec.size() >= 2) {
-            ts_key += output_vec[output_vec.size() - 2];
-            ts_key += "/";
-            ts_key += output_vec[output_vec.size() - 1];
-        } else {
-            ts_key = filename;
-        }
-    }
-    
-    void write(int64_t dts, uint8_t* data, size_t data_len, const std::string& filename) {
-        if (start_dts <= 0) {
-            start_dts = dts;
-        }
-        end_dts = dts;
-
-        if (end_dts > start_dts) {
-            duration = end_dts - start_dts;
-        }
-
-        if (!filename.empty()) {
-            FILE* file_p = fopen(filename.c_str(), "ab+");
-            if (file_p) {
-                fwrite(data, data_len, 1, file_p);
-                fclose(file_p);
-            }
-        }
-
-        return;
-    }
-
-    void reset() {
-        start_dts = -1;
-        end_dts   = -1;
-        duration  = -1;
-    }
-
-public:
-    int64_t start_dts = -1;
-    int64_t end_dts = -1;
-    int64_t duration = -1;
-    std::string ts_filename;
-    std::string ts_key;
-};
-
 class mpegts_handle : public av_format_callback, public session_aliver
 {
 public:
@@ -80,12 +28,33 @@ public:
 
 public:
     void handle_media_packet(MEDIA_PACKET_PTR pkt_ptr);
-    bool gen_live_m3u8(std::string& m3u8_header);
-    std::shared_ptr<ts_item_info> get_mpegts_item(const std::string& ts_name);
     void set_ts_list_max(size_t list_max);
-    void set_ts_duration(size_t duration);
+    void set_ts_duration(size_t duration) { segmenter_.set_duration(duration); }
+    size_t get_ts_duration() { return segmenter_.get_duration(); }
+    void set_fmp4_enable(bool enable) { fmp4_enable_ = enable; }
+    //the stream has an abr ladder, it's called before the handle is shared with the http thread
+    void set_abr_renditions(const ABR_RENDITIONS& renditions) { abr_renditions_ = renditions; }
+    //keep the mpegts segments of the window in the dvr log, 0: disable
+    void set_dvr_window(int64_t window_ms);
     void flush();
 
+public://the playlists may be read in the http thread
+    void set_low_latency(bool enable, size_t part_duration);
+    bool is_low_latency() { return segmenter_.is_low_latency(); }
+    void set_part_callback(hls_part_callbackI* cb) { part_cb_ = cb; }
+
+    //the mpegts playlist, or the fmp4 one(nullptr when fmp4 is disabled)
+    hls_playlist* get_playlist(bool fmp4) {
+        if (fmp4) {
+            return fmp4_enable_ ? &fmp4_playlist_ : nullptr;
+        }
+        return &ts_playlist_;
+    }
+    //the master playlist of the source and its renditions, false without the abr ladder
+    bool gen_master_m3u8(std::string& master_m3u8);
+    //the time-shift window of the stream, nullptr when the dvr is disabled
+    std::shared_ptr<hls_dvr> get_dvr() { return dvr_; }
+
 protected:
     virtual int output_packet(MEDIA_PACKET_PTR pkt_ptr) override;
 
@@ -99,16 +68,27 @@ private:
     int handle_audio_opus(MEDIA_PACKET_PTR pkt_ptr);
 
 private:
-    void write_live_m3u8();
+    void new_segment(int64_t next_dts);
+    void close_part();
+    void write_live_m3u8(hls_playlist& playlist, const std::string& filename);
     void write_record_m3u8();
+    void notify_part_ready();
+
+private:
+    void fmp4_input(MEDIA_PACKET_PTR pkt_ptr);
+    void fmp4_gen_init();
+    void fmp4_flush_fragment();
 
 private:
     bool rec_enable_ = false;
+    std::string key_;
     std::string path_;
     std::string app_;
     std::string streamname_;
     std::string live_m3u8_filename_;
     std::string rec_m3u8_filename_;
+    std::string fmp4_m3u8_filename_;
+    std::string master_m3u8_filename_;
     std::string ts_filename_;
 
 private:
@@ -126,6 +106,9 @@ private:
     size_t  pps_len_ = 0;
     size_t  sps_len_ = 0;
 
+    std::vector<es_slice> nalus_;//reused for every frame, they point into the packet
+    std::vector<es_slice> slices_;
+
     uint8_t aac_type_ = 0;
     int sample_rate_  = 0;
     uint8_t channel_  = 0;
@@ -137,13 +120,23 @@ private:
     bool pat_pmt_flag_ = false;
     bool record_init_  = false;
     int64_t last_patpmt_ts_ = -1;
-    std::shared_ptr<ts_item_info> ts_info_ptr_;
-    std::list<std::shared_ptr<ts_item_info>> ts_list_;
-    size_t ts_list_max_ = 3;
-    size_t mpegts_duration_ = 4;
     MEDIA_PACKET_PTR opus_seq_;
     std::string m3u8_header_;
 
+private:
+    hls_segmenter segmenter_;
+    hls_playlist ts_playlist_;
+    hls_part_callbackI* part_cb_ = nullptr;
+
+private://cmaf/fmp4 output, it shares the segments and parts with mpegts
+    bool fmp4_enable_ = false;
+    bool fmp4_init_done_ = false;
+    fmp4_mux fmp4_muxer_;
+    hls_playlist fmp4_playlist_;
+
+private:
+    ABR_RENDITIONS abr_renditions_;
+    std::shared_ptr<hls_dvr> dvr_;
 };
 
 #endif
\ No newline at end of file
@@ -61,34 +61,32 @@ public:
     std::unordered_map<std::string, std::string> headers() { return headers_; }
 
     int write(const char* data, size_t len, bool continue_flag = false) {
-        std::stringstream ss;
-
         continue_flag_ = continue_flag;
         if (is_close_ || session_ == nullptr) {
             return -1;
         }
 
-        if (!written_header_) {
-            ss << proto_ << "/" << version_ << " " << status_code_ << " " << status_ << "\r\n";
-            if (!continue_flag) {
-                ss << "Content-Length:" << len  << "\r\n";
-            }
-            
-            for (const auto& header : headers_) {
-                ss << header.first << ": " << header.second << "\r\n";
-            }
-            ss << "\r\n";
-            size_t len = ss.str().length();
+        write_header(len, continue_flag);
+        if (data && len > 0) {
             remain_bytes_ += len;
-            session_->write(ss.str().c_str(), len);
-            written_header_ = true;
+            session_->write(data, len);
         }
+        
+        return 0;
+    }
 
+    //the body is sent without copying, the holder keeps the data until it's sent
+    int write(std::shared_ptr<void> holder, const char* data, size_t len, bool continue_flag = false) {
+        continue_flag_ = continue_flag;
+        if (is_close_ || session_ == nullptr) {
+            return -1;
+        }
+
+        write_header(len, continue_flag);
         if (data && len > 0) {
             remain_bytes_ += len;
-            session_->write(data, len);
+            session_->write(holder, data, len);
         }
-        
         return 0;
     }
 
@@ -106,6 +104,43 @@ public:
         session_ = nullptr;
     }
 
+    //the body is [offset, offset + len) of the file, it's sent by the kernel
+    int write_file(std::shared_ptr<void> holder, int file_fd, int64_t offset, size_t len) {
+        continue_flag_ = false;
+        if (is_close_ || session_ == nullptr) {
+            return -1;
+        }
+
+        write_header(len, false);
+        if (len > 0) {
+            remain_bytes_ += len;
+            session_->sendfile(holder, file_fd, offset, len);
+        }
+        return 0;
+    }
+
+private:
+    void write_header(size_t content_len, bool continue_flag) {
+        std::stringstream ss;
+
+        if (written_header_) {
+            return;
+        }
+        ss << proto_ << "/" << version_ << " " << status_code_ << " " << status_ << "\r\n";
+        if (!continue_flag) {
+            ss << "Content-Length:" << content_len  << "\r\n";
+        }
+        
+        for (const auto& header : headers_) {
+            ss << header.first << ": " << header.second << "\r\n";
+        }
+        ss << "\r\n";
+        size_t len = ss.str().length();
+        remain_bytes_ += len;
+        session_->write(ss.str().c_str(), len);
+        written_header_ = true;
+    }
+
 private:
     bool is_close_ = false;
     bool written_header_ = false;
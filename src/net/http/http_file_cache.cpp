@@ -0,0 +1,200 @@
+#include "http_file_cache.hpp"
+#include "timeex.hpp"
+#include "logger.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+http_file::~http_file()
+{
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+static std::string get_http_date(int64_t sec) {
+    time_t t = (time_t)sec;
+    struct tm tm_info;
+    char desc[80];
+
+    gmtime_r(&t, &tm_info);
+    strftime(desc, sizeof(desc), "%a, %d %b %Y %H:%M:%S GMT", &tm_info);
+    return std::string(desc);
+}
+
+http_file_cache::http_file_cache(size_t max_count):max_count_(max_count)
+{
+    if (max_count_ == 0) {
+        max_count_ = 1;
+    }
+}
+
+http_file_cache::~http_file_cache()
+{
+    file_map_.clear();
+    files_.clear();
+}
+
+std::shared_ptr<http_file> http_file_cache::open_file(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return nullptr;
+    }
+
+    std::shared_ptr<http_file> file_ptr = std::make_shared<http_file>();
+    char etag[80];
+
+    file_ptr->path  = path;
+    file_ptr->fd    = fd;
+    file_ptr->size  = (int64_t)st.st_size;
+    file_ptr->mtime = (int64_t)st.st_mtime;
+    file_ptr->inode = (uint64_t)st.st_ino;
+    snprintf(etag, sizeof(etag), "\"%lx-%lx-%lx\"", (unsigned long)file_ptr->inode,
+            (unsigned long)file_ptr->size, (unsigned long)file_ptr->mtime);
+    file_ptr->etag = etag;
+    file_ptr->last_modified = get_http_date(file_ptr->mtime);
+    file_ptr->check_ms = now_millisec();
+    return file_ptr;
+}
+
+std::shared_ptr<http_file> http_file_cache::get_file(const std::string& path) {
+    int64_t now_ms = now_millisec();
+
+    auto iter = file_map_.find(path);
+    if (iter != file_map_.end()) {
+        std::shared_ptr<http_file> file_ptr = *(iter->second);
+        bool valid = true;
+
+        if (now_ms - file_ptr->check_ms >= HTTP_FILE_CHECK_MS) {
+            struct stat st;
+            valid = (stat(path.c_str(), &st) == 0) && ((uint64_t)st.st_ino == file_ptr->inode)
+                    && ((int64_t)st.st_size == file_ptr->size) && ((int64_t)st.st_mtime == file_ptr->mtime);
+            file_ptr->check_ms = now_ms;
+        }
+        if (valid) {
+            files_.splice(files_.begin(), files_, iter->second);
+            return file_ptr;
+        }
+        //the responses in sending keep the old fd
+        files_.erase(iter->second);
+        file_map_.erase(iter);
+    }
+
+    std::shared_ptr<http_file> file_ptr = open_file(path);
+    if (!file_ptr) {
+        return nullptr;
+    }
+    files_.push_front(file_ptr);
+    file_map_[path] = files_.begin();
+
+    while (files_.size() > max_count_) {
+        file_map_.erase(files_.back()->path);
+        files_.pop_back();
+    }
+    return file_ptr;
+}
+
+static std::string get_header(const http_request* request, const char* key) {
+    for (auto& item : request->headers_) {
+        if (strcasecmp(item.first.c_str(), key) == 0) {
+            return item.second;
+        }
+    }
+    return "";
+}
+
+//only one range is supported, return 0: no range, 1: the range is ok, -1: not satisfiable
+static int get_range(const std::string& range, int64_t size, int64_t& start, int64_t& end) {
+    const std::string unit = "bytes=";
+
+    if ((range.compare(0, unit.size(), unit) != 0) || (range.find(',') != std::string::npos)) {
+        return 0;
+    }
+    std::string spec = range.substr(unit.size());
+    size_t pos = spec.find('-');
+    if (pos == std::string::npos) {
+        return 0;
+    }
+    std::string first = spec.substr(0, pos);
+    std::string last  = spec.substr(pos + 1);
+
+    if (first.empty()) {
+        //the suffix: the last n bytes
+        int64_t suffix = atoll(last.c_str());
+        if ((suffix <= 0) || (size == 0)) {
+            return -1;
+        }
+        start = (suffix >= size) ? 0 : (size - suffix);
+        end   = size - 1;
+        return 1;
+    }
+
+    start = atoll(first.c_str());
+    end   = last.empty() ? (size - 1) : atoll(last.c_str());
+    if ((start >= size) || (end < start)) {
+        return -1;
+    }
+    if (end >= size) {
+        end = size - 1;
+    }
+    return 1;
+}
+
+void http_response_file(const http_request* request, std::shared_ptr<http_response> response,
+                    std::shared_ptr<http_file> file_ptr, const std::string& content_type) {
+    response->add_header("Access-Control-Allow-Origin", "*");
+    response->add_header("Accept-Ranges", "bytes");
+    response->add_header("ETag", file_ptr->etag);
+    response->add_header("Last-Modified", file_ptr->last_modified);
+
+    std::string if_none_match = get_header(request, "If-None-Match");
+    std::string if_modified_since = get_header(request, "If-Modified-Since");
+    if ((!if_none_match.empty() && (if_none_match == file_ptr->etag)) ||
+        (if_none_match.empty() && !if_modified_since.empty() && (if_modified_since == file_ptr->last_modified))) {
+        response->set_status_code(304);
+        response->set_status("Not Modified");
+        response->write(nullptr, 0);
+        return;
+    }
+    response->add_header("Content-Type", content_type);
+
+    int64_t start = 0;
+    int64_t end   = file_ptr->size - 1;
+    std::string range = get_header(request, "Range");
+    std::string if_range = get_header(request, "If-Range");
+    int ret = 0;
+
+    if (!range.empty() && (if_range.empty() || (if_range == file_ptr->etag) || (if_range == file_ptr->last_modified))) {
+        ret = get_range(range, file_ptr->size, start, end);
+    }
+    if (ret < 0) {
+        response->set_status_code(416);
+        response->set_status("Range Not Satisfiable");
+        response->add_header("Content-Range", "bytes */" + std::to_string(file_ptr->size));
+        response->write(nullptr, 0);
+        return;
+    }
+    if (ret > 0) {
+        response->set_status_code(206);
+        response->set_status("Partial Content");
+        response->add_header("Content-Range", "bytes " + std::to_string(start) + "-"
+                            + std::to_string(end) + "/" + std::to_string(file_ptr->size));
+    }
+
+    if (file_ptr->size == 0) {
+        response->write(nullptr, 0);
+        return;
+    }
+    response->write_file(file_ptr, file_ptr->fd, start, (size_t)(end - start + 1));
+}
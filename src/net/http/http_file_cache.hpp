@@ -0,0 +1,67 @@
+#ifndef HTTP_FILE_CACHE_HPP
+#define HTTP_FILE_CACHE_HPP
+#include "http_common.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+#define HTTP_FILE_CACHE_MAX   256  //the open files in the cache
+#define HTTP_FILE_CHECK_MS    1000 //the file is checked by stat again after it
+
+//an open file for the responses, the fd is closed when the cache and the responses release it
+class http_file
+{
+public:
+    http_file() {}
+    ~http_file();
+
+public:
+    std::string path;
+    int fd = -1;
+    int64_t size  = 0;
+    int64_t mtime = 0;//seconds
+    uint64_t inode = 0;
+    std::string etag;
+    std::string last_modified;
+    int64_t check_ms = 0;
+};
+
+/*
+the fds of the files served by http, the least recently used one is closed
+when the cache is full. a file is checked by stat at most once a second,
+it's opened again when it's replaced or changed, eg: a growing record playlist.
+it's only used in the uv loop thread.
+*/
+class http_file_cache
+{
+public:
+    http_file_cache(size_t max_count = HTTP_FILE_CACHE_MAX);
+    ~http_file_cache();
+
+public:
+    std::shared_ptr<http_file> get_file(const std::string& path);
+    size_t size() { return files_.size(); }
+
+private:
+    std::shared_ptr<http_file> open_file(const std::string& path);
+
+private:
+    size_t max_count_ = HTTP_FILE_CACHE_MAX;
+    std::list<std::shared_ptr<http_file>> files_;//the front is the most recently used
+    std::unordered_map<std::string, std::list<std::shared_ptr<http_file>>::iterator> file_map_;
+};
+
+/*
+answer the GET of the file:
+    304 for If-None-Match or If-Modified-Since,
+    206 for a single "Range: bytes=" range, 416 when it's out of the file,
+    200 for the whole file.
+the body is sent by sendfile.
+*/
+void http_response_file(const http_request* request, std::shared_ptr<http_response> response,
+                    std::shared_ptr<http_file> file_ptr, const std::string& content_type);
+
+#endif
@@ -60,6 +60,14 @@ void http_session::write(const char* data, size_t len) {
     session_ptr_->async_write(data, len);
 }
 
+void http_session::write(std::shared_ptr<void> holder, const char* data, size_t len) {
+    session_ptr_->async_write(holder, data, len);
+}
+
+void http_session::sendfile(std::shared_ptr<void> holder, int file_fd, int64_t offset, size_t len) {
+    session_ptr_->async_sendfile(holder, file_fd, offset, len);
+}
+
 void http_session::close() {
     if (is_closed_) {
         return;
@@ -34,6 +34,8 @@ public:
 public:
     void try_read();
     void write(const char* data, size_t len);
+    void write(std::shared_ptr<void> holder, const char* data, size_t len);
+    void sendfile(std::shared_ptr<void> holder, int file_fd, int64_t offset, size_t len);
     void close();
     bool is_continue() { return continue_flag_; }
     std::string remote_endpoint() { return remote_address_; }
@@ -13,6 +13,9 @@ extern int get_publisher_statics(const std::string& roomId, const std::string& u
 extern int get_subscriber_statics(const std::string& roomId, const std::string& uid, json& data_json);
 extern int get_room_statics(json& data_json);
 
+/********* for transcode statics ********/
+extern int get_transcode_statics(json& data_json);
+
 /********* for webrtc whip ********/
 extern int whip_publisher(const std::string& roomId, const std::string& uid, const std::string& data,
                 std::string& sdp, std::string& session_id, std::string& err_msg);
@@ -108,6 +111,18 @@ void httpapi_webrtc_room_handle(const http_request* request, std::shared_ptr<htt
     return;
 }
 
+/*
+url: /api/transcode
+the queue depth and the latency of the audio transcodes on the pool threads
+*/
+void httpapi_transcode_handle(const http_request* request, std::shared_ptr<http_response> response) {
+    auto data_json = json::object();
+
+    get_transcode_statics(data_json);
+    httpapi_response(0, "ok", data_json, response);
+    return;
+}
+
 void whip_http_handle(const http_request* request, std::shared_ptr<http_response> response) {
     int ret = 0;
     std::string resp_sdp;
@@ -590,4 +605,6 @@ void httpapi_server::run() {
     server_.add_get_handle("/api/webrtc/subscriber", httpapi_webrtc_subscriber_handle);
     server_.add_get_handle("/api/webrtc/room", httpapi_webrtc_room_handle);
     /******* end: only for webrtc statics *******/
+
+    server_.add_get_handle("/api/transcode", httpapi_transcode_handle);
 }
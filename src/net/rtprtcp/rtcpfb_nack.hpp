@@ -106,6 +106,22 @@ public:
         fb_common_header_->length = htons((uint16_t)(this->data_len/4 - 1));
     }
 
+    //the blocks are in network order already
+    void insert_blocks(const rtcp_nack_block* blocks, size_t count) {
+        rtcp_nack_block* block = (rtcp_nack_block*)(this->data + this->data_len);
+        size_t max_count = (sizeof(this->data) - this->data_len) / sizeof(rtcp_nack_block);
+
+        if (count > max_count) {
+            count = max_count;
+        }
+        memcpy(block, blocks, count * sizeof(rtcp_nack_block));
+        for (size_t index = 0; index < count; index++) {
+            nack_blocks_.push_back(block + index);
+        }
+        this->data_len += count * sizeof(rtcp_nack_block);
+        fb_common_header_->length = htons((uint16_t)(this->data_len/4 - 1));
+    }
+
     std::vector<uint16_t> get_lost_seqs() {
         std::vector<uint16_t> seqs;
 
@@ -0,0 +1,169 @@
+#ifndef RTCP_FEEDBACK_TWCC_HPP
+#define RTCP_FEEDBACK_TWCC_HPP
+#include "rtcp_fb_pub.hpp"
+#include "rtprtcp_pub.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/*
+transport-wide congestion control feedback(draft-holmer-rmcat-transport-wide-cc-extensions-01)
+        0                   1                   2                   3
+        0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+header |V=2|P|  FMT=15 |    PT=205     |           length              |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |                     SSRC of packet sender                     |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |                      SSRC of media source                     |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |      base sequence number     |      packet status count      |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |                 reference time                | fb pkt. count |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |          packet chunk         |         packet chunk          |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       .                                                               .
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |  recv delta   |  recv delta   | recv delta(2 bytes when large)|
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ */
+
+#define TWCC_REFERENCE_TIME_UNIT_US 64000
+#define TWCC_DELTA_UNIT_US          250
+
+typedef enum
+{
+    TWCC_NOT_RECEIVED = 0,
+    TWCC_SMALL_DELTA  = 1,
+    TWCC_LARGE_DELTA  = 2
+} TWCC_STATUS_SYMBOL;
+
+typedef struct TWCC_PACKET_STATUS_S {
+    uint16_t seq       = 0;
+    bool received      = false;
+    int64_t arrival_us = 0;//in the clock of the receiver
+} TWCC_PACKET_STATUS;
+
+/*
+the parser of the transport-cc feedback, one object is kept by the session and
+its status vector is reused by every feedback, nothing is allocated per packet.
+*/
+class rtcp_fb_twcc
+{
+public:
+    rtcp_fb_twcc() {}
+    ~rtcp_fb_twcc() {}
+
+public:
+    bool parse(const uint8_t* data, size_t len) {
+        const size_t fixed_len = sizeof(rtcp_fb_common_header) + sizeof(rtcp_fb_header) + 8;
+
+        statuses_.clear();
+        symbols_.clear();
+        if (len < fixed_len) {
+            return false;
+        }
+        const rtcp_fb_header* fb_header = (const rtcp_fb_header*)(data + sizeof(rtcp_fb_common_header));
+        sender_ssrc_ = ntohl(fb_header->sender_ssrc);
+        media_ssrc_  = ntohl(fb_header->media_ssrc);
+
+        const uint8_t* p   = data + sizeof(rtcp_fb_common_header) + sizeof(rtcp_fb_header);
+        const uint8_t* end = data + len;
+
+        base_seq_     = (uint16_t)((p[0] << 8) | p[1]);
+        status_count_ = (uint16_t)((p[2] << 8) | p[3]);
+        int32_t ref_time = (int32_t)((p[4] << 16) | (p[5] << 8) | p[6]);
+        if (ref_time & 0x800000) {
+            ref_time -= 0x1000000;//signed 24 bits
+        }
+        reference_us_ = (int64_t)ref_time * TWCC_REFERENCE_TIME_UNIT_US;
+        fb_count_     = p[7];
+        p += 8;
+
+        //the packet chunks, the symbols are kept to read the recv deltas
+        uint16_t seq = base_seq_;
+        while (statuses_.size() < status_count_) {
+            if (p + 2 > end) {
+                return false;
+            }
+            uint16_t chunk = (uint16_t)((p[0] << 8) | p[1]);
+            p += 2;
+
+            if ((chunk & 0x8000) == 0) {
+                //run length chunk: symbol(2 bits) + run length(13 bits)
+                uint8_t symbol = (chunk >> 13) & 0x03;
+                uint16_t run_length = chunk & 0x1FFF;
+                for (uint16_t i = 0; (i < run_length) && (statuses_.size() < status_count_); i++) {
+                    add_status(seq++, symbol);
+                }
+            } else if ((chunk & 0x4000) == 0) {
+                //status vector chunk: 14 symbols of 1 bit
+                for (int i = 13; (i >= 0) && (statuses_.size() < status_count_); i--) {
+                    add_status(seq++, (chunk >> i) & 0x01);
+                }
+            } else {
+                //status vector chunk: 7 symbols of 2 bits
+                for (int i = 6; (i >= 0) && (statuses_.size() < status_count_); i--) {
+                    add_status(seq++, (chunk >> (i * 2)) & 0x03);
+                }
+            }
+        }
+
+        //the recv deltas of the received packets
+        int64_t arrival_us = reference_us_;
+        for (size_t index = 0; index < statuses_.size(); index++) {
+            uint8_t symbol = symbols_[index];
+
+            if (symbol == TWCC_SMALL_DELTA) {
+                if (p + 1 > end) {
+                    return false;
+                }
+                arrival_us += (int64_t)p[0] * TWCC_DELTA_UNIT_US;
+                p += 1;
+            } else if (symbol == TWCC_LARGE_DELTA) {
+                if (p + 2 > end) {
+                    return false;
+                }
+                int16_t delta = (int16_t)((p[0] << 8) | p[1]);
+                arrival_us += (int64_t)delta * TWCC_DELTA_UNIT_US;
+                p += 2;
+            } else {
+                continue;
+            }
+            statuses_[index].received   = true;
+            statuses_[index].arrival_us = arrival_us;
+        }
+        return true;
+    }
+
+public:
+    uint32_t get_sender_ssrc() { return sender_ssrc_; }
+    uint32_t get_media_ssrc() { return media_ssrc_; }
+    uint16_t get_base_seq() { return base_seq_; }
+    uint16_t get_status_count() { return status_count_; }
+    uint8_t get_fb_count() { return fb_count_; }
+    //in the order of the transport sequence
+    const std::vector<TWCC_PACKET_STATUS>& get_statuses() { return statuses_; }
+
+private:
+    void add_status(uint16_t seq, uint8_t symbol) {
+        TWCC_PACKET_STATUS status;
+
+        status.seq = seq;
+        statuses_.push_back(status);
+        symbols_.push_back(symbol);
+    }
+
+private:
+    uint32_t sender_ssrc_  = 0;
+    uint32_t media_ssrc_   = 0;
+    uint16_t base_seq_     = 0;
+    uint16_t status_count_ = 0;
+    int64_t reference_us_  = 0;
+    uint8_t fb_count_      = 0;
+    std::vector<TWCC_PACKET_STATUS> statuses_;
+    std::vector<uint8_t> symbols_;
+};
+
+#endif
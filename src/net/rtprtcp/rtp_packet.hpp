@@ -1,6 +1,7 @@
 #ifndef RTP_PACKET_HPP
 #define RTP_PACKET_HPP
 #include "rtprtcp_pub.hpp"
+#include "rtp_packet_view.hpp"
 #include <stdint.h>
 #include <stddef.h>
 #include <string>
@@ -9,29 +10,9 @@
 #else
 #include <WinSock2.h>
 #endif
-#include <map>
 
 #define RTP_SEQ_MOD (1<<16)
 
-typedef struct header_extension_s
-{
-    uint16_t id;
-    uint16_t length;
-    uint8_t  value[1];
-} header_extension;
-
-typedef struct onebyte_extension_s {
-    uint8_t len : 4;
-    uint8_t id  : 4;
-    uint8_t value[1];
-} onebyte_extension;
-
-typedef struct twobytes_extension_s {
-    uint8_t id  : 8;
-    uint8_t len : 8;
-    uint8_t value[1];
-} twobytes_extension;
-
 /**
     0                   1                   2                   3
     0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
@@ -55,41 +36,46 @@ typedef struct twobytes_extension_s {
    |                             ....                              |
  */
 
+//the heap packet used by the streams, it's a thin wrapper of rtp_packet_view
 class rtp_packet
 {
 public:
     rtp_packet(rtp_common_header* header, header_extension* ext,
             uint8_t* payload, size_t payload_len,
             uint8_t pad_len, size_t data_len);
+    rtp_packet(const rtp_packet_view& view);
     ~rtp_packet();
 
 public:
-    uint8_t version() {return this->header->version;}
-    bool has_padding() {return (this->header->padding == 1) ? true : false;}
-    void set_padding(bool flag) {this->header->padding = flag ? 1 : 0;}
-    bool has_extension() {return (this->header->extension == 1) ? true : false;}
-    uint8_t csrc_count() {return this->header->csrc_count;}
-    uint8_t get_payload_type() {return this->header->payload_type;}
-    void set_payload_type(uint8_t type) {this->header->payload_type = type;}
+    uint8_t version() {return view_.version();}
+    bool has_padding() {return view_.has_padding();}
+    void set_padding(bool flag) {view_.set_padding(flag);}
+    bool has_extension() {return view_.has_extension();}
+    uint8_t csrc_count() {return view_.csrc_count();}
+    uint8_t get_payload_type() {return view_.get_payload_type();}
+    void set_payload_type(uint8_t type) {view_.set_payload_type(type);}
     uint8_t get_mpayload_type() {
-        uint8_t marker = this->header->marker;
-        return (marker << 7) | this->header->payload_type;
+        uint8_t marker = view_.get_marker();
+        return (marker << 7) | view_.get_payload_type();
     }
-    uint8_t get_marker() {return this->header->marker;}
-    void set_marker(uint8_t marker) { this->header->marker = marker; }
-    uint16_t get_seq() {return ntohs(this->header->sequence);}
-    void set_seq(uint16_t seq) {this->header->sequence = htons(seq);}
-    uint32_t get_timestamp() {return ntohl(this->header->timestamp);}
-    void set_timestamp(uint32_t ts) { this->header->timestamp = (uint32_t)htonl(ts); }
-    uint32_t get_ssrc() {return ntohl(this->header->ssrc);}
-    void set_ssrc(uint32_t ssrc) {this->header->ssrc = (uint32_t)htonl(ssrc);}
-
-    uint8_t* get_data() {return (uint8_t*)this->header;}
-    size_t get_data_length() {return data_len;}
-
-    uint8_t* get_payload() {return this->payload;}
-    size_t get_payload_length() {return this->payload_len;}
-    void set_payload_length(size_t len) { this->payload_len = len; }
+    uint8_t get_marker() {return view_.get_marker();}
+    void set_marker(uint8_t marker) { view_.set_marker(marker); }
+    uint16_t get_seq() {return view_.get_seq();}
+    void set_seq(uint16_t seq) {view_.set_seq(seq);}
+    uint32_t get_timestamp() {return view_.get_timestamp();}
+    void set_timestamp(uint32_t ts) { view_.set_timestamp(ts); }
+    uint32_t get_ssrc() {return view_.get_ssrc();}
+    void set_ssrc(uint32_t ssrc) {view_.set_ssrc(ssrc);}
+
+    uint8_t* get_data() {return view_.get_data();}
+    size_t get_data_length() {return view_.get_data_length();}
+
+    //the fixed header, the csrcs and the extensions before the payload
+    size_t get_header_length() {return view_.get_header_length();}
+    uint8_t* get_payload() {return view_.get_payload();}
+    size_t get_payload_length() {return view_.get_payload_length();}
+    void set_payload_length(size_t len) { view_.set_payload_length(len); }
+    rtp_packet_view& get_view() { return view_; }
 
     void set_mid_extension_id(uint8_t id) { mid_extension_id_ = id; }
     uint8_t get_mid_extension_id() { return mid_extension_id_; }
@@ -98,7 +84,11 @@ public:
     uint8_t get_abs_time_extension_id() { return abs_time_extension_id_; }
 
     bool update_mid(uint8_t mid);
+    //update the mid in the copy of the header, the packet itself isn't changed
+    bool write_mid(uint8_t* header_copy, uint8_t mid);
     bool read_mid(uint8_t& mid);
+    //the rid and the repaired rid of the simulcast layer, the id is negotiated by the sdp
+    bool read_rid(uint8_t id, std::string& rid);
 
     bool read_abs_time(uint32_t& abs_time_24bits);
     bool update_abs_time(uint32_t abs_time_24bits);
@@ -118,28 +108,17 @@ public:
 public:
     static rtp_packet* parse(uint8_t* data, size_t len);
     rtp_packet* clone(uint8_t* buffer = nullptr);
+    //copy into the buffer and the packet object of the caller, nothing is allocated
+    bool clone_to(rtp_packet& dst, uint8_t* buffer);
+    //parse the data again in the same packet object, the data is owned by the caller
+    bool reset(uint8_t* data, size_t len);
 
 private:
-    void parse_ext();
-    void parse_onebyte_ext();
-    void parse_twobytes_ext();
-    uint16_t get_ext_id(header_extension* rtp_ext);
-    uint16_t get_ext_length(header_extension* rtp_ext);
-    uint8_t* get_ext_value(header_extension* rtp_ext);
-    bool has_onebyte_ext(header_extension* rtp_ext);
-    bool has_twebytes_ext(header_extension* rtp_ext);
-
     uint8_t* get_extension(uint8_t id, uint8_t& len);
-
     bool update_extension_length(uint8_t id, uint8_t len);
 
 private:
-    rtp_common_header* header = nullptr;
-    header_extension* ext     = nullptr;
-    uint8_t* payload          = nullptr;
-    size_t payload_len        = 0;
-    uint8_t pad_len           = 0;
-    size_t data_len           = 0;
+    rtp_packet_view view_;
     int64_t local_ms          = 0;
     bool need_delete          = false;
     bool debug_enable         = false;
@@ -147,9 +126,5 @@ private:
 private:
     uint8_t mid_extension_id_      = 0;
     uint8_t abs_time_extension_id_ = 0;
-
-private:
-    std::map<uint8_t, onebyte_extension*>  onebyte_ext_map_;
-    std::map<uint8_t, twobytes_extension*> twobytes_ext_map_;
 };
 #endif
\ No newline at end of file
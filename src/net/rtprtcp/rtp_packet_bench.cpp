@@ -0,0 +1,131 @@
+#include "rtp_packet.hpp"
+#include "rtp_packet_view.hpp"
+#include "logger.hpp"
+#include "byte_stream.hpp"
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+rtp packet parse benchmark:
+    rtp_packet_bench [packet count]
+the packet is a video rtp packet with the mid, abs-send-time and transport-cc
+one byte extensions like the packets from the browser. every loop parses it,
+reads the abs time and the mid, and rewrites the ssrc, payload type and mid
+like the sfu does for one received packet and one subscriber.
+it runs with the heap rtp_packet and with the rtp_packet_view on the stack,
+the nanoseconds per packet of both are printed.
+*/
+
+#define BENCH_MID_ID      4
+#define BENCH_ABS_TIME_ID 3
+#define BENCH_TCC_ID      5
+
+static int64_t get_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static size_t make_packet(uint8_t* data) {
+    memset(data, 0, RTP_PACKET_MAX_SIZE);
+    data[0] = 0x90;//version 2 with extension
+    data[1] = 96;
+    data[3] = 1;
+    data[11] = 1;
+
+    uint8_t* p = data + 12;
+    p[0] = 0xBE;
+    p[1] = 0xDE;
+    p[3] = 3;//3 words
+    p += 4;
+    p[0] = (BENCH_ABS_TIME_ID << 4) | 2;
+    write_3bytes(p + 1, 0x123456);
+    p += 4;
+    p[0] = (BENCH_TCC_ID << 4) | 1;
+    p[2] = 1;
+    p += 3;
+    p[0] = (BENCH_MID_ID << 4) | 0;
+    p[1] = '0';
+    p += 2;
+    p += 3;//padding of the extensions
+
+    size_t payload_len = 1100;
+    for (size_t i = 0; i < payload_len; i++) {
+        p[i] = (uint8_t)i;
+    }
+    return (size_t)(p - data) + payload_len;
+}
+
+static int64_t bench_rtp_packet(uint8_t* data, size_t len, int64_t count, uint32_t& check) {
+    int64_t start = get_now_ns();
+
+    for (int64_t i = 0; i < count; i++) {
+        rtp_packet* pkt = rtp_packet::parse(data, len);
+        uint32_t abs_time = 0;
+        uint8_t mid = 0;
+
+        pkt->set_mid_extension_id(BENCH_MID_ID);
+        pkt->set_abs_time_extension_id(BENCH_ABS_TIME_ID);
+        pkt->read_abs_time(abs_time);
+        pkt->read_mid(mid);
+        pkt->set_ssrc(pkt->get_ssrc() + 1);
+        pkt->set_payload_type(96);
+        pkt->update_mid((uint8_t)(i % 10));
+        check += abs_time + mid + pkt->get_seq();
+        delete pkt;
+    }
+    return get_now_ns() - start;
+}
+
+static int64_t bench_rtp_view(uint8_t* data, size_t len, int64_t count, uint32_t& check) {
+    int64_t start = get_now_ns();
+
+    for (int64_t i = 0; i < count; i++) {
+        rtp_packet_view view;
+        uint8_t ext_len = 0;
+
+        if (!view.parse(data, len)) {
+            continue;
+        }
+        uint8_t* abs_value = view.get_extension(BENCH_ABS_TIME_ID, ext_len);
+        uint32_t abs_time = abs_value ? read_3bytes(abs_value) : 0;
+        uint8_t* mid_value = view.get_extension(BENCH_MID_ID, ext_len);
+        uint8_t mid = mid_value ? (uint8_t)(mid_value[0] - '0') : 0;
+
+        view.set_ssrc(view.get_ssrc() + 1);
+        view.set_payload_type(96);
+        if (mid_value) {
+            mid_value[0] = (uint8_t)('0' + i % 10);
+            view.set_extension_length(BENCH_MID_ID, 1);
+        }
+        check += abs_time + mid + view.get_seq();
+    }
+    return get_now_ns() - start;
+}
+
+int main(int argn, char** argv) {
+    int64_t count = (argn > 1) ? atoll(argv[1]) : 10000000;
+
+    if (count <= 0) {
+        printf("usage: %s [packet count]\r\n", argv[0]);
+        return -1;
+    }
+    Logger::get_instance()->set_filename("rtp_packet_bench.log");
+
+    uint8_t data[RTP_PACKET_MAX_SIZE];
+    size_t len = make_packet(data);
+    uint32_t check = 0;
+
+    printf("packets:%ld, packet size:%lu\r\n", count, len);
+
+    int64_t packet_ns = bench_rtp_packet(data, len, count, check);
+    printf("rtp_packet(heap):      %.1f ns/packet\r\n", (double)packet_ns / count);
+
+    int64_t view_ns = bench_rtp_view(data, len, count, check);
+    printf("rtp_packet_view(stack): %.1f ns/packet\r\n", (double)view_ns / count);
+
+    printf("speed up: %.2fx, check:%u\r\n", (double)packet_ns / view_ns, check);
+    return 0;
+}
@@ -0,0 +1,334 @@
+#include "rtp_packet_view.hpp"
+
+bool rtp_packet_view::parse(uint8_t* data, size_t len) {
+    rtp_common_header* header = (rtp_common_header*)data;
+    uint8_t* p = (uint8_t*)(header + 1);
+
+    if (len > RTP_PACKET_MAX_SIZE) {
+        error_ = "rtp len is too large";
+        return false;
+    }
+    if (len < sizeof(rtp_common_header)) {
+        error_ = "rtp len is too small";
+        return false;
+    }
+
+    header_   = header;
+    ext_      = nullptr;
+    ext_mode_ = RTP_EXT_NONE;
+    memset(ext_items_, 0, sizeof(ext_items_));
+
+    if (header->csrc_count > 0) {
+        p += 4 * header->csrc_count;
+    }
+
+    if (header->extension) {
+        if (len < (size_t)(p - data + 4)) {
+            error_ = "rtp len is too small for the extension header";
+            return false;
+        }
+        ext_ = (header_extension*)p;
+        size_t extension_byte = (size_t)(ntohs(ext_->length) * 4);
+        if (len < (size_t)(p - data + 4 + extension_byte)) {
+            error_ = "rtp len is too small for the extensions";
+            return false;
+        }
+        uint8_t* ext_start = p + 4;//4bytes(externsion header)
+        uint8_t* ext_end   = ext_start + extension_byte;
+        uint16_t profile   = ntohs(ext_->id);
+
+        //base on rfc5285
+        if (profile == 0xBEDE) {
+            ext_mode_ = RTP_EXT_ONEBYTE;
+            if (!parse_onebyte_ext(ext_start, ext_end)) {
+                return false;
+            }
+        } else if ((profile & 0xfff0) == 0x1000) {
+            ext_mode_ = RTP_EXT_TWOBYTES;
+            if (!parse_twobytes_ext(ext_start, ext_end)) {
+                return false;
+            }
+        } else {
+            error_ = "rtp extension profile error";
+            return false;
+        }
+        p = ext_end;
+    }
+
+    if (len <= (size_t)(p - data)) {
+        error_ = "rtp len is too small, has no payload";
+        return false;
+    }
+    payload_     = p;
+    payload_len_ = len - (size_t)(p - data);
+    pad_len_     = 0;
+    data_len_    = len;
+
+    if (header->padding) {
+        pad_len_ = data[len - 1];
+        if (pad_len_ > 0) {
+            if (payload_len_ <= pad_len_) {
+                error_ = "rtp padding length error";
+                return false;
+            }
+            payload_len_ -= pad_len_;
+        }
+    }
+    return true;
+}
+
+bool rtp_packet_view::parse_onebyte_ext(uint8_t* p, uint8_t* end) {
+    while (p < end) {
+        uint8_t id = (*p & 0xF0) >> 4;
+        size_t len = (size_t)(*p & 0x0F) + 1;
+
+        if (id == 0x0f)
+            break;
+
+        if (id != 0) {
+            if (p + 1 + len > end) {
+                error_ = "rtp extension length is not enough in one byte extension mode";
+                return false;
+            }
+            ext_items_[id] = p;
+            p += (1 + len);
+        } else {
+            p++;
+        }
+
+        while ((p < end) && (*p == 0)) {
+            p++;
+        }
+    }
+    return true;
+}
+
+bool rtp_packet_view::parse_twobytes_ext(uint8_t* p, uint8_t* end) {
+    while (p + 1 < end) {
+        uint8_t id  = *p;
+        uint8_t len = *(p + 1);
+
+        if (id != 0) {
+            if (p + 2 + len > end) {
+                error_ = "rtp extension length is not enough in two bytes extension mode";
+                return false;
+            }
+            if (id < RTP_EXTENSION_SLOTS) {
+                ext_items_[id] = p;
+            }
+            p += (2 + len);
+        } else {
+            ++p;
+        }
+
+        while ((p < end) && (*p == 0)) {
+            ++p;
+        }
+    }
+    return true;
+}
+
+uint8_t* rtp_packet_view::find_twobytes_ext(uint8_t id) {
+    uint8_t* p   = (uint8_t*)ext_ + 4;
+    uint8_t* end = p + ntohs(ext_->length) * 4;
+
+    //it's checked in parse
+    while (p + 1 < end) {
+        if (*p == 0) {
+            p++;
+            continue;
+        }
+        if (*p == id) {
+            return p;
+        }
+        p += 2 + *(p + 1);
+    }
+    return nullptr;
+}
+
+uint8_t* rtp_packet_view::get_extension(uint8_t id, uint8_t& len) {
+    if (ext_mode_ == RTP_EXT_ONEBYTE) {
+        uint8_t* item = get_ext_item(id);
+        if (!item) {
+            return nullptr;
+        }
+        onebyte_extension* ext_data = (onebyte_extension*)item;
+        len = ext_data->len + 1;
+        return ext_data->value;
+    } else if (ext_mode_ == RTP_EXT_TWOBYTES) {
+        uint8_t* item = (id < RTP_EXTENSION_SLOTS) ? ext_items_[id] : find_twobytes_ext(id);
+        if (!item) {
+            return nullptr;
+        }
+        twobytes_extension* ext_data = (twobytes_extension*)item;
+        len = ext_data->len;
+        if (len == 0) {
+            return nullptr;
+        }
+        return ext_data->value;
+    }
+    return nullptr;
+}
+
+bool rtp_packet_view::set_extension_length(uint8_t id, uint8_t len) {
+    if (len == 0) {
+        error_ = "the extension length must not be zero";
+        return false;
+    }
+    if (ext_mode_ == RTP_EXT_ONEBYTE) {
+        onebyte_extension* extension = (onebyte_extension*)get_ext_item(id);
+        if (!extension) {
+            error_ = "fail to get the id in the onebyte extensions";
+            return false;
+        }
+        uint8_t current_len = extension->len + 1;
+        if (len < current_len) {
+            memset(extension->value + len, 0, current_len - len);
+        }
+        extension->len = len - 1;
+    } else if (ext_mode_ == RTP_EXT_TWOBYTES) {
+        uint8_t* item = (id < RTP_EXTENSION_SLOTS) ? ext_items_[id] : find_twobytes_ext(id);
+        twobytes_extension* extension = (twobytes_extension*)item;
+        if (!extension) {
+            error_ = "fail to get the id in the twobytes extensions";
+            return false;
+        }
+        uint8_t current_len = extension->len;
+        if (len < current_len) {
+            memset(extension->value + len, 0, current_len - len);
+        }
+        extension->len = len;
+    } else {
+        error_ = "the extension bytes type is wrong";
+        return false;
+    }
+    return true;
+}
+
+bool rtp_packet_view::rtx_demux(uint32_t ssrc, uint8_t payloadtype) {
+    if (payload_len_ < 2) {
+        error_ = "rtx payload len is less than 2";
+        return false;
+    }
+
+    uint16_t replace_seq = ntohs(*(uint16_t*)(payload_));
+    set_payload_type(payloadtype);
+    set_seq(replace_seq);
+    set_ssrc(ssrc);
+
+    memmove(payload_, payload_ + 2, payload_len_ - 2);
+    payload_len_ -= 2;
+    data_len_    -= 2;
+
+    if (has_padding()) {
+        set_padding(false);
+        data_len_ -= pad_len_;
+        pad_len_   = 0;
+    }
+    return true;
+}
+
+size_t rtp_packet_view::write_transport_seq(const uint8_t* data, size_t len, uint8_t* buffer, size_t buffer_size,
+                                        uint8_t id, uint16_t seq, size_t& header_len) {
+    const rtp_common_header* header = (const rtp_common_header*)data;
+    size_t fixed_len = sizeof(rtp_common_header) + 4 * header->csrc_count;
+
+    header_len = 0;
+    if ((len < sizeof(rtp_common_header)) || (len < fixed_len) || (id == 0)) {
+        return 0;
+    }
+
+    if (!header->extension) {
+        //the one byte extension block with the sequence only: 0xBEDE, length 1, id|len, seq, pad
+        if ((id > 14) || (buffer_size < fixed_len + 8)) {
+            return 0;
+        }
+        memcpy(buffer, data, fixed_len);
+        ((rtp_common_header*)buffer)->extension = 1;
+
+        uint8_t* p = buffer + fixed_len;
+        p[0] = 0xBE;
+        p[1] = 0xDE;
+        p[2] = 0;
+        p[3] = 1;
+        p[4] = (uint8_t)(id << 4) | 0x01;
+        p[5] = (uint8_t)(seq >> 8);
+        p[6] = (uint8_t)(seq & 0xff);
+        p[7] = 0;
+        header_len = fixed_len;
+        return fixed_len + 8;
+    }
+
+    if (len < fixed_len + 4) {
+        return 0;
+    }
+    const uint8_t* ext = data + fixed_len;
+    uint16_t profile = (uint16_t)((ext[0] << 8) | ext[1]);
+    size_t ext_bytes = (size_t)((ext[2] << 8) | ext[3]) * 4;
+    size_t src_len   = fixed_len + 4 + ext_bytes;
+
+    if ((len < src_len) || (buffer_size < src_len + 4)) {
+        return 0;
+    }
+    memcpy(buffer, data, src_len);
+    header_len = src_len;
+
+    //find the sequence in the extension block
+    uint8_t* p   = buffer + fixed_len + 4;
+    uint8_t* end = buffer + src_len;
+    if (profile == 0xBEDE) {
+        if (id > 14) {
+            header_len = 0;
+            return 0;
+        }
+        while (p < end) {
+            if (*p == 0) {
+                p++;//padding
+                continue;
+            }
+            uint8_t item_id  = *p >> 4;
+            uint8_t item_len = (*p & 0x0f) + 1;
+            if (item_id == 15) {
+                break;
+            }
+            if ((item_id == id) && (item_len == 2) && (p + 3 <= end)) {
+                p[1] = (uint8_t)(seq >> 8);
+                p[2] = (uint8_t)(seq & 0xff);
+                return src_len;
+            }
+            p += 1 + item_len;
+        }
+        end[0] = (uint8_t)(id << 4) | 0x01;
+        end[1] = (uint8_t)(seq >> 8);
+        end[2] = (uint8_t)(seq & 0xff);
+        end[3] = 0;
+    } else if ((profile & 0xfff0) == 0x1000) {
+        while (p + 1 < end) {
+            if (*p == 0) {
+                p++;//padding
+                continue;
+            }
+            uint8_t item_id  = p[0];
+            uint8_t item_len = p[1];
+            if ((item_id == id) && (item_len == 2) && (p + 4 <= end)) {
+                p[2] = (uint8_t)(seq >> 8);
+                p[3] = (uint8_t)(seq & 0xff);
+                return src_len;
+            }
+            p += 2 + item_len;
+        }
+        end[0] = id;
+        end[1] = 2;
+        end[2] = (uint8_t)(seq >> 8);
+        end[3] = (uint8_t)(seq & 0xff);
+    } else {
+        header_len = 0;
+        return 0;
+    }
+
+    //one more word in the extension block
+    uint16_t ext_words = (uint16_t)(ext_bytes / 4 + 1);
+    buffer[fixed_len + 2] = (uint8_t)(ext_words >> 8);
+    buffer[fixed_len + 3] = (uint8_t)(ext_words & 0xff);
+    return src_len + 4;
+}
@@ -0,0 +1,120 @@
+#ifndef RTP_PACKET_VIEW_HPP
+#define RTP_PACKET_VIEW_HPP
+#include "rtprtcp_pub.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#ifndef _WIN32
+#include <arpa/inet.h>
+#else
+#include <WinSock2.h>
+#endif
+
+#define RTP_EXTENSION_SLOTS 16 //the one byte extension id is 1~14
+
+typedef struct header_extension_s
+{
+    uint16_t id;
+    uint16_t length;
+    uint8_t  value[1];
+} header_extension;
+
+typedef struct onebyte_extension_s {
+    uint8_t len : 4;
+    uint8_t id  : 4;
+    uint8_t value[1];
+} onebyte_extension;
+
+typedef struct twobytes_extension_s {
+    uint8_t id  : 8;
+    uint8_t len : 8;
+    uint8_t value[1];
+} twobytes_extension;
+
+typedef enum
+{
+    RTP_EXT_NONE = 0,
+    RTP_EXT_ONEBYTE,  //rfc5285 0xBEDE
+    RTP_EXT_TWOBYTES  //rfc5285 0x100X
+} RTP_EXT_MODE;
+
+/*
+the parsed fields of one rtp packet over the buffer of the caller, it allocates
+nothing and is copied by value, so it's put on the stack for every received packet.
+the extensions are indexed by id in an inline table instead of a map, the two bytes
+extension whose id is over 15 isn't in the table and is found by scanning the block.
+parse returns false with the reason in get_error() instead of throwing.
+*/
+class rtp_packet_view
+{
+public:
+    rtp_packet_view() {}
+    ~rtp_packet_view() {}
+
+public:
+    bool parse(uint8_t* data, size_t len);
+    const char* get_error() { return error_; }
+
+public:
+    uint8_t version() { return header_->version; }
+    bool has_padding() { return header_->padding == 1; }
+    void set_padding(bool flag) { header_->padding = flag ? 1 : 0; }
+    bool has_extension() { return header_->extension == 1; }
+    uint8_t csrc_count() { return header_->csrc_count; }
+    uint8_t get_payload_type() { return header_->payload_type; }
+    void set_payload_type(uint8_t type) { header_->payload_type = type; }
+    uint8_t get_marker() { return header_->marker; }
+    void set_marker(uint8_t marker) { header_->marker = marker; }
+    uint16_t get_seq() { return ntohs(header_->sequence); }
+    void set_seq(uint16_t seq) { header_->sequence = htons(seq); }
+    uint32_t get_timestamp() { return ntohl(header_->timestamp); }
+    void set_timestamp(uint32_t ts) { header_->timestamp = (uint32_t)htonl(ts); }
+    uint32_t get_ssrc() { return ntohl(header_->ssrc); }
+    void set_ssrc(uint32_t ssrc) { header_->ssrc = (uint32_t)htonl(ssrc); }
+
+    uint8_t* get_data() { return (uint8_t*)header_; }
+    size_t get_data_length() { return data_len_; }
+    size_t get_header_length() { return (size_t)(payload_ - (uint8_t*)header_); }
+    uint8_t* get_payload() { return payload_; }
+    size_t get_payload_length() { return payload_len_; }
+    void set_payload_length(size_t len) { payload_len_ = len; }
+    uint8_t get_pad_length() { return pad_len_; }
+
+public:
+    RTP_EXT_MODE get_ext_mode() { return ext_mode_; }
+    //return the value of the extension and its length, nullptr when it's not found
+    uint8_t* get_extension(uint8_t id, uint8_t& len);
+    //the length in the element is updated, the bytes left are set 0 when it's shorter
+    bool set_extension_length(uint8_t id, uint8_t len);
+    //the element(id and length bytes) of the extension in the inline table
+    uint8_t* get_ext_item(uint8_t id) { return (id < RTP_EXTENSION_SLOTS) ? ext_items_[id] : nullptr; }
+
+    //the rtx packet is changed into the origin packet in place
+    bool rtx_demux(uint32_t ssrc, uint8_t payloadtype);
+
+public:
+    //copy the rtp header in the data into the buffer with the transport-wide sequence
+    //extension, it's overwritten when the header has it, else it's appended to the
+    //extension block. it returns the length of the new header and the length of the
+    //header in the data, 0 when the header is broken or the buffer is too small.
+    static size_t write_transport_seq(const uint8_t* data, size_t len, uint8_t* buffer, size_t buffer_size,
+                                    uint8_t id, uint16_t seq, size_t& header_len);
+
+private:
+    bool parse_onebyte_ext(uint8_t* p, uint8_t* end);
+    bool parse_twobytes_ext(uint8_t* p, uint8_t* end);
+    uint8_t* find_twobytes_ext(uint8_t id);
+
+private:
+    rtp_common_header* header_ = nullptr;
+    header_extension* ext_     = nullptr;
+    uint8_t* payload_          = nullptr;
+    size_t payload_len_        = 0;
+    size_t data_len_           = 0;
+    uint8_t pad_len_           = 0;
+    RTP_EXT_MODE ext_mode_     = RTP_EXT_NONE;
+    uint8_t* ext_items_[RTP_EXTENSION_SLOTS] = {nullptr};
+    const char* error_         = "";
+};
+
+#endif
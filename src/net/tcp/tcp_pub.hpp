@@ -4,14 +4,24 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <string>
+#include <memory>
 
 #define TCP_DEF_RECV_BUFFER_SIZE (5*1024)
+#define TCP_SENDFILE_MAX_SIZE    (1024*1024) //bytes of one sendfile call in the threadpool
+#define TCP_SENDFILE_PIECE_SIZE  (256*1024)  //bytes written from the mapping when the socket is full
 
 typedef struct {
   uv_write_t req;
   uv_buf_t buf;
 } write_req_t;
 
+//the data is not copied, the holder keeps it alive until the write is done
+typedef struct {
+  uv_write_t req;
+  uv_buf_t buf;
+  std::shared_ptr<void> holder;
+} holder_write_req_t;
+
 class tcp_client_callback
 {
 public:
@@ -38,6 +48,9 @@ class tcp_base_session
 public:
     virtual void async_write(const char* data, size_t data_size) = 0;
     virtual void async_write(std::shared_ptr<data_buffer> buffer_ptr) = 0;
+    virtual void async_write(std::shared_ptr<void> holder, const char* data, size_t data_size) = 0;
+    //send [offset, offset + len) of the file after the queued writes, the holder keeps the fd open
+    virtual void async_sendfile(std::shared_ptr<void> holder, int file_fd, int64_t offset, size_t len) = 0;
     virtual void async_read() = 0;
     virtual void close() = 0;
     virtual std::string get_remote_endpoint() = 0;
@@ -5,6 +5,7 @@
 #include "tcp_pub.hpp"
 #include "ipaddress.hpp"
 #include "ssl_server.hpp"
+#include "file_mapping.hpp"
 #include <uv.h>
 #include <memory>
 #include <string>
@@ -15,6 +16,9 @@
 #include <sstream>
 #include <openssl/ssl.h>
 #include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
 
 inline static void on_tcp_close(uv_handle_t* handle);
 inline static void on_uv_alloc(uv_handle_t* handle,
@@ -24,6 +28,35 @@ inline static void on_uv_read(uv_stream_t* handle,
                        ssize_t nread,
                        const uv_buf_t* buf);
 inline static void on_uv_write(uv_write_t* req, int status);
+inline static void on_uv_holder_write(uv_write_t* req, int status);
+inline static void on_uv_sendfile_work(uv_work_t* work);
+inline static void on_uv_sendfile_done(uv_work_t* work, int status);
+
+class tcp_session;
+
+//the file in sending, every sendfile call runs in the libuv threadpool
+class tcp_sendfile_req
+{
+public:
+    ~tcp_sendfile_req()
+    {
+        if (sock_fd >= 0) {
+            close(sock_fd);
+        }
+    }
+
+public:
+    uv_work_t work;
+    tcp_session* session = nullptr;//nullptr when the session is closed during the call
+    std::shared_ptr<void> holder;//keeps the file open
+    int sock_fd = -1;//a dup of the socket, the fd can't be reused while the call is running
+    int file_fd = -1;
+    int64_t offset = 0;
+    size_t remain  = 0;
+    bool running   = false;
+    ssize_t result = 0;
+    int error      = 0;
+};
 
 class tcp_session : public tcp_base_session, public ssl_server_callbackI
 {
@@ -35,6 +68,8 @@ friend void on_uv_read(uv_stream_t* handle,
                     ssize_t nread,
                     const uv_buf_t* buf);
 friend void on_uv_write(uv_write_t* req, int status);
+friend void on_uv_holder_write(uv_write_t* req, int status);
+friend void on_uv_sendfile_done(uv_work_t* work, int status);
 
 public:
     tcp_session(uv_loop_t* loop,
@@ -160,12 +195,69 @@ public:
         this->async_write(buffer_ptr->data(), buffer_ptr->data_len());
     }
 
+    virtual void async_write(std::shared_ptr<void> holder, const char* data, size_t len) override {
+        if (ssl_enable_ && ssl_) {
+            //the data is encrypted into new buffers anyway
+            ssl_->ssl_write((uint8_t*)data, len);
+            return;
+        }
+        holder_write_req_t* wr = new holder_write_req_t();
+
+        wr->holder = holder;
+        wr->buf = uv_buf_init((char*)data, len);
+        if (uv_write((uv_write_t*)wr, reinterpret_cast<uv_stream_t*>(uv_handle_), &wr->buf, 1, on_uv_holder_write)) {
+            delete wr;
+            throw MediaServerError("uv_write error");
+        }
+    }
+
+    /*
+    the kernel moves the file to the socket without copying. when the socket
+    buffer is full, a piece of the file is mapped and written by uv_write,
+    so libuv waits for the socket to be writable, then sendfile goes on.
+    with ssl, the file is mapped and encrypted piece by piece in the same way.
+    */
+    virtual void async_sendfile(std::shared_ptr<void> holder, int file_fd, int64_t offset, size_t len) override {
+        if (close_ || (len == 0)) {
+            return;
+        }
+        if (sendfile_req_) {
+            throw MediaServerError("the session is sending a file");
+        }
+        uv_os_fd_t sock_fd = -1;
+        if (!(ssl_enable_ && ssl_)) {
+            if (uv_fileno(reinterpret_cast<uv_handle_t*>(uv_handle_), &sock_fd) != 0) {
+                throw MediaServerError("uv_fileno error");
+            }
+            sock_fd = dup(sock_fd);
+        }
+
+        sendfile_req_ = new tcp_sendfile_req();
+        sendfile_req_->work.data = sendfile_req_;
+        sendfile_req_->session = this;
+        sendfile_req_->holder  = holder;
+        sendfile_req_->sock_fd = sock_fd;
+        sendfile_req_->file_fd = file_fd;
+        sendfile_req_->offset  = offset;
+        sendfile_req_->remain  = len;
+        continue_sendfile();
+    }
+
     virtual void close() override {
         if (close_) {
             return;
         }
         close_ = true;
 
+        if (sendfile_req_) {
+            if (sendfile_req_->running) {
+                sendfile_req_->session = nullptr;//it's released in the done callback
+            } else {
+                delete sendfile_req_;
+            }
+            sendfile_req_ = nullptr;
+        }
+
         int err = uv_read_stop(reinterpret_cast<uv_stream_t*>(uv_handle_));
         if (err != 0) {
             throw MediaServerError("uv_read_stop error");
@@ -253,25 +345,110 @@ private:
         callback_->on_read(0, buf->base, nread);
     }
 
+    //the callback may release the session, so nothing of it is touched after the callback
     void on_write(write_req_t* req, int status) {
         write_req_t* wr;
       
         /* Free the read/write buffer and the request */
         wr = (write_req_t*) req;
+        size_t len  = wr->buf.len;
+        bool notify = callback_ && !close_;
+        if (ssl_enable_ && ssl_ && (ssl_->get_state() != TLS_DATA_RECV_STATE)) {
+            notify = false;
+        }
+
+        free(wr->buf.base);
+        free(wr);
+        continue_sendfile();
+
+        if (notify) {
+            callback_->on_write(status, len);
+        }
+    }
+
+    void on_holder_write(holder_write_req_t* wr, int status) {
+        size_t len  = wr->buf.len;
+        bool notify = callback_ && !close_;
+
+        delete wr;
+        continue_sendfile();
+
+        if (notify) {
+            callback_->on_write(status, len);
+        }
+    }
+
+    //the file goes after the queued writes, it's called again when a write is done
+    void continue_sendfile() {
+        tcp_sendfile_req* req = sendfile_req_;
+        if (!req || req->running || close_) {
+            return;
+        }
+        if (uv_stream_get_write_queue_size(reinterpret_cast<uv_stream_t*>(uv_handle_)) > 0) {
+            return;
+        }
+        if (req->remain == 0) {
+            delete req;
+            sendfile_req_ = nullptr;
+            return;
+        }
         if (ssl_enable_ && ssl_) {
-            if (ssl_->get_state() == TLS_DATA_RECV_STATE) {
-                if (callback_ && !close_) {
-                    callback_->on_write(status, wr->buf.len);
-                }
+            //the piece is encrypted into the write queue, the next one goes when it's written
+            size_t len = (req->remain > TCP_SENDFILE_PIECE_SIZE) ? TCP_SENDFILE_PIECE_SIZE : req->remain;
+            std::shared_ptr<file_mapping> mapping_ptr = file_mapping::map(req->file_fd, req->offset, len);
+            if (!mapping_ptr) {
+                throw MediaServerError("mmap file error");
+            }
+            req->offset += (int64_t)len;
+            req->remain -= len;
+            ssl_->ssl_write((uint8_t*)mapping_ptr->data(), len);
+            return;
+        }
+        req->running = true;
+        if (uv_queue_work(uv_handle_->loop, &req->work, on_uv_sendfile_work, on_uv_sendfile_done) != 0) {
+            req->running = false;
+            throw MediaServerError("uv_queue_work error");
+        }
+    }
+
+    void on_sendfile(tcp_sendfile_req* req, int status) {
+        if (req->result > 0) {
+            size_t sent = (size_t)req->result;
+
+            req->offset += (int64_t)sent;
+            req->remain -= sent;
+            if (req->remain == 0) {
+                delete req;
+                sendfile_req_ = nullptr;
             }
-        } else {
-            if (callback_ && !close_) {
-                callback_->on_write(status, wr->buf.len);
+            continue_sendfile();
+            if (callback_) {
+                callback_->on_write(0, sent);
             }
+            return;
         }
 
-        free(wr->buf.base);
-        free(wr);
+        if ((status == 0) && (req->result < 0) && (req->error == EAGAIN)) {
+            size_t len = (req->remain > TCP_SENDFILE_PIECE_SIZE) ? TCP_SENDFILE_PIECE_SIZE : req->remain;
+            std::shared_ptr<file_mapping> mapping_ptr = file_mapping::map(req->file_fd, req->offset, len);
+            if (mapping_ptr) {
+                req->offset += (int64_t)len;
+                req->remain -= len;
+                async_write(mapping_ptr, mapping_ptr->data(), len);
+                return;
+            }
+        } else if ((status == 0) && (req->result < 0) && (req->error == EINTR)) {
+            continue_sendfile();
+            return;
+        }
+
+        //the result 0 means the file is shorter than the range
+        log_errorf("sendfile error:%d, result:%ld, status:%d", req->error, req->result, status);
+        delete req;
+        sendfile_req_ = nullptr;
+        if (callback_) {
+            callback_->on_write(-1, 0);
+        }
     }
 
 private:
@@ -286,6 +463,9 @@ private:
 private:
     bool ssl_enable_     = false;
     ssl_server* ssl_     = nullptr;
+
+private:
+    tcp_sendfile_req* sendfile_req_ = nullptr;
 };
 
 inline static void on_uv_alloc(uv_handle_t* handle,
@@ -317,6 +497,37 @@ inline static void on_uv_write(uv_write_t* req, int status) {
     return;
 }
 
+inline static void on_uv_holder_write(uv_write_t* req, int status) {
+    tcp_session* session = static_cast<tcp_session*>(req->handle->data);
+
+    if (session) {
+        session->on_holder_write((holder_write_req_t*)req, status);
+    } else {
+        delete (holder_write_req_t*)req;
+    }
+    return;
+}
+
+inline static void on_uv_sendfile_work(uv_work_t* work) {
+    tcp_sendfile_req* req = (tcp_sendfile_req*)work->data;
+    off_t offset = (off_t)req->offset;
+    size_t len = (req->remain > TCP_SENDFILE_MAX_SIZE) ? TCP_SENDFILE_MAX_SIZE : req->remain;
+
+    req->result = sendfile(req->sock_fd, req->file_fd, &offset, len);
+    req->error  = (req->result < 0) ? errno : 0;
+}
+
+inline static void on_uv_sendfile_done(uv_work_t* work, int status) {
+    tcp_sendfile_req* req = (tcp_sendfile_req*)work->data;
+
+    req->running = false;
+    if (!req->session) {
+        delete req;
+        return;
+    }
+    req->session->on_sendfile(req, status);
+}
+
 inline static void on_tcp_close(uv_handle_t* handle) {
     delete handle;
 }
@@ -0,0 +1,139 @@
+#ifndef UDP_PEER_TABLE_HPP
+#define UDP_PEER_TABLE_HPP
+#include "udp_server.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#define UDP_PEER_TABLE_INIT_SIZE 64
+
+/*
+the sessions keyed by the binary peer address, it's looked up for every udp packet.
+open addressing with linear probing in one flat array, the table is doubled when
+it's half full and a removed slot is filled by shifting back the following ones,
+so there is no tombstone. it's only used in the uv loop thread.
+*/
+template <class T>
+class udp_peer_table
+{
+public:
+    udp_peer_table(size_t capacity = UDP_PEER_TABLE_INIT_SIZE) {
+        size_t size = 8;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+    ~udp_peer_table() {
+    }
+
+public:
+    T* find(const udp_peer_key& key) const {
+        size_t index = key.hash() & mask_;
+
+        while (slots_[index].value) {
+            if (slots_[index].key == key) {
+                return slots_[index].value;
+            }
+            index = (index + 1) & mask_;
+        }
+        return nullptr;
+    }
+
+    //the value of an existing key is replaced
+    void insert(const udp_peer_key& key, T* value) {
+        if (!value) {
+            return;
+        }
+        if ((count_ + 1) * 2 > slots_.size()) {
+            rehash(slots_.size() * 2);
+        }
+        size_t index = key.hash() & mask_;
+
+        while (slots_[index].value) {
+            if (slots_[index].key == key) {
+                slots_[index].value = value;
+                return;
+            }
+            index = (index + 1) & mask_;
+        }
+        slots_[index].key   = key;
+        slots_[index].value = value;
+        count_++;
+    }
+
+    bool erase(const udp_peer_key& key) {
+        size_t index = key.hash() & mask_;
+
+        while (slots_[index].value) {
+            if (slots_[index].key == key) {
+                erase_slot(index);
+                return true;
+            }
+            index = (index + 1) & mask_;
+        }
+        return false;
+    }
+
+    //remove all the keys of the value, return the removed count
+    size_t erase_value(T* value) {
+        std::vector<udp_peer_key> keys;
+
+        for (const peer_slot& slot : slots_) {
+            if (slot.value && (slot.value == value)) {
+                keys.push_back(slot.key);
+            }
+        }
+        for (const udp_peer_key& key : keys) {
+            erase(key);
+        }
+        return keys.size();
+    }
+
+    size_t size() const { return count_; }
+
+private:
+    class peer_slot
+    {
+    public:
+        udp_peer_key key;
+        T* value = nullptr;//nullptr is an empty slot
+    };
+
+    void erase_slot(size_t index) {
+        size_t next = (index + 1) & mask_;
+
+        while (slots_[next].value) {
+            size_t home = slots_[next].key.hash() & mask_;
+            //move it back when the hole is between its home slot and it
+            if (((next - home) & mask_) >= ((next - index) & mask_)) {
+                slots_[index] = slots_[next];
+                index = next;
+            }
+            next = (next + 1) & mask_;
+        }
+        slots_[index] = peer_slot();
+        count_--;
+    }
+
+    void rehash(size_t size) {
+        std::vector<peer_slot> old_slots(size);
+
+        old_slots.swap(slots_);
+        mask_  = size - 1;
+        count_ = 0;
+        for (const peer_slot& slot : old_slots) {
+            if (slot.value) {
+                insert(slot.key, slot.value);
+            }
+        }
+    }
+
+private:
+    std::vector<peer_slot> slots_;
+    size_t mask_  = 0;
+    size_t count_ = 0;
+};
+
+#endif
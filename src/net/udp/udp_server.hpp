@@ -8,16 +8,44 @@
 #include <string>
 #include <stdint.h>
 #include <queue>
+#include <vector>
 #include <uv.h>
+#ifdef __linux__
+#include <sys/socket.h>
+#include <netinet/udp.h>
+#include <linux/filter.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #define UDP_DATA_BUFFER_MAX (10*1500)
 
+#ifdef __linux__
+#define UDP_BATCH_SUPPORT
+#endif
+
+#define UDP_MMSG_CHUNK_SIZE  (64*1024) //libuv receives one datagram in each 64KB chunk of the buffer
+#define UDP_MMSG_RECV_COUNT  20        //the max datagrams of one recvmmsg in libuv
+#define UDP_SEND_BATCH_MAX   64        //the batch is flushed at once when it's full
+#define UDP_GSO_MAX_SEGMENTS 64
+#define UDP_GSO_MAX_SIZE     (63*1024)
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
 typedef struct udp_req_info_s
 {
     uv_udp_send_t handle;
     uv_buf_t buf;
-    char ip[80];
-    uint16_t port;
+    struct sockaddr_storage addr;
 } udp_req_info_t;
 
 inline void udp_alloc_callback(uv_handle_t* handle,
@@ -30,37 +58,108 @@ inline void udp_read_callback(uv_udp_t* handle,
                     unsigned flags);
 
 inline void udp_send_callback(uv_udp_send_t* req, int status);
+inline void udp_flush_callback(uv_prepare_t* handle);
+
+//the binary peer address, it's compared and hashed without formatting the ip string
+class udp_peer_key
+{
+public:
+    bool operator==(const udp_peer_key& other) const {
+        return memcmp(this, &other, sizeof(udp_peer_key)) == 0;
+    }
+    bool operator!=(const udp_peer_key& other) const {
+        return !(*this == other);
+    }
+
+    size_t hash() const {
+        uint64_t words[2];
+        uint32_t head;
+
+        memcpy(&head, this, sizeof(head));
+        memcpy(words, addr, sizeof(words));
+        uint64_t h = ((uint64_t)head << 32) ^ words[0] ^ (words[1] * 0x9E3779B97F4A7C15ULL);
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        return (size_t)h;
+    }
+
+public:
+    uint16_t family = 0;
+    uint16_t port   = 0;//network byte order
+    uint8_t  addr[16] = {0};//ipv4 uses the first 4 bytes
+};
 
+/*
+the remote address of a udp packet, the sockaddr is kept for sending
+and the key for the peer lookup, the ip string is only made for logs.
+*/
 class udp_tuple
 {
 public:
     udp_tuple() {
+        memset(&addr, 0, sizeof(addr));
     }
-    udp_tuple(const std::string& ip, uint16_t udp_port): ip_address(ip)
-        , port(udp_port)
-    {
+    udp_tuple(const struct sockaddr* sa) {
+        set_sockaddr(sa);
     }
     ~udp_tuple(){
     }
 
+    void set_sockaddr(const struct sockaddr* sa) {
+        key = udp_peer_key();
+        if (sa->sa_family == AF_INET6) {
+            const struct sockaddr_in6* sa6 = (const struct sockaddr_in6*)sa;
+            memcpy(&addr, sa6, sizeof(struct sockaddr_in6));
+            key.family = AF_INET6;
+            key.port   = sa6->sin6_port;
+            memcpy(key.addr, &sa6->sin6_addr, 16);
+        } else {
+            const struct sockaddr_in* sa4 = (const struct sockaddr_in*)sa;
+            memcpy(&addr, sa4, sizeof(struct sockaddr_in));
+            key.family = AF_INET;
+            key.port   = sa4->sin_port;
+            memcpy(key.addr, &sa4->sin_addr, 4);
+        }
+    }
+
+    const struct sockaddr* get_sockaddr() const { return (const struct sockaddr*)&addr; }
+    bool empty() const { return (key.family == 0) || (key.port == 0); }
+    uint16_t get_port() const { return ntohs(key.port); }
+
+    std::string get_ip() const {
+        uint16_t port = 0;
+        return (key.family == 0) ? "" : get_ip_str(get_sockaddr(), port);
+    }
+
     std::string to_string() const {
-        std::string ret = ip_address;
+        std::string ret = get_ip();
 
         ret += ":";
-        ret += std::to_string(port);
+        ret += std::to_string(get_port());
         return ret;
     }
 
 public:
-    std::string ip_address;
-    uint16_t    port = 0;
+    struct sockaddr_storage addr;
+    udp_peer_key key;
 };
 
+//the socket index of the peer in the reuseport group, the same hash as the steering program
+inline size_t udp_steer_index(const udp_tuple& address, size_t count) {
+    if ((count <= 1) || (address.key.family != AF_INET)) {
+        return 0;
+    }
+    uint32_t ip = 0;
+    memcpy(&ip, address.key.addr, sizeof(ip));
+    return (size_t)((ntohl(ip) ^ (uint32_t)ntohs(address.key.port)) % count);
+}
+
 class udp_session_callbackI
 {
 public:
-    virtual void on_write(size_t sent_size, udp_tuple address) = 0;
-    virtual void on_read(const char* data, size_t data_size, udp_tuple address) = 0;
+    virtual void on_write(size_t sent_size, const udp_tuple& address) = 0;
+    virtual void on_read(const char* data, size_t data_size, const udp_tuple& address) = 0;
 };
 
 class udp_server
@@ -74,23 +173,52 @@ friend void udp_read_callback(uv_udp_t* handle,
                     const struct sockaddr* addr,
                     unsigned flags);
 friend void udp_send_callback(uv_udp_send_t* req, int status);
+friend void udp_flush_callback(uv_prepare_t* handle);
 
 public:
-    udp_server(uv_loop_t* loop, uint16_t port, udp_session_callbackI* cb):cb_(cb)
-                                                                        , loop_(loop)
+    //batch: recvmmsg for receiving, the packets written in one loop iteration
+    //are sent by sendmmsg(and gso when it's available) before the loop polls again
+    //reuseport_count: the sockets bound on the same port with SO_REUSEPORT,
+    //they must be created in the order of udp_steer_index, 0 is a normal socket
+    udp_server(uv_loop_t* loop, uint16_t port, udp_session_callbackI* cb,
+            bool batch = true, size_t reuseport_count = 0):cb_(cb)
+                                                        , loop_(loop)
     {
-        recv_buffer_ = new char[UDP_DATA_BUFFER_MAX];
+        recv_buffer_len_ = UDP_DATA_BUFFER_MAX;
+        unsigned int flags = 0;
+#ifdef UDP_BATCH_SUPPORT
+        batch_ = batch;
+        if (batch_) {
+            recv_buffer_len_ = UDP_MMSG_CHUNK_SIZE * UDP_MMSG_RECV_COUNT;
+            flags |= UV_UDP_RECVMMSG;
+            init_batch();
+        }
+        if (reuseport_count > 0) {
+            int fd = open_reuseport_socket(port, reuseport_count);
+            if (fd < 0) {
+                MS_THROW_ERROR("open reuseport udp socket error:%s, port:%d", strerror(errno), port);
+            }
+            uv_udp_init_ex(loop, &udp_handle_, AF_UNSPEC | flags);
+            uv_udp_open(&udp_handle_, fd);
+        } else
+#endif
+        {
+            uv_udp_init_ex(loop, &udp_handle_, AF_INET | flags);
 
-        uv_udp_init(loop, &udp_handle_);
-        struct sockaddr_in recv_addr;
-        uv_ip4_addr("0.0.0.0", port, &recv_addr);
-        uv_udp_bind(&udp_handle_, (const struct sockaddr *)&recv_addr, UV_UDP_REUSEADDR);
+            struct sockaddr_in recv_addr;
+            uv_ip4_addr("0.0.0.0", port, &recv_addr);
+            uv_udp_bind(&udp_handle_, (const struct sockaddr *)&recv_addr, UV_UDP_REUSEADDR);
+        }
+        recv_buffer_ = new char[recv_buffer_len_];
         udp_handle_.data = this;
 
         try_read();
     }
 
     ~udp_server() {
+        if (batch_) {
+            uv_prepare_stop(&flush_handle_);
+        }
         if (recv_buffer_) {
             delete[] recv_buffer_;
             recv_buffer_ = nullptr;
@@ -99,11 +227,76 @@ public:
 
 public:
     uv_loop_t* get_loop() { return loop_; }
+    bool is_batch() { return batch_; }
+    bool is_gso() { return gso_enable_; }
+    size_t get_send_queue_count() { return uv_udp_get_send_queue_count(&udp_handle_); }
 
-    void write(char* data, size_t len, udp_tuple remote_address) {
-        struct sockaddr_in send_addr;
+    void write(char* data, size_t len, const udp_tuple& remote_address) {
+#ifdef UDP_BATCH_SUPPORT
+        if (batch_) {
+            add_batch(data, len, remote_address);
+            return;
+        }
+#endif
+        send_packet(data, len, remote_address.addr);
+    }
+
+    //reserve the buffer of one packet in the pending batch, the caller writes the
+    //packet in place and queues it by commit_write, so it isn't copied again.
+    //the buffer is valid until the next call of the udp server.
+    uint8_t* alloc_write(size_t len) {
+#ifdef UDP_BATCH_SUPPORT
+        if (batch_) {
+            size_t offset = send_data_.size();
+            send_data_.resize(offset + len);
+            alloc_offset_ = offset;
+            return (uint8_t*)&send_data_[offset];
+        }
+#endif
+        if (write_buffer_.size() < len) {
+            write_buffer_.resize(len);
+        }
+        return (uint8_t*)&write_buffer_[0];
+    }
+
+    //queue the packet written in the buffer of alloc_write, len 0 drops it
+    void commit_write(size_t len, const udp_tuple& remote_address) {
+#ifdef UDP_BATCH_SUPPORT
+        if (batch_) {
+            send_data_.resize(alloc_offset_ + len);
+            if (len == 0) {
+                return;
+            }
+            udp_send_item item;
+
+            item.offset  = alloc_offset_;
+            item.len     = len;
+            item.address = remote_address;
+            send_items_.push_back(item);
+
+            if (send_items_.size() >= UDP_SEND_BATCH_MAX) {
+                flush_batch();
+            }
+            return;
+        }
+#endif
+        if (len > 0) {
+            send_packet(&write_buffer_[0], len, remote_address.addr);
+        }
+    }
+
+    //send the pending batch now, it's called by the loop before polling
+    void flush() {
+#ifdef UDP_BATCH_SUPPORT
+        if (batch_) {
+            flush_batch();
+        }
+#endif
+    }
+
+private:
+    void send_packet(const char* data, size_t len, const struct sockaddr_storage& addr) {
         udp_req_info_t* req = (udp_req_info_t*)malloc(sizeof(udp_req_info_t));
-        uv_ip4_addr(remote_address.ip_address.c_str(), ntohs(remote_address.port), &send_addr);
 
         req->handle.data = this;
 
@@ -111,12 +304,10 @@ public:
         memcpy(new_data, data, len);
         req->buf = uv_buf_init(new_data, len);
 
-        memset(req->ip, 0, sizeof(req->ip));
-        memcpy(req->ip, remote_address.ip_address.c_str(), remote_address.ip_address.size());
-        req->port = remote_address.port;
+        memcpy(&req->addr, &addr, sizeof(req->addr));
 
         uv_udp_send((uv_udp_send_t*)req, &udp_handle_, &req->buf, 1,
-                (const struct sockaddr *)&send_addr, udp_send_callback);
+                (const struct sockaddr *)&req->addr, udp_send_callback);
     }
 
 private:
@@ -136,7 +327,7 @@ private:
 
     void on_alloc(uv_buf_t* buf) {
         buf->base = recv_buffer_;
-        buf->len  = UDP_DATA_BUFFER_MAX;
+        buf->len  = recv_buffer_len_;
     }
 
     void on_read(uv_udp_t* handle,
@@ -145,10 +336,9 @@ private:
             const struct sockaddr* addr,
             unsigned flags) {
         if (cb_) {
-            if (nread > 0) {
-                uint16_t remote_port = 0;
-                std::string remote_ip = get_ip_str(addr, remote_port);
-                udp_tuple addr_tuple(remote_ip, remote_port);
+            //in recvmmsg mode, the last callback with UV_UDP_MMSG_FREE has no datagram
+            if ((nread > 0) && addr) {
+                udp_tuple addr_tuple(addr);
                 cb_->on_read(buf->base, nread, addr_tuple);
             }
         }
@@ -156,40 +346,229 @@ private:
     }
 
     void on_write(uv_udp_send_t* req, int status) {
-        udp_tuple addr;
-        if (status != 0) {
-            if (cb_) {
-                cb_->on_write(0, addr);
+        udp_req_info_t* wr = (udp_req_info_t*)req;
+
+        if (cb_) {
+            if (status != 0) {
+                cb_->on_write(0, udp_tuple());
+            } else {
+                cb_->on_write(wr->buf.len, udp_tuple((const struct sockaddr*)&wr->addr));
             }
-            udp_req_info_t* wr = (udp_req_info_t*)req;
-            if (wr) {
-                free(wr);
-                if (wr->buf.base) {
-                    free(wr->buf.base);
-                }
+        }
+        if (wr->buf.base) {
+            free(wr->buf.base);
+        }
+        free(wr);
+    }
+
+#ifdef UDP_BATCH_SUPPORT
+    void init_batch() {
+        uv_prepare_init(loop_, &flush_handle_);
+        flush_handle_.data = this;
+        uv_prepare_start(&flush_handle_, udp_flush_callback);
+
+        send_data_.reserve(UDP_SEND_BATCH_MAX * 1500);
+        send_items_.reserve(UDP_SEND_BATCH_MAX);
+    }
+
+    //the steering program picks the socket by the source address like udp_steer_index,
+    //the kernel hash is used when it can't be attached
+    static int open_reuseport_socket(uint16_t port, size_t count) {
+        int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int on = 1;
+
+        if (fd < 0) {
+            return -1;
+        }
+        if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0) {
+            close(fd);
+            return -1;
+        }
+
+        struct sockaddr_in addr;
+        uv_ip4_addr("0.0.0.0", port, &addr);
+        if (bind(fd, (const struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            return -1;
+        }
+        //the program is attached to the group after the socket joins it
+        if (count > 1) {
+            struct sock_filter code[] = {
+                BPF_STMT(BPF_LD | BPF_W | BPF_ABS, (uint32_t)(SKF_NET_OFF + 12)),//source ip
+                BPF_STMT(BPF_MISC | BPF_TAX, 0),
+                BPF_STMT(BPF_LD | BPF_H | BPF_ABS, (uint32_t)(SKF_NET_OFF + 20)),//source port
+                BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+                BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, (uint32_t)count),
+                BPF_STMT(BPF_RET | BPF_A, 0),
+            };
+            struct sock_fprog prog;
+            prog.len    = sizeof(code) / sizeof(code[0]);
+            prog.filter = code;
+            if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) != 0) {
+                log_warnf("attach udp reuseport steering error:%s", strerror(errno));
+            }
+        }
+        return fd;
+    }
+
+    class udp_send_item
+    {
+    public:
+        size_t offset = 0;
+        size_t len    = 0;
+        udp_tuple address;
+    };
+
+    void add_batch(const char* data, size_t len, const udp_tuple& remote_address) {
+        udp_send_item item;
+
+        item.offset  = send_data_.size();
+        item.len     = len;
+        item.address = remote_address;
+        send_data_.insert(send_data_.end(), data, data + len);
+        send_items_.push_back(item);
+
+        if (send_items_.size() >= UDP_SEND_BATCH_MAX) {
+            flush_batch();
+        }
+    }
+
+    //the packets to the same peer with the same size are sent as gso segments,
+    //only the last segment may be smaller, return the count of the packets
+    size_t get_gso_count(size_t start) {
+        const udp_send_item& first = send_items_[start];
+        size_t total = first.len;
+        size_t count = 1;
+
+        if (!gso_enable_) {
+            return 1;
+        }
+        while ((start + count < send_items_.size()) && (count < UDP_GSO_MAX_SEGMENTS)) {
+            const udp_send_item& prev = send_items_[start + count - 1];
+            const udp_send_item& item = send_items_[start + count];
+
+            if ((prev.len != first.len) || (item.len > first.len) || (item.address.key != first.address.key)
+                || (total + item.len > UDP_GSO_MAX_SIZE)) {
+                break;
             }
+            total += item.len;
+            count++;
+        }
+        return count;
+    }
+
+    void flush_batch() {
+        if (send_items_.empty()) {
             return;
         }
-        
-        udp_req_info_t* wr = (udp_req_info_t*)req;
-        if (cb_) {
-            addr.ip_address = wr->ip;
-            addr.port       = wr->port;
-            cb_->on_write(wr->buf.len, addr);
+        //the packets in the libuv queue are sent first, the order is kept
+        int fd = -1;
+        if ((uv_udp_get_send_queue_count(&udp_handle_) > 0) ||
+            (uv_fileno((uv_handle_t*)&udp_handle_, &fd) != 0)) {
+            send_batch_by_uv(0);
+            return;
+        }
+
+        struct mmsghdr msgs[UDP_SEND_BATCH_MAX];
+        struct iovec iovs[UDP_SEND_BATCH_MAX];
+        char controls[UDP_SEND_BATCH_MAX][CMSG_SPACE(sizeof(uint16_t))];
+        size_t msg_items[UDP_SEND_BATCH_MAX];//the first packet index of the message
+        size_t msg_count = 0;
+        size_t index = 0;
+
+        while (index < send_items_.size()) {
+            const udp_send_item& item = send_items_[index];
+            size_t count = get_gso_count(index);
+            size_t total = 0;
+
+            for (size_t i = index; i < index + count; i++) {
+                total += send_items_[i].len;
+            }
+            //the packets of one peer are contiguous in the send data
+            iovs[msg_count].iov_base = &send_data_[item.offset];
+            iovs[msg_count].iov_len  = total;
+
+            struct msghdr* hdr = &msgs[msg_count].msg_hdr;
+            memset(hdr, 0, sizeof(struct msghdr));
+            hdr->msg_name    = (void*)&item.address.addr;
+            hdr->msg_namelen = (item.address.key.family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+            hdr->msg_iov     = &iovs[msg_count];
+            hdr->msg_iovlen  = 1;
+            if (count > 1) {
+                hdr->msg_control    = controls[msg_count];
+                hdr->msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+
+                struct cmsghdr* cmsg = CMSG_FIRSTHDR(hdr);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type  = UDP_SEGMENT;
+                cmsg->cmsg_len   = CMSG_LEN(sizeof(uint16_t));
+                uint16_t segment_size = (uint16_t)item.len;
+                memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+            }
+            msg_items[msg_count] = index;
+            msg_count++;
+            index += count;
         }
-        if (wr) {
-            if (wr->buf.base) {
-                free(wr->buf.base);
+
+        size_t sent = 0;
+        while (sent < msg_count) {
+            int ret = sendmmsg(fd, msgs + sent, msg_count - sent, MSG_DONTWAIT);
+            if (ret > 0) {
+                sent += ret;
+                continue;
+            }
+            if (errno == EINTR) {
+                continue;
             }
-            free(wr);
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == ENOBUFS)) {
+                //the socket buffer is full, libuv sends the rest when it's writable
+                break;
+            }
+            if (gso_enable_ && ((errno == EIO) || (errno == EINVAL) || (errno == ENOPROTOOPT))) {
+                //the kernel or the nic doesn't support udp gso
+                log_warnf("udp gso is disabled, error:%s", strerror(errno));
+                gso_enable_ = false;
+                break;
+            }
+            log_errorf("udp sendmmsg error:%s", strerror(errno));
+            sent++;//the datagram is dropped like a lost one
         }
+
+        size_t sent_items = (sent < msg_count) ? msg_items[sent] : send_items_.size();
+        if (cb_) {
+            for (size_t i = 0; i < sent_items; i++) {
+                cb_->on_write(send_items_[i].len, send_items_[i].address);
+            }
+        }
+        send_batch_by_uv(sent_items);
     }
 
+    void send_batch_by_uv(size_t start) {
+        for (size_t i = start; i < send_items_.size(); i++) {
+            send_packet(&send_data_[send_items_[i].offset], send_items_[i].len, send_items_[i].address.addr);
+        }
+        send_data_.clear();
+        send_items_.clear();
+    }
+#endif
+
 private:
     udp_session_callbackI* cb_ = nullptr;
     uv_loop_t* loop_ = nullptr;
     uv_udp_t udp_handle_;
     char* recv_buffer_ = nullptr;
+    size_t recv_buffer_len_ = 0;
+
+private:
+    bool batch_ = false;
+    bool gso_enable_ = true;
+    uv_prepare_t flush_handle_;
+    std::vector<char> write_buffer_;//the buffer of alloc_write without batch
+#ifdef UDP_BATCH_SUPPORT
+    std::vector<char> send_data_;
+    std::vector<udp_send_item> send_items_;
+    size_t alloc_offset_ = 0;
+#endif
 };
 
 inline void udp_alloc_callback(uv_handle_t* handle,
@@ -219,4 +598,11 @@ inline void udp_send_callback(uv_udp_send_t* req, int status) {
     }
 }
 
+inline void udp_flush_callback(uv_prepare_t* handle) {
+    udp_server* server = (udp_server*)handle->data;
+    if (server) {
+        server->flush();
+    }
+}
+
 #endif
\ No newline at end of file
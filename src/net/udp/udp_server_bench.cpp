@@ -0,0 +1,188 @@
+#include "udp_server.hpp"
+#include "logger.hpp"
+#include "timeex.hpp"
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+udp server benchmark:
+    udp_server_bench [packet count] [packet size] [burst]
+the sender writes the packets in bursts to one peer like the fan-out of the subscribers,
+the receiver counts them in another thread. it runs in the single packet mode(one
+uv_udp_send per packet, one recvmsg per datagram) and in the batch mode(sendmmsg/gso
+flushed once per loop iteration, recvmmsg), the pps per cpu core of both sides is printed.
+*/
+
+#define BENCH_RECV_PORT 19400
+
+static int64_t get_thread_cpu_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+class bench_receiver : public udp_session_callbackI
+{
+public:
+    bench_receiver() {}
+    virtual ~bench_receiver() {}
+
+public:
+    virtual void on_write(size_t sent_size, const udp_tuple& address) override {}
+    virtual void on_read(const char* data, size_t data_size, const udp_tuple& address) override {
+        count_++;
+        bytes_ += data_size;
+    }
+
+public:
+    std::atomic<int64_t> count_{0};
+    int64_t bytes_ = 0;
+};
+
+class bench_sender : public udp_session_callbackI
+{
+public:
+    bench_sender() {}
+    virtual ~bench_sender() {}
+
+public:
+    virtual void on_write(size_t sent_size, const udp_tuple& address) override {}
+    virtual void on_read(const char* data, size_t data_size, const udp_tuple& address) override {}
+};
+
+class bench_result
+{
+public:
+    double send_pps_core = 0.0;
+    double recv_pps_core = 0.0;
+    int64_t received     = 0;
+    bool gso             = false;
+};
+
+static uv_loop_t* recv_loop_p = nullptr;
+static std::atomic<bool> recv_stop{false};
+
+static void on_recv_check(uv_timer_t* handle) {
+    if (recv_stop) {
+        uv_stop(recv_loop_p);
+    }
+}
+
+class send_context
+{
+public:
+    udp_server* server = nullptr;
+    udp_tuple address;
+    std::string packet;
+    int64_t total = 0;
+    int64_t sent  = 0;
+    int burst     = 0;
+};
+
+static void on_send_idle(uv_idle_t* handle) {
+    send_context* ctx = (send_context*)handle->data;
+
+    for (int i = 0; (i < ctx->burst) && (ctx->sent < ctx->total); i++) {
+        ctx->server->write((char*)ctx->packet.data(), ctx->packet.size(), ctx->address);
+        ctx->sent++;
+    }
+    if (ctx->sent >= ctx->total) {
+        uv_idle_stop(handle);
+    }
+}
+
+static bench_result run_bench(bool batch, int64_t count, size_t size, int burst) {
+    bench_result result;
+    bench_receiver receiver;
+    int64_t recv_cpu_us = 0;
+
+    recv_stop = false;
+    std::thread recv_thread([&]() {
+        uv_loop_t loop;
+        uv_timer_t check_timer;
+
+        uv_loop_init(&loop);
+        recv_loop_p = &loop;
+        udp_server server(&loop, BENCH_RECV_PORT, &receiver, batch);
+        uv_timer_init(&loop, &check_timer);
+        uv_timer_start(&check_timer, on_recv_check, 10, 10);
+
+        int64_t start_cpu = get_thread_cpu_us();
+        uv_run(&loop, UV_RUN_DEFAULT);
+        recv_cpu_us = get_thread_cpu_us() - start_cpu;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    uv_loop_t loop;
+    uv_idle_t idle;
+    bench_sender sender;
+
+    uv_loop_init(&loop);
+    udp_server server(&loop, 0, &sender, batch);
+
+    struct sockaddr_in peer_addr;
+    uv_ip4_addr("127.0.0.1", BENCH_RECV_PORT, &peer_addr);
+
+    send_context ctx;
+    ctx.server  = &server;
+    ctx.address = udp_tuple((struct sockaddr*)&peer_addr);
+    ctx.packet.assign(size, 'x');
+    ctx.total   = count;
+    ctx.burst   = burst;
+
+    uv_idle_init(&loop, &idle);
+    idle.data = &ctx;
+    uv_idle_start(&idle, on_send_idle);
+
+    int64_t start_cpu = get_thread_cpu_us();
+    while (ctx.sent < ctx.total) {
+        uv_run(&loop, UV_RUN_NOWAIT);
+    }
+    server.flush();
+    while (server.get_send_queue_count() > 0) {
+        uv_run(&loop, UV_RUN_NOWAIT);
+    }
+    int64_t send_cpu_us = get_thread_cpu_us() - start_cpu;
+    result.gso = server.is_batch() && server.is_gso();
+
+    //wait for the datagrams in flight
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    recv_stop = true;
+    recv_thread.join();
+
+    result.received      = receiver.count_;
+    result.send_pps_core = (send_cpu_us > 0) ? (double)count * 1000000.0 / send_cpu_us : 0.0;
+    result.recv_pps_core = (recv_cpu_us > 0) ? (double)result.received * 1000000.0 / recv_cpu_us : 0.0;
+    return result;
+}
+
+int main(int argn, char** argv) {
+    int64_t count = (argn > 1) ? atoll(argv[1]) : 1000000;
+    size_t size   = (argn > 2) ? (size_t)atoi(argv[2]) : 1200;
+    int burst     = (argn > 3) ? atoi(argv[3]) : 32;
+
+    if ((count <= 0) || (size == 0) || (size > 1472) || (burst <= 0)) {
+        printf("usage: %s [packet count] [packet size(<=1472)] [burst]\r\n", argv[0]);
+        return -1;
+    }
+    Logger::get_instance()->set_filename("udp_server_bench.log");
+
+    printf("packets:%ld, size:%lu, burst:%d\r\n", count, size, burst);
+
+    bench_result single = run_bench(false, count, size, burst);
+    printf("single mode: send %.0f pps/core, recv %.0f pps/core, received:%ld\r\n",
+        single.send_pps_core, single.recv_pps_core, single.received);
+
+#ifdef UDP_BATCH_SUPPORT
+    bench_result batch = run_bench(true, count, size, burst);
+    printf("batch mode:  send %.0f pps/core, recv %.0f pps/core, received:%ld, gso:%s\r\n",
+        batch.send_pps_core, batch.recv_pps_core, batch.received, batch.gso ? "on" : "off");
+    printf("speed up: send %.2fx, recv %.2fx\r\n",
+        batch.send_pps_core / single.send_pps_core, batch.recv_pps_core / single.recv_pps_core);
+#endif
+    return 0;
+}
@@ -1,31 +1,42 @@
 #include "jitterbuffer.hpp"
 #include "timeex.hpp"
+#include "logger.hpp"
 
 jitterbuffer::jitterbuffer(jitterbuffer_callbackI* cb, uv_loop_t* loop):timer_interface(loop, 100)
-                    , cb_(cb) {
-    for (size_t i = 0; i < BUFFER_POOL_SIZE; i++) {
-        pkt_buffers_[i] = new uint8_t[RTP_PACKET_MAX_SIZE];
+                    , cb_(cb)
+                    , ring_(JITTER_RING_SIZE) {
+    pool_.reserve(JITTER_POOL_SIZE);
+    for (size_t i = 0; i < JITTER_POOL_SIZE; i++) {
+        pool_.push_back(std::make_shared<rtp_packet_info>());
     }
 }
 
 jitterbuffer::~jitterbuffer() {
-    for (size_t i = 0; i < BUFFER_POOL_SIZE; i++) {
-        if (pkt_buffers_[i]) {
-            delete[] pkt_buffers_[i];
+}
+
+std::shared_ptr<rtp_packet_info> jitterbuffer::get_packet_info() {
+    size_t count = pool_.size();
+
+    for (size_t i = 0; i < count; i++) {
+        std::shared_ptr<rtp_packet_info>& info_ptr = pool_[pool_index_];
+
+        pool_index_ = (pool_index_ + 1) % count;
+        //only the pool holds it
+        if (info_ptr.use_count() == 1) {
+            return info_ptr;
         }
     }
+
+    std::shared_ptr<rtp_packet_info> info_ptr = std::make_shared<rtp_packet_info>();
+    pool_.push_back(info_ptr);
+    log_infof("jitter buffer pool grows to %lu, media type:%d", pool_.size(), media_type_);
+    return info_ptr;
 }
 
-void jitterbuffer::input_rtp_packet(const std::string& roomId, const std::string& uid,
-                            const std::string& media_type, const std::string& stream_type,
-                            int clock_rate, rtp_packet* pkt) {
+void jitterbuffer::input_rtp_packet(rtp_packet* input_pkt) {
     int64_t extend_seq = 0;
     bool reset = false;
     bool first_pkt = false;
-    size_t index = (buffer_index_++) % RTP_PACKET_MAX_SIZE;
-    uint8_t* buffer = pkt_buffers_[index];
-
-    rtp_packet* input_pkt = pkt->clone(buffer);
 
     if (!init_flag_) {
         init_flag_ = true;
@@ -44,14 +55,30 @@ void jitterbuffer::input_rtp_packet(const std::string& roomId, const std::string
         }
     }
 
-    std::shared_ptr<rtp_packet_info> pkt_info_ptr = std::make_shared<rtp_packet_info>(roomId,
-                                                                                uid,
-                                                                                media_type,
-                                                                                stream_type,
-                                                                                clock_rate,
-                                                                                input_pkt,
-                                                                                extend_seq);
+    if (!first_pkt && !reset) {
+        if (extend_seq <= output_seq_) {
+            log_infof("receive old seq:%ld, output_seq:%ld media type:%d",
+                    extend_seq, output_seq_, media_type_);
+            return;
+        }
+        if ((extend_seq > output_seq_ + 1) && (extend_seq - output_seq_ < JITTER_RING_SIZE)) {
+            std::shared_ptr<rtp_packet_info>& slot = ring_[extend_seq & JITTER_RING_MASK];
+            if (slot) {
+                //it's repeated
+                return;
+            }
+        }
+    }
+
+    std::shared_ptr<rtp_packet_info> pkt_info_ptr = get_packet_info();
+    if (!pkt_info_ptr->copy_from(input_pkt, extend_seq)) {
+        log_errorf("jitter buffer copy rtp packet error, seq:%d", input_pkt->get_seq());
+        return;
+    }
+
     if (reset) {
+        //the buffered packets are from the last round, drop them
+        clear_ring();
         //if the rtc client is reset, call the reset callback which send pli
         report_lost(pkt_info_ptr);
     }
@@ -66,32 +93,28 @@ void jitterbuffer::input_rtp_packet(const std::string& roomId, const std::string
     if ((output_seq_ + 1) == extend_seq) {
         output_packet(pkt_info_ptr);
 
-        //check the packet in map
-        for (auto iter = rtp_packets_map_.begin();
-            iter != rtp_packets_map_.end();
-            ) {
-            int64_t pkt_extend_seq = iter->first;
-            if ((output_seq_ + 1) == pkt_extend_seq) {
-                if (iter->second->media_type_ == "video") {
-                    log_debugf("jitter buffer media type:%s, output seq(%d) in buffer queue",
-                        iter->second->media_type_.c_str(), pkt_extend_seq);
-                }
-                output_packet(iter->second);
-                iter = rtp_packets_map_.erase(iter);
-                continue;
-            }
-            break;
-        }
+        //check the packets in the ring
+        output_continued();
         return;
-    } else if (extend_seq <= output_seq_) {
-        log_infof("receive old seq:%ld, output_seq:%ld media type:%s",
-                extend_seq, output_seq_, pkt_info_ptr->media_type_.c_str());
+    }
+
+    if (extend_seq - output_seq_ >= JITTER_RING_SIZE) {
+        log_warnf("jitter buffer media type:%d, seq:%ld is out of the ring, last output seq:%ld",
+            media_type_, extend_seq, output_seq_);
+        flush_ring();
+        output_packet(pkt_info_ptr);
+        report_lost(pkt_info_ptr);
         return;
     }
-    rtp_packets_map_[extend_seq] = pkt_info_ptr;
-    if (pkt_info_ptr->media_type_ == "video") {
-        log_debugf("jitterbuffer media type:%s, packets queue len:%lu, pkt seq:%d, last output seq:%d",
-            pkt_info_ptr->media_type_.c_str(), rtp_packets_map_.size(), pkt_info_ptr->extend_seq_, output_seq_);
+
+    ring_[extend_seq & JITTER_RING_MASK] = pkt_info_ptr;
+    ring_count_++;
+    if (extend_seq > ring_max_seq_) {
+        ring_max_seq_ = extend_seq;
+    }
+    if (media_type_ == MEDIA_VIDEO_TYPE) {
+        log_debugf("jitterbuffer packets queue len:%lu, pkt seq:%ld, last output seq:%ld",
+            ring_count_, extend_seq, output_seq_);
     }
 
     check_timeout();
@@ -103,33 +126,79 @@ void jitterbuffer::on_timer() {
     check_timeout();
 }
 
+void jitterbuffer::output_continued() {
+    while (ring_count_ > 0) {
+        std::shared_ptr<rtp_packet_info>& slot = ring_[(output_seq_ + 1) & JITTER_RING_MASK];
+        if (!slot) {
+            break;
+        }
+        if (media_type_ == MEDIA_VIDEO_TYPE) {
+            log_debugf("jitter buffer output seq(%ld) in buffer queue", slot->extend_seq_);
+        }
+        std::shared_ptr<rtp_packet_info> pkt_info_ptr;
+        pkt_info_ptr.swap(slot);
+        ring_count_--;
+        output_packet(pkt_info_ptr);
+    }
+}
+
+void jitterbuffer::flush_ring() {
+    for (int64_t seq = output_seq_ + 1; (ring_count_ > 0) && (seq <= ring_max_seq_); seq++) {
+        std::shared_ptr<rtp_packet_info>& slot = ring_[seq & JITTER_RING_MASK];
+        if (!slot) {
+            continue;
+        }
+        std::shared_ptr<rtp_packet_info> pkt_info_ptr;
+        pkt_info_ptr.swap(slot);
+        ring_count_--;
+        output_packet(pkt_info_ptr);
+    }
+}
+
+void jitterbuffer::clear_ring() {
+    if (ring_count_ == 0) {
+        return;
+    }
+    for (auto& slot : ring_) {
+        slot.reset();
+    }
+    ring_count_   = 0;
+    ring_max_seq_ = 0;
+}
+
 void jitterbuffer::check_timeout() {
-    if (rtp_packets_map_.empty()) {
+    if (ring_count_ == 0) {
         return;
     }
     int64_t now_ms = now_millisec();
-    for(auto iter = rtp_packets_map_.begin();
-        iter != rtp_packets_map_.end();) {
-        std::shared_ptr<rtp_packet_info> pkt_info_ptr = iter->second;
+
+    //the packets are checked in seq order, the later ones are received later
+    for (int64_t seq = output_seq_ + 1; (ring_count_ > 0) && (seq <= ring_max_seq_); seq++) {
+        std::shared_ptr<rtp_packet_info>& slot = ring_[seq & JITTER_RING_MASK];
+        if (!slot) {
+            continue;
+        }
+        std::shared_ptr<rtp_packet_info> pkt_info_ptr = slot;
         int64_t diff_t = now_ms - pkt_info_ptr->pkt->get_local_ms();
 
         if (diff_t > JITTER_BUFFER_TIMEOUT) {
-            if (pkt_info_ptr->media_type_ == "video") {
-                log_infof("timeout output type:%s, seq:%d",
-                    pkt_info_ptr->media_type_.c_str(), pkt_info_ptr->extend_seq_);
+            if (media_type_ == MEDIA_VIDEO_TYPE) {
+                log_infof("timeout output type:%d, seq:%ld",
+                    media_type_, pkt_info_ptr->extend_seq_);
             }
-
+            slot.reset();
+            ring_count_--;
             output_packet(pkt_info_ptr);
-            iter = rtp_packets_map_.erase(iter);
             report_lost(pkt_info_ptr);
             continue;
         }
         if ((output_seq_ + 1) == pkt_info_ptr->extend_seq_) {
-            output_packet(iter->second);
-            iter = rtp_packets_map_.erase(iter);
+            slot.reset();
+            ring_count_--;
+            output_packet(pkt_info_ptr);
             continue;
         }
-        iter++;
+        break;
     }
 
     return;
@@ -195,6 +264,11 @@ bool jitterbuffer::update_seq(rtp_packet* input_pkt, int64_t& extend_seq, bool&
             }
     } else {
         /* duplicate or reordered packet */
+        if ((seq > max_seq_) && (cycles_ >= RTP_SEQ_MOD)) {
+            //it's before the wrap, in the last cycle
+            extend_seq = (int64_t)cycles_ - RTP_SEQ_MOD + seq;
+            return true;
+        }
     }
     extend_seq = cycles_ + seq;
     return true;
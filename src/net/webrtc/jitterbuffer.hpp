@@ -4,15 +4,24 @@
 #include "rtp_packet.hpp"
 #include "jitterbuffer_pub.hpp"
 #include "timer.hpp"
+#include "utils/av/av.hpp"
 #include <string>
 #include <stdint.h>
 #include <stddef.h>
-#include <map>
+#include <vector>
 #include <memory>
 #include <uv.h>
 
-#define BUFFER_POOL_SIZE 2000
+#define JITTER_RING_SIZE 1024//power of 2, the max distance from the last output seq
+#define JITTER_RING_MASK (JITTER_RING_SIZE - 1)
+#define JITTER_POOL_SIZE 256//the packet infos created at first, the pool grows when they are all held
 
+/*
+the disordered packets wait in a ring indexed by the extend seq, the packet
+whose seq is out of the ring is output at once after the packets in the ring.
+the packet infos come from a pool and are reused after the pack handler releases them,
+so nothing is allocated for one packet in the steady state.
+*/
 class jitterbuffer : public timer_interface
 {
 public:
@@ -20,9 +29,8 @@ public:
     ~jitterbuffer();
 
 public:
-    void input_rtp_packet(const std::string& roomId, const std::string& uid,
-            const std::string& media_type, const std::string& stream_type,
-            int clock_rate, rtp_packet* input_pkt);
+    void set_media_type(MEDIA_PKT_TYPE media_type) { media_type_ = media_type; }
+    void input_rtp_packet(rtp_packet* input_pkt);
 
 public:
     virtual void on_timer() override;
@@ -31,25 +39,34 @@ private:
     void init_seq(rtp_packet* input_pkt);
     bool update_seq(rtp_packet* input_pkt, int64_t& extend_seq, bool& reset);
     void output_packet(std::shared_ptr<rtp_packet_info>);
+    void output_continued();
+    void flush_ring();
+    void clear_ring();
     void check_timeout();
     void report_lost(std::shared_ptr<rtp_packet_info> pkt_ptr);
+    std::shared_ptr<rtp_packet_info> get_packet_info();
 
 private:
     jitterbuffer_callbackI* cb_ = nullptr;
+    MEDIA_PKT_TYPE media_type_ = MEDIA_UNKOWN_TYPE;
     bool init_flag_ = false;
     uint16_t base_seq_ = 0;
     uint16_t max_seq_  = 0;
     uint32_t bad_seq_  = RTP_SEQ_MOD + 1;   /* so seq == bad_seq is false */
     uint32_t cycles_   = 0;
-    std::map<int64_t, std::shared_ptr<rtp_packet_info>> rtp_packets_map_;//key: extend_seq, value: rtp packet info
 
 private:
     int64_t output_seq_ = 0;
     int64_t report_lost_ts_ = -1;
 
 private:
-    uint8_t* pkt_buffers_[BUFFER_POOL_SIZE];
-    size_t buffer_index_ = 0;
+    std::vector<std::shared_ptr<rtp_packet_info>> ring_;//index: extend_seq & JITTER_RING_MASK
+    size_t ring_count_ = 0;
+    int64_t ring_max_seq_ = 0;
+
+private:
+    std::vector<std::shared_ptr<rtp_packet_info>> pool_;
+    size_t pool_index_ = 0;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -9,35 +9,36 @@
 
 #define JITTER_BUFFER_TIMEOUT 600 //ms
 
+/*
+the packet in the jitter buffer, it owns the buffer of the rtp data.
+the infos are pooled by the jitter buffer and reused when nobody holds them,
+the stream context(room, uid, media type) is kept by the publisher, not here.
+*/
 class rtp_packet_info
 {
 public:
-    rtp_packet_info(const std::string& roomId, const std::string& uid,
-            const std::string& media_type, const std::string& stream_type,
-            int clock_rate, rtp_packet* input_pkt, int64_t extend_seq):roomId_(roomId)
-                                , uid_(uid)
-                                , media_type_(media_type)
-                                , stream_type_(stream_type)
-                                , extend_seq_(extend_seq)
-                                , clock_rate_(clock_rate)
+    rtp_packet_info():packet_(rtp_packet_view())
     {
-        this->pkt = input_pkt->clone();
+        this->pkt = &packet_;
     }
 
     ~rtp_packet_info()
     {
-        delete this->pkt;
-        this->pkt = nullptr;
+    }
+
+    bool copy_from(rtp_packet* input_pkt, int64_t extend_seq)
+    {
+        extend_seq_ = extend_seq;
+        return input_pkt->clone_to(packet_, buffer_);
     }
 
 public:
-    std::string roomId_;
-    std::string uid_;
-    std::string media_type_;//"video" or "audio"
-    std::string stream_type_;//"camera" or "screen"
     rtp_packet* pkt = nullptr;
     int64_t extend_seq_ = 0;
-    int clock_rate_     = 0;
+
+private:
+    rtp_packet packet_;
+    uint8_t buffer_[RTP_PACKET_MAX_SIZE];
 };
 
 class jitterbuffer_callbackI
@@ -47,4 +48,4 @@ public:
     virtual void rtp_packet_output(std::shared_ptr<rtp_packet_info> pkt_ptr) = 0;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -2,13 +2,13 @@
 #include "net/rtprtcp/rtprtcp_pub.hpp"
 #include "logger.hpp"
 #include "timeex.hpp"
-#include <algorithm>
-#include <sstream>
 
 extern uv_loop_t* get_global_io_context();
 
 nack_generator::nack_generator(nack_generator_callback_interface* cb):timer_interface(get_global_io_context(), NACK_DEFAULT_TIMEOUT)
     , cb_(cb)
+    , nack_ring_(NACK_RING_SIZE)
+    , lost_bits_(NACK_RING_SIZE / 64, 0)
 {
     start_timer();
 }
@@ -22,6 +22,28 @@ void nack_generator::update_rtt(int64_t rtt) {
     rtt_ = rtt;
 }
 
+void nack_generator::set_lost(uint16_t seq) {
+    size_t index = seq & NACK_RING_MASK;
+
+    if (!is_lost(index)) {
+        lost_bits_[index >> 6] |= (uint64_t)1 << (index & 63);
+        lost_count_++;
+    }
+    nack_ring_[index] = NACK_INFO();
+}
+
+void nack_generator::clear_lost(size_t index) {
+    if (is_lost(index)) {
+        lost_bits_[index >> 6] &= ~((uint64_t)1 << (index & 63));
+        lost_count_--;
+    }
+}
+
+void nack_generator::clear_all() {
+    std::fill(lost_bits_.begin(), lost_bits_.end(), 0);
+    lost_count_ = 0;
+}
+
 void nack_generator::update_nacklist(rtp_packet* pkt) {
     uint16_t seq = pkt->get_seq();
 
@@ -37,92 +59,114 @@ void nack_generator::update_nacklist(rtp_packet* pkt) {
     }
 
     if (seq_lower_than(seq, last_seq_)) {
-        auto iter = nack_map_.find(seq);
+        size_t index = seq & NACK_RING_MASK;
 
         //the seq has been in the nack list, remove it.
-        if (iter != nack_map_.end()) {
-            nack_map_.erase(iter);
-            log_debugf("remove from nack map, ssrc:%u, seq:%d, last seq:%d, payloadtype:%d",
+        if (((uint16_t)(last_seq_ - seq) < NACK_RING_SIZE) && is_lost(index)) {
+            clear_lost(index);
+            log_debugf("remove from nack list, ssrc:%u, seq:%d, last seq:%d, payloadtype:%d",
                 pkt->get_ssrc(), seq, last_seq_, pkt->get_payload_type());
             return;
         }
-        std::stringstream ss;
-
-        ss << "[";
-        for (auto item : nack_map_) {
-            ss << " " << item.first;
-        }
-        ss << " ]";
-        log_debugf("receive the old packet which is not in nack list, ssrc:%u, seq:%d, last seq:%d, payloadtype:%d, nack list:%s",
-            pkt->get_ssrc(), seq, last_seq_, pkt->get_payload_type(), ss.str().c_str());
+        log_debugf("receive the old packet which is not in nack list, ssrc:%u, seq:%d, last seq:%d, payloadtype:%d, lost count:%lu",
+            pkt->get_ssrc(), seq, last_seq_, pkt->get_payload_type(), lost_count_);
         return;
     }
 
-    if ((last_seq_ + 1) == seq) {
-        last_seq_ = seq;
-        return;
+    uint16_t gap = seq - last_seq_;
+    if (gap > NACK_LIST_MAX) {
+        log_warnf("the nack list is overflow(%d) and the list threshold is %d, seq:%d, last seq:%d",
+            gap - 1, NACK_LIST_MAX, seq, last_seq_);
+        //only the newest lost sequences are requested
+        clear_all();
+        last_seq_ = seq - NACK_LIST_MAX;
+    } else if (gap > 1) {
+        log_debugf("nack receive seq:%d, last seq:%d", seq, last_seq_);
     }
 
-    uint16_t seq_start = last_seq_;
-    uint16_t seq_end   = seq;
-    
-    log_debugf("nack receive seq:%d, last seq:%d", seq, last_seq_);
+    //add seqs in nack list, their slots are taken over from the sequences of the last round
+    for (uint16_t lost_seq = last_seq_ + 1; lost_seq != seq; lost_seq++) {
+        set_lost(lost_seq);
+    }
+    clear_lost(seq & NACK_RING_MASK);
     last_seq_ = seq;
+}
+
+void nack_generator::add_nack_seq(uint16_t seq) {
+    if (block_open_) {
+        uint16_t diff = seq - block_pid_;
 
-    //add seqs in nack list
-    for (uint16_t key_seq = seq_start + 1; key_seq < seq_end; key_seq++) {
-        auto iter = nack_map_.find(key_seq);
-        if (iter == nack_map_.end()) {
-            nack_map_.insert(std::make_pair(key_seq, NACK_INFO(key_seq, 0, 0)));
+        if ((diff >= 1) && (diff <= 16)) {
+            block_blp_ |= (uint16_t)(1 << (diff - 1));
+            return;
+        }
+        blocks_[block_count_].packet_id   = htons(block_pid_);
+        blocks_[block_count_].lost_bitmap = htons(block_blp_);
+        block_count_++;
+
+        if (block_count_ >= NACK_BLOCKS_MAX) {
+            cb_->generate_nack_blocks(blocks_, block_count_);
+            block_count_ = 0;
         }
     }
+    block_open_ = true;
+    block_pid_  = seq;
+    block_blp_  = 0;
+}
+
+void nack_generator::flush_nack_blocks() {
+    if (block_open_) {
+        blocks_[block_count_].packet_id   = htons(block_pid_);
+        blocks_[block_count_].lost_bitmap = htons(block_blp_);
+        block_count_++;
+        block_open_ = false;
+    }
+    if (block_count_ > 0) {
+        log_debugf("generate nack blocks:%lu, first seq:%d, lost count:%lu",
+            block_count_, ntohs(blocks_[0].packet_id), lost_count_);
+        cb_->generate_nack_blocks(blocks_, block_count_);
+        block_count_ = 0;
+    }
 }
 
 void nack_generator::on_timer() {
-    if (nack_map_.empty()) {
+    if (lost_count_ == 0) {
         return;
     }
 
     int64_t now_ms = now_millisec();
-    std::vector<uint16_t> lost_seq_list;
-    auto iter = nack_map_.begin();
+    //from the oldest slot to the newest one, so the sequences are in order
+    size_t start       = (size_t)(uint16_t)(last_seq_ + 1) & NACK_RING_MASK;
+    uint16_t start_seq = (uint16_t)(last_seq_ + 1 - NACK_RING_SIZE);
+    size_t i = 0;
 
-    while(iter != nack_map_.end()) {
-        if (iter->second.retry > NACK_RETRY_MAX) {
-            iter = nack_map_.erase(iter);
+    while (i < NACK_RING_SIZE) {
+        size_t index  = (start + i) & NACK_RING_MASK;
+        uint64_t word = lost_bits_[index >> 6] >> (index & 63);
+
+        if (word == 0) {
+            i += 64 - (index & 63);
             continue;
         }
-        if (now_ms - iter->second.sent_ms < rtt_) {
-            iter++;
+        if ((word & 1) == 0) {
+            i++;
             continue;
         }
-        iter->second.sent_ms = now_ms;
-        iter->second.retry++;
-
-        lost_seq_list.push_back(iter->first);
-
-        iter++;
-    }
-
-    if (!lost_seq_list.empty()) {
-        std::stringstream ss;
-        std::sort(lost_seq_list.begin(), lost_seq_list.end());
-        ss << "[";
-        for (auto seq : lost_seq_list) {
-            ss << seq;
-            ss << " ";
+        NACK_INFO& info = nack_ring_[index];
+
+        if (info.retry > NACK_RETRY_MAX) {
+            clear_lost(index);
+        } else if (now_ms - info.sent_ms >= rtt_) {
+            info.sent_ms = now_ms;
+            info.retry++;
+            add_nack_seq((uint16_t)(start_seq + i));
         }
-        ss << "]";
-        log_infof("generate nacklist:%s", ss.str().c_str());
-        cb_->generate_nacklist(lost_seq_list);
+        i++;
     }
+    flush_nack_blocks();
 
-    if (nack_map_.size() > NACK_LIST_MAX) {
+    if (lost_count_ > NACK_LIST_MAX) {
         log_warnf("the nack list is overflow(%lu) and the list threshold is %d",
-            nack_map_.size(), NACK_LIST_MAX);
-    }
-
-    while (nack_map_.size() > NACK_LIST_MAX) {
-        nack_map_.erase(nack_map_.begin());
+            lost_count_, NACK_LIST_MAX);
     }
 }
@@ -2,43 +2,46 @@
 #define NACK_GENERATOR_HPP
 #include "net/rtprtcp/rtprtcp_pub.hpp"
 #include "net/rtprtcp/rtp_packet.hpp"
+#include "net/rtprtcp/rtcpfb_nack.hpp"
 #include "timer.hpp"
 #include <stdint.h>
 #include <stddef.h>
 #include <string>
 #include <vector>
-#include <map>
 
 #define NACK_LIST_MAX        5000
 #define NACK_DEFAULT_TIMEOUT 30//ms
 #define NACK_RETRY_MAX       20
 #define NACK_DEFAULT_RTT     20//ms
+#define NACK_RING_SIZE       8192//power of 2 and over NACK_LIST_MAX
+#define NACK_RING_MASK       (NACK_RING_SIZE - 1)
+#define NACK_BLOCKS_MAX      256//the fci blocks in one rtcp nack packet
 
+//the retry state of one lost sequence in the ring
 class NACK_INFO
 {
 public:
-    NACK_INFO(uint16_t seq, int64_t sent_ms, int retry)
-    {
-        this->seq     = seq;
-        this->sent_ms = sent_ms;
-        this->retry   = retry;
-    }
-    ~NACK_INFO()
-    {
-    }
+    NACK_INFO() {}
+    ~NACK_INFO() {}
 
 public:
-    uint16_t seq;
-    int64_t sent_ms;
-    int retry = 0;
+    int64_t sent_ms = 0;
+    int retry       = 0;
 };
 
 class nack_generator_callback_interface
 {
 public:
-    virtual void generate_nacklist(const std::vector<uint16_t>& seq_vec) = 0;
+    //the blocks are in network order and ready to be put in the rtcp nack packet
+    virtual void generate_nack_blocks(const rtcp_nack_block* blocks, size_t count) = 0;
 };
 
+/*
+the lost sequences are kept in a ring indexed by the low bits of the sequence,
+with a bitmap of the lost slots. the ring covers the last NACK_RING_SIZE sequences
+before the newest one, a slot is overwritten when the newest sequence passes it.
+the timer scans the bitmap by 64 bits and makes the PID+BLP blocks directly.
+*/
 class nack_generator : public timer_interface
 {
 public:
@@ -47,16 +50,36 @@ public:
 
     void update_nacklist(rtp_packet* pkt);
     void update_rtt(int64_t rtt);
+    size_t get_lost_count() { return lost_count_; }
 
 protected:
     virtual void on_timer() override;
 
+private:
+    bool is_lost(size_t index) { return (lost_bits_[index >> 6] >> (index & 63)) & 1; }
+    void set_lost(uint16_t seq);
+    void clear_lost(size_t index);
+    void clear_all();
+    void add_nack_seq(uint16_t seq);
+    void flush_nack_blocks();
+
 private:
     nack_generator_callback_interface* cb_ = nullptr;
     bool init_flag_ = false;
     uint16_t last_seq_ = 0;
-    std::map<uint16_t, NACK_INFO> nack_map_;
     int64_t rtt_ = NACK_DEFAULT_RTT;
+
+private:
+    std::vector<NACK_INFO> nack_ring_;
+    std::vector<uint64_t> lost_bits_;
+    size_t lost_count_ = 0;
+
+private://the blocks made in one timer
+    rtcp_nack_block blocks_[NACK_BLOCKS_MAX];
+    size_t block_count_ = 0;
+    uint16_t block_pid_ = 0;
+    uint16_t block_blp_ = 0;
+    bool block_open_    = false;
 };
 
 #endif
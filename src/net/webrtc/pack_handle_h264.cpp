@@ -6,6 +6,7 @@
 
 static const uint8_t NAL_START_CODE[4] = {0, 0, 0, 1};
 static const size_t H264_STAPA_FIELD_SIZE = 2;
+static const size_t H264_NALU_LEN_SIZE    = 4;
 
 pack_handle_h264::pack_handle_h264(pack_callbackI* cb, uv_loop_t* loop):timer_interface(loop, 100)
                                                     , cb_(cb)
@@ -36,127 +37,126 @@ void pack_handle_h264::get_startend_bit(rtp_packet* pkt, bool& start, bool& end)
 }
 
 void pack_handle_h264::on_timer() {
-    check_fua_timeout();
+    check_frame_timeout();
 }
 
 void pack_handle_h264::input_rtp_packet(std::shared_ptr<rtp_packet_info> pkt_ptr) {
+    rtp_packet* pkt = pkt_ptr->pkt;
+
     if (!init_flag_) {
         init_flag_ = true;
         last_extend_seq_ = pkt_ptr->extend_seq_;
     } else {
         if ((last_extend_seq_ + 1) != pkt_ptr->extend_seq_) {
-            packets_queue_.clear();
-            start_flag_ = false;
-            end_flag_   = false;
-
+            //the frame in assembling lost packets
+            drop_frame();
             report_lost(pkt_ptr);
-            last_extend_seq_ = pkt_ptr->extend_seq_;
-            return;
         }
         last_extend_seq_ = pkt_ptr->extend_seq_;
     }
 
-    uint8_t* payload_data = pkt_ptr->pkt->get_payload();
+    if (pkt->get_payload_length() < 1) {
+        return;
+    }
+    int64_t timestamp = (int64_t)pkt->get_timestamp();
+
+    if (timestamp != frame_ts_) {
+        //the last frame has no marker
+        output_frame();
+        start_frame(timestamp);
+    } else if (frame_dropped_) {
+        return;
+    } else if (!frame_ptr_) {
+        start_frame(timestamp);
+    }
+
+    uint8_t* payload_data = pkt->get_payload();
     uint8_t nal_type = payload_data[0] & 0x1f;
+    bool ok = true;
 
     if ((nal_type >= 1) && (nal_type <= 23)) {//single nalu
-        int64_t dts = pkt_ptr->pkt->get_timestamp();
-        size_t pkt_size = sizeof(NAL_START_CODE) + pkt_ptr->pkt->get_payload_length() + 1024;
-
-        MEDIA_PACKET_PTR h264_pkt_ptr = std::make_shared<MEDIA_PACKET>(pkt_size);
-
-        h264_pkt_ptr->buffer_ptr_->append_data((char*)NAL_START_CODE, sizeof(NAL_START_CODE));
-        h264_pkt_ptr->buffer_ptr_->append_data((char*)payload_data, pkt_ptr->pkt->get_payload_length());
-
-        h264_pkt_ptr->av_type_    = MEDIA_VIDEO_TYPE;
-        h264_pkt_ptr->codec_type_ = MEDIA_CODEC_H264;
-        h264_pkt_ptr->fmt_type_   = MEDIA_FORMAT_RAW;
-        h264_pkt_ptr->dts_        = dts;
-        h264_pkt_ptr->pts_        = dts;
-
-        if ((nal_type == kAvcNaluTypeSPS) || (nal_type == kAvcNaluTypePPS)) {
-            h264_pkt_ptr->is_seq_hdr_   = true;
-            h264_pkt_ptr->is_key_frame_ = false;
-        } else if (nal_type == kAvcNaluTypeIDR) {
-            h264_pkt_ptr->is_seq_hdr_   = false;
-            h264_pkt_ptr->is_key_frame_ = true;
-        } else {
-            h264_pkt_ptr->is_seq_hdr_   = false;
-            h264_pkt_ptr->is_key_frame_ = false;
-        }
+        ok = append_nalu(payload_data, pkt->get_payload_length(), timestamp);
+    } else if (nal_type == 28) {//rtp fua
+        ok = append_fua(pkt);
+    } else if (nal_type == 24) {//handle stapA
+        ok = demux_stapA(pkt);
+    }
 
-        cb_->media_packet_output(h264_pkt_ptr);
+    if (!ok) {
+        drop_frame();
+        report_lost(pkt_ptr);
         return;
-    } else if (nal_type == 28) {//rtp fua
-        bool start = false;
-        bool end   = false;
+    }
 
-        get_startend_bit(pkt_ptr->pkt, start, end);
+    if (pkt->get_marker()) {
+        output_frame();
+    }
+    return;
+}
 
-        if (start && !end) {
-            packets_queue_.clear();
-            start_flag_ = start;
-        } else if (start && end) {//exception happened
-            log_errorf("rtp h264 pack error: both start and end flag are enable");
-            reset_rtp_fua();
-            report_lost(pkt_ptr);
-            return;
-        }
+MEDIA_PACKET_PTR pack_handle_h264::get_frame_packet() {
+    size_t count = frame_pool_.size();
 
-        if (end && !start_flag_) {
-            log_errorf("rtp h264 pack error: get end rtp packet but there is no start rtp packet");
-            reset_rtp_fua();
-            report_lost(pkt_ptr);
-            return;
-        }
+    for (size_t i = 0; i < count; i++) {
+        MEDIA_PACKET_PTR& pkt_ptr = frame_pool_[frame_pool_index_];
 
-        if (end) {
-            end_flag_ = true;
+        frame_pool_index_ = (frame_pool_index_ + 1) % count;
+        //only the pool holds the packet and its buffer
+        if ((pkt_ptr.use_count() == 1) && (pkt_ptr->buffer_ptr_.use_count() == 1)) {
+            pkt_ptr->buffer_ptr_->reset();
+            return pkt_ptr;
         }
+    }
 
-        packets_queue_.push_back(pkt_ptr);
-
-        if (start_flag_ && end_flag_) {
-            MEDIA_PACKET_PTR h264_pkt_ptr = std::make_shared<MEDIA_PACKET>(50*1024);
-            int64_t dts = 0;
-            bool ok = demux_fua(h264_pkt_ptr, dts);
-            if (ok) {
-                h264_pkt_ptr->av_type_    = MEDIA_VIDEO_TYPE;
-                h264_pkt_ptr->codec_type_ = MEDIA_CODEC_H264;
-                h264_pkt_ptr->fmt_type_   = MEDIA_FORMAT_RAW;
-                h264_pkt_ptr->dts_        = dts;
-                h264_pkt_ptr->pts_        = dts;
-                nal_type = ((uint8_t*)h264_pkt_ptr->buffer_ptr_->data())[4];
-                nal_type = nal_type & 0x1f;
-                if ((nal_type == kAvcNaluTypeSPS) || (nal_type == kAvcNaluTypePPS)) {
-                    h264_pkt_ptr->is_seq_hdr_   = true;
-                    h264_pkt_ptr->is_key_frame_ = false;
-                } else if (nal_type == kAvcNaluTypeIDR) {
-                    h264_pkt_ptr->is_seq_hdr_   = false;
-                    h264_pkt_ptr->is_key_frame_ = true;
-                } else {
-                    h264_pkt_ptr->is_seq_hdr_   = false;
-                    h264_pkt_ptr->is_key_frame_ = false;
-                }
-                cb_->media_packet_output(h264_pkt_ptr);
-            } else {
-                report_lost(pkt_ptr);
-            }
-            start_flag_ = false;
-            end_flag_   = false;
-            return;
-        }
+    MEDIA_PACKET_PTR pkt_ptr = std::make_shared<MEDIA_PACKET>(H264_FRAME_INIT_SIZE);
+    if (count < H264_FRAME_POOL_MAX) {
+        frame_pool_.push_back(pkt_ptr);
+    }
+    return pkt_ptr;
+}
+
+void pack_handle_h264::start_frame(int64_t timestamp) {
+    frame_ptr_ = get_frame_packet();
+
+    frame_ptr_->av_type_      = MEDIA_VIDEO_TYPE;
+    frame_ptr_->codec_type_   = MEDIA_CODEC_H264;
+    frame_ptr_->fmt_type_     = MEDIA_FORMAT_RAW;
+    frame_ptr_->dts_          = timestamp;
+    frame_ptr_->pts_          = timestamp;
+    frame_ptr_->is_key_frame_ = false;
+    frame_ptr_->is_seq_hdr_   = false;
+    frame_ptr_->streamid_     = 0;
+    frame_ptr_->typeid_       = 0;
+
+    frame_ts_       = timestamp;
+    frame_start_ms_ = now_millisec();
+    frame_dropped_  = false;
+    fua_started_    = false;
+}
 
-        check_fua_timeout();
+void pack_handle_h264::output_frame() {
+    if (!frame_ptr_) {
+        return;
+    }
+    if (fua_started_) {
+        log_errorf("rtp h264 pack error: the frame ends without the fua end packet, timestamp:%ld", frame_ts_);
+        drop_frame();
         return;
-    } else if (nal_type == 24) {//handle stapA
-        bool ret = demux_stapA(pkt_ptr);
-        if (!ret) {
-            report_lost(pkt_ptr);
-        }
     }
+    MEDIA_PACKET_PTR output_ptr;
 
-    return;
+    output_ptr.swap(frame_ptr_);
+    if (output_ptr->buffer_ptr_->data_len() == 0) {
+        return;
+    }
+    cb_->media_packet_output(output_ptr);
+}
+
+void pack_handle_h264::drop_frame() {
+    //the left packets of the frame are dropped too
+    frame_ptr_.reset();
+    frame_dropped_ = true;
+    fua_started_   = false;
 }
 
 void pack_handle_h264::report_lost(std::shared_ptr<rtp_packet_info> pkt_ptr) {
@@ -168,152 +168,147 @@ void pack_handle_h264::report_lost(std::shared_ptr<rtp_packet_info> pkt_ptr) {
     }
 }
 
-void pack_handle_h264::check_fua_timeout() {
-    size_t queue_len = packets_queue_.size();
+void pack_handle_h264::check_frame_timeout() {
+    if (!frame_ptr_) {
+        return;
+    }
     int64_t now_ms = now_millisec();
-    for (size_t index = 0; index < queue_len; index++) {
-        std::shared_ptr<rtp_packet_info> pkt_ptr = packets_queue_.front();
-        int64_t pkt_local_ms = pkt_ptr->pkt->get_local_ms();
-        if ((now_ms - pkt_local_ms) < PACK_BUFFER_TIMEOUT) {
-            break;
-        }
-        packets_queue_.pop_front();
-        log_warnf("h264 fua list is timeout, packet pop seq:%d", pkt_ptr->pkt->get_seq());
+
+    if ((now_ms - frame_start_ms_) >= PACK_BUFFER_TIMEOUT) {
+        log_warnf("h264 frame is timeout, timestamp:%ld, length:%lu",
+            frame_ts_, frame_ptr_->buffer_ptr_->data_len());
+        drop_frame();
     }
-    return;
 }
 
-bool pack_handle_h264::demux_stapA(std::shared_ptr<rtp_packet_info> pkt_ptr) {
-    uint8_t* payload_data = pkt_ptr->pkt->get_payload();
-    size_t payload_length = pkt_ptr->pkt->get_payload_length();
-    std::vector<size_t> offsets;
+void pack_handle_h264::output_seq_hdr(const uint8_t* nalu, size_t len, int64_t timestamp) {
+    MEDIA_PACKET_PTR h264_pkt_ptr = std::make_shared<MEDIA_PACKET>(sizeof(NAL_START_CODE) + len + 1024);
 
-    if (payload_length <= (sizeof(uint8_t) + H264_STAPA_FIELD_SIZE)) {
-        log_errorf("demux stapA error: payload length(%lu) is too short", payload_length);
+    h264_pkt_ptr->buffer_ptr_->append_data((char*)NAL_START_CODE, sizeof(NAL_START_CODE));
+    h264_pkt_ptr->buffer_ptr_->append_data((char*)nalu, len);
+    h264_pkt_ptr->av_type_      = MEDIA_VIDEO_TYPE;
+    h264_pkt_ptr->codec_type_   = MEDIA_CODEC_H264;
+    h264_pkt_ptr->fmt_type_     = MEDIA_FORMAT_RAW;
+    h264_pkt_ptr->dts_          = timestamp;
+    h264_pkt_ptr->pts_          = timestamp;
+    h264_pkt_ptr->is_seq_hdr_   = true;
+    h264_pkt_ptr->is_key_frame_ = false;
+
+    cb_->media_packet_output(h264_pkt_ptr);
+}
+
+bool pack_handle_h264::append_nalu(const uint8_t* nalu, size_t len, int64_t timestamp) {
+    if (fua_started_) {
+        log_errorf("rtp h264 pack error: get single nalu before the fua end packet");
         return false;
     }
+    uint8_t nal_type = nalu[0] & 0x1f;
+
+    if ((nal_type == kAvcNaluTypeSPS) || (nal_type == kAvcNaluTypePPS)) {
+        output_seq_hdr(nalu, len, timestamp);
+        return true;
+    }
+    if (nal_type == kAvcNaluTypeIDR) {
+        frame_ptr_->is_key_frame_ = true;
+    }
+    uint8_t* p = (uint8_t*)frame_ptr_->buffer_ptr_->append_space(H264_NALU_LEN_SIZE + len);
+
+    write_4bytes(p, (uint32_t)len);
+    memcpy(p + H264_NALU_LEN_SIZE, nalu, len);
+    return true;
+}
+
+bool pack_handle_h264::append_fua(rtp_packet* pkt) {
+    uint8_t* payload   = pkt->get_payload();
+    size_t payload_len = pkt->get_payload_length();
+    bool start = false;
+    bool end   = false;
 
-    bool ret = parse_stapA_offsets(payload_data, payload_length, offsets);
-    if (!ret) {
-        return ret;
+    if (payload_len <= 2) {
+        log_errorf("rtp h264 pack error: fua payload length(%lu) is too short", payload_len);
+        return false;
     }
-    int64_t dts = (int64_t)pkt_ptr->pkt->get_timestamp();
-
-    offsets.push_back(payload_length + H264_STAPA_FIELD_SIZE);//end offset.
-    for (size_t index = 0; index < (offsets.size() - 1); index++) {
-        size_t start_offset = offsets[index];
-        size_t end_offset = offsets[index + 1] - H264_STAPA_FIELD_SIZE;
-        if ((end_offset - start_offset) < sizeof(uint8_t)) {
-            log_errorf("demux stapA error: start offset:%lu, end offset:%lu",
-                start_offset,  end_offset);
+    get_startend_bit(pkt, start, end);
+
+    if (start && end) {//exception happened
+        log_errorf("rtp h264 pack error: both start and end flag are enable");
+        return false;
+    }
+
+    data_buffer* frame_buffer = frame_ptr_->buffer_ptr_.get();
+    if (start) {
+        if (fua_started_) {
+            log_errorf("rtp h264 pack error: get start rtp packet before the end rtp packet");
             return false;
         }
-        size_t pkt_size = sizeof(NAL_START_CODE) + end_offset - start_offset + 1024;
-        MEDIA_PACKET_PTR h264_pkt_ptr = std::make_shared<MEDIA_PACKET>(pkt_size);
-
-        h264_pkt_ptr->buffer_ptr_->append_data((char*)NAL_START_CODE, sizeof(NAL_START_CODE));
-        h264_pkt_ptr->buffer_ptr_->append_data((char*)payload_data + start_offset, end_offset - start_offset);
-        h264_pkt_ptr->av_type_    = MEDIA_VIDEO_TYPE;
-        h264_pkt_ptr->codec_type_ = MEDIA_CODEC_H264;
-        h264_pkt_ptr->fmt_type_   = MEDIA_FORMAT_RAW;
-        h264_pkt_ptr->dts_        = dts;
-        h264_pkt_ptr->pts_        = dts;
-
-        uint8_t nal_type = *(payload_data + start_offset) & 0x1f;
-
-        if ((nal_type == kAvcNaluTypeSPS) || (nal_type == kAvcNaluTypePPS)) {
-            h264_pkt_ptr->is_seq_hdr_   = true;
-            h264_pkt_ptr->is_key_frame_ = false;
-        } else if (nal_type == kAvcNaluTypeIDR) {
-            h264_pkt_ptr->is_seq_hdr_   = false;
-            h264_pkt_ptr->is_key_frame_ = true;
+        uint8_t nalu_header = (payload[0] & 0xe0) | (payload[1] & 0x1f);
+        uint8_t nal_type    = nalu_header & 0x1f;
+
+        fua_started_ = true;
+        fua_seq_hdr_ = (nal_type == kAvcNaluTypeSPS) || (nal_type == kAvcNaluTypePPS);
+        if (fua_seq_hdr_) {
+            seq_hdr_buffer_.reset();
+            seq_hdr_buffer_.append_data((char*)&nalu_header, sizeof(nalu_header));
+        } else {
+            //the length is filled when the end packet comes
+            fua_len_pos_ = frame_buffer->data_len();
+            uint8_t* p = (uint8_t*)frame_buffer->append_space(H264_NALU_LEN_SIZE + sizeof(nalu_header));
+            p[H264_NALU_LEN_SIZE] = nalu_header;
+            if (nal_type == kAvcNaluTypeIDR) {
+                frame_ptr_->is_key_frame_ = true;
+            }
+        }
+    } else if (!fua_started_) {
+        log_errorf("rtp h264 pack error: get fua rtp packet but there is no start rtp packet");
+        return false;
+    }
+
+    data_buffer* buffer = fua_seq_hdr_ ? &seq_hdr_buffer_ : frame_buffer;
+    buffer->append_data((char*)payload + 2, payload_len - 2);
+
+    if (end) {
+        fua_started_ = false;
+        if (fua_seq_hdr_) {
+            output_seq_hdr((uint8_t*)seq_hdr_buffer_.data(), seq_hdr_buffer_.data_len(), frame_ts_);
         } else {
-            h264_pkt_ptr->is_seq_hdr_   = false;
-            h264_pkt_ptr->is_key_frame_ = false;
+            uint8_t* p = (uint8_t*)frame_buffer->data() + fua_len_pos_;
+            write_4bytes(p, (uint32_t)(frame_buffer->data_len() - fua_len_pos_ - H264_NALU_LEN_SIZE));
         }
-        cb_->media_packet_output(h264_pkt_ptr);
     }
     return true;
 }
 
-bool pack_handle_h264::parse_stapA_offsets(const uint8_t* data, size_t data_len, std::vector<size_t> &offsets) {
-    
-    size_t offset = 1;
-    size_t left_len = data_len;
-    const uint8_t* p = data + offset;
-    left_len -= offset;
+bool pack_handle_h264::demux_stapA(rtp_packet* pkt) {
+    uint8_t* payload_data = pkt->get_payload();
+    size_t payload_length = pkt->get_payload_length();
+    int64_t timestamp     = (int64_t)pkt->get_timestamp();
+
+    if (payload_length <= (sizeof(uint8_t) + H264_STAPA_FIELD_SIZE)) {
+        log_errorf("demux stapA error: payload length(%lu) is too short", payload_length);
+        return false;
+    }
+
+    const uint8_t* p = payload_data + 1;
+    size_t left_len  = payload_length - 1;
 
     while (left_len > 0) {
-        if (left_len < sizeof(uint16_t)) {
+        if (left_len < H264_STAPA_FIELD_SIZE) {
             log_errorf("h264 stapA nalu len error: left length(%lu) is not enough.", left_len);
             return false;
         }
         uint16_t nalu_len = read_2bytes(p);
-        p += sizeof(uint16_t);
-        left_len -= sizeof(uint16_t);
-        if (nalu_len > left_len) {
-            log_errorf("h264 stapA nalu len error: left length(%lu) is smaller than nalu length(%d).",
+        p        += H264_STAPA_FIELD_SIZE;
+        left_len -= H264_STAPA_FIELD_SIZE;
+        if ((nalu_len == 0) || (nalu_len > left_len)) {
+            log_errorf("h264 stapA nalu len error: left length(%lu), nalu length(%d).",
                     left_len, nalu_len);
             return false;
         }
-        p += nalu_len;
-        left_len -= nalu_len;
-        offsets.push_back(offset + H264_STAPA_FIELD_SIZE);
-        offset += H264_STAPA_FIELD_SIZE + nalu_len;
-    }
-    
-    return true;
-}
-
-bool pack_handle_h264::demux_fua(MEDIA_PACKET_PTR h264_pkt_ptr, int64_t& timestamp) {
-    size_t queue_len = packets_queue_.size();
-    bool has_start = false;
-    bool has_end   = false;
-
-    std::shared_ptr<data_buffer> buffer_ptr = h264_pkt_ptr->buffer_ptr_;
-    for (size_t index = 0; index < queue_len; index++) {
-        bool start = false;
-        bool end   = false;
-
-        std::shared_ptr<rtp_packet_info> pkt_ptr = packets_queue_.front();
-        packets_queue_.pop_front();
-
-        timestamp = (int64_t)pkt_ptr->pkt->get_timestamp();
-        get_startend_bit(pkt_ptr->pkt, start, end);
-
-        uint8_t* payload   = pkt_ptr->pkt->get_payload();
-        size_t payload_len = pkt_ptr->pkt->get_payload_length();
-        if (index == 0) {
-            if (start) {
-                has_start = true;
-                uint8_t fu_indicator = payload[0];
-                uint8_t fu_header    = payload[1];
-                uint8_t nalu_header  = (fu_indicator & 0xe0) | (fu_header & 0x1f);
-                buffer_ptr->append_data((char*)NAL_START_CODE, sizeof(NAL_START_CODE));
-                buffer_ptr->append_data((char*)&nalu_header, sizeof(nalu_header));
-                buffer_ptr->append_data((char*)payload + 2, payload_len - 2);
-            }
-        } else {
-            if (has_start) {
-                buffer_ptr->append_data((char*)payload + 2, payload_len - 2);
-            }
-        }
-        if (end) {
-            has_end = true;
-            break;
+        if (!append_nalu(p, nalu_len, timestamp)) {
+            return false;
         }
-    }
-    if (!has_start || !has_end) {
-        log_errorf("rtp h264 demux fua error: has start:%d, has end:%d", has_start, has_end);
-        return false;
+        p        += nalu_len;
+        left_len -= nalu_len;
     }
     return true;
 }
-void pack_handle_h264::reset_rtp_fua() {
-    start_flag_ = false;
-    end_flag_   = false;
-    packets_queue_.clear();
-}
-
-
-    
@@ -3,8 +3,21 @@
 #include "pack_handle_pub.hpp"
 #include "rtp_packet.hpp"
 #include "timer.hpp"
-#include <queue>
+#include "data_buffer.hpp"
+#include <vector>
 
+#define H264_FRAME_INIT_SIZE (50*1024)
+#define H264_FRAME_POOL_MAX  256//the frames held by the gop cache and writers are not reused
+
+/*
+the nalus of one frame(same rtp timestamp) are written into one media packet
+as they arrive, in the avcc layout(4 bytes length + nalu) which is the flv
+video tag body. the fu-a fragments are appended directly, the length is filled
+when the end fragment comes. the flv video header is written later into the
+reserved head of the data buffer, so the rtp payload is copied only once.
+the sps and pps are output alone as the sequence header.
+the frame packets are reused when nobody holds them any more.
+*/
 class pack_handle_h264 : public pack_handle_base, public timer_interface
 {
 public:
@@ -16,24 +29,41 @@ public:
 
 public:
     virtual void on_timer() override;
-    
+
 private:
     void get_startend_bit(rtp_packet* pkt, bool& start, bool& end);
-    void reset_rtp_fua();
-    bool demux_fua(MEDIA_PACKET_PTR h264_pkt_ptr, int64_t& timestamp);
-    bool demux_stapA(std::shared_ptr<rtp_packet_info>);
-    bool parse_stapA_offsets(const uint8_t* data, size_t data_len, std::vector<size_t> &offsets);
-    void check_fua_timeout();
+    void start_frame(int64_t timestamp);
+    void output_frame();
+    void drop_frame();
+    bool append_nalu(const uint8_t* nalu, size_t len, int64_t timestamp);
+    bool append_fua(rtp_packet* pkt);
+    bool demux_stapA(rtp_packet* pkt);
+    void output_seq_hdr(const uint8_t* nalu, size_t len, int64_t timestamp);
+    void check_frame_timeout();
     void report_lost(std::shared_ptr<rtp_packet_info> pkt_ptr);
-    
+    MEDIA_PACKET_PTR get_frame_packet();
+
 private:
-    bool init_flag_  = false;
-    bool start_flag_ = false;
-    bool end_flag_   = false;
+    bool init_flag_ = false;
     int64_t last_extend_seq_ = 0;
-    std::deque<std::shared_ptr<rtp_packet_info>> packets_queue_;
     pack_callbackI* cb_ = nullptr;
     int64_t report_lost_ts_ = -1;
+
+private://the frame in assembling
+    MEDIA_PACKET_PTR frame_ptr_;
+    int64_t frame_ts_       = -1;
+    int64_t frame_start_ms_ = 0;
+    bool frame_dropped_     = false;
+
+private://the fu-a nalu in assembling
+    bool fua_started_   = false;
+    bool fua_seq_hdr_   = false;//the sps or pps is fragmented, it's put in seq_hdr_buffer_
+    size_t fua_len_pos_ = 0;//the offset of the nalu length in the frame
+    data_buffer seq_hdr_buffer_;
+
+private:
+    std::vector<MEDIA_PACKET_PTR> frame_pool_;
+    size_t frame_pool_index_ = 0;
 };
 
-#endif
\ No newline at end of file
+#endif
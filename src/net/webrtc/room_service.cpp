@@ -2,6 +2,7 @@
 #include "rtc_subscriber.hpp"
 #include "net/http/http_common.hpp"
 #include "utils/logger.hpp"
+#include "utils/config.hpp"
 #include "utils/byte_crypto.hpp"
 #include "utils/av/media_stream_manager.hpp"
 #include "json.hpp"
@@ -274,7 +275,8 @@ int get_publisher_statics(const std::string& roomId, const std::string& uid, jso
         data_json["list"]  = json::array();
         int count = 0;
         for (auto item : session_ptr->ssrc2publishers_) {
-            if (item.first == item.second->get_rtx_ssrc()) {
+            if (item.first != item.second->get_rtp_ssrc()) {
+                //skip the rtx ssrc and the ssrcs of the simulcast layers
                 continue;
             }
             json publisher_data = json::object();
@@ -345,6 +347,9 @@ void room_service::on_timer() {
             iter = live_users_.erase(iter);
             continue;
         }
+        if (iter->second->bridge_active()) {
+            check_live_bridge(iter->second, now_ms);
+        }
         iter++;
     }
 
@@ -554,6 +559,16 @@ std::vector<publisher_info> room_service::get_publishers_info_by_json(const json
 }
 
 void room_service::insert_subscriber(const std::string& publisher_id, std::shared_ptr<rtc_subscriber> subscriber_ptr) {
+    std::shared_ptr<rtp_packet_history> history_ptr;
+    auto history_it = pid2history_.find(publisher_id);
+    if (history_it == pid2history_.end()) {
+        history_ptr = std::make_shared<rtp_packet_history>(subscriber_ptr->get_media_type());
+        pid2history_[publisher_id] = history_ptr;
+    } else {
+        history_ptr = history_it->second;
+    }
+    subscriber_ptr->set_packet_history(history_ptr);
+
     auto subs_map_it = pid2subscribers_.find(publisher_id);
     if (subs_map_it == pid2subscribers_.end()) {
         log_infof("the publisher id:%s is to be subscribed firstly, we need to create one", publisher_id.c_str());
@@ -573,6 +588,43 @@ void room_service::insert_subscriber(const std::string& publisher_id, std::share
         subscriber_ptr->get_uid().c_str(), subscriber_ptr->get_remote_uid().c_str());
 }
 
+size_t room_service::live_subscriber_count(std::shared_ptr<live_user_info> user_ptr, bool connected) {
+    size_t count = 0;
+    const std::string* pids[] = {&user_ptr->video_pid(), &user_ptr->audio_pid()};
+
+    for (const std::string* pid : pids) {
+        auto subs_map_it = pid2subscribers_.find(*pid);
+        if (subs_map_it == pid2subscribers_.end()) {
+            continue;
+        }
+        for (auto& subscribe_item : subs_map_it->second) {
+            if (!subscribe_item.second) {
+                continue;
+            }
+            if (!connected || subscribe_item.second->is_connected()) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+void room_service::check_live_bridge(std::shared_ptr<live_user_info> user_ptr, int64_t now_ms) {
+    if (live_subscriber_count(user_ptr, false) > 0) {
+        user_ptr->set_bridge_idle_ms(-1);
+        return;
+    }
+    if (user_ptr->bridge_idle_ms() < 0) {
+        user_ptr->set_bridge_idle_ms(now_ms);
+        return;
+    }
+    if ((now_ms - user_ptr->bridge_idle_ms()) > (int64_t)Config::rtmp2rtc_idle_timeout() * 1000) {
+        log_infof("live user(%s) has no webrtc viewer in %d seconds, stop the rtmp2rtc bridge",
+            user_ptr->uid().c_str(), Config::rtmp2rtc_idle_timeout());
+        user_ptr->stop_bridge();
+    }
+}
+
 void room_service::on_rtmp_callback(const std::string& roomId, const std::string& uid,
                                 const std::string& stream_type, MEDIA_PACKET_PTR pkt_ptr) {
     auto iter = users_.find(uid);
@@ -594,6 +646,7 @@ void room_service::on_rtppacket_publisher2room(rtc_publisher* publisher, rtp_pac
 
     auto subs_map_it = pid2subscribers_.find(publish_id);
     if (subs_map_it != pid2subscribers_.end()) {
+        save_packet_history(publish_id, pkt);
         for (auto subscribe_item : subs_map_it->second) {
             subscribe_item.second->send_rtp_packet(roomId_, mediatype, publish_id, pkt);
         }
@@ -606,6 +659,7 @@ void room_service::on_rtppacket_publisher2room(const std::string& publisher_id,
         const std::string& media_type, rtp_packet* pkt) {
     auto subs_map_it = pid2subscribers_.find(publisher_id);
     if (subs_map_it != pid2subscribers_.end()) {
+        save_packet_history(publisher_id, pkt);
         for (auto subscribe_item : subs_map_it->second) {
             std::shared_ptr<rtc_subscriber> subscriber_ptr = subscribe_item.second;
             if (!subscriber_ptr) {
@@ -614,12 +668,22 @@ void room_service::on_rtppacket_publisher2room(const std::string& publisher_id,
             subscriber_ptr->send_rtp_packet(roomId_, media_type, publisher_id, pkt);
         }
     }
-    delete pkt;
 
     return;
 }
 
+void room_service::save_packet_history(const std::string& publisher_id, rtp_packet* pkt) {
+    auto iter = pid2history_.find(publisher_id);
+    if (iter == pid2history_.end()) {
+        return;
+    }
+    //saved once for all the subscribers before they rewrite the packet
+    iter->second->save(pkt);
+}
+
 void room_service::on_unpublish(const std::string& pid) {
+    pid2history_.erase(pid);
+
     auto iter = pid2subscribers_.find(pid);
     if (iter == pid2subscribers_.end()) {
         log_warnf("unsubscribe fail to get publisher id:%s", pid.c_str());
@@ -641,6 +705,9 @@ void room_service::on_unsubscribe(const std::string& pid, const std::string& sid
         return;
     }
     iter->second.erase(subscriber_iter);
+    if (iter->second.empty()) {
+        pid2history_.erase(pid);
+    }
     log_warnf("unsubscribe remove subscriber id:%s from publisher id:%s",
         sid.c_str(), pid.c_str());
 }
@@ -1114,7 +1181,14 @@ void room_service::handle_live_subscribe(const std::string& id,
 
     /***************** create subscribers for the publisher *******************/
     for (auto& media_item : support_info.medias) {
-        media_item.header_extentions.clear();
+        //the rtmp packets carry no extension, only the transport-cc is stamped by the session
+        std::vector<HEADER_EXT> header_exts;
+        for (auto& ext : media_item.header_extentions) {
+            if (ext.uri == RTP_EXT_TWCC_URI) {
+                header_exts.push_back(ext);
+            }
+        }
+        media_item.header_extentions = header_exts;
 
         if (media_item.media_type == "video") {
             remote_user_ptr->set_video_mid(media_item.mid);
@@ -1303,6 +1377,10 @@ void room_service::handle_webrtc_subscribe(const std::string& id,
     for (auto media_item : support_info.medias) {
         auto subscirber_ptr = session_ptr->create_subscriber(remote_uid, media_item, media_item.publisher_id, this);
         subscirber_ptr->set_stream_type(RTC_STREAM_TYPE);
+        auto publisher_ptr = remote_session_ptr->get_publisher(media_item.publisher_id);
+        if (publisher_ptr && publisher_ptr->is_simulcast()) {
+            subscirber_ptr->set_simulcast_layers(publisher_ptr->get_simulcast_layers());
+        }
         insert_subscriber(media_item.publisher_id, subscirber_ptr);
     }
 
@@ -1595,6 +1673,10 @@ int room_service::handle_http_webrtc_subscribe(std::shared_ptr<user_info> user_p
     for (auto media_item : support_info.medias) {
         auto subscirber_ptr = session_ptr->create_subscriber(remote_uid, media_item, media_item.publisher_id, this);
         subscirber_ptr->set_stream_type(RTC_STREAM_TYPE);
+        auto publisher_ptr = remote_session_ptr->get_publisher(media_item.publisher_id);
+        if (publisher_ptr && publisher_ptr->is_simulcast()) {
+            subscirber_ptr->set_simulcast_layers(publisher_ptr->get_simulcast_layers());
+        }
         insert_subscriber(media_item.publisher_id, subscirber_ptr);
     }
 
@@ -1750,7 +1832,14 @@ int room_service::handle_http_live_subscribe(std::shared_ptr<user_info> user_ptr
 
     /***************** create subscribers for the publisher *******************/
     for (auto& media_item : support_info.medias) {
-        media_item.header_extentions.clear();
+        //the rtmp packets carry no extension, only the transport-cc is stamped by the session
+        std::vector<HEADER_EXT> header_exts;
+        for (auto& ext : media_item.header_extentions) {
+            if (ext.uri == RTP_EXT_TWCC_URI) {
+                header_exts.push_back(ext);
+            }
+        }
+        media_item.header_extentions = header_exts;
 
         if (media_item.media_type == "video") {
             remote_user_ptr->set_video_mid(media_item.mid);
@@ -2272,7 +2361,7 @@ void room_service::notify_unpublisher_to_others(const std::string& uid, const st
     }
 }
 
-void room_service::rtmp_stream_ingest(MEDIA_PACKET_PTR pkt_ptr) {
+bool room_service::rtmp_stream_ingest(MEDIA_PACKET_PTR pkt_ptr) {
     std::shared_ptr<live_user_info> user_ptr;
 
     auto iter = live_users_.find(pkt_ptr->streamname_);
@@ -2281,6 +2370,7 @@ void room_service::rtmp_stream_ingest(MEDIA_PACKET_PTR pkt_ptr) {
     } else {
         user_ptr = iter->second;
     }
+    user_ptr->update_alive(now_millisec());
 
     if (!user_ptr->media_ready()) {
         user_ptr->pkt_queue_.push(pkt_ptr);
@@ -2320,20 +2410,22 @@ void room_service::rtmp_stream_ingest(MEDIA_PACKET_PTR pkt_ptr) {
                        user_ptr->has_video(), user_ptr->has_audio(),
                        user_ptr->video_ssrc(), user_ptr->audio_ssrc(),
                        user_ptr->video_mid(), user_ptr->audio_mid());
-            //output media packet queue in room
-            while (user_ptr->pkt_queue_.size() > 0) {
-                MEDIA_PACKET_PTR temp_pkt_ptr = user_ptr->pkt_queue_.front();
-                user_ptr->pkt_queue_.pop();
-                if (temp_pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) {
-                    user_ptr->handle_video_data(temp_pkt_ptr);
-                } else if (temp_pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE) {
-                    user_ptr->handle_audio_data(temp_pkt_ptr);
-                } else {
-                    log_debugf("skip packet av type:%d", temp_pkt_ptr->av_type_);
-                }
-            }
+            //the queued packets only tell the media types, nobody has subscribed the live user yet
+            std::queue<MEDIA_PACKET_PTR>().swap(user_ptr->pkt_queue_);
         }
-        return;
+        return false;
+    }
+
+    if (!user_ptr->bridge_active()) {
+        //the packets are dropped until a webrtc viewer is ready to receive
+        if (live_subscriber_count(user_ptr, true) == 0) {
+            return false;
+        }
+        log_infof("live user(%s) has webrtc viewers, start the rtmp2rtc bridge from the gop cache",
+            user_ptr->uid().c_str());
+        user_ptr->start_bridge();
+        //the packet is in the gop cache, it's sent with the gop
+        return true;
     }
 
     //send media packet in room
@@ -2344,5 +2436,5 @@ void room_service::rtmp_stream_ingest(MEDIA_PACKET_PTR pkt_ptr) {
     } else {
         log_debugf("skip packet av type:%d", pkt_ptr->av_type_);
     }
- 
+    return false;
 }
@@ -5,6 +5,7 @@
 #include "utils/timer.hpp"
 #include "rtc_session_pub.hpp"
 #include "user_info.hpp"
+#include "rtp_packet_history.hpp"
 #include "json.hpp"
 #include <string>
 #include <memory>
@@ -64,7 +65,8 @@ public:
     virtual void on_update_alive(const std::string& roomId, const std::string& uid, int64_t now_ms) override;
 public:
     bool has_rtc_user(const std::string& uid);
-    void rtmp_stream_ingest(MEDIA_PACKET_PTR pkt_ptr);
+    //return true when the bridge of the live user is started and it needs the gop
+    bool rtmp_stream_ingest(MEDIA_PACKET_PTR pkt_ptr);
     void remove_live_user(const std::string& roomid, const std::string& uid);
     std::shared_ptr<user_info> get_rtc_user(const std::string& uid);
     std::shared_ptr<live_user_info> get_live_user(const std::string& uid);
@@ -114,7 +116,10 @@ private:
     std::shared_ptr<live_user_info> get_live_user_info(const std::string& uid);
     std::string get_uid_by_json(const json& json_obj);
     std::vector<publisher_info> get_publishers_info_by_json(const json& publishers_json);
+    void save_packet_history(const std::string& publisher_id, rtp_packet* pkt);
     void insert_subscriber(const std::string& publisher_id, std::shared_ptr<rtc_subscriber> subscriber_ptr);
+    size_t live_subscriber_count(std::shared_ptr<live_user_info> user_ptr, bool connected);
+    void check_live_bridge(std::shared_ptr<live_user_info> user_ptr, int64_t now_ms);
     void notify_userin_to_others(const std::string& uid, const std::string& user_type);
     void notify_userout_to_others(const std::string& uid);
     void notify_publisher_to_others(const std::string& uid, const std::string& user_type, const std::string& pc_id, const std::vector<publisher_info>& publisher_vec);
@@ -126,6 +131,7 @@ private:
     std::unordered_map<std::string, std::shared_ptr<user_info>> users_;//key: uid, value: user_info
     std::unordered_map<std::string, std::shared_ptr<live_user_info>> live_users_;//key: uid, value: live_user_info
     std::unordered_map<std::string, SUBSCRIBER_MAP> pid2subscribers_;//key: publisher_id, value: rtc_subscribers
+    std::unordered_map<std::string, std::shared_ptr<rtp_packet_history>> pid2history_;//key: publisher_id, value: the sent packets for nack
 };
 
 std::shared_ptr<room_service> GetorCreate_room_service(const std::string& roomId);
@@ -114,11 +114,42 @@ void rtc_base_session::create_publisher(const MEDIA_RTC_INFO& media_info) {
         mid2publishers_[media_info.mid] = publisher_ptr;
     }
     
-    for (auto info_item : media_info.ssrc_infos) {
+    //the simulcast publisher makes its ssrcs
+    for (auto info_item : publisher_ptr->get_media_info().ssrc_infos) {
         ssrc2publishers_[info_item.ssrc] = publisher_ptr;
     }
 }
 
+std::shared_ptr<rtc_publisher> rtc_base_session::bind_publisher_ssrc(rtp_packet* pkt) {
+    std::shared_ptr<rtc_publisher> publisher_ptr;
+
+    for (auto item : mid2publishers_) {
+        if (!item.second->is_simulcast()) {
+            continue;
+        }
+        if (item.second->bind_simulcast_ssrc(pkt)) {
+            publisher_ptr = item.second;
+            ssrc2publishers_[pkt->get_ssrc()] = publisher_ptr;
+            log_infof("bind the simulcast ssrc:%u to the publisher mid:%d, pid:%s",
+                pkt->get_ssrc(), publisher_ptr->get_mid(), publisher_ptr->get_publisher_id().c_str());
+            break;
+        }
+    }
+    return publisher_ptr;
+}
+
+void rtc_base_session::remove_publisher_ssrcs(std::shared_ptr<rtc_publisher> publisher_ptr) {
+    //the ssrcs of the simulcast layers are bound in running
+    auto iter = ssrc2publishers_.begin();
+    while (iter != ssrc2publishers_.end()) {
+        if (iter->second == publisher_ptr) {
+            iter = ssrc2publishers_.erase(iter);
+        } else {
+            iter++;
+        }
+    }
+}
+
 void rtc_base_session::remove_publisher(const MEDIA_RTC_INFO& media_info) {
     std::shared_ptr<rtc_publisher> publisher_ptr;
 
@@ -140,6 +171,7 @@ void rtc_base_session::remove_publisher(const MEDIA_RTC_INFO& media_info) {
     if (!publisher_ptr) {
         return;
     }
+    remove_publisher_ssrcs(publisher_ptr);
     auto pid_iter = pid2publishers_.find(publisher_ptr->get_publisher_id());
     if (pid_iter != pid2publishers_.end()) {
         pid2publishers_.erase(pid_iter);
@@ -186,6 +218,7 @@ int rtc_base_session::remove_publisher(int mid, const std::string& media_type) {
             ssrc2publishers_.erase(ssrc_iter);
         }
     }
+    remove_publisher_ssrcs(publisher_ptr);
     return 0;
 }
 
@@ -250,13 +283,9 @@ std::shared_ptr<rtc_publisher> rtc_base_session::get_publisher(std::string pid)
 }
 
 void rtc_base_session::send_plaintext_data(uint8_t* data, size_t data_len) {
-    if (!single_udp_server_ptr) {
-        MS_THROW_ERROR("single udp server is not inited");
-    }
-
-    if (remote_address_.ip_address.empty() || remote_address_.port == 0) {
+    if (remote_address_.empty()) {
         MS_THROW_ERROR("remote address is not inited");
     }
 
-    single_udp_server_ptr->write((char*)data, data_len, remote_address_);
+    webrtc_udp_write(data, data_len, remote_address_);
 }
@@ -3,6 +3,7 @@
 #include "rtc_session_pub.hpp"
 #include "rtc_base_session.hpp"
 #include "rtc_media_info.hpp"
+#include "rtc_pacer.hpp"
 #include "net/udp/udp_server.hpp"
 #include "utils/timer.hpp"
 #include <vector>
@@ -33,6 +34,8 @@ public:
     std::shared_ptr<rtc_publisher> get_publisher(uint32_t ssrc);
     std::shared_ptr<rtc_publisher> get_publisher(int mid);
     std::shared_ptr<rtc_publisher> get_publisher(std::string pid);
+    //the simulcast layers aren't in the sdp, their ssrcs are bound by the rid of the first packets
+    std::shared_ptr<rtc_publisher> bind_publisher_ssrc(rtp_packet* pkt);
     size_t get_publisher_count() {return mid2publishers_.size();}//ssrc2publishers_ may have multple publish for rtx ssrc
 
 public:
@@ -48,7 +51,22 @@ public:
 
 public:
     virtual void send_rtp_data_in_dtls(uint8_t* data, size_t data_len) {};
+    //the header rewritten for the subscriber and the payload shared by the subscribers
+    virtual void send_rtp_data_in_dtls(const uint8_t* header, size_t header_len,
+                                    const uint8_t* payload, size_t payload_len) {};
     virtual void send_rtcp_data_in_dtls(uint8_t* data, size_t data_len) {};
+    //the rtp packets of the subscribers go through the pacer of the session
+    virtual void send_rtp_data_paced(PACER_CLASS cls, const uint8_t* header, size_t header_len,
+                                    const uint8_t* payload, size_t payload_len) {};
+    virtual void get_pacer_statics(json& json_data) {};
+    //the bitrate for the subscribers, by the transport-cc feedback or the remb
+    virtual int64_t get_estimate_bitrate() { return remb_bitrate_; }
+    virtual void get_bwe_statics(json& json_data) {};
+    //the rtp packets can be sent when the srtp session is made
+    virtual bool is_connected() { return false; }
+
+private:
+    void remove_publisher_ssrcs(std::shared_ptr<rtc_publisher> publisher_ptr);
     
 public:
     std::string id_;
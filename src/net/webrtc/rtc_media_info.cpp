@@ -139,6 +139,8 @@ int rtc_media_info::parse(json& sdp_json) {
         get_ssrcs_info(media_item_json, rtc_info.ssrc_infos);
         get_fmtps(media_item_json, rtc_info.fmtps);
         get_rtcpfb(media_item_json, rtc_info.rtcp_fbs);
+        get_rids(media_item_json, rtc_info.rids);
+        get_simulcast(media_item_json, rtc_info.simulcast);
 
         this->medias.push_back(rtc_info);
     }
@@ -453,6 +455,40 @@ void rtc_media_info::get_fmtps(json& info_json, std::vector<FMTP>& fmtps) {
     return;
 }
 
+void rtc_media_info::get_rids(json& info_json, std::vector<RID_INFO>& rids) {
+    auto rids_iterJson = info_json.find("rids");
+    if ((rids_iterJson == info_json.end()) || (!rids_iterJson->is_array())) {
+        //it's option, only for simulcast
+        return;
+    }
+
+    for (auto& rid_json : *rids_iterJson) {
+        RID_INFO rid;
+
+        rid.id        = rid_json["id"];
+        rid.direction = rid_json["direction"];
+
+        auto params_iter = rid_json.find("params");
+        if ((params_iter != rid_json.end()) && params_iter->is_string()) {
+            rid.params = params_iter->get<std::string>();
+        }
+        rids.push_back(rid);
+    }
+    return;
+}
+
+void rtc_media_info::get_simulcast(json& info_json, SIMULCAST_INFO& simulcast) {
+    auto simulcast_iterJson = info_json.find("simulcast");
+    if ((simulcast_iterJson == info_json.end()) || (!simulcast_iterJson->is_object())) {
+        //it's option
+        return;
+    }
+
+    simulcast.direction = (*simulcast_iterJson)["dir1"];
+    simulcast.list      = (*simulcast_iterJson)["list1"];
+    return;
+}
+
 void rtc_media_info::filter_payloads() {
     //filter rtcp feedback firstly
     for (auto& media_item: medias) {
@@ -621,6 +657,15 @@ std::string rtc_media_info::dump() {
             ss << "-----------" << "\r\n";
         }
 
+        ss << "--rids:" << "\r\n";
+        for (auto rid : media_item.rids) {
+            ss << "---id: " << rid.id << "\r\n";
+            ss << "---direction: " << rid.direction << "\r\n";
+            ss << "---params: " << rid.params << "\r\n";
+            ss << "-----------" << "\r\n";
+        }
+        ss << "--simulcast: " << media_item.simulcast.direction << " " << media_item.simulcast.list << "\r\n";
+
         ss << "--payloads:\r\n";
         int i = 0;
         for (auto payload :media_item.payloads) {
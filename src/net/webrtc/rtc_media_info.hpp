@@ -11,6 +11,10 @@
 #define RECV_ONLY 1
 #define SEND_RECV 2
 
+#define RTP_EXT_TWCC_URI "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01"
+#define RTP_EXT_RID_URI "urn:ietf:params:rtp-hdrext:sdes:rtp-stream-id"
+#define RTP_EXT_REPAIRED_RID_URI "urn:ietf:params:rtp-hdrext:sdes:repaired-rtp-stream-id"
+
 typedef struct FingerPrint_S
 {
     std::string hash;//eg: "16:B0:B4:16:1F:83:D9:CA:C6:7E:D5:08:3F:D6:67:7E:BB:0E:DB:4C:44:B3:CD:60:B3:D7:67:6E:CA:5D:70:3A"
@@ -79,6 +83,19 @@ typedef struct SSRC_GROUPS_S
     std::vector<uint32_t> ssrcs;
 } SSRC_GROUPS;
 
+typedef struct RID_INFO_S
+{
+    std::string id;//eg: "h", "m", "l"
+    std::string direction;//"send" or "recv"
+    std::string params;//eg: "max-width=1280;max-height=720"
+} RID_INFO;
+
+typedef struct SIMULCAST_INFO_S
+{
+    std::string direction;//"send" or "recv"
+    std::string list;//eg: "h;m;l", "~" is paused and "," is the alternative
+} SIMULCAST_INFO;
+
 typedef struct BASIC_GROUP_S
 {
     std::vector<int> mids;
@@ -137,6 +154,8 @@ typedef struct MEDIA_RTC_INFO_S
     std::vector<RTP_ENCODING> rtp_encodings;
     std::vector<SSRC_INFO> ssrc_infos;
     std::vector<FMTP> fmtps;
+    std::vector<RID_INFO> rids;
+    SIMULCAST_INFO simulcast;
     std::string publisher_id;
 } MEDIA_RTC_INFO;
 
@@ -167,6 +186,8 @@ private:
     void get_rtp_encodings(json& info_json, std::vector<RTP_ENCODING>& rtp_encodings);
     void get_ssrcs_info(json& info_json, std::vector<SSRC_INFO>& ssrc_infos);
     void get_fmtps(json& info_json, std::vector<FMTP>& fmtps);
+    void get_rids(json& info_json, std::vector<RID_INFO>& rids);
+    void get_simulcast(json& info_json, SIMULCAST_INFO& simulcast);
 
 public:
     int version;
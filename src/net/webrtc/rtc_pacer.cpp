@@ -0,0 +1,173 @@
+#include "rtc_pacer.hpp"
+#include "logger.hpp"
+#include <string.h>
+
+rtc_pacer::rtc_pacer(uv_loop_t* loop, pacer_callbackI* cb, double pacing_factor):timer_interface(loop, PACER_INTERVAL_MS)
+                                    , loop_(loop)
+                                    , cb_(cb)
+                                    , pacing_factor_(pacing_factor)
+{
+}
+
+rtc_pacer::~rtc_pacer()
+{
+    stop_timer();
+    for (auto& queue : queues_) {
+        for (pacer_packet* pkt : queue) {
+            delete pkt;
+        }
+        queue.clear();
+    }
+    for (pacer_packet* pkt : pool_) {
+        delete pkt;
+    }
+    pool_.clear();
+}
+
+void rtc_pacer::set_target_bitrate(int64_t bitrate) {
+    pacing_bitrate_ = (int64_t)(bitrate * pacing_factor_);
+
+    max_budget_ = pacing_bitrate_ * PACER_BURST_MS / 8000;
+    if (max_budget_ < PACER_MIN_BURST_BYTES) {
+        max_budget_ = PACER_MIN_BURST_BYTES;
+    }
+    if (budget_ > max_budget_) {
+        budget_ = max_budget_;
+    }
+}
+
+void rtc_pacer::refill(int64_t now_ms) {
+    if (last_refill_ms_ < 0) {
+        last_refill_ms_ = now_ms;
+        budget_ = max_budget_;
+        return;
+    }
+    if (now_ms <= last_refill_ms_) {
+        return;
+    }
+    budget_ += pacing_bitrate_ * (now_ms - last_refill_ms_) / 8000;
+    if (budget_ > max_budget_) {
+        budget_ = max_budget_;
+    }
+    last_refill_ms_ = now_ms;
+}
+
+bool rtc_pacer::is_blocked(PACER_CLASS cls) {
+    for (int index = PACER_RETRANSMISSION; index <= cls; index++) {
+        if (!queues_[index].empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void rtc_pacer::send_rtp(PACER_CLASS cls, const uint8_t* header, size_t header_len,
+                    const uint8_t* payload, size_t payload_len) {
+    int64_t now_ms = (int64_t)uv_now(loop_);
+    size_t len = header_len + payload_len;
+
+    refill(now_ms);
+    if ((cls == PACER_AUDIO) || ((budget_ > 0) && !is_blocked(cls))) {
+        budget_ -= (int64_t)len;
+        sent_count_++;
+        cb_->pacer_send_rtp(header, header_len, payload, payload_len);
+        return;
+    }
+    enqueue(cls, header, header_len, payload, payload_len, now_ms);
+}
+
+void rtc_pacer::enqueue(PACER_CLASS cls, const uint8_t* header, size_t header_len,
+                    const uint8_t* payload, size_t payload_len, int64_t now_ms) {
+    size_t len = header_len + payload_len;
+
+    if (len > RTP_PACKET_MAX_SIZE) {
+        log_errorf("the rtp packet is too large to pace, len:%lu", len);
+        cb_->pacer_send_rtp(header, header_len, payload, payload_len);
+        return;
+    }
+    if (queues_[cls].size() >= PACER_QUEUE_MAX) {
+        //the estimated bitrate is far too low, the oldest packet isn't dropped
+        overflow_count_++;
+        send_queued(cls, now_ms);
+    }
+
+    pacer_packet* pkt = get_packet();
+    memcpy(pkt->data, header, header_len);
+    if (payload_len > 0) {
+        memcpy(pkt->data + header_len, payload, payload_len);
+    }
+    pkt->len        = len;
+    pkt->enqueue_ms = now_ms;
+
+    queues_[cls].push_back(pkt);
+    queued_count_++;
+    queued_total_++;
+    start_timer();
+}
+
+void rtc_pacer::send_queued(PACER_CLASS cls, int64_t now_ms) {
+    pacer_packet* pkt = queues_[cls].front();
+    int64_t delay_ms  = now_ms - pkt->enqueue_ms;
+
+    queues_[cls].pop_front();
+    queued_count_--;
+
+    if (delay_ms > max_delay_ms_) {
+        max_delay_ms_ = delay_ms;
+    }
+    budget_ -= (int64_t)pkt->len;
+    sent_count_++;
+    cb_->pacer_send_rtp(pkt->data, pkt->len, nullptr, 0);
+    release_packet(pkt);
+}
+
+void rtc_pacer::drain(int64_t now_ms) {
+    refill(now_ms);
+
+    for (int index = PACER_RETRANSMISSION; index < PACER_CLASS_MAX; index++) {
+        PACER_CLASS cls = (PACER_CLASS)index;
+
+        while (!queues_[cls].empty()) {
+            bool expired = (now_ms - queues_[cls].front()->enqueue_ms) >= PACER_MAX_DELAY_MS;
+
+            //the lower classes wait too when the tokens run out
+            if ((budget_ <= 0) && !expired) {
+                return;
+            }
+            send_queued(cls, now_ms);
+        }
+    }
+}
+
+void rtc_pacer::on_timer() {
+    drain((int64_t)uv_now(loop_));
+    if (queued_count_ == 0) {
+        stop_timer();
+    }
+}
+
+rtc_pacer::pacer_packet* rtc_pacer::get_packet() {
+    if (pool_.empty()) {
+        return new pacer_packet();
+    }
+    pacer_packet* pkt = pool_.back();
+    pool_.pop_back();
+    return pkt;
+}
+
+void rtc_pacer::release_packet(pacer_packet* pkt) {
+    if (pool_.size() >= PACER_POOL_MAX) {
+        delete pkt;
+        return;
+    }
+    pool_.push_back(pkt);
+}
+
+void rtc_pacer::get_statics(json& json_data) {
+    json_data["pacing_bps"] = pacing_bitrate_;
+    json_data["queue"]      = queued_count_;
+    json_data["sent"]       = sent_count_;
+    json_data["queued"]     = queued_total_;
+    json_data["overflow"]   = overflow_count_;
+    json_data["max_delay"]  = max_delay_ms_;
+}
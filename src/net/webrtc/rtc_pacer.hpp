@@ -0,0 +1,104 @@
+#ifndef RTC_PACER_HPP
+#define RTC_PACER_HPP
+#include "utils/timer.hpp"
+#include "net/rtprtcp/rtprtcp_pub.hpp"
+#include "json.hpp"
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <vector>
+
+using json = nlohmann::json;
+
+#define PACER_INTERVAL_MS     10
+#define PACER_BURST_MS        40//the bucket holds the bytes of 40ms at the pacing rate
+#define PACER_MIN_BURST_BYTES (4 * RTP_PACKET_MAX_SIZE)
+#define PACER_QUEUE_MAX       2048//the packets of one class, the oldest goes out at once when it's full
+#define PACER_MAX_DELAY_MS    500//the packets waiting longer go out without the budget
+#define PACER_POOL_MAX        256
+
+//the higher class is sent first
+typedef enum
+{
+    PACER_AUDIO = 0,
+    PACER_RETRANSMISSION,
+    PACER_VIDEO,
+    PACER_CLASS_MAX
+} PACER_CLASS;
+
+class pacer_callbackI
+{
+public:
+    virtual void pacer_send_rtp(const uint8_t* header, size_t header_len,
+                            const uint8_t* payload, size_t payload_len) = 0;
+};
+
+/*
+the rtp packets of the subscribers of one session go out through the token
+bucket at the pacing rate(the estimated bitrate × pacing factor), so a keyframe
+is spread over tens of milliseconds instead of a line-rate burst.
+a packet is sent at once when the bucket has tokens and no packet of its class
+or a higher class waits, else it's copied into the queue of its class.
+the audio is never held, it only takes the tokens. the queues are drained by
+the timer wheel every 10ms, the packets sent in one pass leave in one sendmmsg
+batch of the udp server.
+*/
+class rtc_pacer : public timer_interface
+{
+public:
+    rtc_pacer(uv_loop_t* loop, pacer_callbackI* cb, double pacing_factor);
+    virtual ~rtc_pacer();
+
+public:
+    void set_target_bitrate(int64_t bitrate);//bits per second
+    int64_t get_pacing_bitrate() { return pacing_bitrate_; }
+    void send_rtp(PACER_CLASS cls, const uint8_t* header, size_t header_len,
+                const uint8_t* payload, size_t payload_len);
+    size_t queue_size() { return queued_count_; }
+    void get_statics(json& json_data);
+
+public:
+    virtual void on_timer() override;
+
+private:
+    class pacer_packet
+    {
+    public:
+        uint8_t data[RTP_PACKET_MAX_SIZE];
+        size_t len = 0;
+        int64_t enqueue_ms = 0;
+    };
+
+private:
+    void refill(int64_t now_ms);
+    bool is_blocked(PACER_CLASS cls);
+    void enqueue(PACER_CLASS cls, const uint8_t* header, size_t header_len,
+                const uint8_t* payload, size_t payload_len, int64_t now_ms);
+    void send_queued(PACER_CLASS cls, int64_t now_ms);
+    void drain(int64_t now_ms);
+    pacer_packet* get_packet();
+    void release_packet(pacer_packet* pkt);
+
+private:
+    uv_loop_t* loop_ = nullptr;
+    pacer_callbackI* cb_ = nullptr;
+    double pacing_factor_ = 1.0;
+    int64_t pacing_bitrate_ = 0;
+    int64_t budget_     = 0;//bytes, it's negative when the audio or a large packet overdraws it
+    int64_t max_budget_ = PACER_MIN_BURST_BYTES;
+    int64_t last_refill_ms_ = -1;
+
+private:
+    std::deque<pacer_packet*> queues_[PACER_CLASS_MAX];
+    size_t queued_count_ = 0;
+    std::vector<pacer_packet*> pool_;
+
+private://for statics
+    int64_t sent_count_     = 0;
+    int64_t queued_total_   = 0;
+    int64_t overflow_count_ = 0;
+    int64_t max_delay_ms_   = 0;
+};
+
+#endif
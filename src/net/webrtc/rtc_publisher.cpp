@@ -14,6 +14,7 @@
 #include "utils/logger.hpp"
 #include "utils/uuid.hpp"
 #include "utils/byte_stream.hpp"
+#include "utils/byte_crypto.hpp"
 #include "utils/av/media_packet.hpp"
 #include "utils/av/media_stream_manager.hpp"
 #include <sstream>
@@ -40,6 +41,7 @@ rtc_publisher::rtc_publisher(const std::string& roomId, const std::string& uid,
     } else {
         media_type_ = MEDIA_UNKOWN_TYPE;
     }
+    jb_handler_.set_media_type(media_type_);
 
     for (auto enc_item : media_info_.rtp_encodings) {
         log_infof("rtc publisher encodec codec:%s",
@@ -50,6 +52,10 @@ rtc_publisher::rtc_publisher(const std::string& roomId, const std::string& uid,
         } else if (enc_item.codec == "VP8") {
             codec_type_ = MEDIA_CODEC_VP8;
             break;
+        } else if (enc_item.codec == "VP9") {
+            //the svc layers are filtered by the subscribers, it isn't sent to rtmp
+            codec_type_ = MEDIA_CODEC_VP9;
+            break;
         } else if (enc_item.codec == "opus") {
             std::string channel_str = media_info_.rtp_encodings[0].encoding;
             int ret = atoi(channel_str.c_str());
@@ -105,8 +111,15 @@ rtc_publisher::rtc_publisher(const std::string& roomId, const std::string& uid,
             mid_extension_id_ = ext_item.value;
         } else if (ext_item.uri == "http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time") {
             abs_time_extension_id_ = ext_item.value;
+        } else if (ext_item.uri == RTP_EXT_RID_URI) {
+            rid_extension_id_ = ext_item.value;
+        } else if (ext_item.uri == RTP_EXT_REPAIRED_RID_URI) {
+            repaired_rid_extension_id_ = ext_item.value;
         }
     }
+    if ((media_type_ == MEDIA_VIDEO_TYPE) && !media_info_.rids.empty()) {
+        init_simulcast();
+    }
     if (media_type_ == MEDIA_VIDEO_TYPE) {
         if (codec_type_ == MEDIA_CODEC_H264) {
             pack_handle_ = new pack_handle_h264(this, get_global_io_context());
@@ -132,6 +145,11 @@ rtc_publisher::~rtc_publisher() {
     if (rtp_handler_) {
         delete rtp_handler_;
     }
+    for (rtp_recv_stream* handler : layer_handlers_) {
+        if (handler) {
+            delete handler;
+        }
+    }
     if (pack_handle_) {
         delete pack_handle_;
     }
@@ -175,7 +193,11 @@ void rtc_publisher::get_statics(json& json_data) {
     if (rtp_handler_) {
         rtp_handler_->get_statics(json_data);
     }
-    
+    if (layers_) {
+        auto layers_json = json::array();
+        layers_->get_statics(layers_json, now_millisec());
+        json_data["layers"] = layers_json;
+    }
 
     return;
 }
@@ -185,7 +207,13 @@ void rtc_publisher::on_handle_rtppacket(rtp_packet* pkt) {
     pkt->set_mid_extension_id((uint8_t)mid_extension_id_);
     pkt->set_abs_time_extension_id((uint8_t)abs_time_extension_id_);
 
-    if ((pkt->get_ssrc() == rtp_ssrc_) && (pkt->get_payload_type() == payloadtype_)) {
+    int layer = -1;
+    if (layers_) {
+        layer = on_handle_simulcast_rtp(pkt);
+        if (layer < 0) {
+            return;
+        }
+    } else if ((pkt->get_ssrc() == rtp_ssrc_) && (pkt->get_payload_type() == payloadtype_)) {
         if (!rtp_handler_) {
             rtp_handler_ = new rtp_recv_stream(this, media_type_str_, pkt->get_ssrc(), payloadtype_, false, clock_rate_);
             if (has_rtx()) {
@@ -210,8 +238,9 @@ void rtc_publisher::on_handle_rtppacket(rtp_packet* pkt) {
     if ( Config::rtmp_is_enable() && Config::rtc2rtmp_is_enable()
         && ( ((media_type_ == MEDIA_VIDEO_TYPE) 
         && (codec_type_ == MEDIA_CODEC_H264))
-        || (media_type_ == MEDIA_AUDIO_TYPE)) ) {
-        jb_handler_.input_rtp_packet(roomId_, uid_, media_type_str_, stream_type_, clock_rate_, pkt);
+        || (media_type_ == MEDIA_AUDIO_TYPE))
+        && (!layers_ || (layer == rtmp_layer_)) ) {
+        jb_handler_.input_rtp_packet(pkt);
     }
     
     room_->on_update_alive(roomId_, uid_, pkt->get_local_ms());
@@ -219,6 +248,13 @@ void rtc_publisher::on_handle_rtppacket(rtp_packet* pkt) {
 }
 
 void rtc_publisher::on_handle_rtcp_sr(rtcp_sr_packet* sr_pkt) {
+    if (layers_) {
+        int layer = layers_->get_layer(sr_pkt->get_ssrc());
+        if ((layer >= 0) && layer_handlers_[layer]) {
+            layer_handlers_[layer]->on_handle_rtcp_sr(sr_pkt);
+        }
+        return;
+    }
     if (rtp_handler_) {
         rtp_handler_->on_handle_rtcp_sr(sr_pkt);
     }
@@ -233,7 +269,12 @@ void rtc_publisher::stream_send_rtp(uint8_t* data, size_t len) {
 }
 
 void rtc_publisher::request_keyframe(uint32_t media_ssrc) {
-    if (rtp_ssrc_ != media_ssrc) {
+    if (layers_) {
+        if (layers_->get_layer(media_ssrc) < 0) {
+            log_errorf("the request keyframe media ssrc(%u) isn't any simulcast layer", media_ssrc);
+            return;
+        }
+    } else if (rtp_ssrc_ != media_ssrc) {
         log_errorf("the request keyframe media ssrc(%u) is error, the publisher rtp ssrc:%u",
             media_ssrc, rtp_ssrc_);
         return;
@@ -281,11 +322,16 @@ void rtc_publisher::handle_xr_dlrr(xr_dlrr_data* dlrr_block) {
     rtt_ += (rtt_float - rtt_)/5;
 
     log_debugf("handle xr dllr rtt:%.02f, avg rtt:%.02f", rtt_float, rtt_);
+    int64_t new_rtt = (rtt_ > 100.0) ? 100 : (int64_t)rtt_;
+    new_rtt = (rtt_ < 5) ? 5 : rtt_;
     if (rtp_handler_) {
-        int64_t new_rtt = (rtt_ > 100.0) ? 100 : (int64_t)rtt_;
-        new_rtt = (rtt_ < 5) ? 5 : rtt_;
         rtp_handler_->update_rtt(new_rtt);
     }
+    for (rtp_recv_stream* handler : layer_handlers_) {
+        if (handler) {
+            handler->update_rtt(new_rtt);
+        }
+    }
     return;
 }
 
@@ -296,16 +342,164 @@ void rtc_publisher::on_timer() {
     if (rtp_handler_) {
         rtp_handler_->on_timer(now_ms);
     }
+    for (rtp_recv_stream* handler : layer_handlers_) {
+        if (handler) {
+            handler->on_timer(now_ms);
+        }
+    }
+    if (layers_) {
+        layers_->on_timer(now_ms);
+
+        //the highest layer goes to rtmp, it's changed only when the layer stops
+        if (!layers_->is_active(rtmp_layer_, now_ms)) {
+            int layer = layers_->get_highest_layer(now_ms);
+            if ((layer >= 0) && (layers_->get_bitrate(layer) > 0)) {
+                log_infof("simulcast layer rid:%s is sent to rtmp, ssrc:%u",
+                    layers_->get_rid(layer).c_str(), layers_->get_ssrc(layer));
+                rtmp_layer_ = layer;
+            }
+        }
+    }
     
     if (last_keyrequest_ts_ == 0) {
         last_keyrequest_ts_ = now_ms;
     } else {
         if (((now_ms - last_keyrequest_ts_) >= KEY_INTERVAL) && (media_type_ == MEDIA_VIDEO_TYPE)) {
             last_keyrequest_ts_ = now_ms;
-            request_keyframe(rtp_ssrc_);
+            if (layers_) {
+                for (size_t i = 0; i < layers_->size(); i++) {
+                    if (layers_->get_ssrc((int)i) != 0) {
+                        request_keyframe(layers_->get_ssrc((int)i));
+                    }
+                }
+            } else {
+                request_keyframe(rtp_ssrc_);
+            }
+        }
+    }
+
+}
+
+void rtc_publisher::init_simulcast() {
+    layers_ = std::make_shared<simulcast_layers>(codec_type_, media_info_);
+    layer_handlers_.resize(layers_->size(), nullptr);
+
+    //the layers have no ssrc in the sdp, the subscribers see one stream with
+    //the ssrcs made here, whatever the layer is
+    SSRC_INFO ssrc_info;
+    SSRC_INFO rtx_ssrc_info;
+    SSRC_GROUPS group;
+
+    rtp_ssrc_ = byte_crypto::get_random_uint(10000, 0x7fffffff);
+    ssrc_info.attribute = "cname";
+    ssrc_info.value     = uid_;
+    ssrc_info.ssrc      = rtp_ssrc_;
+
+    media_info_.ssrc_infos.clear();
+    media_info_.ssrc_groups.clear();
+    media_info_.ssrc_infos.push_back(ssrc_info);
+
+    if (has_rtx_) {
+        rtx_ssrc_ = rtp_ssrc_ + 1;
+        rtx_ssrc_info.attribute = "cname";
+        rtx_ssrc_info.value     = uid_;
+        rtx_ssrc_info.ssrc      = rtx_ssrc_;
+        media_info_.ssrc_infos.push_back(rtx_ssrc_info);
+
+        group.semantics = "FID";
+        group.ssrcs.push_back(rtp_ssrc_);
+        group.ssrcs.push_back(rtx_ssrc_);
+        media_info_.ssrc_groups.push_back(group);
+    }
+    log_infof("rtc publisher is simulcast, layers:%lu, rid extension id:%d, repaired rid extension id:%d, \
+rtp ssrc:%u, rtx ssrc:%u", layers_->size(), rid_extension_id_, repaired_rid_extension_id_, rtp_ssrc_, rtx_ssrc_);
+}
+
+bool rtc_publisher::bind_simulcast_ssrc(rtp_packet* pkt) {
+    if (!layers_) {
+        return false;
+    }
+    uint8_t mid = 0;
+    pkt->set_mid_extension_id((uint8_t)mid_extension_id_);
+    if (pkt->read_mid(mid) && ((int)mid != get_mid())) {
+        return false;
+    }
+
+    std::string rid;
+    if (has_rtx_ && (pkt->get_payload_type() == rtx_payloadtype_)) {
+        if (!pkt->read_rid((uint8_t)repaired_rid_extension_id_, rid)) {
+            return false;
+        }
+        int layer = layers_->get_layer_by_rid(rid);
+        if (layer < 0) {
+            log_warnf("the simulcast repaired rid:%s is unkown, rtx ssrc:%u", rid.c_str(), pkt->get_ssrc());
+            return false;
+        }
+        layers_->set_rtx_ssrc(layer, pkt->get_ssrc());
+        if (layer_handlers_[layer]) {
+            layer_handlers_[layer]->set_rtx_ssrc(pkt->get_ssrc());
         }
+        return true;
+    }
+    if (pkt->get_payload_type() != payloadtype_) {
+        return false;
+    }
+    if (!pkt->read_rid((uint8_t)rid_extension_id_, rid)) {
+        return false;
+    }
+    int layer = layers_->get_layer_by_rid(rid);
+    if (layer < 0) {
+        log_warnf("the simulcast rid:%s is unkown, ssrc:%u", rid.c_str(), pkt->get_ssrc());
+        return false;
     }
+    //the layer is restarted with the new ssrc
+    if (layer_handlers_[layer]) {
+        delete layer_handlers_[layer];
+        layer_handlers_[layer] = nullptr;
+    }
+    layers_->set_ssrc(layer, pkt->get_ssrc());
+    return true;
+}
+
+rtp_recv_stream* rtc_publisher::get_layer_handler(int layer) {
+    rtp_recv_stream* handler = layer_handlers_[layer];
+
+    if (!handler) {
+        handler = new rtp_recv_stream(this, media_type_str_, layers_->get_ssrc(layer), payloadtype_, false, clock_rate_);
+        if (has_rtx()) {
+            handler->set_rtx_ssrc(layers_->get_rtx_ssrc(layer));
+            handler->set_rtx_payloadtype(rtx_payloadtype_);
+        }
+        layer_handlers_[layer] = handler;
+    }
+    return handler;
+}
+
+int rtc_publisher::on_handle_simulcast_rtp(rtp_packet* pkt) {
+    int layer = -1;
 
+    if (pkt->get_payload_type() == payloadtype_) {
+        layer = layers_->get_layer(pkt->get_ssrc());
+        if (layer < 0) {
+            log_errorf("the simulcast packet ssrc:%u isn't bound to any layer", pkt->get_ssrc());
+            return -1;
+        }
+        get_layer_handler(layer)->on_handle_rtp(pkt);
+    } else if (has_rtx() && (pkt->get_payload_type() == rtx_payloadtype_)) {
+        layer = layers_->get_rtx_layer(pkt->get_ssrc());
+        if ((layer < 0) || !layer_handlers_[layer]) {
+            log_warnf("simulcast layer handler is not ready for rtx, rtx_ssrc:%u", pkt->get_ssrc());
+            return -1;
+        }
+        //it's demuxed to the rtp packet of the layer
+        layer_handlers_[layer]->on_handle_rtx_packet(pkt);
+    } else {
+        log_errorf("unkown simulcast packet payload type:%d, packet ssrc:%u, payload type:%d, rtx payload type:%d",
+            pkt->get_payload_type(), pkt->get_ssrc(), payloadtype_, rtx_payloadtype_);
+        return -1;
+    }
+    layers_->on_rtp(layer, pkt->get_data_length(), pkt->get_local_ms());
+    return layer;
 }
 
 void rtc_publisher::rtp_packet_reset(std::shared_ptr<rtp_packet_info> pkt_ptr) {
@@ -324,7 +518,7 @@ void rtc_publisher::rtp_packet_reset(std::shared_ptr<rtp_packet_info> pkt_ptr) {
 
 void rtc_publisher::rtp_packet_output(std::shared_ptr<rtp_packet_info> pkt_ptr) {
     log_debugf("jitterbuffer output roomid:%s uid:%s mediatype:%s, stream_type:%s ssrc:%u, seq:%d, ext_seq:%d, mark:%d, length:%lu",
-        pkt_ptr->roomId_.c_str(), pkt_ptr->uid_.c_str(), pkt_ptr->media_type_.c_str(), pkt_ptr->stream_type_.c_str(),
+        roomId_.c_str(), uid_.c_str(), media_type_str_.c_str(), stream_type_.c_str(),
         pkt_ptr->pkt->get_ssrc(), pkt_ptr->pkt->get_seq(), pkt_ptr->extend_seq_, pkt_ptr->pkt->get_marker(),
         pkt_ptr->pkt->get_data_length());
     
@@ -350,7 +544,7 @@ void rtc_publisher::media_packet_output(std::shared_ptr<MEDIA_PACKET> pkt_ptr) {
     
     if (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) {
         if (pkt_ptr->codec_type_ == MEDIA_CODEC_H264) {
-            uint8_t nalu_len_data[4];
+            //the frame is in the avcc layout already, only the sequence header has the start code
             if (pkt_ptr->is_key_frame_ && (pps_data_.data_len() > 0) && (sps_data_.data_len() > 0)) {
                 uint8_t extra_data[2048];
                 int extra_len = 0;
@@ -383,9 +577,6 @@ void rtc_publisher::media_packet_output(std::shared_ptr<MEDIA_PACKET> pkt_ptr) {
                 }
                 return;
             }
-            write_4bytes(nalu_len_data, (uint32_t)pkt_ptr->buffer_ptr_->data_len() - 4);
-            uint8_t* p = (uint8_t*)pkt_ptr->buffer_ptr_->data();
-            memcpy(p, nalu_len_data, sizeof(nalu_len_data));
         } else if (pkt_ptr->codec_type_ == MEDIA_CODEC_VP8) {
 
         }
@@ -9,6 +9,7 @@
 #include "utils/timeex.hpp"
 #include "rtp_recv_stream.hpp"
 #include "rtc_stream_pub.hpp"
+#include "simulcast_layers.hpp"
 #include "jitterbuffer_pub.hpp"
 #include "jitterbuffer.hpp"
 #include "pack_handle_pub.hpp"
@@ -20,6 +21,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <string>
+#include <memory>
 
 using json = nlohmann::json;
 
@@ -59,6 +61,12 @@ public:
     MEDIA_CODEC_TYPE get_codec_type() { return codec_type_; }
     void get_statics(json& json_data);
 
+public://simulcast
+    bool is_simulcast() { return layers_ != nullptr; }
+    std::shared_ptr<simulcast_layers> get_simulcast_layers() { return layers_; }
+    //bind the ssrc of the layer by the rid in the packet, return false when it isn't a layer of the publisher
+    bool bind_simulcast_ssrc(rtp_packet* pkt);
+
 public:
     void request_keyframe(uint32_t media_ssrc);
     void get_xr_rrt(xr_rrt& rrt, int64_t now_ms);
@@ -81,6 +89,9 @@ public://implement
 
 private:
     void set_rtmp_info(std::shared_ptr<MEDIA_PACKET> pkt_ptr);
+    void init_simulcast();
+    int on_handle_simulcast_rtp(rtp_packet* pkt);
+    rtp_recv_stream* get_layer_handler(int layer);
     
 private:
     std::string roomId_;
@@ -120,6 +131,13 @@ private:
 
 private:
     int64_t last_keyrequest_ts_ = 0;
+
+private://simulcast
+    std::shared_ptr<simulcast_layers> layers_;
+    std::vector<rtp_recv_stream*> layer_handlers_;//indexed by the layer
+    int rid_extension_id_          = 0;
+    int repaired_rid_extension_id_ = 0;
+    int rtmp_layer_                = -1;//only one layer is sent to rtmp
 };
 
 #endif
@@ -31,6 +31,7 @@ class room_callback_interface
 {
 public:
     virtual void on_rtppacket_publisher2room(rtc_publisher* publisher, rtp_packet* pkt) = 0;
+    //the packet is kept by the caller and sent to all the subscribers without change
     virtual void on_rtppacket_publisher2room(const std::string& publisher_id, const std::string& media_type, rtp_packet* pkt) = 0;
     virtual void on_request_keyframe(const std::string& pid, const std::string& sid, uint32_t media_ssrc) = 0;
     virtual void on_unpublish(const std::string& pid) = 0;
@@ -8,11 +8,17 @@
 #define RTT_DEFAULT 30 //ms
 #define RETRANSMIT_MAX_COUNT 20
 
+class rtp_packet;
+
 class rtc_stream_callback
 {
 public:
     virtual void stream_send_rtp(uint8_t* data, size_t len) = 0;
     virtual void stream_send_rtcp(uint8_t* data, size_t len) = 0;
+    //resend the packet of the shared history, it's rewritten for the stream without being changed,
+    //the seq, timestamp and marker are the ones the stream sent it with.
+    //padding: only the header is resent with the padding, the packet was dropped for the stream
+    virtual void stream_resend_rtp(rtp_packet* pkt, uint16_t seq, uint32_t timestamp, bool marker, bool padding) {}
 };
 
 
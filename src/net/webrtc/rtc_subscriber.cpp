@@ -2,6 +2,7 @@
 #include "rtc_base_session.hpp"
 #include "net/rtprtcp/rtp_packet.hpp"
 #include "utils/byte_crypto.hpp"
+#include "utils/config.hpp"
 #include "logger.hpp"
 
 extern uv_loop_t* get_global_io_context();
@@ -30,6 +31,9 @@ rtc_subscriber::rtc_subscriber(const std::string& roomId, const std::string& uid
             rtx_payloadtype_ = (uint8_t)enc_item.payload;
         } else {
             payloadtype_ = (uint8_t)enc_item.payload;
+            if (enc_item.codec == "VP9") {
+                svc_filter_ = std::make_shared<svc_layer_filter>(MEDIA_CODEC_VP9);
+            }
         }
     }
 
@@ -94,48 +98,214 @@ void rtc_subscriber::get_statics(json& json_data) {
     json_data["clockrate"] = clock_rate_;
     json_data["payload"] = payloadtype_;
     json_data["rtx_payload"] = rtx_payloadtype_;
+    if (layers_) {
+        json_data["layer"]        = layers_->get_rid(current_layer_);
+        json_data["target_layer"] = layers_->get_rid(target_layer_);
+        json_data["switches"]     = switch_count_;
+    }
+    if (svc_filter_) {
+        auto svc_json = json::object();
+        svc_filter_->get_statics(svc_json);
+        json_data["svc"] = svc_json;
+    }
 
     if (!stream_ptr_) {
         return;
     }
     stream_ptr_->get_statics(json_data);
+
+    auto pacer_json = json::object();
+    session_->get_pacer_statics(pacer_json);
+    if (!pacer_json.empty()) {
+        json_data["pacer"] = pacer_json;
+    }
+
+    auto bwe_json = json::object();
+    session_->get_bwe_statics(bwe_json);
+    if (!bwe_json.empty()) {
+        json_data["bwe"] = bwe_json;
+    }
     
     return;
 }
 
 void rtc_subscriber::send_rtp_packet(const std::string& roomId, const std::string& media_type,
                     const std::string& publish_id, rtp_packet* pkt) {
-    if (pkt->has_extension()) {
-        pkt->update_mid(this->get_mid());
-    }
-
     if (pkt->get_seq() % 100 == 0) {
         int64_t now_ms = now_millisec();
         update_alive(now_ms);
     }
 
-    uint32_t origin_ssrc   = pkt->get_ssrc();
-    uint8_t origin_payload_type = pkt->get_payload_type();
-
-    pkt->set_ssrc(rtp_ssrc_);
-    pkt->set_payload_type(payloadtype_);
+    uint16_t seq       = pkt->get_seq();
+    uint32_t timestamp = pkt->get_timestamp();
 
+    if (layers_ && !rewrite_simulcast_rtp(pkt, seq, timestamp)) {
+        return;
+    }
     //update timestamp only for rtmp2webrtc
     if (stream_type_ == LIVE_STREAM_TYPE) {
         double rtp_ts = pkt->get_timestamp();
         rtp_ts = rtp_ts * clock_rate_ / 1000.0;
-        pkt->set_timestamp((uint32_t)rtp_ts);
+        timestamp = (uint32_t)rtp_ts;
     }
-    //update payload&ssrc in subscriber
-    stream_ptr_->on_send_rtp_packet(pkt);
 
-    session_->send_rtp_data_in_dtls(pkt->get_data(), pkt->get_data_length());
+    bool marker  = (pkt->get_marker() != 0);
+    bool padding = false;
+    if (svc_filter_ && !svc_filter_->filter(pkt, seq, marker, padding)) {
+        return;
+    }
 
-    pkt->set_ssrc(origin_ssrc);
-    pkt->set_payload_type(origin_payload_type);
+    stream_ptr_->on_send_rtp_packet(pkt, seq, timestamp, marker, padding);
+    send_rewritten_rtp(pkt, seq, timestamp, marker, false, padding);
     return;
 }
 
+bool rtc_subscriber::rewrite_simulcast_rtp(rtp_packet* pkt, uint16_t& seq, uint32_t& timestamp) {
+    int layer = layers_->get_layer(pkt->get_ssrc());
+    if (layer < 0) {
+        return false;
+    }
+    if (target_layer_ < 0) {
+        select_layer(pkt->get_local_ms());
+    }
+    //the layer is switched at the keyframe, so the decoder never sees the gap
+    if ((layer == target_layer_) && (layer != current_layer_) && layers_->is_keyframe_start(pkt)) {
+        switch_layer(pkt, layer);
+    }
+    if (layer != current_layer_) {
+        return false;
+    }
+
+    //the packets before the switch can't be sent, their seqs are used by the last layer
+    int16_t diff = (int16_t)(pkt->get_seq() - floor_seq_);
+    if (diff < 0) {
+        return false;
+    }
+    if (diff > SIMULCAST_SEQ_WINDOW) {
+        floor_seq_ = pkt->get_seq() - SIMULCAST_SEQ_WINDOW;
+    }
+
+    seq       = pkt->get_seq() + seq_offset_;
+    timestamp = pkt->get_timestamp() + ts_offset_;
+
+    if ((int16_t)(seq - max_seq_) > 0) {
+        max_seq_ = seq;
+    }
+    if ((int32_t)(timestamp - max_ts_) > 0) {
+        max_ts_    = timestamp;
+        max_ts_ms_ = pkt->get_local_ms();
+    }
+    return true;
+}
+
+void rtc_subscriber::switch_layer(rtp_packet* pkt, int layer) {
+    int64_t now_ms = pkt->get_local_ms();
+
+    if (!layer_started_) {
+        layer_started_ = true;
+        seq_offset_    = 0;
+        ts_offset_     = 0;
+        max_seq_       = pkt->get_seq() - 1;
+        max_ts_        = pkt->get_timestamp();
+        max_ts_ms_     = now_ms;
+    } else {
+        //the layers have their own seq and timestamp, the new layer goes on from the last
+        //packet sent, and its timestamp goes on by the time passed since then
+        int64_t ts_delta = (now_ms - max_ts_ms_) * clock_rate_ / 1000;
+        ts_delta = (ts_delta < 1) ? 1 : ts_delta;
+
+        seq_offset_ = (uint16_t)(max_seq_ + 1 - pkt->get_seq());
+        ts_offset_  = (uint32_t)(max_ts_ + (uint32_t)ts_delta - pkt->get_timestamp());
+    }
+    floor_seq_ = pkt->get_seq();
+    switch_count_++;
+
+    log_infof("subscriber switch the simulcast layer from %s to %s, ssrc:%u, seq offset:%u, ts offset:%u, id:%s",
+        layers_->get_rid(current_layer_).c_str(), layers_->get_rid(layer).c_str(),
+        pkt->get_ssrc(), seq_offset_, ts_offset_, sid_.c_str());
+    current_layer_ = layer;
+}
+
+int64_t rtc_subscriber::get_layer_bitrate() {
+    int64_t bitrate = session_->get_estimate_bitrate();
+    if (bitrate <= 0) {
+        bitrate = (int64_t)Config::start_kbps() * 1000;
+    }
+    return bitrate;
+}
+
+void rtc_subscriber::select_layer(int64_t now_ms) {
+    int64_t bitrate = get_layer_bitrate();
+
+    int layer = layers_->select_layer(bitrate, current_layer_, now_ms);
+    if (layer < 0) {
+        return;
+    }
+    if (layer != target_layer_) {
+        log_infof("subscriber select the simulcast layer %s(%ldbps) by the estimate bitrate:%ld, current layer:%s, id:%s",
+            layers_->get_rid(layer).c_str(), layers_->get_bitrate(layer), bitrate,
+            layers_->get_rid(current_layer_).c_str(), sid_.c_str());
+        target_layer_ = layer;
+    }
+    if (target_layer_ != current_layer_) {
+        request_keyframe();
+    }
+}
+
+void rtc_subscriber::stream_resend_rtp(rtp_packet* pkt, uint16_t seq, uint32_t timestamp, bool marker, bool padding) {
+    send_rewritten_rtp(pkt, seq, timestamp, marker, true, padding);
+}
+
+void rtc_subscriber::send_rewritten_rtp(rtp_packet* pkt, uint16_t seq, uint32_t timestamp, bool marker, bool resend,
+                                    bool padding) {
+    //the padding only packet: the last byte is the count of the padding bytes
+    static const uint8_t padding_data[RTP_PADDING_ONLY_SIZE] = {0, 0, 0, RTP_PADDING_ONLY_SIZE};
+
+    size_t header_len = pkt->get_header_length();
+
+    if (header_len > sizeof(rtp_header_)) {
+        log_errorf("the rtp header is too large, len:%lu, id:%s", header_len, sid_.c_str());
+        return;
+    }
+    //the packet is shared by the subscribers of the publisher, only its header is
+    //copied and rewritten here, the payload is copied once when it's encrypted
+    memcpy(rtp_header_, pkt->get_data(), header_len);
+
+    rtp_common_header* header = (rtp_common_header*)rtp_header_;
+    header->payload_type = payloadtype_;
+    header->marker       = marker ? 1 : 0;
+    header->ssrc         = htonl(rtp_ssrc_);
+    header->sequence     = htons(seq);
+    header->timestamp    = htonl(timestamp);
+    if (pkt->has_extension()) {
+        pkt->write_mid(rtp_header_, this->get_mid());
+    }
+    if (padding) {
+        header->padding = 1;
+        header->marker  = 0;
+        session_->send_rtp_data_paced(resend ? PACER_RETRANSMISSION : PACER_VIDEO, rtp_header_, header_len,
+                                    padding_data, sizeof(padding_data));
+        return;
+    }
+
+    PACER_CLASS cls = PACER_VIDEO;
+    if (media_type_ == "audio") {
+        cls = PACER_AUDIO;
+    } else if (resend) {
+        cls = PACER_RETRANSMISSION;
+    }
+    session_->send_rtp_data_paced(cls, rtp_header_, header_len,
+                                pkt->get_payload(), pkt->get_data_length() - header_len);
+}
+
+void rtc_subscriber::set_packet_history(std::shared_ptr<rtp_packet_history> history) {
+    stream_ptr_->set_packet_history(history);
+}
+
+void rtc_subscriber::set_simulcast_layers(std::shared_ptr<simulcast_layers> layers) {
+    layers_ = layers;
+}
+
 void rtc_subscriber::handle_fb_rtp_nack(rtcp_fb_nack* nack_pkt) {
     stream_ptr_->handle_fb_rtp_nack(nack_pkt);
 }
@@ -150,6 +320,19 @@ void rtc_subscriber::handle_rtcp_rr(rtcp_rr_packet* rr_pkt) {
 void rtc_subscriber::on_timer() {
     int64_t now_ms = (int64_t)now_millisec();
     stream_ptr_->on_timer(now_ms);
+
+    if (svc_filter_) {
+        svc_filter_->on_timer(now_ms);
+    }
+    if ((layers_ || svc_filter_) && ((now_ms - last_select_ms_) >= LAYER_SELECT_INTERVAL_MS)) {
+        last_select_ms_ = now_ms;
+        if (layers_) {
+            select_layer(now_ms);
+        } else if (svc_filter_->select_layers(get_layer_bitrate())) {
+            //the higher spatial layer can be sent from the keyframe
+            request_keyframe();
+        }
+    }
 }
 
 void rtc_subscriber::stream_send_rtcp(uint8_t* data, size_t len) {
@@ -161,15 +344,28 @@ void rtc_subscriber::stream_send_rtp(uint8_t* data, size_t len) {
     session_->send_rtp_data_in_dtls(data, len);
 }
 
+bool rtc_subscriber::is_connected() {
+    return session_->is_connected();
+}
+
 void rtc_subscriber::request_keyframe() {
     int64_t now_ms = now_millisec();
 
     if ((now_ms - last_reqkey_ts_) < 1000) {
         return;
     }
+    uint32_t media_ssrc = rtp_ssrc_;
+    if (layers_) {
+        //the keyframe of the layer to switch to, or the one being sent
+        int layer  = (target_layer_ >= 0) ? target_layer_ : current_layer_;
+        media_ssrc = layers_->get_ssrc(layer);
+        if (media_ssrc == 0) {
+            return;
+        }
+    }
     last_reqkey_ts_ = now_ms;
 
-    room_cb_->on_request_keyframe(pid_, sid_, rtp_ssrc_);
+    room_cb_->on_request_keyframe(pid_, sid_, media_ssrc);
 }
 
 void rtc_subscriber::update_alive(int64_t now_ms) {
@@ -5,6 +5,8 @@
 #include "rtc_media_info.hpp"
 #include "rtp_send_stream.hpp"
 #include "rtc_stream_pub.hpp"
+#include "simulcast_layers.hpp"
+#include "svc_layer_filter.hpp"
 #include "net/rtprtcp/rtp_packet.hpp"
 #include "net/rtprtcp/rtcpfb_nack.hpp"
 #include "net/rtprtcp/rtcp_rr.hpp"
@@ -20,6 +22,11 @@ typedef enum
     LIVE_STREAM_TYPE
 } SOURCE_STREAM_TYPE;
 
+#define RTP_HEADER_AREA_SIZE 256
+#define LAYER_SELECT_INTERVAL_MS 500
+#define SIMULCAST_SEQ_WINDOW 0x1000//the older packets of the layer are dropped after the switch
+#define RTP_PADDING_ONLY_SIZE 4//sent in the seq reserved for the dropped svc packet
+
 using json = nlohmann::json;
 
 class rtc_base_session;
@@ -38,6 +45,7 @@ public:
     std::string get_remote_uid() {return remote_uid_;}
     std::string get_publisher_id() {return pid_;}
     std::string get_subscirber_id() {return sid_;}
+    std::string get_media_type() {return media_type_;}
     uint32_t get_rtp_ssrc() { return rtp_ssrc_; }
     uint32_t get_rtx_ssrc() { return rtx_ssrc_; }
     uint8_t get_mid() { return media_info_.mid; }
@@ -50,6 +58,9 @@ public:
     void set_remb_bitrate(int64_t bitrate);
     void get_statics(json& json_data);
     void update_alive(int64_t now_ms);
+    void set_packet_history(std::shared_ptr<rtp_packet_history> history);
+    void set_simulcast_layers(std::shared_ptr<simulcast_layers> layers);
+    bool is_connected();
 
 public:
     void send_rtp_packet(const std::string& roomId, const std::string& media_type,
@@ -64,6 +75,16 @@ public://implement timer_interface
 public://implement rtc_stream_callback
     virtual void stream_send_rtcp(uint8_t* data, size_t len) override;
     virtual void stream_send_rtp(uint8_t* data, size_t len) override;
+    virtual void stream_resend_rtp(rtp_packet* pkt, uint16_t seq, uint32_t timestamp, bool marker, bool padding) override;
+
+private:
+    void send_rewritten_rtp(rtp_packet* pkt, uint16_t seq, uint32_t timestamp, bool marker, bool resend,
+                        bool padding = false);
+    //return false when the packet isn't sent for the selected layer
+    bool rewrite_simulcast_rtp(rtp_packet* pkt, uint16_t& seq, uint32_t& timestamp);
+    void switch_layer(rtp_packet* pkt, int layer);
+    void select_layer(int64_t now_ms);
+    int64_t get_layer_bitrate();
 
 private:
     std::string roomId_;
@@ -74,6 +95,7 @@ private:
     SOURCE_STREAM_TYPE stream_type_ = RTC_STREAM_TYPE;
     rtc_base_session* session_ = nullptr;
     std::shared_ptr<rtp_send_stream> stream_ptr_;
+    uint8_t rtp_header_[RTP_HEADER_AREA_SIZE];//the header of the shared packet rewritten for the subscriber
 
 private:
     MEDIA_RTC_INFO media_info_;
@@ -95,6 +117,23 @@ private:
 
 private:
     int64_t last_reqkey_ts_ = -1;
+
+private://simulcast, the layers are rewritten to one stream of continuous seq and timestamp
+    std::shared_ptr<simulcast_layers> layers_;
+    int current_layer_      = -1;
+    int target_layer_       = -1;
+    bool layer_started_     = false;
+    uint16_t seq_offset_    = 0;
+    uint32_t ts_offset_     = 0;
+    uint16_t floor_seq_     = 0;//the source seq of the current layer
+    uint16_t max_seq_       = 0;
+    uint32_t max_ts_        = 0;
+    int64_t max_ts_ms_      = 0;
+    int64_t last_select_ms_ = 0;
+    int64_t switch_count_   = 0;
+
+private://svc, the layers over the bitrate are dropped
+    std::shared_ptr<svc_layer_filter> svc_filter_;
 };
 
 
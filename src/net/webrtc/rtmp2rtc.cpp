@@ -1,6 +1,7 @@
 #include "rtmp2rtc.hpp"
 #include "room_service.hpp"
 #include "utils/av/media_packet.hpp"
+#include "utils/av/media_stream_manager.hpp"
 #include "utils/config.hpp"
 #include "utils/logger.hpp"
 
@@ -28,7 +29,10 @@ int rtmp2rtc_writer::write_packet(MEDIA_PACKET_PTR pkt_ptr) {
         return 0;
     }
 
-    room_service_ptr->rtmp_stream_ingest(pkt_ptr);
+    if (room_service_ptr->rtmp_stream_ingest(pkt_ptr)) {
+        //the first viewer starts from the latest key frame
+        media_stream_manager::writer_gop(pkt_ptr->key_, this);
+    }
     return 0;
 }
 
@@ -4,51 +4,67 @@
 
 #include <cstring>
 
-static rtp_packet* make_rtp_packet(header_extension* ext, size_t payload_len) {
-    uint8_t* data = new uint8_t[RTP_PACKET_MAX_SIZE];
-    size_t ext_len = 0;
-    rtp_common_header* header = (rtp_common_header*)data;
+rtp_packet_arena::rtp_packet_arena(size_t init_count) {
+    items_.reserve(init_count);
+    for (size_t i = 0; i < init_count; i++) {
+        items_.push_back(new RTP_ARENA_ITEM());
+    }
+}
+
+rtp_packet_arena::~rtp_packet_arena() {
+    for (RTP_ARENA_ITEM* item : items_) {
+        delete item;
+    }
+    items_.clear();
+}
+
+rtp_packet* rtp_packet_arena::alloc(size_t payload_len, header_extension* ext) {
+    size_t ext_len = ext ? (4 + 4 * ntohs(ext->length)) : 0;
+    size_t data_len = payload_len + sizeof(rtp_common_header) + ext_len;
+
+    if ((payload_len == 0) || (data_len > RTP_PACKET_MAX_SIZE)) {
+        return nullptr;
+    }
+    if (used_ >= items_.size()) {
+        items_.push_back(new RTP_ARENA_ITEM());
+    }
+    RTP_ARENA_ITEM* item = items_[used_];
+    rtp_common_header* header = (rtp_common_header*)item->data;
 
     memset(header, 0, sizeof(rtp_common_header));
     header->version = RTP_VERSION;
 
     if (ext) {
         header->extension = 1;
-        uint8_t* p = (uint8_t*)(header + 1);
-        memcpy(p, ext, 4 + 4 * ntohs(ext->length));
-        ext_len = 4 + 4 * ntohs(ext->length);
-    } else {
-        header->extension = 0;
-        ext_len = 0;
+        memcpy((uint8_t*)(header + 1), ext, ext_len);
     }
 
-    size_t data_len = payload_len + sizeof(rtp_common_header) + ext_len;
-    if (data_len > RTP_PACKET_MAX_SIZE) {
+    if (!item->pkt.reset(item->data, data_len)) {
         return nullptr;
     }
-    rtp_packet* packet = rtp_packet::parse(data, data_len);
-    packet->set_need_delete(true);
-
-    return packet;
+    used_++;
+    return &item->pkt;
 }
 
-rtp_packet* generate_stapA_packets(std::vector<std::pair<unsigned char*, int>> NaluVec, header_extension* ext) {
+rtp_packet* generate_stapA_packets(rtp_packet_arena& arena, const std::vector<std::pair<uint8_t*, int>>& nalu_vec, header_extension* ext) {
     size_t data_len = 0;
 
     data_len += kNalHeaderSize;
-    for (auto& nalu : NaluVec) {
+    for (auto& nalu : nalu_vec) {
         data_len += kLengthFieldSize;
         data_len += nalu.second;
     }
-    rtp_packet* packet = make_rtp_packet(ext, data_len);
+    rtp_packet* packet = arena.alloc(data_len, ext);
+    if (!packet) {
+        return nullptr;
+    }
 
     uint8_t* payload = packet->get_payload();
-    auto nalu        = NaluVec[0];
-    auto nalu_header = (nalu.first)[0];
+    auto nalu_header = (nalu_vec[0].first)[0];
     payload[0]       = (nalu_header & (kFBit | kNriMask)) | NaluType::kStapA;
     size_t index     = kNalHeaderSize;
 
-    for (auto& nalu : NaluVec)
+    for (auto& nalu : nalu_vec)
     {
         payload[index]     = nalu.second >> 8;
         payload[index + 1] = nalu.second;
@@ -61,49 +77,48 @@ rtp_packet* generate_stapA_packets(std::vector<std::pair<unsigned char*, int>> N
     return packet;
 }
 
+size_t generate_fuA_packets(rtp_packet_arena& arena, uint8_t* nalu, size_t nalu_size, header_extension* ext) {
+    size_t payload_left = nalu_size - kNalHeaderSize;
+    uint8_t naul_header = nalu[0];
+    uint8_t* fragment   = nalu + kNalHeaderSize;
+    size_t count        = 0;
 
-std::vector<rtp_packet*> generate_fuA_packets(uint8_t* nalu, size_t nalu_size, header_extension* ext) {
-    std::vector<rtp_packet*> packets;
-    size_t payload_left             = nalu_size - kNalHeaderSize;
-    std::vector<int> fragment_sizes = split_nalu(payload_left);
-    uint8_t naul_header             = nalu[0];
-    auto fragment                   = nalu + kNalHeaderSize;
-
-    for (size_t i = 0; i < fragment_sizes.size(); ++i) {
-        size_t payload_len = kFuAHeaderSize + fragment_sizes[i];
-        rtp_packet* packet = make_rtp_packet(ext, payload_len);
-        uint8_t* payload   = packet->get_payload();
+    uint8_t fu_indicator = (naul_header & (kFBit | kNriMask)) | NaluType::kFuA;
+    uint8_t type         = naul_header & kTypeMask;
 
-        uint8_t fu_indicator = (naul_header & (kFBit | kNriMask)) | NaluType::kFuA;
+    while (payload_left > 0) {
+        size_t fragment_size = (payload_left > kPayloadMaxSize) ? kPayloadMaxSize : payload_left;
+        rtp_packet* packet   = arena.alloc(kFuAHeaderSize + fragment_size, ext);
+        if (!packet) {
+            break;
+        }
+        uint8_t* payload = packet->get_payload();
 
-        uint8_t fu_header = 0;
         // S | E | R | 5 bit type.
-        fu_header |= (i == 0 ? kSBit : 0);
-        fu_header |= (i == (fragment_sizes.size() - 1) ? kEBit : 0);
-
-        uint8_t type = naul_header & kTypeMask;
-        fu_header |= type;
+        uint8_t fu_header = type;
+        fu_header |= (count == 0 ? kSBit : 0);
+        fu_header |= (fragment_size == payload_left ? kEBit : 0);
 
         payload[0] = fu_indicator;
         payload[1] = fu_header;
-        memcpy(payload + kFuAHeaderSize, fragment, fragment_sizes[i]);
+        memcpy(payload + kFuAHeaderSize, fragment, fragment_size);
 
-        fragment += fragment_sizes[i];
+        fragment     += fragment_size;
+        payload_left -= fragment_size;
 
-        packet->set_payload_length(kFuAHeaderSize + fragment_sizes[i]);
-        packet->set_marker(i == (fragment_sizes.size() - 1));
-        packets.push_back(packet);
+        packet->set_marker(payload_left == 0);
+        count++;
     }
-    return packets;
+    return count;
 }
 
-rtp_packet* generate_singlenalu_packets(uint8_t* data, size_t len, header_extension* ext) {
-    rtp_packet* packet = make_rtp_packet(ext, len);
-
-    uint8_t* payload = packet->get_payload();
+rtp_packet* generate_singlenalu_packets(rtp_packet_arena& arena, uint8_t* data, size_t len, header_extension* ext) {
+    rtp_packet* packet = arena.alloc(len, ext);
+    if (!packet) {
+        return nullptr;
+    }
 
-    memcpy(payload, data, len);
-    packet->set_payload_length(len);
+    memcpy(packet->get_payload(), data, len);
     return packet;
 }
 
@@ -38,11 +38,49 @@ static const size_t kNaluShortStartSequenceSize = 3;
 // The size of the NALU type byte (1).
 static const size_t kNaluTypeSize = 1;
 
-rtp_packet* generate_stapA_packets(std::vector<std::pair<unsigned char*, int>> NalUVec, header_extension* ext = nullptr);
+#define RTP_ARENA_INIT_COUNT 64
 
-std::vector<rtp_packet*> generate_fuA_packets(uint8_t* data, size_t len, header_extension* ext = nullptr);
+class RTP_ARENA_ITEM
+{
+public:
+    RTP_ARENA_ITEM():pkt(rtp_packet_view()) {}
+    ~RTP_ARENA_ITEM() {}
+
+public:
+    rtp_packet pkt;
+    uint8_t data[RTP_PACKET_MAX_SIZE];
+};
+
+/*
+the rtp packets of one frame are made in the arena and sent to all the subscribers,
+they don't change the packets. the arena is reset for the next frame and its items
+are reused, it grows to the packet count of the largest frame.
+*/
+class rtp_packet_arena
+{
+public:
+    rtp_packet_arena(size_t init_count = RTP_ARENA_INIT_COUNT);
+    ~rtp_packet_arena();
+
+public:
+    void reset() { used_ = 0; }
+    size_t size() { return used_; }
+    rtp_packet* at(size_t index) { return &items_[index]->pkt; }
+
+    //the packet has the rtp header, the extension and the payload of payload_len
+    rtp_packet* alloc(size_t payload_len, header_extension* ext = nullptr);
+
+private:
+    std::vector<RTP_ARENA_ITEM*> items_;
+    size_t used_ = 0;
+};
+
+rtp_packet* generate_stapA_packets(rtp_packet_arena& arena, const std::vector<std::pair<uint8_t*, int>>& nalu_vec, header_extension* ext = nullptr);
+
+//return the count of the fua packets made in the arena
+size_t generate_fuA_packets(rtp_packet_arena& arena, uint8_t* data, size_t len, header_extension* ext = nullptr);
 
-rtp_packet* generate_singlenalu_packets(uint8_t* data, size_t len, header_extension* ext = nullptr);
+rtp_packet* generate_singlenalu_packets(rtp_packet_arena& arena, uint8_t* data, size_t len, header_extension* ext = nullptr);
 
 std::vector<int> split_nalu(int payload_len);
 
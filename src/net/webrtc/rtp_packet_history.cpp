@@ -0,0 +1,90 @@
+#include "rtp_packet_history.hpp"
+#include "logger.hpp"
+
+rtp_packet_history::rtp_packet_history(const std::string& media_type):media_type_(media_type)
+{
+    size_ = (media_type_ == "video") ? RTP_HISTORY_VIDEO_SIZE : RTP_HISTORY_AUDIO_SIZE;
+    mask_ = size_ - 1;
+
+    //the rings are never moved, the packets point to the data of their items
+    rings_.reserve(RTP_HISTORY_SSRC_MAX);
+}
+
+rtp_packet_history::~rtp_packet_history()
+{
+}
+
+rtp_packet_history::history_ring* rtp_packet_history::get_ring(uint32_t ssrc) {
+    for (history_ring& ring : rings_) {
+        if (ring.ssrc == ssrc) {
+            return &ring;
+        }
+    }
+    return nullptr;
+}
+
+rtp_packet_history::history_ring* rtp_packet_history::reuse_idle_ring(uint32_t ssrc, int64_t now_ms) {
+    history_ring* idle_ring = nullptr;
+
+    for (history_ring& ring : rings_) {
+        if ((now_ms - ring.last_ms) < RTP_HISTORY_IDLE_MS) {
+            continue;
+        }
+        if (!idle_ring || (ring.last_ms < idle_ring->last_ms)) {
+            idle_ring = &ring;
+        }
+    }
+    if (!idle_ring) {
+        return nullptr;
+    }
+    log_infof("the rtp history ring of the idle ssrc:%u is reused by the ssrc:%u", idle_ring->ssrc, ssrc);
+    idle_ring->ssrc = ssrc;
+    for (history_item& item : idle_ring->items) {
+        item.valid = false;
+    }
+    return idle_ring;
+}
+
+void rtp_packet_history::save(rtp_packet* pkt) {
+    if (pkt->get_data_length() >= RTP_PACKET_MAX_SIZE) {
+        log_warnf("the rtp packet is too large to be saved, len:%lu", pkt->get_data_length());
+        return;
+    }
+    int64_t now_ms = pkt->get_local_ms();
+    history_ring* ring = get_ring(pkt->get_ssrc());
+    if (!ring && (rings_.size() >= RTP_HISTORY_SSRC_MAX)) {
+        ring = reuse_idle_ring(pkt->get_ssrc(), now_ms);
+        if (!ring) {
+            log_warnf("the rtp history has too many ssrcs, the ssrc:%u isn't saved", pkt->get_ssrc());
+            return;
+        }
+    }
+    if (!ring) {
+        rings_.emplace_back();
+        ring = &rings_.back();
+        ring->ssrc = pkt->get_ssrc();
+        ring->items.resize(size_);
+    }
+    ring->last_ms = now_ms;
+    uint16_t seq = pkt->get_seq();
+    history_item& item = ring->items[seq & mask_];
+
+    //the packet is repeated by the publisher
+    if (item.valid && (item.packet.get_seq() == seq) && (item.packet.get_timestamp() == pkt->get_timestamp())) {
+        return;
+    }
+    item.valid = pkt->clone_to(item.packet, item.data);
+}
+
+rtp_packet* rtp_packet_history::get(uint16_t seq, uint32_t ssrc) {
+    history_ring* ring = get_ring(ssrc);
+    if (!ring) {
+        return nullptr;
+    }
+    history_item& item = ring->items[seq & mask_];
+
+    if (!item.valid || (item.packet.get_seq() != seq)) {
+        return nullptr;
+    }
+    return &item.packet;
+}
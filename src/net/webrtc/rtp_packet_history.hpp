@@ -0,0 +1,67 @@
+#ifndef RTP_PACKET_HISTORY_HPP
+#define RTP_PACKET_HISTORY_HPP
+#include "net/rtprtcp/rtp_packet.hpp"
+#include "net/rtprtcp/rtprtcp_pub.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#define RTP_HISTORY_VIDEO_SIZE 1024
+#define RTP_HISTORY_AUDIO_SIZE 128
+#define RTP_HISTORY_SSRC_MAX   4//one ring for each simulcast layer
+#define RTP_HISTORY_IDLE_MS    2000//the ring of a stopped ssrc is reused, eg: the layer is restarted
+
+/*
+the sent rtp packets of one publisher, shared by all its subscribers for nack.
+the packets are saved once as the publisher sends them, in a ring indexed by
+the publisher sequence. the subscribers rewrite the copy of the header when
+it's resent, so the ring keeps the origin ssrc, payload type and timestamp.
+the simulcast layers have their own sequences, so every ssrc has its ring.
+the ring of an idle ssrc is given to the new one when all the rings are used.
+*/
+class rtp_packet_history
+{
+public:
+    rtp_packet_history(const std::string& media_type);
+    ~rtp_packet_history();
+
+public:
+    void save(rtp_packet* pkt);
+    //return nullptr when the sequence is overwritten or never saved
+    rtp_packet* get(uint16_t seq, uint32_t ssrc);
+    size_t capacity() { return size_; }
+
+private:
+    //the packet is filled in place, nothing is allocated when it's saved
+    class history_item
+    {
+    public:
+        history_item():packet(rtp_packet_view()) {}
+
+    public:
+        bool valid = false;
+        rtp_packet packet;
+        uint8_t data[RTP_PACKET_MAX_SIZE];
+    };
+
+    class history_ring
+    {
+    public:
+        uint32_t ssrc = 0;
+        int64_t last_ms = 0;
+        std::vector<history_item> items;
+    };
+
+private:
+    history_ring* get_ring(uint32_t ssrc);
+    history_ring* reuse_idle_ring(uint32_t ssrc, int64_t now_ms);
+
+private:
+    std::string media_type_;
+    std::vector<history_ring> rings_;
+    size_t size_ = 0;
+    size_t mask_ = 0;
+};
+
+#endif
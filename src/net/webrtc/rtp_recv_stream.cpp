@@ -267,13 +267,11 @@ void rtp_recv_stream::update_rtt(int64_t rtt) {
     }
 }
 
-void rtp_recv_stream::generate_nacklist(const std::vector<uint16_t>& seq_vec) {
-    rtcp_fb_nack* nack_pkt = new rtcp_fb_nack(0, ssrc_);
-    nack_pkt->insert_seq_list(seq_vec);
+void rtp_recv_stream::generate_nack_blocks(const rtcp_nack_block* blocks, size_t count) {
+    rtcp_fb_nack nack_pkt(0, ssrc_);
+    nack_pkt.insert_blocks(blocks, count);
 
-    cb_->stream_send_rtcp(nack_pkt->get_data(), nack_pkt->get_len());
-
-    delete nack_pkt;
+    cb_->stream_send_rtcp(nack_pkt.get_data(), nack_pkt.get_len());
 }
 
 void rtp_recv_stream::get_statics(json& json_data) {
@@ -27,7 +27,7 @@ public:
     void on_handle_rtcp_sr(rtcp_sr_packet* sr_pkt);
 
 public:
-    virtual void generate_nacklist(const std::vector<uint16_t>& seq_vec) override;
+    virtual void generate_nack_blocks(const rtcp_nack_block* blocks, size_t count) override;
     
 public:
     void on_timer(int64_t now_ms);
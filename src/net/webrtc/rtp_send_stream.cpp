@@ -9,21 +9,18 @@
 
 using json = nlohmann::json;
 
-static const size_t RTP_VIDEO_BUFFER_MAX = 800;
-static const size_t RTP_AUDIO_BUFFER_MAX = 100;
-static const size_t STORAGE_MAX_SIZE     = 2000;
-
 rtp_send_stream::rtp_send_stream(const std::string& media_type, bool nack_enable,
                         rtc_stream_callback* cb):media_type_(media_type)
                                                 , nack_enable_(nack_enable)
                                                 , cb_(cb)
-                                                , rtp_packet_array(65536, nullptr)
 {
-    storages_.resize(STORAGE_MAX_SIZE);
+    if (nack_enable_) {
+        size_t size = (media_type_ == "video") ? RTP_HISTORY_VIDEO_SIZE : RTP_HISTORY_AUDIO_SIZE;
+        resend_items_.resize(size);
+    }
 }
 
 rtp_send_stream::~rtp_send_stream() {
-    clear_buffer();
 }
 
 void rtp_send_stream::get_statics(json& json_data) {
@@ -43,89 +40,24 @@ void rtp_send_stream::get_statics(json& json_data) {
     return;
 }
 
-void rtp_send_stream::save_buffer(rtp_packet* input_pkt) {
-    uint16_t seq = input_pkt->get_seq();
-    size_t buffer_max = (media_type_ == "video") ? RTP_VIDEO_BUFFER_MAX : RTP_AUDIO_BUFFER_MAX;
-
-    size_t storage_index = seq % STORAGE_MAX_SIZE;
-
-    if (storages_[storage_index].packet != nullptr) {
-        if (storages_[storage_index].packet->get_timestamp() == input_pkt->get_timestamp()) {
-            return;
-        }
-        assert(false == storages_[storage_index].packet->get_need_delete());
-        delete storages_[storage_index].packet;
-
-        storages_[storage_index].packet              = nullptr;
-        storages_[storage_index].last_sent_timestamp = 0;
-        storages_[storage_index].sent_count          = 0;
-    }
-
-    if (first_seq_ < 0) {
-        first_seq_ = seq;
-    }
-
-    storages_[storage_index].packet              = input_pkt->clone(storages_[storage_index].data);
-    storages_[storage_index].last_sent_timestamp = 0;
-    storages_[storage_index].sent_count          = 0;
-
-    rtp_packet_array[seq] = &(storages_[storage_index]);
-
-    pkt_count_++;
-
-    int repeat_count = 0;
-    while (pkt_count_ > (int)buffer_max) {
-        if (repeat_count++ > 5000) {
-            break;
-        }
-        size_t index = first_seq_ % STORAGE_MAX_SIZE;
-
-        rtp_packet_array[first_seq_] = nullptr;
-        if (storages_[index].packet == nullptr) {
-            first_seq_ = (first_seq_ + 1) % 65536;
-            storages_[index].last_sent_timestamp = 0;
-            storages_[index].sent_count          = 0;
-        } else {
-            assert(false == storages_[index].packet->get_need_delete());
-            delete storages_[index].packet;
-
-            storages_[index].packet              = nullptr;
-            storages_[index].last_sent_timestamp = 0;
-            storages_[index].sent_count          = 0;
-            
-            first_seq_ = (first_seq_ + 1) % 65536;
-            if (pkt_count_ > 0) {
-                pkt_count_--;
-            }
-        }
-    }
-}
-
-void rtp_send_stream::on_send_rtp_packet(rtp_packet* pkt) {
+void rtp_send_stream::on_send_rtp_packet(rtp_packet* pkt, uint16_t seq, uint32_t timestamp, bool marker, bool padding) {
     send_statics_.update(pkt->get_data_length(),  pkt->get_local_ms());
 
-    pkt->set_payload_type(rtp_payload_type_);
-    pkt->set_ssrc(rtp_ssrc_);
-
     if (nack_enable_) {
-        save_buffer(pkt);
+        RESEND_ITEM& item = resend_items_[seq % resend_items_.size()];
+
+        item.seq                 = seq;
+        item.src_seq             = pkt->get_seq();
+        item.src_ssrc            = pkt->get_ssrc();
+        item.timestamp           = timestamp;
+        item.marker              = marker;
+        item.padding             = padding;
+        item.last_sent_timestamp = 0;
+        item.sent_count          = 0;
     }
     return;
 }
 
-void rtp_send_stream::clear_buffer() {
-    for (size_t i = 0; i < STORAGE_MAX_SIZE; i++) {
-        if (storages_[i].packet) {
-            assert(false == storages_[i].packet->get_need_delete());
-            delete storages_[i].packet;
-        }
-        storages_[i].packet              = nullptr;
-        storages_[i].last_sent_timestamp = 0;
-        storages_[i].sent_count          = 0;
-    }
-    pkt_count_ = 0;
-}
-
 void rtp_send_stream::handle_fb_rtp_nack(rtcp_fb_nack* nack_pkt) {
     std::vector<uint16_t> lost_seqs = nack_pkt->get_lost_seqs();
     int64_t now_ms = now_millisec();
@@ -139,39 +71,43 @@ void rtp_send_stream::handle_fb_rtp_nack(rtcp_fb_nack* nack_pkt) {
     //log_infof("media ssrc:%u, nack lost seqs:%s, avg rtt:%.02f",
     //    nack_pkt->get_media_ssrc(), ss.str().c_str(), avg_rtt_);
 
+    if (!nack_enable_ || !history_) {
+        return;
+    }
+
     for (auto seq : lost_seqs) {
-        if ((rtp_packet_array[seq] == nullptr) || (rtp_packet_array[seq]->packet == nullptr)) {
+        RESEND_ITEM& item = resend_items_[seq % resend_items_.size()];
+        rtp_packet* history_pkt = (item.seq == (int)seq) ? history_->get(item.src_seq, item.src_ssrc) : nullptr;
+
+        if (history_pkt == nullptr) {
             log_warnf("nack seq[%d] can't be found", seq);
             continue;
         }
         
-        if (rtp_packet_array[seq]->last_sent_timestamp == 0) {
-            rtp_packet_array[seq]->last_sent_timestamp = now_ms;
-            rtp_packet_array[seq]->sent_count = 1;
+        if (item.last_sent_timestamp == 0) {
+            item.last_sent_timestamp = now_ms;
+            item.sent_count = 1;
         } else {
-            int64_t diff_t = now_ms - rtp_packet_array[seq]->last_sent_timestamp;
+            int64_t diff_t = now_ms - item.last_sent_timestamp;
             if ((diff_t < avg_rtt_) && (avg_rtt_ <= 150)) {
-                log_warnf("resend is too often, seq:%d, diff:%ld",
-                    rtp_packet_array[seq]->packet->get_seq(), diff_t);
+                log_warnf("resend is too often, seq:%d, diff:%ld", seq, diff_t);
                 continue;
             }
             
-            rtp_packet_array[seq]->sent_count++;
-            if (rtp_packet_array[seq]->sent_count > RETRANSMIT_MAX_COUNT) {
+            item.sent_count++;
+            if (item.sent_count > RETRANSMIT_MAX_COUNT) {
                 log_errorf("the lost sequence(%d) has been retransmited over times(%d), avg rtt:%.02f",
-                        seq, rtp_packet_array[seq]->sent_count, avg_rtt_);
+                        seq, item.sent_count, avg_rtt_);
                 continue;
             }
-            rtp_packet_array[seq]->last_sent_timestamp = now_ms;
+            item.last_sent_timestamp = now_ms;
         }
-        if (rtp_packet_array[seq]->sent_count > 3) {
+        if (item.sent_count > 3) {
             for (int i = 0; i < 2; i++) {
-                cb_->stream_send_rtp(rtp_packet_array[seq]->packet->get_data(),
-                                rtp_packet_array[seq]->packet->get_data_length());
+                cb_->stream_resend_rtp(history_pkt, item.seq, item.timestamp, item.marker, item.padding);
             }
         } else {
-            cb_->stream_send_rtp(rtp_packet_array[seq]->packet->get_data(),
-                            rtp_packet_array[seq]->packet->get_data_length());
+            cb_->stream_resend_rtp(history_pkt, item.seq, item.timestamp, item.marker, item.padding);
         }
     }
 }
@@ -8,21 +8,29 @@
 #include "utils/stream_statics.hpp"
 #include "utils/timeex.hpp"
 #include "rtc_stream_pub.hpp"
+#include "rtp_packet_history.hpp"
 #include "json.hpp"
 #include <stdint.h>
 #include <stddef.h>
 #include <string>
 #include <map>
+#include <memory>
 #include <vector>
 
 using json = nlohmann::json;
 
-typedef struct STORAGE_ITEM_S {
-    uint32_t last_sent_timestamp = 0;
+//the resend state of one sequence in the subscriber, the packet is in the shared history.
+//the sequence and timestamp may be rewritten for the subscriber, so the source is kept
+typedef struct RESEND_ITEM_S {
+    int seq                      = -1;
+    uint16_t src_seq             = 0;
+    uint32_t src_ssrc            = 0;
+    uint32_t timestamp           = 0;
+    bool marker                  = false;
+    bool padding                 = false;//the padding only packet in the seq of a dropped one
+    int64_t last_sent_timestamp  = 0;
     int sent_count               = 0;
-    rtp_packet* packet           = nullptr;
-    uint8_t data[RTP_PACKET_MAX_SIZE];
-} STORAGE_ITEM;
+} RESEND_ITEM;
 
 class rtp_send_stream
 {
@@ -46,22 +54,20 @@ public:
     void set_rtx_ssrc(uint32_t ssrc) { rtx_ssrc_ = ssrc; }
     uint32_t get_rtx_ssrc() { return rtx_ssrc_; }
 
+    void set_packet_history(std::shared_ptr<rtp_packet_history> history) { history_ = history; }
+
     void get_statics(json& json_data);
 
 public:
     void on_timer(int64_t now_ms);
 
 public:
-    void on_send_rtp_packet(rtp_packet* pkt);
+    void on_send_rtp_packet(rtp_packet* pkt, uint16_t seq, uint32_t timestamp, bool marker, bool padding = false);
     void handle_fb_rtp_nack(rtcp_fb_nack* nack_pkt);
     void handle_rtcp_rr(rtcp_rr_packet* rr_pkt);
 
     rtcp_sr_packet* get_rtcp_sr(int64_t now_ms);
 
-private:
-    void save_buffer(rtp_packet* pkt);
-    void clear_buffer();
-
 private:
     std::string media_type_;
     uint32_t rtp_ssrc_        = 0;
@@ -73,10 +79,8 @@ private:
     rtc_stream_callback* cb_  = nullptr;
 
 private:
-    std::vector<STORAGE_ITEM> storages_;
-    std::vector<STORAGE_ITEM*> rtp_packet_array;
-    int first_seq_ = -1;
-    int pkt_count_ = 0;
+    std::shared_ptr<rtp_packet_history> history_;
+    std::vector<RESEND_ITEM> resend_items_;
 
 private:
     stream_statics send_statics_;
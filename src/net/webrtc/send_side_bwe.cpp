@@ -0,0 +1,175 @@
+#include "send_side_bwe.hpp"
+#include "logger.hpp"
+
+//the send time is in the abs-send-time format(6.18 fixed point seconds) shifted
+//up to 32 bits, like the abs-send-time estimator of the publishers
+#define ABS_SEND_TIME_FRACTION      18
+#define INTER_ARRIVAL_UPSHIFT       8
+#define INTER_ARRIVAL_SHIFT         (ABS_SEND_TIME_FRACTION + INTER_ARRIVAL_UPSHIFT)
+#define TIMESTAMP_GROUP_LENGTH_MS   5
+#define ABS_SEND_TIME_WRAP_US       (64 * 1000000LL)
+
+#define ACKED_BITRATE_INTERVAL_MS   1000
+#define LOSS_REPORT_MIN_COUNT       50
+#define LOSS_INCREASE_INTERVAL_MS   1000
+#define LOSS_HIGH_RATE              0.10
+#define LOSS_LOW_RATE               0.02
+
+static const double kTimestampToMs = 1000.0 / static_cast<double>(1 << INTER_ARRIVAL_SHIFT);
+
+send_side_bwe::send_side_bwe():history_(TWCC_HISTORY_SIZE)
+                    , inter_arrival_((TIMESTAMP_GROUP_LENGTH_MS << INTER_ARRIVAL_SHIFT) / 1000, kTimestampToMs, true)
+                    , estimator_(webrtc::OverUseDetectorOptions())
+{
+}
+
+send_side_bwe::~send_side_bwe()
+{
+}
+
+void send_side_bwe::set_bitrate_range(int64_t min_bitrate, int64_t max_bitrate, int64_t start_bitrate) {
+    min_bitrate_ = min_bitrate;
+    max_bitrate_ = max_bitrate;
+
+    rate_ctrl_.set_min_bitrate(min_bitrate);
+    rate_ctrl_.set_max_bitrate(max_bitrate);
+    rate_ctrl_.set_start_bitrate(start_bitrate);
+
+    delay_bitrate_    = start_bitrate;
+    loss_bitrate_     = max_bitrate;
+    estimate_bitrate_ = start_bitrate;
+}
+
+void send_side_bwe::on_packet_sent(size_t len, int64_t now_us) {
+    int64_t ext_seq = next_seq_++;
+    sent_item& item = history_[ext_seq & TWCC_HISTORY_MASK];
+
+    item.ext_seq  = ext_seq;
+    item.send_us  = now_us;
+    item.size     = len;
+    item.reported = false;
+    item.lost     = false;
+}
+
+int64_t send_side_bwe::unwrap_seq(uint16_t seq) {
+    //the feedback is for the packets before next_seq_
+    int64_t last_seq = next_seq_ - 1;
+    int16_t diff = (int16_t)(seq - (uint16_t)(last_seq & 0xffff));
+
+    return last_seq + diff;
+}
+
+bool send_side_bwe::on_feedback(rtcp_fb_twcc& feedback, int64_t now_ms) {
+    const std::vector<TWCC_PACKET_STATUS>& statuses = feedback.get_statuses();
+
+    feedback_count_++;
+    for (const TWCC_PACKET_STATUS& status : statuses) {
+        int64_t ext_seq = unwrap_seq(status.seq);
+        if (ext_seq < 0) {
+            continue;
+        }
+        sent_item& item = history_[ext_seq & TWCC_HISTORY_MASK];
+
+        //overwritten by the later packets or reported by the last feedback
+        if ((item.ext_seq != ext_seq) || item.reported) {
+            continue;
+        }
+        if (!status.received) {
+            //it may be reported received by the next feedback
+            if (!item.lost) {
+                item.lost = true;
+                lost_count_++;
+                report_count_++;
+            }
+            continue;
+        }
+        item.reported = true;
+        if (!item.lost) {
+            report_count_++;
+        }
+
+        acked_statics_.update(item.size, now_ms);
+        update_delay_based(item.send_us, status.arrival_us, item.size, now_ms);
+    }
+    update_loss_based(now_ms);
+
+    int64_t estimate = (delay_bitrate_ < loss_bitrate_) ? delay_bitrate_ : loss_bitrate_;
+    estimate = (estimate > max_bitrate_) ? max_bitrate_ : estimate;
+    estimate = (estimate < min_bitrate_) ? min_bitrate_ : estimate;
+
+    if (estimate == estimate_bitrate_) {
+        return false;
+    }
+    estimate_bitrate_ = estimate;
+    return true;
+}
+
+void send_side_bwe::update_delay_based(int64_t send_us, int64_t arrival_us, size_t size, int64_t now_ms) {
+    uint32_t send_time_24bits = (uint32_t)((((send_us % ABS_SEND_TIME_WRAP_US) << ABS_SEND_TIME_FRACTION) / 1000000) & 0x00ffffff);
+    uint32_t timestamp = send_time_24bits << INTER_ARRIVAL_UPSHIFT;
+    int64_t arrival_ms = arrival_us / 1000;
+
+    uint32_t ts_delta  = 0;
+    int64_t t_delta    = 0;
+    int size_delta     = 0;
+
+    if (inter_arrival_.ComputeDeltas(timestamp, arrival_ms, now_ms, size,
+                                    &ts_delta, &t_delta, &size_delta)) {
+        double ts_delta_ms = (1000.0 * ts_delta) / (1 << INTER_ARRIVAL_SHIFT);
+        estimator_.Update(t_delta, ts_delta_ms, size_delta, detector_.State(), arrival_ms);
+        detector_.Detect(estimator_.offset(), ts_delta_ms, estimator_.num_of_deltas(), arrival_ms);
+    }
+
+    if (last_acked_ms_ < 0) {
+        last_acked_ms_ = now_ms;
+    } else if ((now_ms - last_acked_ms_) > ACKED_BITRATE_INTERVAL_MS) {
+        size_t count_per_second = 0;
+        int64_t acked_rate = 8 * (int64_t)acked_statics_.bytes_per_second(now_ms, count_per_second);
+
+        last_acked_ms_ = now_ms;
+        if (acked_bitrate_ <= 0) {
+            acked_bitrate_ = acked_rate;
+        } else {
+            acked_bitrate_ += (acked_rate - acked_bitrate_) / 4;
+        }
+    }
+
+    //the rate control starts with the first acked bitrate
+    if (acked_bitrate_ > 0) {
+        rate_ctrl_.update(acked_bitrate_, detector_.State());
+        delay_bitrate_ = rate_ctrl_.get_target_bitrate();
+    }
+}
+
+void send_side_bwe::update_loss_based(int64_t now_ms) {
+    if (report_count_ < LOSS_REPORT_MIN_COUNT) {
+        return;
+    }
+    loss_rate_ = (float)lost_count_ / (float)report_count_;
+    lost_count_   = 0;
+    report_count_ = 0;
+
+    if (loss_rate_ > LOSS_HIGH_RATE) {
+        int64_t current = (delay_bitrate_ < loss_bitrate_) ? delay_bitrate_ : loss_bitrate_;
+        loss_bitrate_ = (int64_t)(current * (1.0 - 0.5 * loss_rate_));
+        log_debugf("send side bwe loss rate:%.03f, loss based bitrate:%ld", loss_rate_, loss_bitrate_);
+    } else if (loss_rate_ < LOSS_LOW_RATE) {
+        if ((now_ms - last_increase_ms_) >= LOSS_INCREASE_INTERVAL_MS) {
+            last_increase_ms_ = now_ms;
+            loss_bitrate_ = (int64_t)(loss_bitrate_ * 1.08) + 1000;
+        }
+    }
+    loss_bitrate_ = (loss_bitrate_ > max_bitrate_) ? max_bitrate_ : loss_bitrate_;
+    loss_bitrate_ = (loss_bitrate_ < min_bitrate_) ? min_bitrate_ : loss_bitrate_;
+}
+
+void send_side_bwe::get_statics(json& json_data) {
+    json_data["estimate_bps"] = estimate_bitrate_;
+    json_data["delay_bps"]    = delay_bitrate_;
+    json_data["loss_bps"]     = loss_bitrate_;
+    json_data["acked_bps"]    = acked_bitrate_;
+    json_data["lostrate"]     = loss_rate_;
+    json_data["state"]        = detector_.GetState();
+    json_data["feedbacks"]    = feedback_count_;
+    json_data["sent"]         = next_seq_;
+}
@@ -0,0 +1,90 @@
+#ifndef SEND_SIDE_BWE_HPP
+#define SEND_SIDE_BWE_HPP
+#include "net/rtprtcp/rtcpfb_twcc.hpp"
+#include "modules/remote_bitrate_estimator/inter_arrival.h"
+#include "modules/remote_bitrate_estimator/overuse_detector.h"
+#include "modules/remote_bitrate_estimator/overuse_estimator.h"
+#include "modules/remote_bitrate_estimator/rate_control.h"
+#include "utils/stream_statics.hpp"
+#include "json.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+using json = nlohmann::json;
+
+#define TWCC_HISTORY_SIZE 4096//power of 2, the sent packets waiting for the feedback
+#define TWCC_HISTORY_MASK (TWCC_HISTORY_SIZE - 1)
+
+/*
+the send side bandwidth estimation of one subscriber session by the transport-cc feedback.
+every sent packet takes a transport-wide sequence and is saved in a ring indexed by it,
+the feedback finds the send time of each packet there, so it's O(packets).
+the delay based estimation runs the inter arrival, the overuse estimator and detector
+of the bundled libwebrtc on the send/arrival times, like the abs-send-time estimator
+of the publishers, and the rate control follows the acked bitrate.
+the loss based bitrate decreases over 10% lost and increases under 2% lost,
+the estimate is the smaller one.
+*/
+class send_side_bwe
+{
+public:
+    send_side_bwe();
+    ~send_side_bwe();
+
+public:
+    void set_bitrate_range(int64_t min_bitrate, int64_t max_bitrate, int64_t start_bitrate);
+    //the transport sequence of the packet to send, it's taken by on_packet_sent
+    uint16_t next_transport_seq() { return (uint16_t)(next_seq_ & 0xffff); }
+    void on_packet_sent(size_t len, int64_t now_us);
+    //return true when the estimate is changed
+    bool on_feedback(rtcp_fb_twcc& feedback, int64_t now_ms);
+    int64_t get_estimate_bitrate() { return estimate_bitrate_; }
+    bool has_feedback() { return feedback_count_ > 0; }
+    void get_statics(json& json_data);
+
+private:
+    void update_delay_based(int64_t send_us, int64_t arrival_us, size_t size, int64_t now_ms);
+    void update_loss_based(int64_t now_ms);
+    int64_t unwrap_seq(uint16_t seq);
+
+private:
+    class sent_item
+    {
+    public:
+        int64_t ext_seq = -1;
+        int64_t send_us = 0;
+        size_t size     = 0;
+        bool reported   = false;
+        bool lost       = false;//counted as lost once, the later feedbacks still cover it
+    };
+
+private:
+    std::vector<sent_item> history_;
+    int64_t next_seq_ = 0;//the extended transport sequence
+
+private://delay based
+    webrtc::InterArrival inter_arrival_;
+    webrtc::OveruseEstimator estimator_;
+    webrtc::OveruseDetector detector_;
+    webrtc::RateControl rate_ctrl_;
+    stream_statics acked_statics_;
+    int64_t acked_bitrate_     = -1;
+    int64_t last_acked_ms_     = -1;
+    int64_t delay_bitrate_     = 0;
+
+private://loss based
+    int64_t loss_bitrate_      = 0;
+    uint32_t lost_count_       = 0;
+    uint32_t report_count_     = 0;
+    float loss_rate_           = 0.0;
+    int64_t last_increase_ms_  = 0;
+
+private:
+    int64_t min_bitrate_       = 0;
+    int64_t max_bitrate_       = 0;
+    int64_t estimate_bitrate_  = 0;
+    int64_t feedback_count_    = 0;
+};
+
+#endif
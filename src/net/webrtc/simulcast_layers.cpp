@@ -0,0 +1,307 @@
+#include "simulcast_layers.hpp"
+#include "logger.hpp"
+
+static const uint8_t H264_NALU_IDR    = 5;
+static const uint8_t H264_NALU_SPS    = 7;
+static const uint8_t H264_NALU_STAPA  = 24;
+static const uint8_t H264_NALU_FUA    = 28;
+
+simulcast_layers::simulcast_layers(MEDIA_CODEC_TYPE codec_type, const MEDIA_RTC_INFO& media_info):codec_type_(codec_type)
+{
+    //the layers in the order of a=simulcast, eg: "h;m;l", "~h;m", "h,h2;l".
+    //the paused layer is kept, and the first one of the alternatives is used
+    std::vector<std::string> ids;
+    const std::string& list = media_info.simulcast.list;
+    size_t pos = 0;
+
+    while (pos < list.size()) {
+        size_t end = list.find(';', pos);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        std::string item = list.substr(pos, end - pos);
+        size_t comma = item.find(',');
+        if (comma != std::string::npos) {
+            item = item.substr(0, comma);
+        }
+        if (!item.empty() && (item[0] == '~')) {
+            item = item.substr(1);
+        }
+        if (!item.empty()) {
+            ids.push_back(item);
+        }
+        pos = end + 1;
+    }
+    if (ids.empty()) {
+        for (const RID_INFO& rid : media_info.rids) {
+            if (rid.direction == "send") {
+                ids.push_back(rid.id);
+            }
+        }
+    }
+
+    for (const std::string& id : ids) {
+        if (get_layer_by_rid(id) >= 0) {
+            continue;
+        }
+        simulcast_layer layer;
+        layer.rid = id;
+        layers_.push_back(layer);
+    }
+    log_infof("simulcast layers construct codec:%s, layer count:%lu, list:%s",
+        codectype_tostring(codec_type_).c_str(), layers_.size(), list.c_str());
+}
+
+simulcast_layers::~simulcast_layers()
+{
+}
+
+int simulcast_layers::get_layer_by_rid(const std::string& rid) {
+    for (size_t i = 0; i < layers_.size(); i++) {
+        if (layers_[i].rid == rid) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+int simulcast_layers::get_layer(uint32_t ssrc) {
+    for (size_t i = 0; i < layers_.size(); i++) {
+        if ((layers_[i].ssrc != 0) && (layers_[i].ssrc == ssrc)) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+int simulcast_layers::get_rtx_layer(uint32_t ssrc) {
+    for (size_t i = 0; i < layers_.size(); i++) {
+        if ((layers_[i].rtx_ssrc != 0) && (layers_[i].rtx_ssrc == ssrc)) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+void simulcast_layers::set_ssrc(int layer, uint32_t ssrc) {
+    if ((layer < 0) || (layer >= (int)layers_.size())) {
+        return;
+    }
+    layers_[layer].ssrc = ssrc;
+    log_infof("simulcast layer rid:%s is bound to ssrc:%u", layers_[layer].rid.c_str(), ssrc);
+}
+
+void simulcast_layers::set_rtx_ssrc(int layer, uint32_t ssrc) {
+    if ((layer < 0) || (layer >= (int)layers_.size())) {
+        return;
+    }
+    layers_[layer].rtx_ssrc = ssrc;
+    log_infof("simulcast layer rid:%s is bound to rtx ssrc:%u", layers_[layer].rid.c_str(), ssrc);
+}
+
+uint32_t simulcast_layers::get_ssrc(int layer) {
+    if ((layer < 0) || (layer >= (int)layers_.size())) {
+        return 0;
+    }
+    return layers_[layer].ssrc;
+}
+
+uint32_t simulcast_layers::get_rtx_ssrc(int layer) {
+    if ((layer < 0) || (layer >= (int)layers_.size())) {
+        return 0;
+    }
+    return layers_[layer].rtx_ssrc;
+}
+
+std::string simulcast_layers::get_rid(int layer) {
+    if ((layer < 0) || (layer >= (int)layers_.size())) {
+        return "";
+    }
+    return layers_[layer].rid;
+}
+
+int64_t simulcast_layers::get_bitrate(int layer) {
+    if ((layer < 0) || (layer >= (int)layers_.size())) {
+        return 0;
+    }
+    return layers_[layer].bitrate;
+}
+
+bool simulcast_layers::is_active(int layer, int64_t now_ms) {
+    if ((layer < 0) || (layer >= (int)layers_.size())) {
+        return false;
+    }
+    const simulcast_layer& item = layers_[layer];
+
+    return (item.ssrc != 0) && (item.last_rtp_ms >= 0)
+        && ((now_ms - item.last_rtp_ms) < SIMULCAST_LAYER_TIMEOUT_MS);
+}
+
+void simulcast_layers::on_rtp(int layer, size_t len, int64_t now_ms) {
+    if ((layer < 0) || (layer >= (int)layers_.size())) {
+        return;
+    }
+    layers_[layer].bytes += (int64_t)len;
+    layers_[layer].last_rtp_ms = now_ms;
+}
+
+void simulcast_layers::on_timer(int64_t now_ms) {
+    if (last_bitrate_ms_ < 0) {
+        last_bitrate_ms_ = now_ms;
+        return;
+    }
+    int64_t diff_ms = now_ms - last_bitrate_ms_;
+    if (diff_ms < SIMULCAST_BITRATE_INTERVAL_MS) {
+        return;
+    }
+    last_bitrate_ms_ = now_ms;
+
+    for (simulcast_layer& layer : layers_) {
+        int64_t bitrate = layer.bytes * 8 * 1000 / diff_ms;
+
+        layer.bytes = 0;
+        if (layer.bitrate == 0) {
+            layer.bitrate = bitrate;
+        } else {
+            layer.bitrate += (bitrate - layer.bitrate) / 4;
+        }
+    }
+}
+
+int simulcast_layers::select_layer(int64_t bitrate, int current, int64_t now_ms) {
+    int best   = -1;
+    int lowest = -1;
+
+    for (size_t i = 0; i < layers_.size(); i++) {
+        if (!is_active((int)i, now_ms)) {
+            continue;
+        }
+        int64_t layer_bitrate = layers_[i].bitrate;
+        if ((lowest < 0) || (layer_bitrate < layers_[lowest].bitrate)) {
+            lowest = (int)i;
+        }
+        if ((layer_bitrate <= bitrate) && ((best < 0) || (layer_bitrate > layers_[best].bitrate))) {
+            best = (int)i;
+        }
+    }
+    if (best < 0) {
+        best = lowest;
+    }
+
+    //it goes up when the estimate is over the bitrate of the higher layer,
+    //and goes down only when the estimate is much lower than the current one
+    if ((best >= 0) && is_active(current, now_ms)
+        && (layers_[best].bitrate < layers_[current].bitrate)
+        && (bitrate >= (int64_t)(layers_[current].bitrate * SIMULCAST_DOWNGRADE_RATIO))) {
+        return current;
+    }
+    return best;
+}
+
+int simulcast_layers::get_highest_layer(int64_t now_ms) {
+    int highest = -1;
+
+    for (size_t i = 0; i < layers_.size(); i++) {
+        if (!is_active((int)i, now_ms)) {
+            continue;
+        }
+        if ((highest < 0) || (layers_[i].bitrate > layers_[highest].bitrate)) {
+            highest = (int)i;
+        }
+    }
+    return highest;
+}
+
+bool simulcast_layers::is_keyframe_start(rtp_packet* pkt) {
+    return is_keyframe_start(codec_type_, pkt->get_payload(), pkt->get_payload_length());
+}
+
+bool simulcast_layers::is_keyframe_start(MEDIA_CODEC_TYPE codec_type, const uint8_t* payload, size_t len) {
+    if ((payload == nullptr) || (len == 0)) {
+        return false;
+    }
+    if (codec_type == MEDIA_CODEC_H264) {
+        return is_h264_keyframe_start(payload, len);
+    } else if (codec_type == MEDIA_CODEC_VP8) {
+        return is_vp8_keyframe_start(payload, len);
+    }
+    return false;
+}
+
+bool simulcast_layers::is_h264_keyframe_start(const uint8_t* payload, size_t len) {
+    uint8_t nal_type = payload[0] & 0x1f;
+
+    if (nal_type == H264_NALU_STAPA) {
+        size_t offset = 1;
+        while ((offset + 2) < len) {
+            size_t nalu_len = ((size_t)payload[offset] << 8) | payload[offset + 1];
+            uint8_t type = payload[offset + 2] & 0x1f;
+
+            if ((type == H264_NALU_IDR) || (type == H264_NALU_SPS)) {
+                return true;
+            }
+            offset += 2 + nalu_len;
+        }
+        return false;
+    }
+    if (nal_type == H264_NALU_FUA) {
+        if (len < 2) {
+            return false;
+        }
+        uint8_t type  = payload[1] & 0x1f;
+        bool is_start = (payload[1] & 0x80) != 0;
+
+        return is_start && ((type == H264_NALU_IDR) || (type == H264_NALU_SPS));
+    }
+    return (nal_type == H264_NALU_IDR) || (nal_type == H264_NALU_SPS);
+}
+
+bool simulcast_layers::is_vp8_keyframe_start(const uint8_t* payload, size_t len) {
+    const uint8_t* p    = payload;
+    const uint8_t* pend = payload + len;
+
+    //the start of the first partition: S is set and PID is 0
+    bool extended = (p[0] & 0x80) != 0;
+    if (((p[0] & 0x10) == 0) || ((p[0] & 0x07) != 0)) {
+        return false;
+    }
+    p++;
+
+    if (extended && (p < pend)) {
+        bool pictureid_present = (p[0] & 0x80) != 0;
+        bool tl0picidx_present = (p[0] & 0x40) != 0;
+        bool tid_present       = (p[0] & 0x20) != 0;
+        bool keyidx_present    = (p[0] & 0x10) != 0;
+        p++;
+
+        if (pictureid_present && (p < pend)) {
+            p += (p[0] & 0x80) ? 2 : 1;
+        }
+        if (tl0picidx_present) {
+            p++;
+        }
+        if (tid_present || keyidx_present) {
+            p++;
+        }
+    }
+    if (p >= pend) {
+        return false;
+    }
+    //P: inverse key frame flag in the vp8 payload header
+    return (p[0] & 0x01) == 0;
+}
+
+void simulcast_layers::get_statics(json& json_data, int64_t now_ms) {
+    json_data = json::array();
+
+    for (size_t i = 0; i < layers_.size(); i++) {
+        json layer_json = json::object();
+
+        layer_json["rid"]      = layers_[i].rid;
+        layer_json["ssrc"]     = layers_[i].ssrc;
+        layer_json["rtx_ssrc"] = layers_[i].rtx_ssrc;
+        layer_json["bps"]      = layers_[i].bitrate;
+        layer_json["active"]   = is_active((int)i, now_ms);
+        json_data.push_back(layer_json);
+    }
+}
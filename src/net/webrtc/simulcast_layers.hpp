@@ -0,0 +1,82 @@
+#ifndef SIMULCAST_LAYERS_HPP
+#define SIMULCAST_LAYERS_HPP
+#include "rtc_media_info.hpp"
+#include "net/rtprtcp/rtp_packet.hpp"
+#include "utils/av/av.hpp"
+#include "json.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+#define SIMULCAST_LAYER_TIMEOUT_MS      2000//the layer is stopped when no rtp in the time
+#define SIMULCAST_BITRATE_INTERVAL_MS   1000
+#define SIMULCAST_DOWNGRADE_RATIO       0.8//the current layer is kept over 80% of its bitrate
+
+/*
+the simulcast layers of one video publisher, shared by the publisher and its subscribers.
+the layers are declared by a=rid and a=simulcast without any ssrc, so every layer gets
+its ssrc and rtx ssrc from the rid and the repaired rid extension of its first packets.
+the publisher updates the bitrate of each layer, every subscriber selects the layer
+by its bandwidth estimate and switches to it at the keyframe.
+the layers are compared by the measured bitrate, not by the order of the rids.
+*/
+class simulcast_layers
+{
+public:
+    simulcast_layers(MEDIA_CODEC_TYPE codec_type, const MEDIA_RTC_INFO& media_info);
+    ~simulcast_layers();
+
+public:
+    size_t size() { return layers_.size(); }
+    //return -1 when it isn't found
+    int get_layer_by_rid(const std::string& rid);
+    int get_layer(uint32_t ssrc);
+    int get_rtx_layer(uint32_t ssrc);
+
+    void set_ssrc(int layer, uint32_t ssrc);
+    void set_rtx_ssrc(int layer, uint32_t ssrc);
+    uint32_t get_ssrc(int layer);
+    uint32_t get_rtx_ssrc(int layer);
+    std::string get_rid(int layer);
+    int64_t get_bitrate(int layer);
+    bool is_active(int layer, int64_t now_ms);
+
+    void on_rtp(int layer, size_t len, int64_t now_ms);
+    void on_timer(int64_t now_ms);
+
+    //the highest layer under the bitrate, or the lowest layer when all are over it
+    int select_layer(int64_t bitrate, int current, int64_t now_ms);
+    int get_highest_layer(int64_t now_ms);
+
+    //the first packet of the keyframe, the subscriber can switch to the layer from it
+    bool is_keyframe_start(rtp_packet* pkt);
+    static bool is_keyframe_start(MEDIA_CODEC_TYPE codec_type, const uint8_t* payload, size_t len);
+
+    void get_statics(json& json_data, int64_t now_ms);
+
+private:
+    static bool is_h264_keyframe_start(const uint8_t* payload, size_t len);
+    static bool is_vp8_keyframe_start(const uint8_t* payload, size_t len);
+
+private:
+    class simulcast_layer
+    {
+    public:
+        std::string rid;
+        uint32_t ssrc       = 0;
+        uint32_t rtx_ssrc   = 0;
+        int64_t bytes       = 0;//in the bitrate interval
+        int64_t bitrate     = 0;
+        int64_t last_rtp_ms = -1;
+    };
+
+private:
+    MEDIA_CODEC_TYPE codec_type_ = MEDIA_CODEC_UNKOWN;
+    std::vector<simulcast_layer> layers_;
+    int64_t last_bitrate_ms_ = -1;
+};
+
+#endif
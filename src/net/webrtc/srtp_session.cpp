@@ -236,6 +236,30 @@ bool srtp_session::encrypt_rtcp(uint8_t** data, size_t* len) {
     return true;
 }
 
+bool srtp_session::encrypt_rtp_in_place(uint8_t* data, size_t* len) {
+    int data_len = (int)*len;
+    srtp_err_status_t err = srtp_protect(session_, (void*)data, &data_len);
+
+    if (err != srtp_err_status_ok) {
+        log_errorf("srtp_protect error: %s", srtp_session::errors.at(err));
+        return false;
+    }
+    *len = (size_t)data_len;
+    return true;
+}
+
+bool srtp_session::encrypt_rtcp_in_place(uint8_t* data, size_t* len) {
+    int data_len = (int)*len;
+    srtp_err_status_t err = srtp_protect_rtcp(session_, (void*)data, &data_len);
+
+    if (err != srtp_err_status_ok) {
+        log_errorf("srtp_protect_rtcp error: %s", srtp_session::errors.at(err));
+        return false;
+    }
+    *len = (size_t)data_len;
+    return true;
+}
+
 bool srtp_session::decrypt_srtcp(uint8_t* data, size_t* len) {
     srtp_err_status_t err = srtp_unprotect_rtcp(session_, (void*)(data), (int*)(len));
     if (err != srtp_err_status_ok) {
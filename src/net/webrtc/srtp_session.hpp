@@ -46,6 +46,9 @@ public:
     bool decrypt_srtp(uint8_t* data, size_t* len);
     bool encrypt_rtcp(uint8_t** data, size_t* len);
     bool decrypt_srtcp(uint8_t* data, size_t* len);
+    //encrypted in the buffer of the caller, it must have SRTP_MAX_TRAILER_LEN(+4 for rtcp) bytes left
+    bool encrypt_rtp_in_place(uint8_t* data, size_t* len);
+    bool encrypt_rtcp_in_place(uint8_t* data, size_t* len);
     void remove_stream(uint32_t ssrc);
 
 private:
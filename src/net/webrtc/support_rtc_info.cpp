@@ -28,6 +28,11 @@ static RTCP_FB support_rtcp_fb_list[] = {
         .type = "nack",
         .subtype = "pli"
     },
+    {
+        .payload = 0,
+        .type = "transport-cc",
+        .subtype = ""
+    },
 };
 
 static HEADER_EXT support_header_ext_list[] = {
@@ -38,6 +43,18 @@ static HEADER_EXT support_header_ext_list[] = {
     {
         .uri = "http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time",
         .value = 0
+    },
+    {
+        .uri = RTP_EXT_TWCC_URI,
+        .value = 0
+    },
+    {
+        .uri = RTP_EXT_RID_URI,
+        .value = 0
+    },
+    {
+        .uri = RTP_EXT_REPAIRED_RID_URI,
+        .value = 0
     }
 };
 
@@ -48,6 +65,12 @@ static RTP_ENCODING support_rtp_encoding_list[] = {
         .clock_rate = 90000,
         .media_type = MEDIA_VIDEO_TYPE
     },
+    {
+        .codec = "VP9",
+        .payload = 0,
+        .clock_rate = 90000,
+        .media_type = MEDIA_VIDEO_TYPE
+    },
     {
         .codec = "H264",
         .payload = 0,
@@ -89,6 +112,10 @@ static FMTP support_fmtp_list[] = {
         .config  = "x-google-start-bitrate",
         .payload = 0
     },
+    {
+        .config  = "profile-id=0",
+        .payload = 0
+    },
     {
         .config  = "profile-level-id=42e01f;level-asymmetry-allowed=1;packetization-mode=1",
         .payload = 0
@@ -136,6 +163,11 @@ static RTCP_FB support_rtcp_fb_list[] = {
 		"nack",
 		"pli"
 	},
+	{
+		0,
+		"transport-cc",
+		""
+	},
 };
 static HEADER_EXT support_header_ext_list[] = {
 	{
@@ -145,6 +177,18 @@ static HEADER_EXT support_header_ext_list[] = {
 	{
 		"http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time",
 		 0
+	},
+	{
+		RTP_EXT_TWCC_URI,
+		 0
+	},
+	{
+		RTP_EXT_RID_URI,
+		 0
+	},
+	{
+		RTP_EXT_REPAIRED_RID_URI,
+		 0
 	}
 };
 
@@ -156,6 +200,13 @@ static RTP_ENCODING support_rtp_encoding_list[] = {
 		"",				//encoding
 		MEDIA_VIDEO_TYPE //media_type
 	},
+	{
+		"VP9",
+		0,
+		90000,
+		"",
+		MEDIA_VIDEO_TYPE
+	},
 	{
 		"H264",
 		0,
@@ -200,6 +251,10 @@ static FMTP support_fmtp_list[] = {
 		"x-google-start-bitrate",
 		0
 	},
+	{
+		"profile-id=0",
+		0
+	},
 	{
 		"profile-level-id=42e01f;level-asymmetry-allowed=1;packetization-mode=1",
 		0
@@ -331,10 +386,13 @@ static void get_support_ssrc_info(const std::vector<SSRC_INFO>& input_ssrc_infos
 }
 
 static void get_support_rtcp_fb(const std::vector<RTCP_FB>& input_rtcp_fbs,
-        std::vector<RTCP_FB>& support_rtcp_fbs) {
+        std::vector<RTCP_FB>& support_rtcp_fbs, bool twcc_enable) {
 
     for (auto input_fb : input_rtcp_fbs) {
         bool found = false;
+        if (!twcc_enable && (input_fb.type == "transport-cc")) {
+            continue;
+        }
         for (size_t index = 0; index < sizeof(support_rtcp_fb_list)/sizeof(RTCP_FB); index++) {
             if (input_fb.type == support_rtcp_fb_list[index].type) {
                 if (input_fb.subtype.empty()) {
@@ -355,9 +413,15 @@ static void get_support_rtcp_fb(const std::vector<RTCP_FB>& input_rtcp_fbs,
 }
 
 static void get_support_header_ext(const std::vector<HEADER_EXT>& input_header_exts,
-            std::vector<HEADER_EXT>& support_header_ext) {
+            std::vector<HEADER_EXT>& support_header_ext, bool twcc_enable, bool simulcast_enable) {
     for (auto ext : input_header_exts) {
         bool found = false;
+        if (!twcc_enable && (ext.uri == RTP_EXT_TWCC_URI)) {
+            continue;
+        }
+        if (!simulcast_enable && ((ext.uri == RTP_EXT_RID_URI) || (ext.uri == RTP_EXT_REPAIRED_RID_URI))) {
+            continue;
+        }
         for (size_t i = 0; i < sizeof(support_header_ext_list)/sizeof(HEADER_EXT); i++) {
             if (support_header_ext_list[i].uri == ext.uri) {
                 found = true;
@@ -413,12 +477,12 @@ static void get_support_rtp_encoding(const std::vector<RTP_ENCODING>& input_rtp_
     return;
 }
 
-static void filter_fmts_and_encs_by_h264payload(std::vector<FMTP>& support_input_fmtps,
+static void filter_fmts_and_encs_by_payload(std::vector<FMTP>& support_input_fmtps,
                             std::vector<RTP_ENCODING>& support_rtp_encodings,
-                            int h264_payload, int h264_apt_payload) {
+                            int codec_payload, int apt_payload) {
     for (std::vector<FMTP>::iterator iter = support_input_fmtps.begin();
         iter != support_input_fmtps.end();) {
-        if ((iter->payload != h264_payload) && (iter->payload != h264_apt_payload)) {
+        if ((iter->payload != codec_payload) && (iter->payload != apt_payload)) {
             //log_infof("remove payload:%d frome fmtps", iter->payload);
             iter = support_input_fmtps.erase(iter);
         } else {
@@ -428,7 +492,7 @@ static void filter_fmts_and_encs_by_h264payload(std::vector<FMTP>& support_input
 
     for (std::vector<RTP_ENCODING>::iterator iter = support_rtp_encodings.begin();
         iter != support_rtp_encodings.end();) {
-        if ((iter->payload != h264_payload) && (iter->payload != h264_apt_payload)) {
+        if ((iter->payload != codec_payload) && (iter->payload != apt_payload)) {
             //log_infof("remove payload:%d frome rtp encodings", iter->payload);
             iter = support_rtp_encodings.erase(iter);
         } else {
@@ -438,6 +502,51 @@ static void filter_fmts_and_encs_by_h264payload(std::vector<FMTP>& support_input
     return;
 }
 
+//vp9 is used only when it's the first video codec of the offer, eg: by setCodecPreferences,
+//otherwise h264 is preferred for rtmp. only the profile 0 is supported
+static bool vp9_payload_preferred(const std::vector<int>& payloads,
+                            const std::vector<FMTP>& input_fmtps,
+                            const std::vector<RTP_ENCODING>& support_rtp_encodings,
+                            int& vp9_payload, int& apt_payload) {
+    std::string first_codec;
+    vp9_payload = 0;
+
+    for (int payload : payloads) {
+        for (const auto& enc_item : support_rtp_encodings) {
+            if ((enc_item.payload != payload) || (enc_item.media_type != MEDIA_VIDEO_TYPE)) {
+                continue;
+            }
+            if (first_codec.empty()) {
+                first_codec = enc_item.codec;
+            }
+            if ((enc_item.codec != "VP9") || (vp9_payload != 0)) {
+                continue;
+            }
+            bool profile0 = true;
+            for (const auto& fmtp_item : input_fmtps) {
+                if ((fmtp_item.payload == payload) && (fmtp_item.config.find("profile-id=0") == std::string::npos)) {
+                    profile0 = false;
+                }
+            }
+            if (profile0) {
+                vp9_payload = payload;
+            }
+        }
+    }
+    if ((first_codec != "VP9") || (vp9_payload == 0)) {
+        return false;
+    }
+
+    apt_payload = 0;
+    for (const auto& fmtp_item : input_fmtps) {
+        if (get_apt_payload(fmtp_item.config) == vp9_payload) {
+            apt_payload = fmtp_item.payload;
+            break;
+        }
+    }
+    return true;
+}
+
 static bool filter_fmts_and_encs_by_vp8(std::vector<FMTP>& support_input_fmtps,
                             std::vector<RTP_ENCODING>& support_rtp_encodings) {
     int vp8_payload = 0;
@@ -569,6 +678,24 @@ static void filter_enc_by_fmts(std::vector<RTP_ENCODING>& support_rtp_encodings,
 }
 */
 
+//answer the rids sent by the publisher in the receive direction
+static void get_support_simulcast(const MEDIA_RTC_INFO& input_info, MEDIA_RTC_INFO& support_info) {
+    for (auto rid : input_info.rids) {
+        if (rid.direction != "send") {
+            continue;
+        }
+        rid.direction = "recv";
+        support_info.rids.push_back(rid);
+    }
+    if (support_info.rids.empty()) {
+        return;
+    }
+    if (input_info.simulcast.direction == "send") {
+        support_info.simulcast.direction = "recv";
+        support_info.simulcast.list      = input_info.simulcast.list;
+    }
+}
+
 void get_support_rtc_media(const rtc_media_info& input, rtc_media_info& support_rtc_media) {
     support_rtc_media.version = input.version;
     support_rtc_media.extmap_allow_mixed = input.extmap_allow_mixed;
@@ -589,6 +716,11 @@ void get_support_rtc_media(const rtc_media_info& input, rtc_media_info& support_
         support_rtc_media.direction_type = SEND_RECV;
     }
 
+    //only the subscribers are estimated by the transport-cc feedback, the publishers keep the remb
+    bool twcc_enable = (input.direction_type != SEND_ONLY);
+    //only the publishers send the simulcast layers
+    bool simulcast_enable = (input.direction_type == SEND_ONLY);
+
     for (auto rtc_info : input.medias) {
         MEDIA_RTC_INFO support_rtc_info;
 
@@ -606,8 +738,9 @@ void get_support_rtc_media(const rtc_media_info& input, rtc_media_info& support_
         support_rtc_info.protocol = rtc_info.protocol;
         support_rtc_info.payloads = rtc_info.payloads;
 
-        get_support_header_ext(rtc_info.header_extentions, support_rtc_info.header_extentions);
-        get_support_rtcp_fb(rtc_info.rtcp_fbs, support_rtc_info.rtcp_fbs);
+        get_support_header_ext(rtc_info.header_extentions, support_rtc_info.header_extentions,
+                            twcc_enable, simulcast_enable);
+        get_support_rtcp_fb(rtc_info.rtcp_fbs, support_rtc_info.rtcp_fbs, twcc_enable);
         get_support_ssrc_info(rtc_info.ssrc_infos, support_rtc_info.ssrc_infos);
         get_support_rtp_encoding(rtc_info.rtp_encodings,
                                 support_rtc_info.rtp_encodings);
@@ -627,11 +760,18 @@ void get_support_rtc_media(const rtc_media_info& input, rtc_media_info& support_
         if (support_rtc_info.media_type == "video") {
             int h264_payload     = 0;
             int h264_apt_payload = 0;
+            int vp9_payload      = 0;
+            int vp9_apt_payload  = 0;
             bool has_h264profile = fmtp_has_h264profile(support_rtc_info.fmtps,
                                                 h264_payload, h264_apt_payload);
-            if (has_h264profile && (h264_payload > 0) && (h264_apt_payload > 0)) {
+            if (vp9_payload_preferred(rtc_info.payloads, rtc_info.fmtps,
+                                    support_rtc_info.rtp_encodings, vp9_payload, vp9_apt_payload)) {
+                filter_fmts_and_encs_by_payload(support_rtc_info.fmtps,
+                                                support_rtc_info.rtp_encodings,
+                                                vp9_payload, vp9_apt_payload);
+            } else if (has_h264profile && (h264_payload > 0) && (h264_apt_payload > 0)) {
                 //log_infof("h264 payload:%d, apt payload:%d", h264_payload, h264_apt_payload);
-                filter_fmts_and_encs_by_h264payload(support_rtc_info.fmtps,
+                filter_fmts_and_encs_by_payload(support_rtc_info.fmtps,
                                                 support_rtc_info.rtp_encodings,
                                                 h264_payload, h264_apt_payload);
             } else {
@@ -655,6 +795,9 @@ void get_support_rtc_media(const rtc_media_info& input, rtc_media_info& support_
         if (!rtc_info.ssrc_groups.empty()) {
             support_rtc_info.ssrc_groups = rtc_info.ssrc_groups;
         }
+        if (simulcast_enable && (support_rtc_info.media_type == "video")) {
+            get_support_simulcast(rtc_info, support_rtc_info);
+        }
         support_rtc_media.medias.push_back(support_rtc_info);
     }
     support_rtc_media.filter_payloads();
@@ -843,6 +986,24 @@ void rtc_media_info_to_json(const rtc_media_info& input, json& sdp_json) {
             media_json["ext"].push_back(ext_object);
         }
 
+        if (!media_info.rids.empty()) {
+            media_json["rids"] = json::array();
+            for (const auto& rid : media_info.rids) {
+                json rid_json = json::object();
+                rid_json["id"]        = rid.id;
+                rid_json["direction"] = rid.direction;
+                if (!rid.params.empty()) {
+                    rid_json["params"] = rid.params;
+                }
+                media_json["rids"].push_back(rid_json);
+            }
+        }
+        if (!media_info.simulcast.list.empty()) {
+            media_json["simulcast"] = json::object();
+            media_json["simulcast"]["dir1"]  = media_info.simulcast.direction;
+            media_json["simulcast"]["list1"] = media_info.simulcast.list;
+        }
+
         media_json["ssrcs"] = json::array();
         for (const auto& ssrc_info : media_info.ssrc_infos) {
             json ssrc_object = json::object();
@@ -0,0 +1,254 @@
+#include "svc_layer_filter.hpp"
+#include "logger.hpp"
+#include <cstring>
+
+svc_layer_filter::svc_layer_filter(MEDIA_CODEC_TYPE codec_type):codec_type_(codec_type)
+{
+    seq_items_.resize(SVC_SEQ_HISTORY_SIZE);
+    memset(layer_bytes_, 0, sizeof(layer_bytes_));
+    memset(layer_bitrate_, 0, sizeof(layer_bitrate_));
+}
+
+svc_layer_filter::~svc_layer_filter()
+{
+}
+
+bool svc_layer_filter::parse_vp9_descriptor(const uint8_t* payload, size_t len, VP9_PAYLOAD_DESC& desc) {
+    const uint8_t* p    = payload;
+    const uint8_t* pend = payload + len;
+
+    if ((payload == nullptr) || (len == 0)) {
+        return false;
+    }
+    bool picture_id_present = (p[0] & 0x80) != 0;
+    bool layer_present      = (p[0] & 0x20) != 0;
+
+    desc.inter_picture = (p[0] & 0x40) != 0;
+    desc.flexible      = (p[0] & 0x10) != 0;
+    desc.begin_frame   = (p[0] & 0x08) != 0;
+    desc.end_frame     = (p[0] & 0x04) != 0;
+    desc.ss_present    = (p[0] & 0x02) != 0;
+    p++;
+
+    if (picture_id_present) {
+        if (p >= pend) {
+            return false;
+        }
+        if (p[0] & 0x80) {
+            if ((p + 1) >= pend) {
+                return false;
+            }
+            desc.picture_id = ((p[0] & 0x7f) << 8) | p[1];
+            p += 2;
+        } else {
+            desc.picture_id = p[0] & 0x7f;
+            p++;
+        }
+    }
+
+    if (layer_present) {
+        if (p >= pend) {
+            return false;
+        }
+        desc.temporal_id  = (p[0] >> 5) & 0x07;
+        desc.switching_up = (p[0] & 0x10) != 0;
+        desc.spatial_id   = (p[0] >> 1) & 0x07;
+        desc.inter_layer  = (p[0] & 0x01) != 0;
+        p++;
+
+        if (!desc.flexible) {
+            if (p >= pend) {
+                return false;
+            }
+            desc.tl0_pic_idx = p[0];
+            p++;
+        }
+    }
+    //the reference indices and the scalability structure aren't needed by the filter
+    return true;
+}
+
+bool svc_layer_filter::filter(rtp_packet* pkt, uint16_t& seq, bool& marker, bool& padding) {
+    VP9_PAYLOAD_DESC desc;
+
+    padding = false;
+    if (!parse_vp9_descriptor(pkt->get_payload(), pkt->get_payload_length(), desc)) {
+        //the packet without the payload, eg: padding
+        return rewrite_seq(seq, false, seq, padding);
+    }
+    int sid = desc.spatial_id;
+    int tid = desc.temporal_id;
+
+    layer_bytes_[sid][tid] += pkt->get_data_length();
+    max_spatial_  = (sid > max_spatial_) ? sid : max_spatial_;
+    max_temporal_ = (tid > max_temporal_) ? tid : max_temporal_;
+
+    //the layers are changed at the start of the picture, not by the late packet
+    bool is_new = !seq_started_ || ((int16_t)(seq - max_seq_) > 0);
+    if (is_new && desc.begin_frame && (sid == 0)) {
+        if (target_spatial_ < current_spatial_) {
+            current_spatial_ = target_spatial_;
+        } else if ((target_spatial_ > current_spatial_) && !desc.inter_picture) {
+            current_spatial_ = target_spatial_;
+        }
+        if (target_temporal_ < current_temporal_) {
+            current_temporal_ = target_temporal_;
+        } else if ((target_temporal_ > current_temporal_) && (tid == 0)) {
+            current_temporal_ = target_temporal_;
+        }
+    }
+
+    bool drop = (sid > current_spatial_) || (tid > current_temporal_);
+    if (!rewrite_seq(seq, drop, seq, padding)) {
+        return false;
+    }
+    if (padding) {
+        marker = false;
+        return true;
+    }
+    //the higher spatial layers which have the marker are dropped
+    marker = pkt->get_marker() || (desc.end_frame && (sid == current_spatial_));
+    return true;
+}
+
+void svc_layer_filter::save_seq(uint16_t seq, bool dropped) {
+    seq_item& item = seq_items_[seq & (SVC_SEQ_HISTORY_SIZE - 1)];
+
+    item.seq     = seq;
+    item.offset  = offset_;
+    item.dropped = dropped;
+}
+
+bool svc_layer_filter::rewrite_seq(uint16_t seq, bool drop, uint16_t& out_seq, bool& padding) {
+    if (!seq_started_) {
+        seq_started_ = true;
+        max_seq_     = seq - 1;
+    }
+    int16_t diff = (int16_t)(seq - max_seq_);
+
+    if (diff > 0) {
+        if (diff > SVC_SEQ_HISTORY_SIZE) {
+            max_seq_ = seq - SVC_SEQ_HISTORY_SIZE;
+        }
+        //the lost seqs are expected to be sent when they come late
+        for (uint16_t lost_seq = max_seq_ + 1; lost_seq != seq; lost_seq++) {
+            save_seq(lost_seq, false);
+        }
+        max_seq_ = seq;
+
+        if (drop) {
+            offset_++;
+            drop_count_++;
+            save_seq(seq, true);
+            return false;
+        }
+        save_seq(seq, false);
+        out_seq = seq - offset_;
+        return true;
+    }
+
+    //the late packet takes the seq reserved for it
+    seq_item& item = seq_items_[seq & (SVC_SEQ_HISTORY_SIZE - 1)];
+    if ((item.seq != (int32_t)seq) || item.dropped) {
+        return false;
+    }
+    out_seq = seq - item.offset;
+    if (drop) {
+        //the receiver waits for the reserved seq, it's filled by the padding only once
+        item.dropped = true;
+        padding = true;
+        drop_count_++;
+    }
+    return true;
+}
+
+void svc_layer_filter::on_timer(int64_t now_ms) {
+    if (last_bitrate_ms_ < 0) {
+        last_bitrate_ms_ = now_ms;
+        return;
+    }
+    int64_t diff_ms = now_ms - last_bitrate_ms_;
+    if (diff_ms < SVC_BITRATE_INTERVAL_MS) {
+        return;
+    }
+    last_bitrate_ms_ = now_ms;
+
+    for (int sid = 0; sid < SVC_LAYER_MAX; sid++) {
+        for (int tid = 0; tid < SVC_LAYER_MAX; tid++) {
+            int64_t bitrate = layer_bytes_[sid][tid] * 8 * 1000 / diff_ms;
+
+            layer_bytes_[sid][tid] = 0;
+            if (layer_bitrate_[sid][tid] == 0) {
+                layer_bitrate_[sid][tid] = bitrate;
+            } else {
+                layer_bitrate_[sid][tid] += (bitrate - layer_bitrate_[sid][tid]) / 4;
+            }
+        }
+    }
+}
+
+int64_t svc_layer_filter::get_layers_bitrate(int spatial_id, int temporal_id) {
+    int64_t bitrate = 0;
+
+    for (int sid = 0; sid <= spatial_id; sid++) {
+        for (int tid = 0; tid <= temporal_id; tid++) {
+            bitrate += layer_bitrate_[sid][tid];
+        }
+    }
+    return bitrate;
+}
+
+bool svc_layer_filter::select_layers(int64_t bitrate) {
+    if (get_layers_bitrate(max_spatial_, max_temporal_) <= 0) {
+        return false;
+    }
+    int best_spatial    = 0;
+    int best_temporal   = 0;
+    int64_t best_bitrate = -1;
+
+    for (int sid = 0; sid <= max_spatial_; sid++) {
+        for (int tid = 0; tid <= max_temporal_; tid++) {
+            int64_t layers_bitrate = get_layers_bitrate(sid, tid);
+            if ((layers_bitrate <= bitrate) && (layers_bitrate >= best_bitrate)) {
+                best_spatial  = sid;
+                best_temporal = tid;
+                best_bitrate  = layers_bitrate;
+            }
+        }
+    }
+    if (best_bitrate < 0) {
+        best_bitrate = get_layers_bitrate(0, 0);
+    }
+
+    //the current layers are kept until the bitrate is much lower than them
+    int current_spatial  = (current_spatial_ < max_spatial_) ? current_spatial_ : max_spatial_;
+    int current_temporal = (current_temporal_ < max_temporal_) ? current_temporal_ : max_temporal_;
+    int64_t current_bitrate = get_layers_bitrate(current_spatial, current_temporal);
+    if ((best_bitrate < current_bitrate) && (bitrate >= (int64_t)(current_bitrate * SVC_DOWNGRADE_RATIO))) {
+        best_spatial  = current_spatial;
+        best_temporal = current_temporal;
+    }
+
+    set_target_layers(best_spatial, best_temporal);
+    return target_spatial_ > current_spatial;
+}
+
+void svc_layer_filter::set_target_layers(int spatial_id, int temporal_id) {
+    if ((spatial_id == target_spatial_) && (temporal_id == target_temporal_)) {
+        return;
+    }
+    log_infof("svc layer filter target spatial:%d, temporal:%d, current spatial:%d, temporal:%d, bitrate:%ld",
+        spatial_id, temporal_id, current_spatial_, current_temporal_, get_layers_bitrate(spatial_id, temporal_id));
+    target_spatial_  = spatial_id;
+    target_temporal_ = temporal_id;
+}
+
+void svc_layer_filter::get_statics(json& json_data) {
+    json_data["codec"]    = codectype_tostring(codec_type_);
+    json_data["spatial"]  = (current_spatial_ < max_spatial_) ? current_spatial_ : max_spatial_;
+    json_data["temporal"] = (current_temporal_ < max_temporal_) ? current_temporal_ : max_temporal_;
+    json_data["target_spatial"]  = (target_spatial_ < max_spatial_) ? target_spatial_ : max_spatial_;
+    json_data["target_temporal"] = (target_temporal_ < max_temporal_) ? target_temporal_ : max_temporal_;
+    json_data["dropped"]  = drop_count_;
+    json_data["bps"]      = get_layers_bitrate(max_spatial_, max_temporal_);
+}
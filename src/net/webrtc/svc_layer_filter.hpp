@@ -0,0 +1,111 @@
+#ifndef SVC_LAYER_FILTER_HPP
+#define SVC_LAYER_FILTER_HPP
+#include "net/rtprtcp/rtp_packet.hpp"
+#include "utils/av/av.hpp"
+#include "json.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+using json = nlohmann::json;
+
+#define SVC_LAYER_MAX              8//the spatial and temporal ids are 3 bits
+#define SVC_SEQ_HISTORY_SIZE       1024//power of 2, the seqs waiting for the late packets
+#define SVC_BITRATE_INTERVAL_MS    1000
+#define SVC_DOWNGRADE_RATIO        0.8
+
+/*
+rfc9628: the vp9 payload descriptor
+     0 1 2 3 4 5 6 7
+    +-+-+-+-+-+-+-+-+
+    |I|P|L|F|B|E|V|Z| (REQUIRED)
+    +-+-+-+-+-+-+-+-+
+I:  |M| PICTURE ID  | (REQUIRED)
+    +-+-+-+-+-+-+-+-+
+M:  | EXTENDED PID  | (RECOMMENDED)
+    +-+-+-+-+-+-+-+-+
+L:  |  TID  |U| SID |D| (CONDITIONALLY RECOMMENDED)
+    +-+-+-+-+-+-+-+-+
+    |   TL0PICIDX   | (CONDITIONALLY REQUIRED, non-flexible mode)
+    +-+-+-+-+-+-+-+-+
+*/
+typedef struct VP9_PAYLOAD_DESC_S
+{
+    bool inter_picture = false;//P
+    bool flexible      = false;//F
+    bool begin_frame   = false;//B
+    bool end_frame     = false;//E
+    bool ss_present    = false;//V
+    int picture_id     = -1;
+    int temporal_id    = 0;
+    bool switching_up  = false;//U
+    int spatial_id     = 0;
+    bool inter_layer   = false;//D
+    int tl0_pic_idx    = -1;
+} VP9_PAYLOAD_DESC;
+
+/*
+the svc layer filter of one subscriber, it's in front of rtp_send_stream.
+the spatial and temporal layers over the target of the subscriber are dropped
+from the packets of the publisher, so the viewers get the layers fit for them
+from one encoding without transcoding.
+the seqs are rewritten without the dropped packets, the marker is set at the end
+of the highest spatial layer sent. the temporal layer is switched up at the base
+temporal layer, and the spatial layer is switched up at the keyframe.
+*/
+class svc_layer_filter
+{
+public:
+    svc_layer_filter(MEDIA_CODEC_TYPE codec_type);
+    ~svc_layer_filter();
+
+public:
+    static bool parse_vp9_descriptor(const uint8_t* payload, size_t len, VP9_PAYLOAD_DESC& desc);
+
+public:
+    //return false when the packet is dropped, the seq and marker are rewritten for the subscriber.
+    //padding: the late packet is dropped, but its seq was reserved, a padding only packet fills it
+    bool filter(rtp_packet* pkt, uint16_t& seq, bool& marker, bool& padding);
+    void on_timer(int64_t now_ms);
+    //select the layers under the bitrate, return true when it waits for the keyframe to go up
+    bool select_layers(int64_t bitrate);
+    void set_target_layers(int spatial_id, int temporal_id);
+    void get_statics(json& json_data);
+
+private:
+    bool rewrite_seq(uint16_t seq, bool drop, uint16_t& out_seq, bool& padding);
+    void save_seq(uint16_t seq, bool dropped);
+    int64_t get_layers_bitrate(int spatial_id, int temporal_id);
+
+private:
+    class seq_item
+    {
+    public:
+        int32_t seq     = -1;
+        uint16_t offset = 0;
+        bool dropped    = false;
+    };
+
+private:
+    MEDIA_CODEC_TYPE codec_type_ = MEDIA_CODEC_UNKOWN;
+    int current_spatial_  = SVC_LAYER_MAX - 1;//all the layers are sent before the first selection
+    int current_temporal_ = SVC_LAYER_MAX - 1;
+    int target_spatial_   = SVC_LAYER_MAX - 1;
+    int target_temporal_  = SVC_LAYER_MAX - 1;
+
+private://the seqs without the dropped packets
+    std::vector<seq_item> seq_items_;
+    bool seq_started_ = false;
+    uint16_t max_seq_ = 0;
+    uint16_t offset_  = 0;
+    int64_t drop_count_ = 0;
+
+private://the bitrate of each layer from the publisher
+    int64_t layer_bytes_[SVC_LAYER_MAX][SVC_LAYER_MAX];
+    int64_t layer_bitrate_[SVC_LAYER_MAX][SVC_LAYER_MAX];
+    int max_spatial_      = 0;
+    int max_temporal_     = 0;
+    int64_t last_bitrate_ms_ = -1;
+};
+
+#endif
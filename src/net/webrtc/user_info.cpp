@@ -209,6 +209,7 @@ void user_info::on_rtmp_camera_callback(MEDIA_PACKET_PTR pkt_ptr) {
     if (pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE) {
         if (!trans_) {
             trans_ = new transcode();
+            trans_->set_name(roomId_ + "/" + uid_);
             trans_->set_output_audio_fmt("libfdk_aac");
             trans_->set_output_format(MEDIA_FORMAT_FLV);
             trans_->set_output_audio_samplerate(44100);
@@ -270,10 +271,24 @@ live_user_info::live_user_info(const std::string& uid,
                                                  , room_cb_(room_callbacl_p)
 {
     active_last_ms_ = now_millisec();
+    video_pid_ = uid_ + "_video";
+    audio_pid_ = uid_ + "_audio";
 }
 
 live_user_info::~live_user_info()
 {
+    stop_bridge();
+}
+
+void live_user_info::start_bridge() {
+    bridge_active_  = true;
+    bridge_idle_ms_ = -1;
+}
+
+void live_user_info::stop_bridge() {
+    bridge_active_  = false;
+    bridge_idle_ms_ = -1;
+    //the transcode is made again with the audio sequence header in the gop cache
     if (trans_) {
         trans_->stop();
         delete trans_;
@@ -308,10 +323,6 @@ void live_user_info::updata_pps(uint8_t* pps, size_t pps_len) {
 int live_user_info::handle_video_data(MEDIA_PACKET_PTR pkt_ptr) {
     int ret = 0;
 
-    std::string publisher_id = uid_;
-    publisher_id += "_";
-    publisher_id += "video";
-
     if (pkt_ptr->codec_type_ == MEDIA_CODEC_H264) {
         uint8_t sps[1024];
         uint8_t pps[1024];
@@ -319,9 +330,7 @@ int live_user_info::handle_video_data(MEDIA_PACKET_PTR pkt_ptr) {
         size_t pps_len = 0;
         uint8_t* p = (uint8_t*)pkt_ptr->buffer_ptr_->data() + 5;
         size_t data_len = pkt_ptr->buffer_ptr_->data_len() - 5;
-        std::vector<std::shared_ptr<data_buffer>> nalus;
 
-        active_last_ms_ = now_millisec();
         //update h264 sps/pps
         if (pkt_ptr->is_seq_hdr_) {
             ret = get_sps_pps_from_extradata(pps, pps_len,
@@ -342,18 +351,27 @@ int live_user_info::handle_video_data(MEDIA_PACKET_PTR pkt_ptr) {
             return ret;
         }
 
-        bool ok = annexb_to_nalus(p, data_len, nalus);
-        if (!ok) {
-            log_errorf("annexb to nalus error, data len:%lu", data_len);
-            return -1;
-        }
-
-        for (auto& buffer_ptr : nalus) {
-            uint8_t* data = (uint8_t*)buffer_ptr->data() + 4;
-            int64_t data_len = buffer_ptr->data_len() - 4;
+        //the rtp packets of the frame are made once in the arena by walking the avcc nalus,
+        //then all the subscribers send the same packets
+        rtp_arena_.reset();
+        while (data_len > 0) {
+            if (data_len < 4) {
+                log_errorf("avcc nalu error, left data len:%lu", data_len);
+                return -1;
+            }
+            size_t nalu_len = read_4bytes(p);
+            p        += 4;
+            data_len -= 4;
+            if ((nalu_len == 0) || (nalu_len > data_len)) {
+                log_errorf("avcc nalu len error, nalu len:%lu, left data len:%lu", nalu_len, data_len);
+                return -1;
+            }
+            uint8_t* data = p;
+            p        += nalu_len;
+            data_len -= nalu_len;
 
             if ((data[0] & 0x1f) == kSps) {
-                updata_sps(data, data_len);
+                updata_sps(data, nalu_len);
                 continue;
             }
             if ((data[0] & 0x1f) == kPps) {
@@ -374,31 +392,27 @@ int live_user_info::handle_video_data(MEDIA_PACKET_PTR pkt_ptr) {
     
                 data_vec.push_back({sps_.data(), sps_.size()});
                 data_vec.push_back({pps_.data(), pps_.size()});
-                rtp_packet* sps_pps_pkt = generate_stapA_packets(data_vec);
-                sps_pps_pkt->set_seq(vseq_++);
-                sps_pps_pkt->set_ssrc(video_ssrc_);
-                sps_pps_pkt->set_timestamp((uint32_t)pkt_ptr->dts_);
-                room_cb_->on_rtppacket_publisher2room(publisher_id, "video", sps_pps_pkt);
+                generate_stapA_packets(rtp_arena_, data_vec);
             }
 
-            if (data_len > RTP_PAYLOAD_MAX_SIZE) {
-                std::vector<rtp_packet*> fuA_vec = generate_fuA_packets(data, data_len);
-                for (auto fuA_pkt : fuA_vec) {
-                    fuA_pkt->set_seq(vseq_++);
-                    fuA_pkt->set_ssrc(video_ssrc_);
-                    fuA_pkt->set_timestamp((uint32_t)pkt_ptr->dts_);
-                    room_cb_->on_rtppacket_publisher2room(publisher_id, "video", fuA_pkt);
-                }
-                fuA_vec.clear();
+            if (nalu_len > RTP_PAYLOAD_MAX_SIZE) {
+                generate_fuA_packets(rtp_arena_, data, nalu_len);
             } else {
-                rtp_packet* single_pkt = generate_singlenalu_packets(data, data_len);
-                single_pkt->set_seq(vseq_++);
-                single_pkt->set_ssrc(video_ssrc_);
-                single_pkt->set_marker(1);
-                single_pkt->set_timestamp((uint32_t)pkt_ptr->dts_);
-                room_cb_->on_rtppacket_publisher2room(publisher_id, "video", single_pkt);
+                generate_singlenalu_packets(rtp_arena_, data, nalu_len);
             }
         }
+
+        size_t count = rtp_arena_.size();
+        for (size_t index = 0; index < count; index++) {
+            rtp_packet* pkt = rtp_arena_.at(index);
+
+            pkt->set_seq(vseq_++);
+            pkt->set_ssrc(video_ssrc_);
+            pkt->set_timestamp((uint32_t)pkt_ptr->dts_);
+            //only the last packet of the frame has the marker
+            pkt->set_marker((index == count - 1) ? 1 : 0);
+            room_cb_->on_rtppacket_publisher2room(video_pid_, "video", pkt);
+        }
     }
 
     return ret;
@@ -407,29 +421,29 @@ int live_user_info::handle_video_data(MEDIA_PACKET_PTR pkt_ptr) {
 int live_user_info::handle_audio_data(MEDIA_PACKET_PTR pkt_ptr) {
 
     if (pkt_ptr->codec_type_ == MEDIA_CODEC_OPUS) {
-        active_last_ms_ = now_millisec();
         if (pkt_ptr->buffer_ptr_->data_len() > RTP_PAYLOAD_MAX_SIZE) {
             log_errorf("audio opus size is too large, %lu", pkt_ptr->buffer_ptr_->data_len());
             return -1;
         }
-        rtp_packet* single_pkt = generate_singlenalu_packets((uint8_t*)pkt_ptr->buffer_ptr_->data() + 2,
+        rtp_arena_.reset();
+        rtp_packet* single_pkt = generate_singlenalu_packets(rtp_arena_, (uint8_t*)pkt_ptr->buffer_ptr_->data() + 2,
                                                              pkt_ptr->buffer_ptr_->data_len() - 2);
-
+        if (!single_pkt) {
+            return -1;
+        }
         single_pkt->set_seq(aseq_++);
         single_pkt->set_ssrc(audio_ssrc_);
         single_pkt->set_timestamp((uint32_t)pkt_ptr->dts_);
         single_pkt->set_marker(1);
 
-        std::string publisher_id = uid_;
-        publisher_id += "_";
-        publisher_id += "audio";
-        room_cb_->on_rtppacket_publisher2room(publisher_id, "audio", single_pkt);
+        room_cb_->on_rtppacket_publisher2room(audio_pid_, "audio", single_pkt);
     }
 
     if (pkt_ptr->codec_type_ == MEDIA_CODEC_AAC) {
         MEDIA_PACKET_PTR raw_pkt_ptr = pkt_ptr->copy();
         if (!trans_) {
             trans_ = new transcode();
+            trans_->set_name(roomId_ + "/" + uid_);
             trans_->set_output_audio_fmt("libopus");
             trans_->set_output_format(MEDIA_FORMAT_RAW);
             trans_->set_audio_bitrate(32);
@@ -477,18 +491,18 @@ int live_user_info::handle_audio_data(MEDIA_PACKET_PTR pkt_ptr) {
             ret_pkt_ptr->app_        = pkt_ptr->app_;
             ret_pkt_ptr->streamname_ = pkt_ptr->streamname_;
 
-            rtp_packet* single_pkt = generate_singlenalu_packets((uint8_t*)ret_pkt_ptr->buffer_ptr_->data(),
+            rtp_arena_.reset();
+            rtp_packet* single_pkt = generate_singlenalu_packets(rtp_arena_, (uint8_t*)ret_pkt_ptr->buffer_ptr_->data(),
                                                                  ret_pkt_ptr->buffer_ptr_->data_len());
-
+            if (!single_pkt) {
+                continue;
+            }
             single_pkt->set_seq(aseq_++);
             single_pkt->set_ssrc(audio_ssrc_);
             single_pkt->set_timestamp((uint32_t)ret_pkt_ptr->dts_);
             single_pkt->set_marker(1);
 
-            std::string publisher_id = uid_;
-            publisher_id += "_";
-            publisher_id += "audio";
-            room_cb_->on_rtppacket_publisher2room(publisher_id, "audio", single_pkt);
+            room_cb_->on_rtppacket_publisher2room(audio_pid_, "audio", single_pkt);
 
         }
     }
@@ -7,6 +7,7 @@
 #include "sdp_analyze.hpp"
 #include "rtc_media_info.hpp"
 #include "webrtc_session.hpp"
+#include "rtp_h264_pack.hpp"
 #include "udp/udp_server.hpp"
 #include <string>
 #include <stdlib.h>
@@ -147,6 +148,18 @@ public:
     int handle_audio_data(MEDIA_PACKET_PTR pkt_ptr);
 
     int64_t active_last_ms() { return active_last_ms_; }
+    void update_alive(int64_t now_ms) { active_last_ms_ = now_ms; }
+
+    const std::string& video_pid() { return video_pid_; }
+    const std::string& audio_pid() { return audio_pid_; }
+
+public:
+    //the bridge makes the rtp packets(and the opus transcode) only when the stream has webrtc viewers
+    bool bridge_active() { return bridge_active_; }
+    void start_bridge();
+    void stop_bridge();
+    int64_t bridge_idle_ms() { return bridge_idle_ms_; }
+    void set_bridge_idle_ms(int64_t idle_ms) { bridge_idle_ms_ = idle_ms; }
 
 public:
     std::queue<MEDIA_PACKET_PTR> pkt_queue_;
@@ -176,6 +189,12 @@ private:
     std::string audio_msid_;
     std::string video_cname_;
     std::string audio_cname_;
+    std::string video_pid_;
+    std::string audio_pid_;
+
+private:
+    bool bridge_active_     = false;
+    int64_t bridge_idle_ms_ = -1;//the time when the last viewer left, -1: it has viewers
 
 private:
     uint16_t vseq_ = 0;
@@ -185,6 +204,7 @@ private:
 private:
     std::vector<uint8_t> pps_;
     std::vector<uint8_t> sps_;
+    rtp_packet_arena rtp_arena_;
 
 private:
     transcode* trans_ = nullptr;
@@ -5,7 +5,7 @@
 #include <stdint.h>
 #include <stddef.h>
 
-void init_single_udp_server(uv_loop_t* loop, const std::string& candidate_ip, uint16_t port);
+void init_single_udp_server(uv_loop_t* loop, const std::string& candidate_ip, uint16_t port, size_t workers = 1);
 void dtls_init(const std::string& key_file, const std::string& cert_file);
 void init_webrtc_stream_manager_callback();
 
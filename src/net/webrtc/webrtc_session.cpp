@@ -3,6 +3,8 @@
 #include "logger.hpp"
 #include "stringex.hpp"
 #include "net/udp/udp_server.hpp"
+#include "net/udp/udp_peer_table.hpp"
+#include "webrtc_worker.hpp"
 #include "net/stun/stun_packet.hpp"
 #include "net/rtprtcp/rtprtcp_pub.hpp"
 #include "net/rtprtcp/rtp_packet.hpp"
@@ -14,6 +16,7 @@
 #include "net/rtprtcp/rtcp_xr_dlrr.hpp"
 #include "net/rtprtcp/rtcp_xr_rrt.hpp"
 #include "net/rtprtcp/rtcpfb_remb.hpp"
+#include "net/rtprtcp/rtp_packet_view.hpp"
 #include "rtc_dtls.hpp"
 #include "rtc_subscriber.hpp"
 #include "srtp_session.hpp"
@@ -35,22 +38,68 @@
 #include <thread>
 #include <chrono>
 
+extern uv_loop_t* get_global_io_context();
+
 std::shared_ptr<udp_server> single_udp_server_ptr;
 single_udp_session_callback single_udp_cb;
 
-//key: "srcip+srcport" or "username", value: webrtc_session*
+//key: "username", value: webrtc_session*, only for the first stun packet of the peer
 std::unordered_map<std::string, webrtc_session*> single_webrtc_map;
+//key: the binary remote address, value: webrtc_session*
+udp_peer_table<webrtc_session> single_peer_table;
 std::string single_candidate_ip;
 uint16_t single_candidate_port = 0;
 
+//the reuseport sockets with their own threads when there are more than one worker
+std::vector<std::shared_ptr<webrtc_worker>> single_workers;
+single_worker_callback single_worker_cb;
+//key: the peer id of the srtp sessions moved to a worker, value: webrtc_session*
+std::unordered_map<uint64_t, webrtc_session*> single_peer_id_map;
+uint64_t single_peer_id = 0;
+
 void init_single_udp_server(uv_loop_t* loop,
-        const std::string& candidate_ip, uint16_t port) {
-    if (!single_udp_server_ptr) {
-        single_candidate_ip   = candidate_ip;
-        single_candidate_port = port;
-        log_infof("init udp server candidate_ip:%s, port:%d", candidate_ip.c_str(), port);
+        const std::string& candidate_ip, uint16_t port, size_t workers) {
+    if (single_udp_server_ptr || !single_workers.empty()) {
+        return;
+    }
+    single_candidate_ip   = candidate_ip;
+    single_candidate_port = port;
+    log_infof("init udp server candidate_ip:%s, port:%d, workers:%lu", candidate_ip.c_str(), port, workers);
+
+    if (workers <= 1) {
         single_udp_server_ptr = std::make_shared<udp_server>(loop, port, &single_udp_cb);
+        return;
+    }
+    //the sockets join the reuseport group in the order of the worker index
+    for (size_t index = 0; index < workers; index++) {
+        std::shared_ptr<webrtc_worker> worker_ptr = std::make_shared<webrtc_worker>(index, workers,
+                                                                        port, loop, &single_worker_cb);
+        if (!worker_ptr->start()) {
+            MS_THROW_ERROR("start webrtc worker error, index:%lu, port:%d", index, port);
+        }
+        single_workers.push_back(worker_ptr);
+    }
+}
+
+void webrtc_udp_write(uint8_t* data, size_t data_size, const udp_tuple& address) {
+    if (!single_workers.empty()) {
+        if (data_size > WEBRTC_WORKER_PACKET_SIZE) {
+            log_errorf("udp data is too large to send, len:%lu", data_size);
+            return;
+        }
+        webrtc_worker* worker = single_workers[udp_steer_index(address, single_workers.size())].get();
+        webrtc_worker_packet* pkt = worker->alloc_packet();
+        pkt->type    = WORKER_SEND_RAW;
+        pkt->address = address;
+        pkt->len     = data_size;
+        memcpy(pkt->data, data, data_size);
+        worker->post(pkt);
+        return;
+    }
+    if (!single_udp_server_ptr) {
+        MS_THROW_ERROR("single udp server is not inited");
     }
+    single_udp_server_ptr->write((char*)data, data_size, address);
 }
 
 void insert_webrtc_session(std::string key, webrtc_session* session) {
@@ -61,6 +110,18 @@ void insert_webrtc_session(std::string key, webrtc_session* session) {
     single_webrtc_map.insert(std::make_pair(key, session));
 }
 
+void insert_webrtc_session(const udp_tuple& address, webrtc_session* session) {
+    if (address.empty() || (session == NULL)) {
+        MS_THROW_ERROR("insert webrtc session error, remote:%s", address.to_string().c_str());
+    }
+    log_infof("insert webrtc session by remote:%s", address.to_string().c_str());
+    single_peer_table.insert(address.key, session);
+}
+
+webrtc_session* get_webrtc_session(const udp_peer_key& key) {
+    return single_peer_table.find(key);
+}
+
 webrtc_session* get_webrtc_session(const std::string& key) {
     webrtc_session* session = nullptr;
     
@@ -95,6 +156,7 @@ int remove_webrtc_session(webrtc_session* session) {
             iter++;
         }
     }
+    count += (int)single_peer_table.erase_value(session);
     return count;
 }
 
@@ -108,17 +170,35 @@ int remove_webrtc_session(webrtc_session* session) {
 //        return 3 * timer_us / 2;
 //}
 
-void single_udp_session_callback::on_write(size_t sent_size, udp_tuple address) {
+void single_udp_session_callback::on_write(size_t sent_size, const udp_tuple& address) {
     //log_infof("udp write callback len:%lu, remote:%s",
     //    sent_size, address.to_string().c_str());
 }
 
-void single_udp_session_callback::on_read(const char* data, size_t data_size, udp_tuple address) {
+void single_udp_session_callback::on_read(const char* data, size_t data_size, const udp_tuple& address) {
+    handle_single_udp_packet(data, data_size, address);
+}
+
+void single_worker_callback::on_worker_packet(webrtc_worker_packet* pkt) {
+    if (pkt->type == WORKER_RECV_RAW) {
+        handle_single_udp_packet((const char*)pkt->data, pkt->len, pkt->address);
+        return;
+    }
+    auto iter = single_peer_id_map.find(pkt->peer_id);
+    if (iter == single_peer_id_map.end()) {
+        return;
+    }
+    if (pkt->type == WORKER_RECV_RTP) {
+        iter->second->on_handle_rtp_plain(pkt->data, pkt->len);
+    } else if (pkt->type == WORKER_RECV_RTCP) {
+        iter->second->on_handle_rtcp_plain(pkt->data, pkt->len);
+    }
+}
+
+void handle_single_udp_packet(const char* data, size_t data_size, const udp_tuple& address) {
     webrtc_session* session = nullptr;
-    
-    std::string peerid = address.to_string();
-    
-    session = get_webrtc_session(peerid);
+
+    session = get_webrtc_session(address.key);
     if (session) {
         session->on_recv_packet((const uint8_t*)data, data_size, address);
         return;
@@ -146,8 +226,8 @@ void single_udp_session_callback::on_read(const char* data, size_t data_size, ud
                 return;
             }
             log_infof("insert new session, username:%s, remote address:%s",
-                    username.c_str(), peerid.c_str());
-            insert_webrtc_session(peerid, session);
+                    username.c_str(), address.to_string().c_str());
+            insert_webrtc_session(address, session);
 
             session->on_handle_stun_packet(packet, address);
         }
@@ -165,8 +245,6 @@ void single_udp_session_callback::on_read(const char* data, size_t data_size, ud
     log_warnf("fail to find session to handle packet, data len:%lu, remote address:%s",
         data_size, address.to_string().c_str());
 }
-extern uv_loop_t* get_global_io_context();
-
 webrtc_session::webrtc_session(const std::string& roomId, const std::string& uid,
                 room_callback_interface* room, int session_direction, const rtc_media_info& media_info,
                 std::string id):rtc_base_session(roomId, uid, room, session_direction, media_info, id)
@@ -177,7 +255,7 @@ webrtc_session::webrtc_session(const std::string& roomId, const std::string& uid
 
     insert_webrtc_session(username_fragment_, this);
 
-    dtls_trans_ = new rtc_dtls(this, single_udp_server_ptr->get_loop());
+    dtls_trans_ = new rtc_dtls(this, get_global_io_context());
 
     close_session_ = false;
     start_timer();
@@ -189,6 +267,23 @@ webrtc_session::webrtc_session(const std::string& roomId, const std::string& uid
     bitrate_estimate_.SetMinBitrate(Config::min_kbps() * 1000);
     bitrate_estimate_.SetStartBitrate(Config::start_kbps() * 1000);
 
+    if (direction_ == RTC_DIRECTION_SEND) {
+        for (auto& media_item : media_info_.medias) {
+            for (auto& ext : media_item.header_extentions) {
+                if (ext.uri == RTP_EXT_TWCC_URI) {
+                    twcc_extension_id_ = (uint8_t)ext.value;
+                }
+            }
+        }
+        send_bwe_.set_bitrate_range((int64_t)Config::min_kbps() * 1000, (int64_t)Config::max_kbps() * 1000,
+                                (int64_t)Config::start_kbps() * 1000);
+    }
+
+    if (Config::pacing_factor() > 0) {
+        pacer_ = new rtc_pacer(get_global_io_context(), this, Config::pacing_factor());
+        pacer_->set_target_bitrate((int64_t)Config::start_kbps() * 1000);
+    }
+
     log_infof("webrtc_session construct username fragement:%s, user password:%s, \
 roomid:%s, uid:%s, direction:%s, max kbps:%d, min kbps:%d, start kbps:%d",
         username_fragment_.c_str(), user_pwd_.c_str(), roomId_.c_str(), uid_.c_str(),
@@ -199,6 +294,10 @@ roomid:%s, uid:%s, direction:%s, max kbps:%d, min kbps:%d, start kbps:%d",
 webrtc_session::~webrtc_session() {
     close_session();
     stop_timer();
+    if (pacer_) {
+        delete pacer_;
+        pacer_ = nullptr;
+    }
     if (write_srtp_) {
         delete write_srtp_;
         write_srtp_ = nullptr;
@@ -230,6 +329,8 @@ void webrtc_session::close_session() {
         }
     }
 
+    release_worker_peer();
+
     int ret = remove_webrtc_session(this);
     if (ret > 0) {
         log_infof("close webrtc session remove %d item from the global map", ret);
@@ -292,23 +393,103 @@ void webrtc_session::send_xr_rrt(int64_t now_ms) {
 }
 
 void webrtc_session::send_rtp_data_in_dtls(uint8_t* data, size_t data_len) {
+    send_rtp_data_in_dtls(data, data_len, nullptr, 0);
+}
+
+void webrtc_session::send_rtp_data_in_dtls(const uint8_t* header, size_t header_len,
+                                        const uint8_t* payload, size_t payload_len) {
+    if (peer_id_ != 0) {
+        post_to_worker(WORKER_SEND_RTP, header, header_len, payload, payload_len);
+        return;
+    }
     if(!write_srtp_) {
         log_errorf("write_srtp is not ready, roomid:%s, uid:%s",
                 roomId_.c_str(), uid_.c_str());
         return;
     }
-    
-    bool ret = write_srtp_->encrypt_rtp(const_cast<uint8_t**>(&data), &data_len);
+    if (!single_udp_server_ptr) {
+        MS_THROW_ERROR("single udp server is not inited");
+    }
+    size_t data_len = header_len + payload_len;
+
+    //the only copy of the packet for the subscriber: it's assembled and encrypted
+    //in the send buffer of the udp server and sent in the batch of the loop
+    uint8_t* data = single_udp_server_ptr->alloc_write(data_len + SRTP_MAX_TRAILER_LEN);
+    memcpy(data, header, header_len);
+    if (payload_len > 0) {
+        memcpy(data + header_len, payload, payload_len);
+    }
+
+    bool ret = write_srtp_->encrypt_rtp_in_place(data, &data_len);
     if (!ret) {
         log_errorf("encrypt_rtp error, roomid:%s, uid:%s",
                 roomId_.c_str(), uid_.c_str());
-        return;
+        data_len = 0;
     }
     //log_infof("sent srtp data len:%u, remote:%s", data_len, remote_address_.to_string().c_str());
-    write_udp_data(data, data_len, remote_address_);
+    single_udp_server_ptr->commit_write(data_len, remote_address_);
+}
+
+void webrtc_session::send_rtp_data_paced(PACER_CLASS cls, const uint8_t* header, size_t header_len,
+                                    const uint8_t* payload, size_t payload_len) {
+    if (!pacer_) {
+        pacer_send_rtp(header, header_len, payload, payload_len);
+        return;
+    }
+    pacer_->send_rtp(cls, header, header_len, payload, payload_len);
+}
+
+void webrtc_session::pacer_send_rtp(const uint8_t* header, size_t header_len,
+                                const uint8_t* payload, size_t payload_len) {
+    if (twcc_extension_id_ == 0) {
+        send_rtp_data_in_dtls(header, header_len, payload, payload_len);
+        return;
+    }
+    //the transport sequence is taken in the order of sending, after the pacer
+    uint8_t twcc_header[RTP_HEADER_AREA_SIZE];
+    size_t src_header_len  = 0;
+    size_t twcc_header_len = rtp_packet_view::write_transport_seq(header, header_len,
+                                    twcc_header, sizeof(twcc_header), twcc_extension_id_,
+                                    send_bwe_.next_transport_seq(), src_header_len);
+    if (twcc_header_len == 0) {
+        send_rtp_data_in_dtls(header, header_len, payload, payload_len);
+        return;
+    }
+    //the queued packet of the pacer is in the header buffer as a whole
+    if (payload_len == 0) {
+        payload     = header + src_header_len;
+        payload_len = header_len - src_header_len;
+    }
+    send_bwe_.on_packet_sent(twcc_header_len + payload_len, now_microsec());
+    send_rtp_data_in_dtls(twcc_header, twcc_header_len, payload, payload_len);
+}
+
+int64_t webrtc_session::get_estimate_bitrate() {
+    if ((twcc_extension_id_ != 0) && send_bwe_.has_feedback()) {
+        return send_bwe_.get_estimate_bitrate();
+    }
+    return remb_bitrate_;
+}
+
+void webrtc_session::get_bwe_statics(json& json_data) {
+    if (twcc_extension_id_ == 0) {
+        return;
+    }
+    send_bwe_.get_statics(json_data);
+}
+
+void webrtc_session::get_pacer_statics(json& json_data) {
+    if (!pacer_) {
+        return;
+    }
+    pacer_->get_statics(json_data);
 }
 
 void webrtc_session::send_rtcp_data_in_dtls(uint8_t* data, size_t data_len) {
+    if (peer_id_ != 0) {
+        post_to_worker(WORKER_SEND_RTCP, data, data_len);
+        return;
+    }
     if(!write_srtp_) {
         return;
     }
@@ -321,10 +502,77 @@ void webrtc_session::send_rtcp_data_in_dtls(uint8_t* data, size_t data_len) {
 }
 
 void webrtc_session::write_udp_data(uint8_t* data, size_t data_size, const udp_tuple& address) {
-    if (!single_udp_server_ptr) {
-        MS_THROW_ERROR("single udp server is not inited");
+    webrtc_udp_write(data, data_size, address);
+}
+
+void webrtc_session::post_to_worker(int type, const uint8_t* data, size_t data_len,
+                                const uint8_t* payload, size_t payload_len) {
+    if (!worker_ || (data_len + payload_len > WEBRTC_WORKER_PACKET_SIZE)) {
+        return;
+    }
+    webrtc_worker_packet* pkt = worker_->alloc_packet();
+
+    pkt->type    = (WORKER_PACKET_TYPE)type;
+    pkt->peer_id = peer_id_;
+    pkt->address = remote_address_;
+    pkt->len     = data_len + payload_len;
+    if (data_len > 0) {
+        memcpy(pkt->data, data, data_len);
+    }
+    if (payload_len > 0) {
+        memcpy(pkt->data + data_len, payload, payload_len);
+    }
+    worker_->post(pkt);
+}
+
+void webrtc_session::move_srtp_to_worker() {
+    release_worker_peer();
+
+    srtp_session* read_srtp  = read_srtp_;
+    srtp_session* write_srtp = write_srtp_;
+
+    peer_id_ = ++single_peer_id;
+    worker_  = single_workers[udp_steer_index(remote_address_, single_workers.size())].get();
+    webrtc_worker_packet* pkt = worker_->alloc_packet();
+
+    pkt->type       = WORKER_PEER_ADD;
+    pkt->peer_id    = peer_id_;
+    pkt->address    = remote_address_;
+    pkt->read_srtp  = read_srtp;
+    pkt->write_srtp = write_srtp;
+    if (!worker_->post(pkt)) {
+        //the srtp sessions are still in the session
+        log_errorf("move srtp to webrtc worker(%lu) error, roomid:%s, uid:%s",
+            worker_->get_index(), roomId_.c_str(), uid_.c_str());
+        peer_id_ = 0;
+        worker_  = nullptr;
+        return;
+    }
+    read_srtp_  = nullptr;
+    write_srtp_ = nullptr;
+    single_peer_id_map[peer_id_] = this;
+    log_infof("move srtp to webrtc worker(%lu), peer id:%lu, remote:%s",
+        worker_->get_index(), peer_id_, remote_address_.to_string().c_str());
+}
+
+void webrtc_session::release_worker_peer() {
+    if (peer_id_ == 0) {
+        return;
+    }
+    post_to_worker(WORKER_PEER_REMOVE, nullptr, 0);
+    single_peer_id_map.erase(peer_id_);
+    peer_id_ = 0;
+    worker_  = nullptr;
+}
+
+void webrtc_session::set_remote_address(const udp_tuple& address) {
+    bool changed = (remote_address_.key != address.key);
+
+    remote_address_ = address;
+    if (changed && (peer_id_ != 0)) {
+        //the worker keeps the srtp, the packets from the new address are sent to it by the main loop
+        post_to_worker(WORKER_PEER_UPDATE, nullptr, 0);
     }
-    single_udp_server_ptr->write((char*)data, data_size, address);
 }
 
 void webrtc_session::on_recv_packet(const uint8_t* udp_data, size_t udp_data_len,
@@ -389,6 +637,10 @@ void webrtc_session::on_dtls_connected(CRYPTO_SUITE_ENUM suite,
         }
         write_srtp_ = new srtp_session(SRTP_SESSION_OUT_TYPE, suite, local_key, local_key_len);
         read_srtp_  = new srtp_session(SRTP_SESSION_IN_TYPE, suite, remote_key, remote_key_len);
+
+        if (!single_workers.empty()) {
+            move_srtp_to_worker();
+        }
     }
     catch(const std::exception& e) {
         log_errorf("create srtp session error:%s", e.what());
@@ -403,6 +655,12 @@ void webrtc_session::on_handle_rtp_data(const uint8_t* data, size_t data_len, co
         return;
     }
 
+    if (peer_id_ != 0) {
+        //received by another worker, it's decrypted by the worker owning the srtp
+        post_to_worker(WORKER_DECRYPT, data, data_len);
+        return;
+    }
+
     if (!read_srtp_) {
         log_errorf("read srtp session is not ready and discard rtp packet");
         return;
@@ -416,19 +674,25 @@ void webrtc_session::on_handle_rtp_data(const uint8_t* data, size_t data_len, co
             ntohs(header->sequence), ntohl(header->timestamp), ntohl(header->ssrc));
         return;
     }
+    on_handle_rtp_plain(const_cast<uint8_t*>(data), data_len);
+}
 
-    //handle rtp packet
-    rtp_packet* pkt = nullptr;
-    try {
-        pkt = rtp_packet::parse(const_cast<uint8_t*>(data), data_len);
-    }
-    catch(const std::exception& e) {
-        log_errorf("rtp packet parse error:%s", e.what());
+void webrtc_session::on_handle_rtp_plain(uint8_t* data, size_t data_len) {
+    //handle rtp packet, it's parsed on the stack without any allocation,
+    //the publisher clones it when it needs to keep it
+    rtp_packet_view view;
+    if (!view.parse(data, data_len)) {
+        log_errorf("rtp packet parse error:%s, len:%lu", view.get_error(), data_len);
         return;
     }
+    rtp_packet rtp_pkt(view);
+    rtp_packet* pkt = &rtp_pkt;
 
     uint32_t ssrc = pkt->get_ssrc();
     auto publisher_ptr = rtc_base_session::get_publisher(ssrc);
+    if (!publisher_ptr) {
+        publisher_ptr = bind_publisher_ssrc(pkt);
+    }
     if (!publisher_ptr) {
         log_errorf("fail to get publisher object by ssrc:%u", pkt->get_ssrc());
         return;
@@ -441,8 +705,6 @@ void webrtc_session::on_handle_rtp_data(const uint8_t* data, size_t data_len, co
     pkt->set_abs_time_extension_id((uint8_t)abstime_id);
     ret_abs_time = pkt->read_abs_time(abs_time);
     publisher_ptr->on_handle_rtppacket(pkt);
-
-    delete pkt;
     
     if (ret_abs_time) {
         int64_t arrivalTimeMs = now_millisec();
@@ -489,6 +751,11 @@ void webrtc_session::on_handle_rtcp_data(const uint8_t* data, size_t data_len, c
         return;
     }
 
+    if (peer_id_ != 0) {
+        post_to_worker(WORKER_DECRYPT, data, data_len);
+        return;
+    }
+
     if (!read_srtp_) {
         log_errorf("read srtp session is not ready and discard rtcp packet");
         return;
@@ -498,10 +765,13 @@ void webrtc_session::on_handle_rtcp_data(const uint8_t* data, size_t data_len, c
     if (!ret) {
         return;
     }
+    on_handle_rtcp_plain(const_cast<uint8_t*>(data), data_len);
+}
 
+void webrtc_session::on_handle_rtcp_plain(uint8_t* data, size_t data_len) {
     //handle rtcp packet
     int left_len = (int)data_len;
-    uint8_t* p = const_cast<uint8_t*>(data);
+    uint8_t* p = data;
 
     log_debugf("handle rtcp direction:%s, total len:%lu",
         (direction_ == RTC_DIRECTION_SEND) ? "send" : "recv", data_len);
@@ -658,6 +928,14 @@ void webrtc_session::handle_rtcp_psfb(uint8_t* data, size_t data_len) {
                 }
                 //log_infof("subscriber bitrate:%ld", remb_pkt->get_bitrate());
                 remb_bitrate_ = remb_pkt->get_bitrate();
+                //the transport-cc estimate paces the session when it's negotiated
+                if (pacer_ && (twcc_extension_id_ == 0)) {
+                    int64_t target_bitrate = remb_bitrate_;
+                    if (target_bitrate < (int64_t)Config::min_kbps() * 1000) {
+                        target_bitrate = (int64_t)Config::min_kbps() * 1000;
+                    }
+                    pacer_->set_target_bitrate(target_bitrate);
+                }
                 std::vector<uint32_t> ssrcs = remb_pkt->get_ssrcs();
 
                 for (auto ssrc : ssrcs) {
@@ -704,6 +982,24 @@ void webrtc_session::handle_rtcp_rtpfb(uint8_t* data, size_t data_len) {
                 delete nack_pkt;
                 break;
             }
+            case FB_RTP_TCC:
+            {
+                if (twcc_extension_id_ == 0) {
+                    break;
+                }
+                if (!twcc_feedback_.parse(data, data_len)) {
+                    log_warnf("parse transport-cc feedback error, len:%lu", data_len);
+                    break;
+                }
+                if (send_bwe_.on_feedback(twcc_feedback_, now_ms)) {
+                    log_debugf("transport-cc estimate bitrate:%ld, roomid:%s, uid:%s",
+                        send_bwe_.get_estimate_bitrate(), roomId_.c_str(), uid_.c_str());
+                    if (pacer_) {
+                        pacer_->set_target_bitrate(send_bwe_.get_estimate_bitrate());
+                    }
+                }
+                break;
+            }
             default:
             {
                 log_warnf("receive rtcp psfb format(%d) is not handled.", header->fmt);
@@ -762,13 +1058,13 @@ void webrtc_session::handle_rtcp_rr(uint8_t* data, size_t data_len) {
 }
 
 void webrtc_session::on_handle_dtls_data(const uint8_t* data, size_t data_len, const udp_tuple& address) {
-    if ((remote_address_.ip_address != address.ip_address) && (remote_address_.port != address.port)) {
+    if (remote_address_.key != address.key) {
         log_warnf("remote address(%s) is not equal to the address(%s)",
             remote_address_.to_string().c_str(), address.to_string().c_str());
     }
 
     //update remote address
-    remote_address_ = address;
+    set_remote_address(address);
 
     if ((dtls_trans_->state != DTLS_CONNECTING) && (dtls_trans_->state != DTLS_CONNECTED)) {
         log_errorf("dtls state(%d) is not ready.", dtls_trans_->state);
@@ -819,15 +1115,12 @@ void webrtc_session::on_handle_stun_packet(stun_packet* pkt, const udp_tuple& ad
             return;
         }
 
-        struct sockaddr src_address;
-        get_ipv4_sockaddr(address.ip_address, address.port, &src_address);
-
         stun_packet* resp_pkt = pkt->create_success_response();
-        resp_pkt->xor_address = &src_address;
+        resp_pkt->xor_address = address.get_sockaddr();
         resp_pkt->password    = this->user_pwd_;
         resp_pkt->serialize();
 
-        remote_address_ = address;
+        set_remote_address(address);
         write_udp_data(resp_pkt->data, resp_pkt->data_len, address);
         delete resp_pkt;
 
@@ -6,6 +6,9 @@
 #include "rtc_media_info.hpp"
 #include "rtc_publisher.hpp"
 #include "net/udp/udp_server.hpp"
+#include "webrtc_worker.hpp"
+#include "send_side_bwe.hpp"
+#include "net/rtprtcp/rtcpfb_twcc.hpp"
 #include "utils/timeex.hpp"
 #include "modules/remote_bitrate_estimator/remote_bitrate_estimator_abs_send_time.h"
 
@@ -27,15 +30,27 @@ class room_callback_interface;
 
 void insert_webrtc_session(std::string key, webrtc_session* session);
 webrtc_session* get_webrtc_session(const std::string& key);
+void insert_webrtc_session(const udp_tuple& address, webrtc_session* session);
+webrtc_session* get_webrtc_session(const udp_peer_key& key);
+void handle_single_udp_packet(const char* data, size_t data_size, const udp_tuple& address);
+//sent by the single udp server or by the worker of the address
+void webrtc_udp_write(uint8_t* data, size_t data_size, const udp_tuple& address);
 
 class single_udp_session_callback : public udp_session_callbackI
 {
 protected:
-    virtual void on_write(size_t sent_size, udp_tuple address) override;
-    virtual void on_read(const char* data, size_t data_size, udp_tuple address) override;
+    virtual void on_write(size_t sent_size, const udp_tuple& address) override;
+    virtual void on_read(const char* data, size_t data_size, const udp_tuple& address) override;
+};
+
+class single_worker_callback : public webrtc_worker_callbackI
+{
+protected:
+    virtual void on_worker_packet(webrtc_worker_packet* pkt) override;
 };
 
 class webrtc_session : public rtc_base_session, public timer_interface, public webrtc::RemoteBitrateObserver
+                    , public pacer_callbackI
 {
 public:
     webrtc_session(const std::string& roomId, const std::string& uid,
@@ -59,6 +74,8 @@ public:
     void on_handle_dtls_data(const uint8_t* data, size_t data_len, const udp_tuple& address);
     void on_handle_rtp_data(const uint8_t* data, size_t data_len, const udp_tuple& address);
     void on_handle_rtcp_data(const uint8_t* data, size_t data_len, const udp_tuple& address);
+    void on_handle_rtp_plain(uint8_t* data, size_t data_len);
+    void on_handle_rtcp_plain(uint8_t* data, size_t data_len);
 
 public:
     void on_dtls_connected(CRYPTO_SUITE_ENUM srtpCryptoSuite,
@@ -75,13 +92,33 @@ public://implement webrtc::RemoteBitrateObserver
        const std::vector<uint32_t>& ssrcs,
        uint32_t availableBitrate) override;
 
+public://implement pacer_callbackI
+    virtual void pacer_send_rtp(const uint8_t* header, size_t header_len,
+                            const uint8_t* payload, size_t payload_len) override;
+
 private:
     virtual void send_rtp_data_in_dtls(uint8_t* data, size_t data_len) override;
+    virtual void send_rtp_data_in_dtls(const uint8_t* header, size_t header_len,
+                                    const uint8_t* payload, size_t payload_len) override;
     virtual void send_rtcp_data_in_dtls(uint8_t* data, size_t data_len) override;
+    virtual void send_rtp_data_paced(PACER_CLASS cls, const uint8_t* header, size_t header_len,
+                                    const uint8_t* payload, size_t payload_len) override;
+    virtual void get_pacer_statics(json& json_data) override;
+    virtual int64_t get_estimate_bitrate() override;
+    virtual void get_bwe_statics(json& json_data) override;
+    virtual bool is_connected() override { return (peer_id_ != 0) || (write_srtp_ != nullptr); }
 
 private:
     void write_udp_data(uint8_t* data, size_t data_size, const udp_tuple& address);
     void write_error_stun_packet(stun_packet* pkt, int err, const udp_tuple& address);
+    void set_remote_address(const udp_tuple& address);
+
+private://the srtp sessions in the webrtc worker
+    void move_srtp_to_worker();
+    void release_worker_peer();
+    //the payload is appended to the data when it's not null
+    void post_to_worker(int type, const uint8_t* data, size_t data_len,
+                    const uint8_t* payload = nullptr, size_t payload_len = 0);
 
 private:
     void handle_rtcp_sr(uint8_t* data, size_t data_len);
@@ -102,6 +139,8 @@ private://for dtls
     rtc_dtls* dtls_trans_     = nullptr;
     srtp_session* write_srtp_ = nullptr;
     srtp_session* read_srtp_  = nullptr;
+    uint64_t peer_id_ = 0;//not 0 when the srtp sessions are moved to the worker
+    webrtc_worker* worker_ = nullptr;
 
 private:
     bool close_session_ = false;
@@ -113,6 +152,14 @@ private:
 
 private:
     webrtc::RemoteBitrateEstimatorAbsSendTime bitrate_estimate_;
+
+private:
+    rtc_pacer* pacer_ = nullptr;//null when the pacing is disabled
+
+private://for the transport-cc of the subscribers
+    uint8_t twcc_extension_id_ = 0;//0: the transport-cc isn't negotiated
+    send_side_bwe send_bwe_;
+    rtcp_fb_twcc twcc_feedback_;
 };
 
 #endif
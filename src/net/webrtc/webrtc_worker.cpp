@@ -0,0 +1,363 @@
+#include "webrtc_worker.hpp"
+#include "srtp_session.hpp"
+#include "net/rtprtcp/rtprtcp_pub.hpp"
+#include "logger.hpp"
+#include <string.h>
+
+webrtc_worker_peer::~webrtc_worker_peer()
+{
+    if (read_srtp) {
+        delete read_srtp;
+        read_srtp = nullptr;
+    }
+    if (write_srtp) {
+        delete write_srtp;
+        write_srtp = nullptr;
+    }
+}
+
+void on_worker_input_async(uv_async_t* handle) {
+    webrtc_worker* worker = (webrtc_worker*)handle->data;
+    if (worker) {
+        worker->on_input();
+    }
+}
+
+void on_worker_output_async(uv_async_t* handle) {
+    webrtc_worker* worker = (webrtc_worker*)handle->data;
+    if (worker) {
+        worker->on_output();
+    }
+}
+
+static void on_worker_output_close(uv_handle_t* handle) {
+    delete (uv_async_t*)handle;
+}
+
+static void on_worker_handle_close(uv_handle_t* handle, void* arg) {
+    if (!uv_is_closing(handle)) {
+        uv_close(handle, nullptr);
+    }
+}
+
+webrtc_worker::webrtc_worker(size_t index, size_t count, uint16_t port,
+                        uv_loop_t* main_loop, webrtc_worker_callbackI* cb):index_(index)
+                                                                    , count_(count)
+                                                                    , port_(port)
+                                                                    , cb_(cb)
+                                                                    , input_queue_(WEBRTC_WORKER_QUEUE_SIZE)
+                                                                    , output_queue_(WEBRTC_WORKER_QUEUE_SIZE)
+                                                                    , input_pool_(WEBRTC_WORKER_POOL_SIZE)
+                                                                    , output_pool_(WEBRTC_WORKER_POOL_SIZE)
+{
+    output_async_ = new uv_async_t;
+    uv_async_init(main_loop, output_async_, on_worker_output_async);
+    output_async_->data = this;
+
+    //the worker thread isn't started yet, both pools are filled here
+    for (size_t i = 0; i < WEBRTC_WORKER_POOL_INIT; i++) {
+        input_pool_.push(new webrtc_worker_packet);
+        output_pool_.push(new webrtc_worker_packet);
+    }
+}
+
+webrtc_worker::~webrtc_worker()
+{
+    stop();
+    //the handle is released in the close callback of the main loop
+    output_async_->data = nullptr;
+    uv_close((uv_handle_t*)output_async_, on_worker_output_close);
+    output_async_ = nullptr;
+
+    webrtc_worker_packet* pkt = nullptr;
+    while (input_queue_.pop(pkt)) {
+        delete pkt;
+    }
+    while (output_queue_.pop(pkt)) {
+        delete pkt;
+    }
+    while (input_pool_.pop(pkt)) {
+        delete pkt;
+    }
+    while (output_pool_.pop(pkt)) {
+        delete pkt;
+    }
+}
+
+webrtc_worker_packet* webrtc_worker::pop_packet(spsc_queue<webrtc_worker_packet*>& pool) {
+    webrtc_worker_packet* pkt = nullptr;
+
+    if (!pool.pop(pkt)) {
+        pkt = new webrtc_worker_packet;
+    }
+    pkt->type       = WORKER_RECV_RAW;
+    pkt->peer_id    = 0;
+    pkt->read_srtp  = nullptr;
+    pkt->write_srtp = nullptr;
+    pkt->len        = 0;
+    return pkt;
+}
+
+void webrtc_worker::push_packet(spsc_queue<webrtc_worker_packet*>& pool, webrtc_worker_packet* pkt) {
+    if (!pool.push(pkt)) {
+        delete pkt;
+    }
+}
+
+webrtc_worker_packet* webrtc_worker::alloc_packet() {
+    return pop_packet(input_pool_);
+}
+
+bool webrtc_worker::start() {
+    if (run_flag_) {
+        return true;
+    }
+    run_flag_ = true;
+    thread_ptr_ = std::make_shared<std::thread>(&webrtc_worker::on_work, this);
+
+    std::unique_lock<std::mutex> locker(ready_mutex_);
+    ready_cond_.wait(locker, [this] { return ready_ != 0; });
+    if (ready_ < 0) {
+        locker.unlock();
+        stop();
+        return false;
+    }
+    log_infof("webrtc worker(%lu) is started, udp port:%d", index_, port_);
+    return true;
+}
+
+void webrtc_worker::stop() {
+    if (!thread_ptr_) {
+        return;
+    }
+    run_flag_ = false;
+    {
+        std::lock_guard<std::mutex> locker(ready_mutex_);
+        if (ready_ > 0) {
+            uv_async_send(&input_async_);
+        }
+    }
+    thread_ptr_->join();
+    thread_ptr_ = nullptr;
+}
+
+bool webrtc_worker::post(webrtc_worker_packet* pkt) {
+    if (!input_queue_.push(pkt)) {
+        push_packet(output_pool_, pkt);
+        if ((drop_count_++ % 1000) == 0) {
+            log_warnf("webrtc worker(%lu) input queue is full, drop count:%ld", index_, (int64_t)drop_count_);
+        }
+        return false;
+    }
+    uv_async_send(&input_async_);
+    return true;
+}
+
+void webrtc_worker::on_work() {
+    uv_loop_init(&loop_);
+    uv_async_init(&loop_, &input_async_, on_worker_input_async);
+    input_async_.data = this;
+
+    int ready = 1;
+    try {
+        server_.reset(new udp_server(&loop_, port_, this, true, count_));
+    }
+    catch(const std::exception& e) {
+        log_errorf("webrtc worker(%lu) create udp server error:%s", index_, e.what());
+        ready = -1;
+    }
+    {
+        std::lock_guard<std::mutex> locker(ready_mutex_);
+        ready_ = ready;
+    }
+    ready_cond_.notify_one();
+
+    if (ready > 0) {
+        uv_run(&loop_, UV_RUN_DEFAULT);
+    }
+
+    for (auto& item : peers_) {
+        delete item.second;
+    }
+    peers_.clear();
+
+    //close the udp and async handles, the udp server is deleted after
+    //their close callbacks are done, then the loop can be closed
+    uv_walk(&loop_, on_worker_handle_close, nullptr);
+    uv_run(&loop_, UV_RUN_DEFAULT);
+    server_.reset();
+    uv_loop_close(&loop_);
+    log_infof("webrtc worker(%lu) is stopped", index_);
+}
+
+void webrtc_worker::on_input() {
+    webrtc_worker_packet* pkt = nullptr;
+
+    while (input_queue_.pop(pkt)) {
+        if (handle_input(pkt)) {
+            push_packet(input_pool_, pkt);
+        }
+    }
+    if (!run_flag_) {
+        uv_stop(&loop_);
+    }
+}
+
+void webrtc_worker::on_output() {
+    webrtc_worker_packet* pkt = nullptr;
+
+    while (output_queue_.pop(pkt)) {
+        if (cb_) {
+            cb_->on_worker_packet(pkt);
+        }
+        push_packet(output_pool_, pkt);
+    }
+}
+
+void webrtc_worker::output(webrtc_worker_packet* pkt) {
+    if (!output_queue_.push(pkt)) {
+        push_packet(input_pool_, pkt);
+        if ((drop_count_++ % 1000) == 0) {
+            log_warnf("webrtc worker(%lu) output queue is full, drop count:%ld", index_, (int64_t)drop_count_);
+        }
+        return;
+    }
+    uv_async_send(output_async_);
+}
+
+bool webrtc_worker::decrypt(webrtc_worker_peer* peer, webrtc_worker_packet* pkt) {
+    if (!peer->read_srtp) {
+        return false;
+    }
+    if (is_rtcp(pkt->data, pkt->len)) {
+        pkt->type = WORKER_RECV_RTCP;
+        return peer->read_srtp->decrypt_srtcp(pkt->data, &pkt->len);
+    }
+    if (is_rtp(pkt->data, pkt->len)) {
+        pkt->type = WORKER_RECV_RTP;
+        return peer->read_srtp->decrypt_srtp(pkt->data, &pkt->len);
+    }
+    return false;
+}
+
+void webrtc_worker::remove_peer(uint64_t peer_id) {
+    auto iter = peers_.find(peer_id);
+    if (iter == peers_.end()) {
+        return;
+    }
+    webrtc_worker_peer* peer = iter->second;
+    if (peer_table_.find(peer->address.key) == peer) {
+        peer_table_.erase(peer->address.key);
+    }
+    peers_.erase(iter);
+    delete peer;
+}
+
+bool webrtc_worker::handle_input(webrtc_worker_packet* pkt) {
+    webrtc_worker_peer* peer = nullptr;
+
+    if (pkt->peer_id != 0) {
+        auto iter = peers_.find(pkt->peer_id);
+        if (iter != peers_.end()) {
+            peer = iter->second;
+        }
+    }
+
+    switch (pkt->type) {
+        case WORKER_SEND_RAW:
+        {
+            server_->write((char*)pkt->data, pkt->len, pkt->address);
+            break;
+        }
+        case WORKER_SEND_RTP:
+        case WORKER_SEND_RTCP:
+        {
+            if (!peer || !peer->write_srtp) {
+                break;
+            }
+            //encrypted in the send buffer of the udp server, it's not copied again
+            size_t len = pkt->len;
+            uint8_t* data = server_->alloc_write(len + SRTP_MAX_TRAILER_LEN + 4);
+            memcpy(data, pkt->data, len);
+
+            bool ret = (pkt->type == WORKER_SEND_RTP) ? peer->write_srtp->encrypt_rtp_in_place(data, &len)
+                                                    : peer->write_srtp->encrypt_rtcp_in_place(data, &len);
+            server_->commit_write(ret ? len : 0, pkt->address);
+            break;
+        }
+        case WORKER_DECRYPT:
+        {
+            if (!peer) {
+                break;
+            }
+            //decrypted in place and sent back to the main loop
+            if (decrypt(peer, pkt)) {
+                output(pkt);
+                return false;
+            }
+            break;
+        }
+        case WORKER_PEER_ADD:
+        {
+            remove_peer(pkt->peer_id);
+            peer = new webrtc_worker_peer();
+            peer->id         = pkt->peer_id;
+            peer->address    = pkt->address;
+            peer->read_srtp  = pkt->read_srtp;
+            peer->write_srtp = pkt->write_srtp;
+            peers_[peer->id] = peer;
+            peer_table_.insert(peer->address.key, peer);
+            log_infof("webrtc worker(%lu) add peer id:%lu, remote:%s", index_,
+                peer->id, peer->address.to_string().c_str());
+            break;
+        }
+        case WORKER_PEER_UPDATE:
+        {
+            if (!peer) {
+                break;
+            }
+            if (peer_table_.find(peer->address.key) == peer) {
+                peer_table_.erase(peer->address.key);
+            }
+            peer->address = pkt->address;
+            peer_table_.insert(peer->address.key, peer);
+            break;
+        }
+        case WORKER_PEER_REMOVE:
+        {
+            remove_peer(pkt->peer_id);
+            break;
+        }
+        default:
+        {
+            log_errorf("webrtc worker(%lu) unknown input type:%d", index_, (int)pkt->type);
+            break;
+        }
+    }
+    return true;
+}
+
+void webrtc_worker::on_write(size_t sent_size, const udp_tuple& address) {
+}
+
+void webrtc_worker::on_read(const char* data, size_t data_size, const udp_tuple& address) {
+    if (data_size > WEBRTC_WORKER_PACKET_SIZE) {
+        return;
+    }
+    webrtc_worker_packet* pkt = pop_packet(output_pool_);
+
+    pkt->type    = WORKER_RECV_RAW;
+    pkt->address = address;
+    pkt->len     = data_size;
+    memcpy(pkt->data, data, data_size);
+
+    webrtc_worker_peer* peer = peer_table_.find(address.key);
+    if (peer && (is_rtcp(pkt->data, pkt->len) || is_rtp(pkt->data, pkt->len))) {
+        pkt->peer_id = peer->id;
+        if (!decrypt(peer, pkt)) {
+            push_packet(input_pool_, pkt);
+            return;
+        }
+    }
+    output(pkt);
+}
@@ -0,0 +1,149 @@
+#ifndef WEBRTC_WORKER_HPP
+#define WEBRTC_WORKER_HPP
+#include "net/udp/udp_server.hpp"
+#include "net/udp/udp_peer_table.hpp"
+#include "utils/spsc_queue.hpp"
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+
+#define WEBRTC_WORKER_QUEUE_SIZE  8192
+#define WEBRTC_WORKER_PACKET_SIZE 2048 //the rtp packet and the srtp trailer
+#define WEBRTC_WORKER_POOL_SIZE   1024 //the free packets kept for each direction
+#define WEBRTC_WORKER_POOL_INIT   256
+
+class srtp_session;
+
+typedef enum
+{
+    WORKER_RECV_RAW = 0,//worker to main: stun, dtls or the srtp packet of an unknown peer
+    WORKER_RECV_RTP,    //worker to main: the decrypted rtp
+    WORKER_RECV_RTCP,   //worker to main: the decrypted rtcp
+    WORKER_SEND_RAW,    //main to worker: sent as it is
+    WORKER_SEND_RTP,    //main to worker: encrypted by the srtp of the peer and sent
+    WORKER_SEND_RTCP,
+    WORKER_DECRYPT,     //main to worker: the srtp packet of the peer received by another worker
+    WORKER_PEER_ADD,    //main to worker: the srtp sessions are moved to the worker
+    WORKER_PEER_UPDATE, //main to worker: the remote address of the peer is changed
+    WORKER_PEER_REMOVE  //main to worker: the srtp sessions are released
+} WORKER_PACKET_TYPE;
+
+//it's allocated by new without (), so the data isn't zero filled
+class webrtc_worker_packet
+{
+public:
+    WORKER_PACKET_TYPE type = WORKER_RECV_RAW;
+    uint64_t peer_id = 0;
+    udp_tuple address;
+    srtp_session* read_srtp  = nullptr;
+    srtp_session* write_srtp = nullptr;
+    size_t len = 0;
+    uint8_t data[WEBRTC_WORKER_PACKET_SIZE];
+};
+
+//the srtp sessions of one webrtc session, they're only used in the worker thread
+class webrtc_worker_peer
+{
+public:
+    webrtc_worker_peer() {}
+    ~webrtc_worker_peer();
+
+public:
+    uint64_t id = 0;
+    udp_tuple address;
+    srtp_session* read_srtp  = nullptr;
+    srtp_session* write_srtp = nullptr;
+};
+
+class webrtc_worker_callbackI
+{
+public:
+    //called in the main loop, the packet is released after it returns
+    virtual void on_worker_packet(webrtc_worker_packet* pkt) = 0;
+};
+
+/*
+one udp socket of the SO_REUSEPORT group with its own loop and thread.
+the worker receives the datagrams of the peers steered to it, decrypts the
+srtp of the peers it owns and encrypts and sends the packets of them.
+the sessions stay in the main loop, the packets are exchanged by two
+lock-free rings: main to worker and worker to main.
+*/
+class webrtc_worker : public udp_session_callbackI
+{
+friend void on_worker_input_async(uv_async_t* handle);
+friend void on_worker_output_async(uv_async_t* handle);
+
+public:
+    webrtc_worker(size_t index, size_t count, uint16_t port,
+                uv_loop_t* main_loop, webrtc_worker_callbackI* cb);
+    virtual ~webrtc_worker();
+
+public://called in the main loop
+    //the socket is bound before it returns, so the index in the reuseport group is kept
+    bool start();
+    void stop();
+    //the packet from the pool, it's posted to the worker then
+    webrtc_worker_packet* alloc_packet();
+    //the packet is released by the worker, it's dropped when the ring is full
+    bool post(webrtc_worker_packet* pkt);
+    size_t get_index() { return index_; }
+    int64_t get_drop_count() { return drop_count_; }
+
+public://implement udp_session_callbackI, called in the worker thread
+    virtual void on_write(size_t sent_size, const udp_tuple& address) override;
+    virtual void on_read(const char* data, size_t data_size, const udp_tuple& address) override;
+
+private:
+    void on_work();
+    void on_input();
+    void on_output();
+    //return false when the packet is kept, eg: it's decrypted and sent to the main loop
+    bool handle_input(webrtc_worker_packet* pkt);
+    bool decrypt(webrtc_worker_peer* peer, webrtc_worker_packet* pkt);
+    void output(webrtc_worker_packet* pkt);
+    static webrtc_worker_packet* pop_packet(spsc_queue<webrtc_worker_packet*>& pool);
+    static void push_packet(spsc_queue<webrtc_worker_packet*>& pool, webrtc_worker_packet* pkt);
+    void remove_peer(uint64_t peer_id);
+
+private:
+    size_t index_ = 0;
+    size_t count_ = 0;
+    uint16_t port_ = 0;
+    webrtc_worker_callbackI* cb_ = nullptr;
+
+private:
+    uv_loop_t loop_;
+    uv_async_t input_async_; //in the worker loop
+    uv_async_t* output_async_ = nullptr;//in the main loop
+    std::unique_ptr<udp_server> server_;
+    std::shared_ptr<std::thread> thread_ptr_;
+    std::atomic<bool> run_flag_{false};
+    std::atomic<int64_t> drop_count_{0};
+
+private:
+    std::mutex ready_mutex_;
+    std::condition_variable ready_cond_;
+    int ready_ = 0;//1: the socket is bound, -1: it fails
+
+private:
+    spsc_queue<webrtc_worker_packet*> input_queue_; //main to worker
+    spsc_queue<webrtc_worker_packet*> output_queue_;//worker to main
+
+private://the free packets, a new one is made when the pool is empty.
+       //each pool is pushed only by one thread and popped only by the other
+    spsc_queue<webrtc_worker_packet*> input_pool_; //pushed by the worker, popped by main
+    spsc_queue<webrtc_worker_packet*> output_pool_;//pushed by main, popped by the worker
+
+private://only in the worker thread
+    std::unordered_map<uint64_t, webrtc_worker_peer*> peers_;//key: peer id
+    udp_peer_table<webrtc_worker_peer> peer_table_;           //key: remote address
+};
+
+#endif
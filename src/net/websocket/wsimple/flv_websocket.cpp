@@ -39,6 +39,7 @@ int av_outputer::output_packet(MEDIA_PACKET_PTR pkt_ptr) {
     if ((pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE) && (pkt_ptr->codec_type_ == MEDIA_CODEC_OPUS)) {
         if (trans_ == nullptr) {
             trans_ = new transcode();
+            trans_->set_name(pkt_ptr->key_);
             trans_->set_output_audio_fmt("libfdk_aac");
             trans_->set_output_format(MEDIA_FORMAT_FLV);
             trans_->set_output_audio_samplerate(44100);
@@ -0,0 +1,368 @@
+#include "abr_transcode.hpp"
+#include "utils/logger.hpp"
+
+static void free_avframe(AVFrame* frame) {
+    av_frame_free(&frame);
+}
+
+static void free_avpacket(AVPacket* pkt) {
+    av_packet_free(&pkt);
+}
+
+abr_output::abr_output(const abr_rendition& rendition, const std::string& app,
+                    const std::string& streamname, abr_packet_callbackI* cb):rendition_(rendition)
+                                                                        , app_(app)
+                                                                        , cb_(cb)
+{
+    strand_     = std::make_shared<encoder_strand>();
+    streamname_ = streamname + "_" + rendition.name;
+    key_        = app + "/" + streamname_;
+    log_infof("abr output construct key:%s, %dx%d, bitrate:%dkbps",
+        key_.c_str(), rendition_.width, rendition_.height, rendition_.bitrate);
+}
+
+abr_output::~abr_output()
+{
+    if (venc_) {
+        delete venc_;
+        venc_ = nullptr;
+    }
+    log_infof("abr output destruct key:%s, drop frames:%ld", key_.c_str(), drop_count_);
+}
+
+int abr_output::init_encoder(AVFrame* frame) {
+    int width  = rendition_.width;
+    int height = rendition_.height;
+
+    //keep the aspect ratio of the source when only one side is configured, never upscale
+    if ((width <= 0) && (height > 0)) {
+        width = frame->width * height / frame->height;
+    } else if ((height <= 0) && (width > 0)) {
+        height = frame->height * width / frame->width;
+    }
+    if ((width <= 0) || (height <= 0) || (height > frame->height)) {
+        width  = frame->width;
+        height = frame->height;
+    }
+    width  = width & ~1;
+    height = height & ~1;
+
+    venc_ = new video_encode(this);
+    venc_->set_keyframe_follow(true);
+    int ret = venc_->init_video("libx264", width, height, "main", "veryfast",
+                            rendition_.bitrate, rendition_.framerate);
+    if (ret < 0) {
+        log_errorf("abr video encode init error, key:%s", key_.c_str());
+        delete venc_;
+        venc_ = nullptr;
+        return -1;
+    }
+    return 0;
+}
+
+void abr_output::send_frame(AVFRAME_PTR frame_ptr) {
+    if (init_failed_) {
+        return;
+    }
+    if (!venc_ && (init_encoder(frame_ptr.get()) < 0)) {
+        init_failed_ = true;
+        flush_audio();
+        return;
+    }
+    venc_->send_frame(frame_ptr.get());
+}
+
+//the muxer of the rendition is ready after some packets without waiting for the video,
+//so the audio is held until the video sequence header, which is delayed by the lookahead of x264
+void abr_output::send_audio(MEDIA_PACKET_PTR pkt_ptr) {
+    set_packet_info(pkt_ptr);
+    if (seq_sent_ || init_failed_) {
+        cb_->on_abr_packet(pkt_ptr);
+        return;
+    }
+    if (pkt_ptr->is_seq_hdr_) {
+        audio_seq_ptr_ = pkt_ptr;
+        return;
+    }
+    audio_queue_.push_back(pkt_ptr);
+    if (audio_queue_.size() > ABR_AUDIO_WAIT_MAX) {
+        audio_queue_.pop_front();
+    }
+}
+
+void abr_output::flush_audio() {
+    if (audio_seq_ptr_) {
+        cb_->on_abr_packet(audio_seq_ptr_);
+        audio_seq_ptr_ = nullptr;
+    }
+    while (!audio_queue_.empty()) {
+        cb_->on_abr_packet(audio_queue_.front());
+        audio_queue_.pop_front();
+    }
+}
+
+void abr_output::set_packet_info(MEDIA_PACKET_PTR pkt_ptr) {
+    pkt_ptr->app_        = app_;
+    pkt_ptr->streamname_ = streamname_;
+    pkt_ptr->key_        = key_;
+}
+
+//the packets of libx264 are annexb, they are changed into flv(avcc) for the hls worker
+void abr_output::on_avpacket_callback(AVPacket* pkt, MEDIA_CODEC_TYPE codec_type,
+                                    uint8_t* extra_data, size_t extra_data_size) {
+    std::vector<es_slice> nalus;
+    std::vector<es_slice> frame_nalus;
+    const uint8_t* sps = nullptr;
+    const uint8_t* pps = nullptr;
+    size_t sps_len = 0;
+    size_t pps_len = 0;
+
+    //only the sps/pps are taken from the extradata, the sei of x264 is not repeated in the frames
+    size_t extra_count = 0;
+    if (extra_data && (extra_data_size > 0)) {
+        annexb_split_nalus(extra_data, extra_data_size, nalus);
+        extra_count = nalus.size();
+    }
+    annexb_split_nalus(pkt->data, pkt->size, nalus);
+    for (size_t index = 0; index < nalus.size(); index++) {
+        const es_slice& nalu = nalus[index];
+        uint8_t nalu_type = nalu.data[0] & 0x1f;
+
+        if (H264_IS_SPS(nalu_type)) {
+            sps = nalu.data;
+            sps_len = nalu.len;
+            continue;
+        }
+        if (H264_IS_PPS(nalu_type)) {
+            pps = nalu.data;
+            pps_len = nalu.len;
+            continue;
+        }
+        if (H264_IS_AUD(nalu_type) || (index < extra_count)) {
+            continue;
+        }
+        frame_nalus.push_back(nalu);
+    }
+
+    if (!seq_sent_) {
+        MEDIA_PACKET_PTR seq_pkt_ptr = std::make_shared<MEDIA_PACKET>();
+        uint8_t flv_header[5] = {0x17, 0x00, 0x00, 0x00, 0x00};
+
+        seq_pkt_ptr->buffer_ptr_->append_data((char*)flv_header, sizeof(flv_header));
+        if (!make_avcc_record(sps, sps_len, pps, pps_len, *seq_pkt_ptr->buffer_ptr_)) {
+            log_errorf("abr output has no sps/pps yet, key:%s", key_.c_str());
+            return;
+        }
+        seq_sent_ = true;
+        seq_pkt_ptr->av_type_    = MEDIA_VIDEO_TYPE;
+        seq_pkt_ptr->codec_type_ = codec_type;
+        seq_pkt_ptr->fmt_type_   = MEDIA_FORMAT_FLV;
+        seq_pkt_ptr->is_seq_hdr_ = true;
+        seq_pkt_ptr->dts_        = pkt->dts;
+        seq_pkt_ptr->pts_        = pkt->dts;
+        set_packet_info(seq_pkt_ptr);
+        cb_->on_abr_packet(seq_pkt_ptr);
+        flush_audio();
+    }
+
+    if (frame_nalus.empty()) {
+        return;
+    }
+    bool is_key = (pkt->flags & AV_PKT_FLAG_KEY) != 0;
+    int64_t cts = (pkt->pts > pkt->dts) ? (pkt->pts - pkt->dts) : 0;
+    MEDIA_PACKET_PTR pkt_ptr = std::make_shared<MEDIA_PACKET>(pkt->size + 5 + 4 * frame_nalus.size());
+    uint8_t* p = (uint8_t*)pkt_ptr->buffer_ptr_->append_space(5);
+
+    p[0] = is_key ? 0x17 : 0x27;
+    p[1] = 0x01;
+    p[2] = (uint8_t)((cts >> 16) & 0xff);
+    p[3] = (uint8_t)((cts >> 8) & 0xff);
+    p[4] = (uint8_t)(cts & 0xff);
+    nalus_to_avcc(frame_nalus, *pkt_ptr->buffer_ptr_);
+
+    pkt_ptr->av_type_      = MEDIA_VIDEO_TYPE;
+    pkt_ptr->codec_type_   = codec_type;
+    pkt_ptr->fmt_type_     = MEDIA_FORMAT_FLV;
+    pkt_ptr->is_key_frame_ = is_key;
+    pkt_ptr->dts_          = pkt->dts;
+    pkt_ptr->pts_          = pkt->pts;
+    set_packet_info(pkt_ptr);
+    cb_->on_abr_packet(pkt_ptr);
+}
+
+abr_transcode::abr_transcode(const std::string& app, const std::string& streamname,
+                        const ABR_RENDITIONS& renditions, encoder_pool* pool,
+                        abr_packet_callbackI* cb):app_(app)
+                                                , streamname_(streamname)
+                                                , pool_(pool)
+{
+    dec_strand_ = std::make_shared<encoder_strand>();
+    dec_ = new decode_oper(this);
+    for (const abr_rendition& rendition : renditions) {
+        outputs_.push_back(std::make_shared<abr_output>(rendition, app, streamname, cb));
+    }
+    log_infof("abr transcode construct app:%s, streamname:%s, renditions:%lu",
+            app_.c_str(), streamname_.c_str(), outputs_.size());
+}
+
+abr_transcode::~abr_transcode()
+{
+    if (dec_) {
+        delete dec_;
+        dec_ = nullptr;
+    }
+    log_infof("abr transcode destruct app:%s, streamname:%s, drop packets:%ld",
+            app_.c_str(), streamname_.c_str(), drop_count_);
+}
+
+//the tasks in the strands only hold weak pointers, the pipeline is released
+//by the last owner: the hls worker or the pool thread running its task
+void abr_transcode::stop() {
+    closed_ = true;
+}
+
+//it's called in the hls worker thread before the mpegts handle changes the packet
+void abr_transcode::input_packet(MEDIA_PACKET_PTR pkt_ptr) {
+    if (closed_) {
+        return;
+    }
+    if (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) {
+        input_video(pkt_ptr);
+    } else if (pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE) {
+        input_audio(pkt_ptr);
+    }
+}
+
+void abr_transcode::input_audio(MEDIA_PACKET_PTR pkt_ptr) {
+    for (std::shared_ptr<abr_output> output : outputs_) {
+        MEDIA_PACKET_PTR copy_pkt_ptr = pkt_ptr->copy();
+        std::weak_ptr<abr_output> weak_output(output);
+        bool ret = pool_->post(output->strand_, [weak_output, copy_pkt_ptr]() {
+            std::shared_ptr<abr_output> output = weak_output.lock();
+            if (output) {
+                output->send_audio(copy_pkt_ptr);
+            }
+        });
+        if (!ret) {
+            output->drop_count_++;
+        }
+    }
+}
+
+void abr_transcode::input_video(MEDIA_PACKET_PTR pkt_ptr) {
+    if (pkt_ptr->codec_type_ != MEDIA_CODEC_H264) {
+        if (drop_count_++ == 0) {
+            log_errorf("abr transcode only supports h264, codec:%s",
+                    codectype_tostring(pkt_ptr->codec_type_).c_str());
+        }
+        return;
+    }
+    size_t header_len = (pkt_ptr->fmt_type_ == MEDIA_FORMAT_FLV) ? 5 : 0;
+    if (pkt_ptr->buffer_ptr_->data_len() <= header_len) {
+        return;
+    }
+    const uint8_t* data = (uint8_t*)pkt_ptr->buffer_ptr_->data() + header_len;
+    size_t data_len = pkt_ptr->buffer_ptr_->data_len() - header_len;
+
+    if (pkt_ptr->is_seq_hdr_) {
+        uint8_t sps[1024];
+        size_t sps_len = 0;
+        uint8_t pps[1024];
+        size_t pps_len = 0;
+
+        if (get_sps_pps_from_extradata(pps, pps_len, sps, sps_len, data, data_len) != 0) {
+            log_errorf("abr transcode get sps/pps error");
+            return;
+        }
+        if (((sizeof(H264_START_CODE) + sps_len) < sizeof(sps_)) &&
+            ((sizeof(H264_START_CODE) + pps_len) < sizeof(pps_))) {
+            memcpy(sps_, H264_START_CODE, sizeof(H264_START_CODE));
+            memcpy(sps_ + sizeof(H264_START_CODE), sps, sps_len);
+            sps_len_ = sizeof(H264_START_CODE) + sps_len;
+            memcpy(pps_, H264_START_CODE, sizeof(H264_START_CODE));
+            memcpy(pps_ + sizeof(H264_START_CODE), pps, pps_len);
+            pps_len_ = sizeof(H264_START_CODE) + pps_len;
+        }
+        return;
+    }
+
+    //the decoder can't go on after a dropped packet until the next keyframe
+    if (wait_keyframe_ && !pkt_ptr->is_key_frame_) {
+        drop_count_++;
+        return;
+    }
+
+    nalus_.clear();
+    if (!avcc_to_nalus(data, data_len, nalus_)) {
+        log_errorf("abr transcode avcc data error, len:%lu", data_len);
+        return;
+    }
+
+    //the decoder has no extradata, so it's given annexb with the sps/pps before the idr
+    bool append_sps_pps = false;
+    slices_.clear();
+    for (const es_slice& nalu : nalus_) {
+        uint8_t nalu_type = nalu.data[0] & 0x1f;
+        if (H264_IS_KEYFRAME(nalu_type) && !append_sps_pps && (sps_len_ > 0) && (pps_len_ > 0)) {
+            slices_.emplace_back(sps_, sps_len_);
+            slices_.emplace_back(pps_, pps_len_);
+            append_sps_pps = true;
+        }
+        slices_.emplace_back(H264_START_CODE, sizeof(H264_START_CODE));
+        slices_.push_back(nalu);
+    }
+
+    AVPacket* pkt = av_packet_alloc();
+    if (av_new_packet(pkt, (int)es_slices_size(slices_)) < 0) {
+        av_packet_free(&pkt);
+        log_errorf("abr transcode av_new_packet error");
+        return;
+    }
+    uint8_t* p = pkt->data;
+    for (const es_slice& slice : slices_) {
+        memcpy(p, slice.data, slice.len);
+        p += slice.len;
+    }
+    pkt->stream_index = VIDEO_STREAM_ID;
+    pkt->dts = pkt_ptr->dts_;
+    pkt->pts = pkt_ptr->pts_;
+
+    std::shared_ptr<AVPacket> pkt_sp(pkt, free_avpacket);
+    std::weak_ptr<abr_transcode> weak_self(shared_from_this());
+    bool ret = pool_->post(dec_strand_, [weak_self, pkt_sp]() {
+        std::shared_ptr<abr_transcode> self = weak_self.lock();
+        if (!self || self->closed_) {
+            return;
+        }
+        self->dec_->input_avpacket(pkt_sp.get(), MEDIA_CODEC_H264, false);
+    });
+    if (!ret) {
+        drop_count_++;
+        wait_keyframe_ = true;
+        return;
+    }
+    wait_keyframe_ = false;
+}
+
+//it's called in the decoder strand, the frame is shared by the outputs without copying
+void abr_transcode::on_avframe_callback(int stream_index, AVFrame* frame) {
+    if ((stream_index != VIDEO_STREAM_ID) || closed_) {
+        return;
+    }
+    for (std::shared_ptr<abr_output> output : outputs_) {
+        AVFRAME_PTR frame_ptr(av_frame_clone(frame), free_avframe);
+        if (!frame_ptr) {
+            continue;
+        }
+        std::weak_ptr<abr_output> weak_output(output);
+        bool ret = pool_->post(output->strand_, [weak_output, frame_ptr]() {
+            std::shared_ptr<abr_output> output = weak_output.lock();
+            if (output) {
+                output->send_frame(frame_ptr);
+            }
+        });
+        if (!ret) {
+            output->drop_count_++;
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef ABR_TRANSCODE_HPP
+#define ABR_TRANSCODE_HPP
+#include "transcode_pub.hpp"
+#include "decode.hpp"
+#include "encode.hpp"
+#include "encoder_pool.hpp"
+#include "utils/av/abr_rendition.hpp"
+#include "utils/av/media_packet.hpp"
+#include "format/h264_header.hpp"
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+
+#define ABR_AUDIO_WAIT_MAX 500//the audio packets held until the video sequence header
+
+//the flv packets of the renditions, it's called in the encoder pool threads
+class abr_packet_callbackI
+{
+public:
+    virtual void on_abr_packet(MEDIA_PACKET_PTR pkt_ptr) = 0;
+};
+
+typedef std::shared_ptr<AVFrame> AVFRAME_PTR;
+
+//one rendition: scale and encode the decoded frames, output flv packets of "streamname_name"
+class abr_output : public encode_callback
+{
+public:
+    abr_output(const abr_rendition& rendition, const std::string& app,
+            const std::string& streamname, abr_packet_callbackI* cb);
+    virtual ~abr_output();
+
+public://called in the strand of the output
+    void send_frame(AVFRAME_PTR frame_ptr);
+    void send_audio(MEDIA_PACKET_PTR pkt_ptr);
+
+public:
+    virtual void on_avpacket_callback(AVPacket* pkt, MEDIA_CODEC_TYPE codec_type,
+                                    uint8_t* extra_data, size_t extra_data_size) override;
+
+public:
+    std::shared_ptr<encoder_strand> strand_;
+    int64_t drop_count_ = 0;
+
+private:
+    int init_encoder(AVFrame* frame);
+    void set_packet_info(MEDIA_PACKET_PTR pkt_ptr);
+    void flush_audio();
+
+private:
+    abr_rendition rendition_;
+    std::string app_;
+    std::string streamname_;
+    std::string key_;
+    abr_packet_callbackI* cb_ = nullptr;
+    video_encode* venc_ = nullptr;
+    bool init_failed_ = false;
+    bool seq_sent_ = false;
+    MEDIA_PACKET_PTR audio_seq_ptr_;
+    std::deque<MEDIA_PACKET_PTR> audio_queue_;
+};
+
+/*
+the abr ladder of one stream: the h264 of the source is decoded once in the
+decoder strand, every decoded frame is encoded by the outputs in their own
+strands. the audio of the source is passed to the outputs without transcoding.
+all the strands run in the shared encoder pool, input_packet only copies the
+packet and posts it, the caller thread is never blocked.
+*/
+class abr_transcode : public decode_callback, public std::enable_shared_from_this<abr_transcode>
+{
+public:
+    abr_transcode(const std::string& app, const std::string& streamname,
+                const ABR_RENDITIONS& renditions, encoder_pool* pool, abr_packet_callbackI* cb);
+    virtual ~abr_transcode();
+
+public:
+    void input_packet(MEDIA_PACKET_PTR pkt_ptr);
+    void stop();
+
+public:
+    virtual void on_avframe_callback(int stream_index, AVFrame* frame) override;
+
+private:
+    void input_video(MEDIA_PACKET_PTR pkt_ptr);
+    void input_audio(MEDIA_PACKET_PTR pkt_ptr);
+
+private:
+    std::string app_;
+    std::string streamname_;
+    encoder_pool* pool_ = nullptr;
+    std::atomic<bool> closed_{false};
+    std::vector<std::shared_ptr<abr_output>> outputs_;
+
+private:
+    std::shared_ptr<encoder_strand> dec_strand_;
+    decode_oper* dec_ = nullptr;
+    bool wait_keyframe_ = true;
+    int64_t drop_count_ = 0;
+
+private:
+    uint8_t sps_[1024];
+    uint8_t pps_[1024];
+    size_t sps_len_ = 0;
+    size_t pps_len_ = 0;
+    std::vector<es_slice> nalus_;
+    std::vector<es_slice> slices_;
+};
+
+#endif
@@ -370,6 +370,10 @@ int video_encode::init_video(const std::string& vcodec, int width, int height, c
     fps.den = framerate;
 
     codec_ctx_->time_base = fps;
+    if (keyframe_follow_) {
+        //keep the millisecond timestamps of the input, the frames are not retimed by the framerate
+        codec_ctx_->time_base = av_make_q(1, 1000);
+    }
     codec_ctx_->bit_rate = bitrate_*1000;
     codec_ctx_->framerate = av_inv_q(fps);
     codec_ctx_->rc_max_rate = codec_ctx_->bit_rate * 1.5;
@@ -394,6 +398,17 @@ int video_encode::init_video(const std::string& vcodec, int width, int height, c
     av_dict_set(&videoopt_p, "keyint_min", szIFrameInterval, 0);
     av_dict_set(&videoopt_p, "g", szIFrameMax, 0);
     av_dict_set(&videoopt_p, "threads", "auto", 0);
+    if (keyframe_follow_) {
+        char szKeyIntMax[80];
+
+        //the idrs come only from the source keyframes, x264 doesn't add any by the min gop
+        sprintf(szKeyIntMax, "%d", framerate*10);
+        av_dict_set(&videoopt_p, "keyint_min", szKeyIntMax, 0);
+        av_dict_set(&videoopt_p, "g", szKeyIntMax, 0);
+        av_dict_set(&videoopt_p, "sc_threshold", "0", 0);
+        av_dict_set(&videoopt_p, "forced-idr", "1", 0);
+        codec_ctx_->gop_size = framerate*10;
+    }
     
     codec_ctx_->flags |= AVFMT_GLOBALHEADER;
 
@@ -457,6 +472,7 @@ int video_encode::send_frame(AVFrame* frame) {
 
     AVFrame* filtered_frame = nullptr;
     AVFrame* input_frame_p = frame;
+    bool force_key = keyframe_follow_ && frame && frame->key_frame;
     while (true) {
         ret = filter_.filter_write_frame(input_frame_p, VIDEO_STREAM_ID, &filtered_frame);
         if ((ret  < 0) || (filtered_frame == nullptr)) {
@@ -466,7 +482,8 @@ int video_encode::send_frame(AVFrame* frame) {
             return ret;
         }
         input_frame_p = nullptr;//set nullptr for only reading in next time
-        filtered_frame->pict_type = AV_PICTURE_TYPE_NONE;
+        filtered_frame->pict_type = force_key ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+        force_key = false;
     
         AVRational filter_tb = filter_.get_outputlink_timebase(VIDEO_STREAM_ID);
         filtered_frame->pts = av_rescale_q(filtered_frame->pts, filter_tb, codec_ctx_->time_base);
@@ -496,6 +513,9 @@ int video_encode::send_frame(AVFrame* frame) {
             video_pkt_p->pts = (video_pkt_p->pts < 0) ? 0 :video_pkt_p->pts;
             video_pkt_p->dts = (video_pkt_p->dts < 0) ? 0 :video_pkt_p->dts;
             video_pkt_p->stream_index = VIDEO_STREAM_ID;
+            if (keyframe_follow_) {
+                av_packet_rescale_ts(video_pkt_p, codec_ctx_->time_base, standard_tb);
+            }
 
             if (cb_) {
                 cb_->on_avpacket_callback(video_pkt_p, video_codec_type_, extra_data_, extra_data_size_);
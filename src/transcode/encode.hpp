@@ -69,6 +69,9 @@ public:
 public:
     int init_video(const std::string& vcodec, int width, int height, const std::string& profile, const std::string& preset, int bitrate, int framerate);
     void release_video();
+    //called before init_video: the idr frames are only made at the keyframes of the input,
+    //so the encoders of one source make their keyframes at the same timestamps.
+    void set_keyframe_follow(bool enable) { keyframe_follow_ = enable; }
 
 public:
     virtual int send_frame(AVFrame* frame) override;
@@ -80,6 +83,7 @@ private:
     std::string preset_;
     int bitrate_   = 0;
     int framerate_ = 0;
+    bool keyframe_follow_ = false;
 };
 
 #endif
@@ -0,0 +1,111 @@
+#include "encoder_pool.hpp"
+#include "utils/logger.hpp"
+
+//the tasks run in one turn of the strand, then the other strands get the thread
+#define ENCODER_STRAND_BATCH 8
+
+encoder_pool::encoder_pool(size_t thread_count):thread_count_(thread_count)
+{
+    if (thread_count_ == 0) {
+        thread_count_ = 1;
+    }
+}
+
+encoder_pool::~encoder_pool()
+{
+    stop();
+}
+
+void encoder_pool::start() {
+    if (run_flag_) {
+        return;
+    }
+    run_flag_ = true;
+    for (size_t index = 0; index < thread_count_; index++) {
+        threads_.push_back(std::make_shared<std::thread>(&encoder_pool::on_work, this));
+    }
+    log_infof("encoder pool is running, thread count:%lu", thread_count_);
+}
+
+void encoder_pool::stop() {
+    if (!run_flag_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> locker(ready_mutex_);
+        run_flag_ = false;
+    }
+    ready_cond_.notify_all();
+    for (auto thread_ptr : threads_) {
+        thread_ptr->join();
+    }
+    threads_.clear();
+    ready_strands_.clear();
+}
+
+bool encoder_pool::post(std::shared_ptr<encoder_strand> strand, ENCODER_TASK task) {
+    {
+        std::lock_guard<std::mutex> locker(strand->mutex_);
+        if (strand->tasks_.size() >= strand->queue_max_) {
+            return false;
+        }
+        strand->tasks_.push_back(std::move(task));
+        if (strand->scheduled_) {
+            return true;
+        }
+        strand->scheduled_ = true;
+    }
+
+    {
+        std::lock_guard<std::mutex> locker(ready_mutex_);
+        ready_strands_.push_back(strand);
+    }
+    ready_cond_.notify_one();
+    return true;
+}
+
+void encoder_pool::on_work() {
+    while (true) {
+        std::shared_ptr<encoder_strand> strand;
+        {
+            std::unique_lock<std::mutex> locker(ready_mutex_);
+            ready_cond_.wait(locker, [this]() {
+                return !run_flag_ || !ready_strands_.empty();
+            });
+            if (!run_flag_) {
+                break;
+            }
+            strand = ready_strands_.front();
+            ready_strands_.pop_front();
+        }
+
+        //scheduled_ is kept during the batch, so no other thread runs the strand
+        for (int count = 0; count < ENCODER_STRAND_BATCH; count++) {
+            ENCODER_TASK task;
+            {
+                std::lock_guard<std::mutex> locker(strand->mutex_);
+                if (strand->tasks_.empty()) {
+                    break;
+                }
+                task = std::move(strand->tasks_.front());
+                strand->tasks_.pop_front();
+            }
+            task();
+        }
+
+        bool more = false;
+        {
+            std::lock_guard<std::mutex> locker(strand->mutex_);
+            more = !strand->tasks_.empty();
+            if (!more) {
+                strand->scheduled_ = false;
+            }
+        }
+
+        if (more) {
+            //the strand is still scheduled, put it back to the tail for fairness
+            std::lock_guard<std::mutex> locker(ready_mutex_);
+            ready_strands_.push_back(strand);
+        }
+    }
+}
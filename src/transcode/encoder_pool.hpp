@@ -0,0 +1,79 @@
+#ifndef ENCODER_POOL_HPP
+#define ENCODER_POOL_HPP
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+#define ENCODER_POOL_DEF_THREADS   2
+#define ENCODER_STRAND_QUEUE_MAX   60
+
+typedef std::function<void()> ENCODER_TASK;
+
+/*
+the tasks posted to one strand run in order and never at the same time,
+so a decoder or an encoder which is not thread safe can run on any pool thread.
+the queue of the strand is bounded, the post fails when it's full.
+*/
+class encoder_strand
+{
+friend class encoder_pool;
+public:
+    encoder_strand(size_t queue_max = ENCODER_STRAND_QUEUE_MAX):queue_max_(queue_max)
+    {
+    }
+    ~encoder_strand()
+    {
+    }
+
+    size_t queue_size() {
+        std::lock_guard<std::mutex> locker(mutex_);
+        return tasks_.size();
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<ENCODER_TASK> tasks_;
+    size_t queue_max_ = ENCODER_STRAND_QUEUE_MAX;
+    bool scheduled_ = false;//it's in the ready queue of the pool or running
+};
+
+/*
+a fixed number of threads for the transcoding work, the encoders can't
+take more cpu than the pool threads and never run in the io loops.
+*/
+class encoder_pool
+{
+public:
+    encoder_pool(size_t thread_count = ENCODER_POOL_DEF_THREADS);
+    ~encoder_pool();
+
+public:
+    void start();
+    void stop();
+    size_t thread_count() { return thread_count_; }
+
+    //return false when the queue of the strand is full, the task is not posted
+    bool post(std::shared_ptr<encoder_strand> strand, ENCODER_TASK task);
+
+private:
+    void on_work();
+
+private:
+    size_t thread_count_ = ENCODER_POOL_DEF_THREADS;
+    std::atomic<bool> run_flag_{false};
+    std::vector<std::shared_ptr<std::thread>> threads_;
+
+private:
+    std::mutex ready_mutex_;
+    std::condition_variable ready_cond_;
+    std::deque<std::shared_ptr<encoder_strand>> ready_strands_;
+};
+
+#endif
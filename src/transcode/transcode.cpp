@@ -1,9 +1,9 @@
 #include "transcode.hpp"
 #include "utils/logger.hpp"
-#include <chrono>
-#include <functional>
+#include "utils/timeex.hpp"
 
-transcode::transcode()
+transcode::transcode():send_queue_(TRANSCODE_QUEUE_SIZE)
+                      , recv_queue_(TRANSCODE_QUEUE_SIZE)
 {
     dec_ = new decode_oper(this);
     output_audio_fmt_ = "libfdk_aac";
@@ -34,7 +34,7 @@ void transcode::start() {
         return;
     }
     run_ = true;
-    thread_ptr_ = std::make_shared<std::thread>(std::bind(&transcode::on_work, this));
+    worker_ = transcode_pool::instance().add_job(this);
 }
 
 void transcode::stop() {
@@ -42,27 +42,21 @@ void transcode::stop() {
         return;
     }
     run_ = false;
-    thread_ptr_->join();
+    worker_->remove_job(this);
+    worker_ = nullptr;
     clear();
     return;
 }
 
 void transcode::clear() {
-    do {
-        std::unique_lock<std::mutex> locker(send_mutex_);
-        while(!send_queue_.empty()) {
-            rtp_packet_info info = send_queue_.front();
-            send_queue_.pop();
-            av_packet_free(&info.pkt);
-        }
-    } while(0);
-    
-    do {
-        std::unique_lock<std::mutex> locker(recv_mutex_);
-        while(!recv_queue_.empty()) {
-            recv_queue_.pop();
-        }
-    } while(0);
+    rtp_packet_info info;
+    while (send_queue_.pop(info)) {
+        av_packet_free(&info.pkt);
+    }
+
+    MEDIA_PACKET_PTR pkt_ptr;
+    while (recv_queue_.pop(pkt_ptr)) {
+    }
     return;
 }
 
@@ -86,62 +80,47 @@ void transcode::set_audio_bitrate(int bitrate) {
     audio_bitrate_ = bitrate;
 }
 
-void transcode::insert_send_queue(rtp_packet_info info) {
-    std::unique_lock<std::mutex> locker(send_mutex_);
-    send_queue_.push(info);
-}
-
-AVPacket* transcode::get_send_queue(MEDIA_CODEC_TYPE& codec_type) {
-    std::unique_lock<std::mutex> locker(send_mutex_);
-    if (send_queue_.empty()) {
-        return nullptr;
-    }
-    rtp_packet_info info = send_queue_.front();
-    send_queue_.pop();
-    
-    codec_type = info.codec_type;
-    return info.pkt;
-}
-
 void transcode::insert_recv_queue(MEDIA_PACKET_PTR pkt_ptr) {
-    std::unique_lock<std::mutex> locker(recv_mutex_);
-    
-    recv_queue_.push(pkt_ptr);
+    if (!recv_queue_.push(pkt_ptr)) {
+        //the io thread doesn't take the output
+        output_drop_count_++;
+    }
 }
 
+void transcode::update_latency(int64_t latency_us) {
+    int64_t smoothed = latency_us_.load(std::memory_order_relaxed);
 
-MEDIA_PACKET_PTR transcode::get_recv_queue() {
-    std::unique_lock<std::mutex> locker(recv_mutex_);
-    MEDIA_PACKET_PTR pkt_ptr;
-    
-    if (recv_queue_.empty()) {
-        return pkt_ptr;
+    smoothed = (smoothed == 0) ? latency_us : (smoothed * 7 + latency_us) / 8;
+    latency_us_.store(smoothed, std::memory_order_relaxed);
+    if (latency_us > max_latency_us_.load(std::memory_order_relaxed)) {
+        max_latency_us_.store(latency_us, std::memory_order_relaxed);
     }
-    pkt_ptr = recv_queue_.front();
-    recv_queue_.pop();
-    
-    return pkt_ptr;
+    done_count_.fetch_add(1, std::memory_order_relaxed);
 }
 
+bool transcode::run_job() {
+    rtp_packet_info info;
 
-void transcode::on_work() {
-    log_infof("transcode work thread is running...");
-    while(run_) {
-        if (!dec_) {
-            break;
-        }
-        MEDIA_CODEC_TYPE codec_type = MEDIA_CODEC_UNKOWN;
-        AVPacket* pkt = get_send_queue(codec_type);
-        if (!pkt) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(5));
-            continue;
+    for (int count = 0; count < TRANSCODE_JOB_BATCH; count++) {
+        if (!send_queue_.pop(info)) {
+            return false;
         }
-        
-        dec_->input_avpacket(pkt, codec_type);
-        av_packet_free(&pkt);
+        //the encoded packets are output in the callbacks of the decoder
+        dec_->input_avpacket(info.pkt, info.codec_type);
+        av_packet_free(&info.pkt);
+        update_latency(now_microsec() - info.input_us);
     }
-    log_infof("transcode work thread is over...");
-    return;
+    return send_queue_.size() > 0;
+}
+
+void transcode::get_statics(json& data_json) {
+    data_json["name"]            = name_;
+    data_json["queue"]           = send_queue_.size();
+    data_json["latency_us"]      = latency_us_.load(std::memory_order_relaxed);
+    data_json["max_latency_us"]  = max_latency_us_.load(std::memory_order_relaxed);
+    data_json["packets"]         = done_count_.load(std::memory_order_relaxed);
+    data_json["input_drops"]     = input_drop_count_.load(std::memory_order_relaxed);
+    data_json["output_drops"]    = output_drop_count_.load(std::memory_order_relaxed);
 }
 
 void transcode::on_avpacket_callback(AVPacket* pkt, MEDIA_CODEC_TYPE codec_type,
@@ -270,16 +249,33 @@ int transcode::send_transcode(MEDIA_PACKET_PTR pkt_ptr, int pos) {
     if (pkt == nullptr) {
         return -1;
     }
+    if (!run_) {
+        av_packet_free(&pkt);
+        return -1;
+    }
     rtp_packet_info info;
-    info.pkt = pkt;
+    info.pkt        = pkt;
     info.codec_type = pkt_ptr->codec_type_;
-    
-    insert_send_queue(info);
+    info.input_us   = now_microsec();
+
+    if (!send_queue_.push(info)) {
+        //the worker is too busy, the packet is dropped instead of growing the delay
+        if ((input_drop_count_++ % 100) == 0) {
+            log_warnf("transcode(%s) input queue is full, drop count:%ld",
+                    name_.c_str(), input_drop_count_.load());
+        }
+        av_packet_free(&pkt);
+        return -1;
+    }
+    worker_->wakeup();
     return 0;
 }
 
 MEDIA_PACKET_PTR transcode::recv_transcode() {
-    return get_recv_queue();
+    MEDIA_PACKET_PTR pkt_ptr;
+
+    recv_queue_.pop(pkt_ptr);
+    return pkt_ptr;
 }
 
 
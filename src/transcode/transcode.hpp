@@ -6,11 +6,20 @@
 #include "transcode_pub.hpp"
 #include "decode.hpp"
 #include "encode.hpp"
+#include "transcode_pool.hpp"
+#include "utils/spsc_queue.hpp"
 #include <memory>
-#include <queue>
-#include <thread>
-#include <mutex>
+#include <atomic>
+#include <string>
 
+#define TRANSCODE_QUEUE_SIZE 256
+#define TRANSCODE_JOB_BATCH  16//the packets decoded in one turn, then the other jobs of the worker run
+
+/*
+the transcode runs on a thread of the transcode pool. the packets are exchanged
+with the io thread by two lock-free rings: input(io thread to worker) and
+output(worker to io thread).
+*/
 class transcode : public decode_callback, public encode_callback
 {
     class rtp_packet_info
@@ -18,6 +27,7 @@ class transcode : public decode_callback, public encode_callback
     public:
         AVPacket* pkt = nullptr;
         MEDIA_CODEC_TYPE codec_type = MEDIA_CODEC_UNKOWN;
+        int64_t input_us = 0;
     };
 public:
     transcode();
@@ -29,11 +39,19 @@ public:
     void set_output_format(MEDIA_FORMAT_TYPE format);
     void set_video_bitrate(int bitrate);
     void set_audio_bitrate(int bitrate);
+    void set_name(const std::string& name) { name_ = name; }
     void start();
     void stop();
     int send_transcode(MEDIA_PACKET_PTR pkt_ptr, int pos = 0);
     MEDIA_PACKET_PTR recv_transcode();
 
+public://called in the worker thread
+    //return true when the input ring still has packets
+    bool run_job();
+
+public://called in any thread, the statics are atomic
+    void get_statics(json& data_json);
+
 public:
     virtual void on_avframe_callback(int stream_index, AVFrame* frame) override;
 
@@ -45,25 +63,28 @@ private:
     MEDIA_PACKET_PTR get_media_packet(AVPacket* pkt, MEDIA_CODEC_TYPE codec_type);
 
 private:
-    void insert_send_queue(rtp_packet_info info);
-    AVPacket* get_send_queue(MEDIA_CODEC_TYPE& codec_type);
-    void on_work();
     void insert_recv_queue(MEDIA_PACKET_PTR pkt_ptr);
-    MEDIA_PACKET_PTR get_recv_queue();
+    void update_latency(int64_t latency_us);
     void clear();
     
 private:
     bool run_ = false;
+    std::string name_;
     MEDIA_FORMAT_TYPE output_format_ = MEDIA_FORMAT_RAW;
     std::string output_audio_fmt_;
     int audio_samplerate_ = 48000;
     int video_bitrate_ = 1000;//1000kbps
     int audio_bitrate_ = 64;//64kbps
-    std::shared_ptr<std::thread> thread_ptr_;
-    std::mutex send_mutex_;
-    std::mutex recv_mutex_;
-    std::queue<rtp_packet_info> send_queue_;
-    std::queue<MEDIA_PACKET_PTR> recv_queue_;
+    transcode_worker* worker_ = nullptr;
+    spsc_queue<rtp_packet_info> send_queue_;//io thread to worker
+    spsc_queue<MEDIA_PACKET_PTR> recv_queue_;//worker to io thread
+
+private://statics, written in the worker thread except the input drops
+    std::atomic<int64_t> latency_us_{0};//smoothed time from the input to the output of a packet
+    std::atomic<int64_t> max_latency_us_{0};
+    std::atomic<int64_t> done_count_{0};
+    std::atomic<int64_t> input_drop_count_{0};
+    std::atomic<int64_t> output_drop_count_{0};
     
 private:
     decode_oper* dec_ = nullptr;
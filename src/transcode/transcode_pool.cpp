@@ -0,0 +1,185 @@
+#include "transcode_pool.hpp"
+#include "transcode.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+
+transcode_worker::transcode_worker(size_t index):index_(index)
+{
+}
+
+transcode_worker::~transcode_worker()
+{
+    stop();
+}
+
+void transcode_worker::start() {
+    if (run_flag_) {
+        return;
+    }
+    run_flag_ = true;
+    thread_ptr_ = std::make_shared<std::thread>(&transcode_worker::on_work, this);
+}
+
+void transcode_worker::stop() {
+    if (!run_flag_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> locker(wake_mutex_);
+        run_flag_ = false;
+    }
+    wake_cond_.notify_one();
+    thread_ptr_->join();
+    thread_ptr_ = nullptr;
+}
+
+void transcode_worker::add_job(transcode* job) {
+    std::lock_guard<std::mutex> locker(jobs_mutex_);
+    jobs_.push_back(job);
+    job_count_ = jobs_.size();
+}
+
+void transcode_worker::remove_job(transcode* job) {
+    std::unique_lock<std::mutex> locker(jobs_mutex_);
+    auto iter = std::find(jobs_.begin(), jobs_.end(), job);
+    if (iter != jobs_.end()) {
+        jobs_.erase(iter);
+    }
+    job_count_ = jobs_.size();
+
+    //the job isn't used after it's removed, only its own turn is waited for
+    done_cond_.wait(locker, [this, job]() {
+        return running_job_ != job;
+    });
+}
+
+void transcode_worker::wakeup() {
+    {
+        std::lock_guard<std::mutex> locker(wake_mutex_);
+        if (pending_) {
+            return;
+        }
+        pending_ = true;
+    }
+    wake_cond_.notify_one();
+}
+
+void transcode_worker::on_work() {
+    log_infof("transcode worker(%lu) is running...", index_);
+    while (true) {
+        {
+            std::unique_lock<std::mutex> locker(wake_mutex_);
+            wake_cond_.wait(locker, [this]() {
+                return !run_flag_ || pending_;
+            });
+            if (!run_flag_) {
+                break;
+            }
+            //the packets pushed after it wake up the worker again
+            pending_ = false;
+        }
+
+        bool more = false;
+        {
+            std::lock_guard<std::mutex> locker(jobs_mutex_);
+            run_jobs_ = jobs_;
+        }
+        for (transcode* job : run_jobs_) {
+            {
+                //the job removed in this turn is skipped
+                std::lock_guard<std::mutex> locker(jobs_mutex_);
+                if (std::find(jobs_.begin(), jobs_.end(), job) == jobs_.end()) {
+                    continue;
+                }
+                running_job_ = job;
+            }
+            bool job_more = job->run_job();
+            {
+                std::lock_guard<std::mutex> locker(jobs_mutex_);
+                running_job_ = nullptr;
+            }
+            done_cond_.notify_all();
+            more = more || job_more;
+        }
+
+        if (more) {
+            std::lock_guard<std::mutex> locker(wake_mutex_);
+            pending_ = true;
+        }
+    }
+    log_infof("transcode worker(%lu) is over...", index_);
+}
+
+void transcode_worker::get_statics(json& data_json) {
+    auto jobs_json = json::array();
+    size_t queue_depth = 0;
+
+    //the statics of the jobs are atomic, the jobs aren't waited for
+    {
+        std::lock_guard<std::mutex> locker(jobs_mutex_);
+        for (transcode* job : jobs_) {
+            auto job_json = json::object();
+            job->get_statics(job_json);
+            queue_depth += job_json["queue"].get<size_t>();
+            jobs_json.push_back(job_json);
+        }
+    }
+    data_json["index"] = index_;
+    data_json["queue"] = queue_depth;
+    data_json["jobs"]  = jobs_json;
+}
+
+transcode_pool& transcode_pool::instance() {
+    static transcode_pool s_pool(std::thread::hardware_concurrency());
+
+    return s_pool;
+}
+
+transcode_pool::transcode_pool(size_t thread_count)
+{
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+    for (size_t index = 0; index < thread_count; index++) {
+        workers_.emplace_back(new transcode_worker(index));
+        workers_.back()->start();
+    }
+    log_infof("transcode pool is running, thread count:%lu", thread_count);
+}
+
+transcode_pool::~transcode_pool()
+{
+    for (auto& worker : workers_) {
+        worker->stop();
+    }
+}
+
+transcode_worker* transcode_pool::add_job(transcode* job) {
+    std::lock_guard<std::mutex> locker(mutex_);
+    transcode_worker* selected = workers_[0].get();
+
+    for (auto& worker : workers_) {
+        if (worker->job_count() < selected->job_count()) {
+            selected = worker.get();
+        }
+    }
+    selected->add_job(job);
+    return selected;
+}
+
+void transcode_pool::get_statics(json& data_json) {
+    auto workers_json = json::array();
+
+    for (auto& worker : workers_) {
+        auto worker_json = json::object();
+        worker->get_statics(worker_json);
+        workers_json.push_back(worker_json);
+    }
+    data_json["threads"] = workers_.size();
+    data_json["workers"] = workers_json;
+}
+
+int get_transcode_statics(json& data_json) {
+    transcode_pool::instance().get_statics(data_json);
+    return 0;
+}
@@ -0,0 +1,88 @@
+#ifndef TRANSCODE_POOL_HPP
+#define TRANSCODE_POOL_HPP
+#include "json.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+class transcode;
+
+/*
+one thread of the transcode pool and the transcodes pinned to it.
+the thread sleeps on the condition until a transcode gets packets, then it
+drains the input rings of its transcodes. a transcode always runs on the
+same thread, so its decoder and encoder need no lock.
+*/
+class transcode_worker
+{
+public:
+    transcode_worker(size_t index);
+    ~transcode_worker();
+
+public:
+    void start();
+    void stop();
+    void add_job(transcode* job);
+    //it only waits for the job itself when it's running, not the other jobs
+    void remove_job(transcode* job);
+    //called by the producer after the packet is in the input ring of the job
+    void wakeup();
+    size_t job_count() { return job_count_; }
+    void get_statics(json& data_json);
+
+private:
+    void on_work();
+
+private:
+    size_t index_ = 0;
+    std::shared_ptr<std::thread> thread_ptr_;
+    std::atomic<bool> run_flag_{false};
+    std::atomic<size_t> job_count_{0};
+
+private:
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cond_;
+    bool pending_ = false;
+
+private:
+    std::mutex jobs_mutex_;//not held when the jobs run
+    std::condition_variable done_cond_;
+    std::vector<transcode*> jobs_;
+    transcode* running_job_ = nullptr;
+    std::vector<transcode*> run_jobs_;//only in the worker thread: the jobs of this turn
+};
+
+/*
+the fixed threads for the audio transcodes(aac<->opus) of all the streams,
+the thread count is the cpu core count instead of the stream count.
+a new transcode is pinned to the worker with the fewest jobs.
+*/
+class transcode_pool
+{
+public:
+    static transcode_pool& instance();
+    ~transcode_pool();
+
+public:
+    transcode_worker* add_job(transcode* job);
+    size_t thread_count() { return workers_.size(); }
+    void get_statics(json& data_json);
+
+private:
+    transcode_pool(size_t thread_count);
+
+private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<transcode_worker>> workers_;
+};
+
+int get_transcode_statics(json& data_json);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef ABR_RENDITION_HPP
+#define ABR_RENDITION_HPP
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define ABR_DEF_FRAMERATE    25
+#define ABR_AUDIO_BANDWIDTH  128000 //bps, the audio of the source is kept in every rendition
+
+//one output of the abr ladder, the stream is published as "streamname_name"
+class abr_rendition
+{
+public:
+    std::string name;//eg: "720p"
+    int width   = 0;
+    int height  = 0;
+    int bitrate = 0;//kbps
+    int framerate = ABR_DEF_FRAMERATE;
+};
+
+typedef std::vector<abr_rendition> ABR_RENDITIONS;
+
+#endif
@@ -126,6 +126,15 @@ void media_stream_manager::remove_publisher(const std::string& stream_key) {
     return;
 }
 
+int media_stream_manager::writer_gop(const std::string& stream_key, av_writer_base* writer_p) {
+    auto iter = media_streams_map_.find(stream_key);
+    if (iter == media_streams_map_.end()) {
+        log_warnf("fail to find stream key:%s to write gop", stream_key.c_str());
+        return -1;
+    }
+    return iter->second->cache_.writer_gop(writer_p);
+}
+
 void media_stream_manager::set_hls_writer(av_writer_base* writer) {
     hls_writer_ = writer;
 }
@@ -177,8 +186,8 @@ int media_stream_manager::writer_media_packet(MEDIA_PACKET_PTR pkt_ptr) {
     }
 
     if (media_stream_manager::r2r_writer_) {
-        MEDIA_PACKET_PTR new_pkt_ptr = pkt_ptr->copy();
-        media_stream_manager::r2r_writer_->write_packet(new_pkt_ptr);
+        //the bridge only reads the packet, it works when the stream has webrtc viewers
+        media_stream_manager::r2r_writer_->write_packet(pkt_ptr);
     }
 
     if (media_stream_manager::hls_writer_) {
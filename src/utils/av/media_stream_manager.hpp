@@ -51,6 +51,8 @@ public:
 
 public:
     static int writer_media_packet(MEDIA_PACKET_PTR pkt_ptr);
+    //write the cached gop of the stream, it starts from the latest key frame
+    static int writer_gop(const std::string& stream_key, av_writer_base* writer_p);
 
 public:
     static void add_stream_callback(stream_manager_callbackI* cb) {
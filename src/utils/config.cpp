@@ -189,6 +189,89 @@ int Config::init_hls(json& json_object) {
         hls_config_.hls_path = hls_path_iter->get<std::string>();
     }
 
+    auto worker_count_iter = json_object.find("worker_count");
+    if (worker_count_iter != json_object.end()) {
+        int worker_count = worker_count_iter->get<int>();
+        hls_config_.worker_count = (worker_count > 0) ? (size_t)worker_count : HLS_DEF_WORKER_COUNT;
+    }
+
+    auto http_port_iter = json_object.find("http_port");
+    if (http_port_iter != json_object.end()) {
+        hls_config_.http_port = (uint16_t)http_port_iter->get<int>();
+    }
+
+    auto low_latency_iter = json_object.find("low_latency");
+    if (low_latency_iter != json_object.end()) {
+        hls_config_.low_latency = low_latency_iter->get<bool>();
+    }
+
+    auto part_duration_iter = json_object.find("part_duration");
+    if (part_duration_iter != json_object.end()) {
+        hls_config_.part_duration = part_duration_iter->get<int>();
+    }
+
+    auto fmp4_iter = json_object.find("fmp4");
+    if (fmp4_iter != json_object.end()) {
+        hls_config_.fmp4 = fmp4_iter->get<bool>();
+    }
+
+    auto dvr_window_iter = json_object.find("dvr_window");
+    if (dvr_window_iter != json_object.end()) {
+        int dvr_window = dvr_window_iter->get<int>();
+        hls_config_.dvr_window = (dvr_window > 0) ? dvr_window : HLS_DEF_DVR_WINDOW;
+    }
+
+    auto abr_iter = json_object.find("abr");
+    if (abr_iter != json_object.end()) {
+        return init_hls_abr(*abr_iter);
+    }
+    return 0;
+}
+
+int Config::init_hls_abr(json& json_object) {
+    auto threads_iter = json_object.find("threads");
+    if (threads_iter != json_object.end()) {
+        int threads = threads_iter->get<int>();
+        hls_config_.abr_threads = (threads > 0) ? (size_t)threads : HLS_DEF_ABR_THREADS;
+    }
+
+    auto apps_iter = json_object.find("apps");
+    if (apps_iter == json_object.end()) {
+        return 0;
+    }
+    for (auto& app_item : apps_iter->items()) {
+        ABR_RENDITIONS renditions;
+
+        for (auto& rendition_json : app_item.value()) {
+            abr_rendition rendition;
+
+            auto name_iter = rendition_json.find("name");
+            auto bitrate_iter = rendition_json.find("bitrate");
+            if ((name_iter == rendition_json.end()) || (bitrate_iter == rendition_json.end())) {
+                std::cout << "hls abr rendition needs name and bitrate, app:" << app_item.key() << "\r\n";
+                return -1;
+            }
+            rendition.name    = name_iter->get<std::string>();
+            rendition.bitrate = bitrate_iter->get<int>();
+
+            auto width_iter = rendition_json.find("width");
+            if (width_iter != rendition_json.end()) {
+                rendition.width = width_iter->get<int>();
+            }
+            auto height_iter = rendition_json.find("height");
+            if (height_iter != rendition_json.end()) {
+                rendition.height = height_iter->get<int>();
+            }
+            auto framerate_iter = rendition_json.find("framerate");
+            if (framerate_iter != rendition_json.end()) {
+                rendition.framerate = framerate_iter->get<int>();
+            }
+            renditions.push_back(rendition);
+        }
+        if (!renditions.empty()) {
+            hls_config_.abr_apps[app_item.key()] = renditions;
+        }
+    }
     return 0;
 }
 
@@ -261,6 +344,12 @@ int Config::init_webrtc(json& json_object) {
         webrtc_config_.udp_port = (uint16_t)udp_port_iter->get<int>();
     }
 
+    auto workers_iter = json_object.find("workers");
+    if (workers_iter != json_object.end()) {
+        int workers = workers_iter->get<int>();
+        webrtc_config_.workers = (workers > 0) ? (size_t)workers : 1;
+    }
+
     auto candidat_ip_iter = json_object.find("candidate_ip");
     if (candidat_ip_iter != json_object.end()) {
         webrtc_config_.candidate_ip = candidat_ip_iter->get<std::string>();
@@ -282,6 +371,12 @@ int Config::init_webrtc(json& json_object) {
         webrtc_config_.rtmp2rtc_enable = rtmp2rtc_iter->get<bool>();
     }
 
+    auto rtmp2rtc_idle_iter = json_object.find("rtmp2rtc_idle_timeout");
+    if (rtmp2rtc_idle_iter != json_object.end()) {
+        int idle_timeout = rtmp2rtc_idle_iter->get<int>();
+        webrtc_config_.rtmp2rtc_idle_timeout = (idle_timeout > 0) ? idle_timeout : 10;
+    }
+
     auto min_kbps_iter = json_object.find("min_kbps");
     if (min_kbps_iter != json_object.end()) {
         webrtc_config_.min_kbps = min_kbps_iter->get<int>();
@@ -302,6 +397,12 @@ int Config::init_webrtc(json& json_object) {
     } else {
         webrtc_config_.start_kbps = 800;
     }
+
+    auto pacing_factor_iter = json_object.find("pacing_factor");
+    if (pacing_factor_iter != json_object.end()) {
+        double pacing_factor = pacing_factor_iter->get<double>();
+        webrtc_config_.pacing_factor = (pacing_factor > 0) ? pacing_factor : 0;
+    }
     return 0;
 }
 
@@ -465,6 +566,38 @@ int Config::mpegts_duration() {
     return hls_config_.ts_duration;
 }
 
+size_t Config::hls_worker_count() {
+    return hls_config_.worker_count;
+}
+
+uint16_t Config::hls_http_port() {
+    return hls_config_.http_port;
+}
+
+bool Config::hls_low_latency() {
+    return hls_config_.low_latency;
+}
+
+int Config::hls_part_duration() {
+    return hls_config_.part_duration;
+}
+
+bool Config::hls_fmp4_enable() {
+    return hls_config_.fmp4;
+}
+
+int Config::hls_dvr_window() {
+    return hls_config_.dvr_window;
+}
+
+size_t Config::hls_abr_threads() {
+    return hls_config_.abr_threads;
+}
+
+const std::map<std::string, ABR_RENDITIONS>& Config::hls_abr_apps() {
+    return hls_config_.abr_apps;
+}
+
 bool Config::webrtc_is_enable() {
     return webrtc_config_.webrtc_enable;
 }
@@ -489,6 +622,10 @@ uint16_t Config::webrtc_udp_port() {
     return webrtc_config_.udp_port;
 }
 
+size_t Config::webrtc_workers() {
+    return webrtc_config_.workers;
+}
+
 std::string Config::candidate_ip() {
     return webrtc_config_.candidate_ip;
 }
@@ -497,6 +634,10 @@ bool Config::rtmp2rtc_is_enable() {
     return webrtc_config_.rtmp2rtc_enable;
 }
 
+int Config::rtmp2rtc_idle_timeout() {
+    return webrtc_config_.rtmp2rtc_idle_timeout;
+}
+
 bool Config::rtc2rtmp_is_enable() {
     return webrtc_config_.rtc2rtmp_enable;
 }
@@ -512,3 +653,7 @@ int Config::max_kbps() {
 int Config::start_kbps() {
     return webrtc_config_.start_kbps;
 }
+
+double Config::pacing_factor() {
+    return webrtc_config_.pacing_factor;
+}
@@ -3,11 +3,13 @@
 
 #include "json.hpp"
 #include "logger.hpp"
+#include "av/abr_rendition.hpp"
 
 #include <stdint.h>
 #include <stddef.h>
 #include <string>
 #include <sstream>
+#include <map>
 
 using json = nlohmann::json;
 
@@ -19,6 +21,10 @@ using json = nlohmann::json;
 #define WEBSOCKET_DEF_PORT 9000
 #define HLS_MPEGTS_DEF_DURATION 5000 //ms
 #define HLS_DEF_PATH "./hls"
+#define HLS_DEF_WORKER_COUNT 1
+#define HLS_DEF_PART_DURATION 500 //ms
+#define HLS_DEF_ABR_THREADS 2
+#define HLS_DEF_DVR_WINDOW 0 //seconds, 0: disable
 
 #define CONFIG_DATA_BUFFER (30*1000)
 
@@ -63,12 +69,15 @@ public:
         ss << "  tls key: " << tls_key << "\r\n";
         ss << "  tls cert: " << tls_cert << "\r\n";
         ss << "  webrtc udp: " << udp_port << "\r\n";
+        ss << "  workers: " << workers << "\r\n";
         ss << "  candidate ip: " << candidate_ip << "\r\n";
         ss << "  rtmp2rtc: " << rtmp2rtc_enable << "\r\n";
+        ss << "  rtmp2rtc idle timeout: " << rtmp2rtc_idle_timeout << "\r\n";
         ss << "  rtc2rtmp: " << rtc2rtmp_enable << "\r\n";
         ss << "  min kbps:" << min_kbps << "\r\n";
         ss << "  max kbps:" << max_kbps << "\r\n";
         ss << "  start kbps:" << start_kbps << "\r\n";
+        ss << "  pacing factor:" << pacing_factor << "\r\n";
 
         return ss.str();
     }
@@ -80,12 +89,15 @@ public:
     std::string tls_key;
     std::string tls_cert;
     uint16_t udp_port = WEBRTC_UDP_PORT;
+    size_t workers = 1;//more than 1: the reuseport udp sockets with their own threads
     std::string candidate_ip;
     bool rtmp2rtc_enable = false;
+    int rtmp2rtc_idle_timeout = 10;//seconds, the bridge of the stream stops when it has no webrtc viewer
     bool rtc2rtmp_enable = false;
     int min_kbps = 200;
     int max_kbps = 1500;
     int start_kbps = 800;
+    double pacing_factor = 2.5;//the subscribers are paced at the estimated bitrate × it, 0: no pacing
 };
 
 class RtmpRelayConfig
@@ -175,6 +187,20 @@ public:
         ss << "  enable: " << hls_enable << "\r\n";
         ss << "  mpegts duration: " << ts_duration << "\r\n";
         ss << "  hls path: " << hls_path << "\r\n";
+        ss << "  worker count: " << worker_count << "\r\n";
+        ss << "  http port: " << http_port << "\r\n";
+        ss << "  low latency: " << low_latency << "\r\n";
+        ss << "  part duration: " << part_duration << "\r\n";
+        ss << "  fmp4: " << fmp4 << "\r\n";
+        ss << "  dvr window: " << dvr_window << "\r\n";
+        ss << "  abr threads: " << abr_threads << "\r\n";
+        for (auto& item : abr_apps) {
+            ss << "  abr app: " << item.first << "\r\n";
+            for (const abr_rendition& rendition : item.second) {
+                ss << "    rendition: " << rendition.name << ", " << rendition.width << "x" << rendition.height
+                   << ", bitrate:" << rendition.bitrate << "kbps, framerate:" << rendition.framerate << "\r\n";
+            }
+        }
 
         return ss.str();
     }
@@ -183,6 +209,14 @@ public:
     bool hls_enable = false;
     int ts_duration = HLS_MPEGTS_DEF_DURATION;
     std::string hls_path = HLS_DEF_PATH;
+    size_t worker_count = HLS_DEF_WORKER_COUNT;
+    uint16_t http_port = 0;//0: the hls is not served by http
+    bool low_latency = false;
+    int part_duration = HLS_DEF_PART_DURATION;
+    bool fmp4 = false;
+    int dvr_window = HLS_DEF_DVR_WINDOW;//seconds of the time-shift window
+    size_t abr_threads = HLS_DEF_ABR_THREADS;
+    std::map<std::string, ABR_RENDITIONS> abr_apps;//app -> renditions, empty: no abr ladder
 };
 
 class HttpApiConfig
@@ -258,6 +292,14 @@ public:
     static bool hls_is_enable();
     static std::string hls_path();
     static int mpegts_duration();
+    static size_t hls_worker_count();
+    static uint16_t hls_http_port();
+    static bool hls_low_latency();
+    static int hls_part_duration();
+    static bool hls_fmp4_enable();
+    static int hls_dvr_window();
+    static size_t hls_abr_threads();
+    static const std::map<std::string, ABR_RENDITIONS>& hls_abr_apps();
 
 public:
     static bool webrtc_is_enable();
@@ -266,12 +308,15 @@ public:
     static std::string tls_key();
     static std::string tls_cert();
     static uint16_t webrtc_udp_port();
+    static size_t webrtc_workers();
     static std::string candidate_ip();
     static bool rtmp2rtc_is_enable();
+    static int rtmp2rtc_idle_timeout();
     static bool rtc2rtmp_is_enable();
     static int min_kbps();
     static int max_kbps();
     static int start_kbps();
+    static double pacing_factor();
 
 public:
     static bool websocket_is_enable();
@@ -290,6 +335,7 @@ private:
     static int init_rtmp(json& json_object);
     static int init_httpflv(json& json_object);
     static int init_hls(json& json_object);
+    static int init_hls_abr(json& json_object);
     static int init_webrtc(json& json_object);
     static int init_websocket(json& json_object);
     static int init_httpapi(json& json_object);
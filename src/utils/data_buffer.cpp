@@ -49,7 +49,8 @@ data_buffer::~data_buffer() {
     }
 }
 
-static int get_new_size(int new_len) {
+//the large buffers grow geometrically, so appending to them costs amortized O(1)
+static int get_new_size(int new_len, size_t old_size) {
     int ret = new_len;
 
     if (new_len <= 50*1024) {
@@ -60,6 +61,8 @@ static int get_new_size(int new_len) {
         ret = 200*1024;
     } else if ((new_len > 200*1024) && (new_len <= 500*1024)) {
         ret = 500*1024;
+    } else if ((size_t)new_len < old_size * 2) {
+        ret = (int)(old_size * 2);
     } else {
         ret = new_len;
     }
@@ -67,43 +70,43 @@ static int get_new_size(int new_len) {
     return ret;
 }
 
+void data_buffer::reserve_tail(size_t len) {
+    if ((size_t)end_ + len <= (buffer_size_ - PRE_RESERVE_HEADER_SIZE)) {
+        return;
+    }
+
+    if (data_len_ + len >= (buffer_size_ - PRE_RESERVE_HEADER_SIZE)) {
+        int new_len = data_len_ + (int)len + EXTRA_LEN;
+
+        new_len = get_new_size(new_len, buffer_size_);
+        char* new_buffer = new char[new_len];
+        memcpy(new_buffer + PRE_RESERVE_HEADER_SIZE, buffer_ + start_, data_len_);
+        delete[] buffer_;
+        buffer_      = new_buffer;
+        buffer_size_ = new_len;
+        start_       = PRE_RESERVE_HEADER_SIZE;
+        end_         = start_ + data_len_;
+        return;
+    }
+
+    if (data_len_ >= start_) {
+        char* temp_p = new char[data_len_];
+        memcpy(temp_p, buffer_ + start_, data_len_);
+        memcpy(buffer_ + PRE_RESERVE_HEADER_SIZE, temp_p, data_len_);
+        delete[] temp_p;
+    } else {
+        memcpy(buffer_ + PRE_RESERVE_HEADER_SIZE, buffer_ + start_, data_len_);
+    }
+    start_ = PRE_RESERVE_HEADER_SIZE;
+    end_   = start_ + data_len_;
+}
+
 int data_buffer::append_data(const char* input_data, size_t input_len) {
     if ((input_data == nullptr) || (input_len == 0)) {
         return 0;
     }
 
-    if ((size_t)end_ + input_len > (buffer_size_ - PRE_RESERVE_HEADER_SIZE)) {
-        if (data_len_ + input_len >= (buffer_size_ - PRE_RESERVE_HEADER_SIZE)) {
-            int new_len = data_len_ + (int)input_len + EXTRA_LEN;
-            
-            new_len = get_new_size(new_len);
-            char* new_buffer = new char[new_len];
-            memcpy(new_buffer + PRE_RESERVE_HEADER_SIZE, buffer_ + start_, data_len_);
-            memcpy(new_buffer + PRE_RESERVE_HEADER_SIZE + data_len_, input_data, input_len);
-            delete[] buffer_;
-            buffer_      = new_buffer;
-            buffer_size_ = new_len;
-            data_len_    += input_len;
-            start_     = PRE_RESERVE_HEADER_SIZE;
-            end_       = start_ + data_len_;
-            return data_len_;
-        }
-        if (data_len_ >= start_) {
-            char* temp_p = new char[data_len_];
-            memcpy(temp_p, buffer_ + start_, data_len_);
-            memcpy(buffer_ + PRE_RESERVE_HEADER_SIZE, temp_p, data_len_);
-            delete[] temp_p;
-        } else {
-            memcpy(buffer_ + PRE_RESERVE_HEADER_SIZE, buffer_ + start_, data_len_);
-        }
-        
-        memcpy(buffer_ + PRE_RESERVE_HEADER_SIZE + data_len_, input_data, input_len);
-        
-        data_len_ += input_len;
-        start_     = PRE_RESERVE_HEADER_SIZE;
-        end_       = start_ + data_len_;
-        return data_len_;
-    }
+    reserve_tail(input_len);
 
     memcpy(buffer_ + end_, input_data, input_len);
     data_len_ += (int)input_len;
@@ -111,6 +114,15 @@ int data_buffer::append_data(const char* input_data, size_t input_len) {
     return data_len_;
 }
 
+char* data_buffer::append_space(size_t len) {
+    reserve_tail(len);
+
+    char* p = buffer_ + end_;
+    data_len_ += (int)len;
+    end_ += (int)len;
+    return p;
+}
+
 char* data_buffer::consume_data(int consume_len) {
     if (consume_len > data_len_) {
         log_errorf("consume_len:%lu, data_len_:%d", consume_len, data_len_);
@@ -23,6 +23,7 @@ public:
 
 public:
     int append_data(const char* input_data, size_t input_len);
+    char* append_space(size_t len);//return writable area of len bytes at the end
     char* consume_data(int consume_len);
     void reset();
 
@@ -35,6 +36,9 @@ public:
     std::string dst_ip_;
     uint16_t    dst_port_ = 0;
 
+private:
+    void reserve_tail(size_t len);
+
 private:
     char* buffer_       = nullptr;
     size_t buffer_size_ = 0;
@@ -0,0 +1,56 @@
+#ifndef FILE_MAPPING_HPP
+#define FILE_MAPPING_HPP
+#include <stdint.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <memory>
+
+//a read-only mapping of [offset, offset + len) in a file, the pages are kept until it's released
+class file_mapping
+{
+public:
+    file_mapping(void* addr, size_t map_len, const char* data, size_t len):addr_(addr)
+                                                                    , map_len_(map_len)
+                                                                    , data_(data)
+                                                                    , len_(len)
+    {
+    }
+    ~file_mapping()
+    {
+        if (addr_ && (addr_ != MAP_FAILED)) {
+            munmap(addr_, map_len_);
+        }
+    }
+
+    //the offset of mmap must be aligned to the page, the data starts inside the first page
+    static std::shared_ptr<file_mapping> map(int fd, int64_t offset, size_t len) {
+        static const int64_t page_size = (int64_t)sysconf(_SC_PAGESIZE);
+
+        if ((fd < 0) || (len == 0)) {
+            return nullptr;
+        }
+        int64_t map_offset = offset - (offset % page_size);
+        size_t delta = (size_t)(offset - map_offset);
+        size_t map_len = delta + len;
+
+        void* addr = mmap(nullptr, map_len, PROT_READ, MAP_SHARED, fd, (off_t)map_offset);
+        if (addr == MAP_FAILED) {
+            return nullptr;
+        }
+        madvise(addr, map_len, MADV_SEQUENTIAL);
+        return std::make_shared<file_mapping>(addr, map_len, (const char*)addr + delta, len);
+    }
+
+public:
+    const char* data() { return data_; }
+    size_t data_len() { return len_; }
+
+private:
+    void* addr_ = nullptr;
+    size_t map_len_ = 0;
+    const char* data_ = nullptr;
+    size_t len_ = 0;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef MPSC_RING_HPP
+#define MPSC_RING_HPP
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+#include <utility>
+
+/*
+bounded lock-free queue: many producers, one consumer.
+every cell carries a sequence number(D. Vyukov's bounded queue),
+producers claim a cell by cas on enqueue_pos_, the consumer owns dequeue_pos_.
+the capacity is rounded up to the power of 2.
+*/
+template <typename T>
+class mpsc_ring
+{
+public:
+    mpsc_ring(size_t capacity = 4096) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask_  = size - 1;
+        cells_ = std::vector<CELL>(size);
+        for (size_t i = 0; i < size; i++) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+    ~mpsc_ring() {
+    }
+
+public:
+    //return false when the ring is full
+    bool push(T item) {
+        CELL* cell = nullptr;
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->data = std::move(item);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    //only called by the consumer thread
+    bool pop(T& item) {
+        CELL* cell = &cells_[dequeue_pos_ & mask_];
+        size_t seq = cell->seq.load(std::memory_order_acquire);
+
+        if ((intptr_t)seq - (intptr_t)(dequeue_pos_ + 1) < 0) {
+            return false;
+        }
+        item = std::move(cell->data);
+        cell->data = T();
+        cell->seq.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+        dequeue_pos_++;
+        return true;
+    }
+
+    //only called by the consumer thread
+    bool empty() {
+        CELL* cell = &cells_[dequeue_pos_ & mask_];
+        size_t seq = cell->seq.load(std::memory_order_acquire);
+
+        return ((intptr_t)seq - (intptr_t)(dequeue_pos_ + 1) < 0);
+    }
+
+    size_t capacity() { return mask_ + 1; }
+
+private:
+    struct CELL
+    {
+        CELL() {}
+        CELL(const CELL& cell):data(cell.data) {
+            seq.store(cell.seq.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+private:
+    std::vector<CELL> cells_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> enqueue_pos_{0};
+    alignas(64) size_t dequeue_pos_ = 0;
+};
+
+#endif //MPSC_RING_HPP
@@ -0,0 +1,68 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#define SPSC_CACHE_LINE_SIZE 64
+
+/*
+a bounded lock-free ring for one producer thread and one consumer thread.
+the size is rounded up to a power of 2, the push fails when the ring is full.
+the head and the tail are in different cache lines, each thread only writes its own.
+*/
+template <class T>
+class spsc_queue
+{
+public:
+    spsc_queue(size_t size) {
+        size_t capacity = 2;
+        while (capacity < size) {
+            capacity <<= 1;
+        }
+        items_.resize(capacity);
+        mask_ = capacity - 1;
+    }
+    ~spsc_queue() {
+    }
+
+public:
+    //called in the producer thread
+    bool push(const T& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+
+        if (tail - head_.load(std::memory_order_acquire) > mask_) {
+            return false;
+        }
+        items_[tail & mask_] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    //called in the consumer thread
+    bool pop(T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        //moved out, the slot doesn't keep the item alive
+        item = std::move(items_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> items_;
+    size_t mask_ = 0;
+    alignas(SPSC_CACHE_LINE_SIZE) std::atomic<size_t> head_{0};
+    alignas(SPSC_CACHE_LINE_SIZE) std::atomic<size_t> tail_{0};
+};
+
+#endif
@@ -3,56 +3,229 @@
 #include "logger.hpp"
 #include <uv.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include <unordered_map>
 
+#define TIMER_WHEEL_TICK_MS   10
+#define TIMER_WHEEL_SLOT_BITS 9
+#define TIMER_WHEEL_SLOTS     (1 << TIMER_WHEEL_SLOT_BITS)//5.12s in one round
+#define TIMER_WHEEL_SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+
+class timer_wheel;
+class timer_interface;
 inline void on_uv_timer_callback(uv_timer_t *handle);
+inline timer_wheel* get_timer_wheel(uv_loop_t* loop);
 
-class timer_interface
+//the node of the timer in the intrusive list of the wheel slot
+class timer_node
 {
 public:
-    timer_interface(uv_loop_t* loop, uint32_t timeout_ms):timeout_ms_(timeout_ms)
-    {
-        uv_timer_init(loop, &timer_);
-        timer_.data = this;
+    timer_node* prev = this;
+    timer_node* next = this;
+    timer_interface* owner = nullptr;
+
+public:
+    bool linked() { return next != this; }
 
-        
+    void link_before(timer_node* node) {
+        prev = node->prev;
+        next = node;
+        node->prev->next = this;
+        node->prev = this;
     }
 
-    virtual ~timer_interface() {
-        log_infof("timer base destruct...");
-        stop_timer();
+    void unlink() {
+        prev->next = next;
+        next->prev = prev;
+        prev = this;
+        next = this;
     }
+};
+
+class timer_interface
+{
+friend class timer_wheel;
+public:
+    timer_interface(uv_loop_t* loop, uint32_t timeout_ms);
+    virtual ~timer_interface();
 
 public:
     virtual void on_timer() = 0;
 
 public:
-    void start_timer() {
-        if(running_) {
-            return;
+    void start_timer();
+    void stop_timer();
+
+private:
+    timer_node node_;
+    timer_wheel* wheel_ = nullptr;
+    uint32_t timeout_ms_;
+    uint32_t ticks_  = 1;
+    uint32_t rounds_ = 0;//the left rounds of the wheel before it expires
+    bool running_ = false;
+};
+
+/*
+the hashed timing wheel of one uv loop, all the timer_interface objects of
+the loop share it instead of arming their own uv timers.
+the slot of a timer is its expiring tick modulo the slot count, a timer
+over one round of the wheel waits for its rounds, so arming and canceling are O(1).
+one uv timer ticks the wheel, all the timers expiring in a tick are dispatched
+in a batch. it runs only when the wheel has timers, like the uv timers it replaces.
+after a stall of the loop, a timer fires once for all its missed periods, like a uv timer.
+it's only used in the thread of its loop.
+*/
+class timer_wheel
+{
+public:
+    timer_wheel(uv_loop_t* loop):loop_(loop)
+    {
+        uv_timer_init(loop_, &tick_timer_);
+        tick_timer_.data = this;
+    }
+    ~timer_wheel() {
+    }
+
+public:
+    void add(timer_interface* timer) {
+        uint32_t ticks = timer->ticks_;
+        uint64_t expire_tick = current_tick_ + ticks;
+
+        timer->rounds_ = (ticks - 1) >> TIMER_WHEEL_SLOT_BITS;
+        timer->node_.link_before(&slots_[expire_tick & TIMER_WHEEL_SLOT_MASK]);
+    }
+
+    void arm(timer_interface* timer) {
+        if (timer_count_++ == 0) {
+            //the ticks restart from now
+            last_tick_ms_ = uv_now(loop_);
+            uv_timer_start(&tick_timer_, on_uv_timer_callback, TIMER_WHEEL_TICK_MS, TIMER_WHEEL_TICK_MS);
+        }
+        add(timer);
+    }
+
+    void cancel(timer_interface* timer) {
+        timer->node_.unlink();
+        if (--timer_count_ == 0) {
+            uv_timer_stop(&tick_timer_);
+        }
+    }
+
+    size_t timer_count() { return timer_count_; }
+
+    void on_tick() {
+        uint64_t now_ms = uv_now(loop_);
+
+        //the ticks missed by a busy loop are passed, the expired timers are
+        //collected without being rearmed, so each one fires once in the tick
+        while ((timer_count_ > 0) && (now_ms - last_tick_ms_ >= TIMER_WHEEL_TICK_MS)) {
+            last_tick_ms_ += TIMER_WHEEL_TICK_MS;
+            current_tick_++;
+            collect(&slots_[current_tick_ & TIMER_WHEEL_SLOT_MASK]);
+        }
+        dispatch();
+        if (timer_count_ == 0) {
+            uv_timer_stop(&tick_timer_);
         }
-        running_ = true;
-        uv_timer_start(&timer_, on_uv_timer_callback, timeout_ms_, timeout_ms_);
     }
 
-    void stop_timer() {
-        if (!running_) {
+private:
+    void collect(timer_node* slot) {
+        if (!slot->linked()) {
             return;
         }
-        running_ = false;
-        uv_timer_stop(&timer_);
+        //the slot is moved to the collect list, the timers waiting for their rounds go back
+        collect_list_.link_before(slot);
+        slot->unlink();
+
+        while (collect_list_.linked()) {
+            timer_interface* timer = collect_list_.next->owner;
+
+            timer->node_.unlink();
+            if (timer->rounds_ > 0) {
+                timer->rounds_--;
+                timer->node_.link_before(slot);
+                continue;
+            }
+            timer->node_.link_before(&dispatch_list_);
+        }
+    }
+
+    //the timers armed in the callbacks and the timers removed by the callbacks
+    //don't break the walk of the dispatch list
+    void dispatch() {
+        while (dispatch_list_.linked()) {
+            timer_interface* timer = dispatch_list_.next->owner;
+
+            timer->node_.unlink();
+            //it's rearmed from the current tick before the callback which may stop or delete it
+            add(timer);
+            timer->on_timer();
+        }
     }
 
 private:
-    uv_timer_t timer_;
-    uint32_t timeout_ms_;
-    bool running_ = false;
+    uv_loop_t* loop_ = nullptr;
+    uv_timer_t tick_timer_;
+    uint64_t last_tick_ms_ = 0;
+    uint64_t current_tick_ = 0;
+    size_t timer_count_    = 0;
+    timer_node slots_[TIMER_WHEEL_SLOTS];
+    timer_node collect_list_;
+    timer_node dispatch_list_;
 };
 
+inline timer_wheel* get_timer_wheel(uv_loop_t* loop) {
+    static std::mutex s_mutex;
+    static std::unordered_map<uv_loop_t*, timer_wheel*> s_wheels;//the wheels live as long as the process
+
+    std::lock_guard<std::mutex> locker(s_mutex);
+    auto iter = s_wheels.find(loop);
+    if (iter != s_wheels.end()) {
+        return iter->second;
+    }
+    timer_wheel* wheel = new timer_wheel(loop);
+    s_wheels[loop] = wheel;
+    return wheel;
+}
+
+inline timer_interface::timer_interface(uv_loop_t* loop, uint32_t timeout_ms):timeout_ms_(timeout_ms)
+{
+    node_.owner = this;
+    wheel_ = get_timer_wheel(loop);
+    ticks_ = (timeout_ms_ + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS;
+    if (ticks_ == 0) {
+        ticks_ = 1;
+    }
+}
+
+inline timer_interface::~timer_interface() {
+    log_infof("timer base destruct...");
+    stop_timer();
+}
+
+inline void timer_interface::start_timer() {
+    if(running_) {
+        return;
+    }
+    running_ = true;
+    wheel_->arm(this);
+}
+
+inline void timer_interface::stop_timer() {
+    if (!running_) {
+        return;
+    }
+    running_ = false;
+    wheel_->cancel(this);
+}
+
 inline void on_uv_timer_callback(uv_timer_t *handle) {
-    timer_interface* timer = (timer_interface*)handle->data;
-    if (timer) {
-        timer->on_timer();
+    timer_wheel* wheel = (timer_wheel*)handle->data;
+    if (wheel) {
+        wheel->on_tick();
     }
 }
 
-#endif
\ No newline at end of file
+#endif
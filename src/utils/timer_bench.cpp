@@ -0,0 +1,147 @@
+#include "timer.hpp"
+#include "logger.hpp"
+#include <uv.h>
+#include <vector>
+#include <memory>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+timer benchmark:
+    timer_bench [timer count] [seconds]
+the timers have the periods of the rtc objects: 50ms(subscriber), 100ms(jitter
+buffer and pack handle), 500ms(session and publisher) and 2000ms(room).
+they run in one loop with the uv timer per object and with the timer wheel,
+the cpu time of the loop per timer fire is printed for both.
+the arming and canceling of all the timers are measured too.
+*/
+
+static const uint32_t s_periods[] = {50, 100, 500, 2000};
+
+static int64_t get_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int64_t get_cpu_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int64_t s_fire_count = 0;
+
+//the timer of every object before the wheel
+class uv_bench_timer
+{
+public:
+    uv_bench_timer(uv_loop_t* loop, uint32_t timeout_ms):timeout_ms_(timeout_ms) {
+        timer_ = new uv_timer_t;
+        uv_timer_init(loop, timer_);
+        timer_->data = this;
+    }
+    ~uv_bench_timer() {
+        //the handle is released in the close callback
+        uv_close((uv_handle_t*)timer_, on_uv_bench_close);
+    }
+
+public:
+    void start_timer() {
+        uv_timer_start(timer_, on_uv_bench_timer, timeout_ms_, timeout_ms_);
+    }
+    void stop_timer() {
+        uv_timer_stop(timer_);
+    }
+    static void on_uv_bench_timer(uv_timer_t* handle) {
+        s_fire_count++;
+    }
+    static void on_uv_bench_close(uv_handle_t* handle) {
+        delete (uv_timer_t*)handle;
+    }
+
+private:
+    uv_timer_t* timer_ = nullptr;
+    uint32_t timeout_ms_;
+};
+
+class wheel_bench_timer : public timer_interface
+{
+public:
+    wheel_bench_timer(uv_loop_t* loop, uint32_t timeout_ms):timer_interface(loop, timeout_ms) {
+    }
+    virtual ~wheel_bench_timer() {
+    }
+
+public:
+    virtual void on_timer() override {
+        s_fire_count++;
+    }
+};
+
+static void on_stop_timer(uv_timer_t* handle) {
+    uv_stop(handle->loop);
+}
+
+static void run_loop(uv_loop_t* loop, int seconds) {
+    uv_timer_t stop_timer;
+
+    uv_timer_init(loop, &stop_timer);
+    uv_timer_start(&stop_timer, on_stop_timer, (uint64_t)seconds * 1000, 0);
+    uv_run(loop, UV_RUN_DEFAULT);
+    uv_close((uv_handle_t*)&stop_timer, nullptr);
+    uv_run(loop, UV_RUN_NOWAIT);
+}
+
+template <class T>
+static void bench_timers(const char* name, uv_loop_t* loop, size_t count, int seconds) {
+    std::vector<std::unique_ptr<T>> timers;
+    size_t period_count = sizeof(s_periods) / sizeof(s_periods[0]);
+
+    timers.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        timers.emplace_back(new T(loop, s_periods[i % period_count]));
+    }
+
+    int64_t start = get_now_ns();
+    for (auto& timer : timers) {
+        timer->start_timer();
+    }
+    int64_t arm_ns = get_now_ns() - start;
+
+    s_fire_count = 0;
+    int64_t cpu_start = get_cpu_ns();
+    run_loop(loop, seconds);
+    int64_t cpu_ns = get_cpu_ns() - cpu_start;
+
+    start = get_now_ns();
+    for (auto& timer : timers) {
+        timer->stop_timer();
+    }
+    int64_t cancel_ns = get_now_ns() - start;
+
+    printf("%s: timers:%lu, fires:%ld(%ld/s), loop cpu:%ldms, %.1f ns/fire, arm:%.1f ns, cancel:%.1f ns\r\n",
+        name, count, s_fire_count, s_fire_count / seconds, cpu_ns / 1000000,
+        s_fire_count ? (double)cpu_ns / s_fire_count : 0.0,
+        (double)arm_ns / count, (double)cancel_ns / count);
+}
+
+int main(int argn, char** argv) {
+    size_t count = 100000;
+    int seconds = 5;
+
+    if (argn > 1) {
+        count = (size_t)atol(argv[1]);
+    }
+    if (argn > 2) {
+        seconds = atoi(argv[2]);
+    }
+    Logger::get_instance()->set_level(LOGGER_ERROR_LEVEL);
+
+    uv_loop_t* loop = uv_default_loop();
+
+    bench_timers<uv_bench_timer>("uv timer per object", loop, count, seconds);
+    uv_run(loop, UV_RUN_NOWAIT);//close the uv timers
+    bench_timers<wheel_bench_timer>("timer wheel", loop, count, seconds);
+    return 0;
+}